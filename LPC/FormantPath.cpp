@@ -22,10 +22,12 @@
 #include "Graphics_extensions.h"
 #include "LPC_and_Formant.h"
 #include "Matrix.h"
+#include "MelderThread.h"
 #include "Sound_to_Formant.h"
 #include "Sound_and_LPC.h"
 #include "Sound.h"
 #include "Sound_and_LPC_robust.h"
+#include "Sound_extensions.h"
 
 #include "oo_DESTROY.h"
 #include "FormantPath_def.h"
@@ -219,6 +221,39 @@ autoFormant FormantPath_extractFormant (FormantPath me) {
 	return thee;
 }
 
+/*
+	Sound_to_FormantPath_any () analyses the sound at every ceiling, resampled to twice that ceiling,
+	exactly as Sound_to_LPC (), LPC_Sound_to_LPC_robust () and LPC_to_Formant () would,
+	but all ceilings share a single pass over the frames:
+	- every resampled sound is pre-emphasized once, for both the LPC and the robust analysis;
+	- the LPC, the robust LPC and the formants of a frame are computed in one go,
+	  while the windowed frame is still in the cache;
+	- the frames of all ceilings are handed out to the threads together.
+	To keep the memory bounded for long sounds, the ceilings are taken in groups
+	whose resampled sounds together fit in `maximumNumberOfSamplesInMemory`.
+*/
+struct FormantPath_Ceiling {
+	autoSound sound;   // resampled and pre-emphasized
+	autoSound original;   // resampled only, for the sources
+	autoSound window, robustWindow;
+	double windowDuration, robustWindowDuration;
+	autoLPC lpc;
+	autoFormant formant;
+};
+
+struct FormantPath_CeilingWorkspace {
+	autoSound sframe, robustSframe;
+	autoVEC lpcWorkspace, lpcFrom;
+	struct huber_struct huber;
+};
+
+struct FormantPath_Workspace {
+	std::vector <FormantPath_CeilingWorkspace> ceilings;
+	autoPolynomial polynomial;
+	autoRoots roots;
+	autoVEC rootsWorkspace;
+};
+
 autoFormantPath Sound_to_FormantPath_any (Sound me, kLPC_Analysis lpcType, double timeStep, double maximumNumberOfFormants,
 	double middleCeiling, double analysisWidth, double preemphasisFrequency, double ceilingStepSize, 
 	integer numberOfStepsToACeiling, double marple_tol1, double marple_tol2, double huber_numberOfStdDev, double huber_tol,
@@ -230,6 +265,7 @@ autoFormantPath Sound_to_FormantPath_any (Sound me, kLPC_Analysis lpcType, doubl
 			U"The ceiling step size should larger than 0.0.");
 		const double nyquistFrequency = 0.5 / my dx;
 		const integer numberOfCeilings = 2 * numberOfStepsToACeiling + 1;
+		const integer middleCeilingNumber = numberOfStepsToACeiling + 1;
 		const double maximumCeiling = middleCeiling *  exp (ceilingStepSize * numberOfStepsToACeiling);
 		Melder_require (maximumCeiling <= nyquistFrequency,
 			U"The maximum ceiling should be smaller than ", nyquistFrequency, U" Hz. "
@@ -251,41 +287,161 @@ autoFormantPath Sound_to_FormantPath_any (Sound me, kLPC_Analysis lpcType, doubl
 		if (out_sourcesMultiChannel)
 			multiChannelSound = Sound_create (numberOfCeilings, midCeiling -> xmin, midCeiling -> xmax, midCeiling -> nx, midCeiling -> dx, midCeiling -> x1);
 		const double formantSafetyMargin = 50.0;
-		thy ceilings [numberOfStepsToACeiling + 1] = middleCeiling;
-		for (integer ic  = 1; ic <= numberOfCeilings; ic ++) {
-			autoFormant formant;
+		thy ceilings [middleCeilingNumber] = middleCeiling;
+		for (integer ic = 1; ic <= numberOfCeilings; ic ++) {
 			if (ic <= numberOfStepsToACeiling)
 				thy ceilings [ic] = middleCeiling * exp (-ceilingStepSize * (numberOfStepsToACeiling - ic + 1));
-			else if (ic > numberOfStepsToACeiling + 1)
+			else if (ic > middleCeilingNumber)
 				thy ceilings [ic] = middleCeiling * exp ( ceilingStepSize * (ic - numberOfStepsToACeiling - 1));
-			autoSound resampled;
-			if (ic != numberOfStepsToACeiling + 1)
-				resampled = Sound_resample (me, 2.0 * thy ceilings [ic], 50);
-			else 
-				resampled = midCeiling.move();
-			autoLPC lpc = LPC_create (my xmin, my xmax, numberOfFrames, timeStep, t1, predictionOrder, resampled -> dx);
-			if (lpcType != kLPC_Analysis::ROBUST) {
-				Sound_into_LPC (resampled.get(), lpc.get(), analysisWidth, preemphasisFrequency, lpcType, marple_tol1, marple_tol2);
-			} else {
-				Sound_into_LPC (resampled.get(), lpc.get(), analysisWidth, preemphasisFrequency, kLPC_Analysis::AUTOCORRELATION, marple_tol1, marple_tol2);
-				lpc = LPC_Sound_to_LPC_robust (lpc.get(), resampled.get(), analysisWidth, preemphasisFrequency, huber_numberOfStdDev, huber_maximumNumberOfIterations, huber_tol, true);
+		}
+		const bool robust = ( lpcType == kLPC_Analysis::ROBUST );
+		const kLPC_Analysis lpcMethod = ( robust ? kLPC_Analysis::AUTOCORRELATION : lpcType );
+		const double robustWindowDuration = 2.0 * analysisWidth;   // not shortened, as in LPC_Sound_to_LPC_robust ()
+		const integer maximumNumberOfFormantsPerFrame = (predictionOrder + 1) / 2;   // as in LPC_to_Formant () if the margin is not zero
+		const integer maximumNumberOfSamplesInMemory = 50'000'000;
+		/*
+			Each ceiling of a group holds a resampled sound, and for the sources also an unfiltered copy of it.
+		*/
+		const double numberOfSoundsPerCeiling = ( out_sourcesMultiChannel ? 2.0 : 1.0 );
+		autoMelderProgress progress (U"FormantPath analysis");
+		integer numberOfFrameErrors = 0, numberOfSuspectFrames = 0;
+		integer lastCeilingNumber;
+		for (integer firstCeilingNumber = 1; firstCeilingNumber <= numberOfCeilings; firstCeilingNumber = lastCeilingNumber + 1) {
+			lastCeilingNumber = firstCeilingNumber;
+			double numberOfSamplesInGroup = numberOfSoundsPerCeiling * my nx * 2.0 * thy ceilings [firstCeilingNumber] * my dx;
+			while (lastCeilingNumber < numberOfCeilings) {
+				numberOfSamplesInGroup += numberOfSoundsPerCeiling * my nx * 2.0 * thy ceilings [lastCeilingNumber + 1] * my dx;
+				if (numberOfSamplesInGroup > maximumNumberOfSamplesInMemory)
+					break;
+				lastCeilingNumber ++;
 			}
-			formant = LPC_to_Formant (lpc.get(), formantSafetyMargin);
-			thy formants . addItem_move (formant.move());
-			if (out_sourcesMultiChannel) {
-				autoSound source = LPC_Sound_filterInverse (lpc.get(), resampled.get ());
-				autoSound source_resampled = Sound_resample (source.get(), 2.0 * middleCeiling, 50);
-				const integer numberOfSamples = std::min (midCeiling -> nx, source_resampled -> nx);
-				multiChannelSound -> z.row (ic).part (1, numberOfSamples) <<= source_resampled -> z.row (1).part (1, numberOfSamples);
+			const integer numberOfCeilingsInGroup = lastCeilingNumber - firstCeilingNumber + 1;
+			std::vector <FormantPath_Ceiling> ceilings (integer_to_uinteger (numberOfCeilingsInGroup));
+			for (integer ic = firstCeilingNumber; ic <= lastCeilingNumber; ic ++) {
+				FormantPath_Ceiling& ceiling = ceilings [integer_to_uinteger (ic - firstCeilingNumber)];
+				if (ic == middleCeilingNumber)
+					ceiling.sound = midCeiling.move();
+				else
+					ceiling.sound = Sound_resample (me, 2.0 * thy ceilings [ic], 50);
+				const Sound resampled = ceiling.sound.get();
+				const double samplingFrequency = 1.0 / resampled -> dx;
+				/*
+					The checks of Sound_into_LPC (), LPC_Sound_to_LPC_robust () and LPC_to_Formant ().
+				*/
+				Melder_require (Melder_roundDown (2.0 * analysisWidth / resampled -> dx) > predictionOrder,
+					U"Analysis window duration too short.\n For a prediction order of ", predictionOrder,
+					U" the analysis window duration should be greater than ", resampled -> dx * (predictionOrder + 1),
+					U" s. Please increase the analysis window duration.");
+				Melder_require (predictionOrder < 100,
+					U"We cannot find the roots of a polynomial of order > 99.");
+				Melder_require (formantSafetyMargin < samplingFrequency / 4.0,
+					U"Margin should be smaller than ", samplingFrequency / 4.0, U".");
+				if (out_sourcesMultiChannel)
+					ceiling.original = Data_copy (resampled);
+				Sound_preEmphasis (resampled, preemphasisFrequency);
+				ceiling.windowDuration = std::min (2.0 * analysisWidth, resampled -> dx * resampled -> nx);
+				ceiling.window = Sound_createGaussian (ceiling.windowDuration, samplingFrequency);
+				if (robust) {
+					ceiling.robustWindowDuration = robustWindowDuration;
+					if (ceiling.robustWindowDuration != ceiling.windowDuration)
+						ceiling.robustWindow = Sound_createGaussian (ceiling.robustWindowDuration, samplingFrequency);
+				}
+				ceiling.lpc = LPC_create (my xmin, my xmax, numberOfFrames, timeStep, t1, predictionOrder, resampled -> dx);
+				for (integer iframe = 1; iframe <= numberOfFrames; iframe ++)
+					LPC_Frame_init (& ceiling.lpc -> d_frames [iframe], predictionOrder);
+				ceiling.formant = Formant_create (my xmin, my xmax, numberOfFrames, timeStep, t1, maximumNumberOfFormantsPerFrame);
+				for (integer iframe = 1; iframe <= numberOfFrames; iframe ++)
+					Formant_Frame_init (& ceiling.formant -> frames [iframe], maximumNumberOfFormantsPerFrame);
+			}
+			/*
+				The frames are numbered ceiling by ceiling.
+				The robust analysis needs many more operations than the others,
+				and the number of iterations differs between frames, so its chunks are smaller.
+				The workspaces are initialized on the calling thread, so that SVD_create
+				sets up the LAPACK machine constants before any thread runs an SVD.
+			*/
+			std::atomic <integer> frameErrorCount (0), suspectFrameCount (0);
+			MelderThread_runFrames <FormantPath_Workspace> (numberOfCeilingsInGroup * numberOfFrames, ( robust ? 5 : 25 ),
+				[&] (FormantPath_Workspace& workspace) {
+					workspace.ceilings.resize (integer_to_uinteger (numberOfCeilingsInGroup));
+					for (integer icg = 1; icg <= numberOfCeilingsInGroup; icg ++) {
+						const FormantPath_Ceiling& ceiling = ceilings [integer_to_uinteger (icg - 1)];
+						FormantPath_CeilingWorkspace& ceilingWorkspace = workspace.ceilings [integer_to_uinteger (icg - 1)];
+						const double samplingFrequency = 1.0 / ceiling.sound -> dx;
+						ceilingWorkspace.sframe = Sound_createSimple (1, ceiling.windowDuration, samplingFrequency);
+						ceilingWorkspace.lpcWorkspace = Sound_into_LPC_Frame_createWorkspace (ceilingWorkspace.sframe -> nx, predictionOrder, lpcMethod);
+						if (robust) {
+							if (ceiling.robustWindow)
+								ceilingWorkspace.robustSframe = Sound_createSimple (1, ceiling.robustWindowDuration, samplingFrequency);
+							const integer numberOfSamples = ( ceiling.robustWindow ? ceiling.robustWindow : ceiling.window ) -> nx;
+							const double location = 0.0;
+							huber_struct_init (& ceilingWorkspace.huber, numberOfSamples, predictionOrder, location, true);
+							ceilingWorkspace.huber.k_stdev = huber_numberOfStdDev;
+							ceilingWorkspace.huber.tol = huber_tol;
+							ceilingWorkspace.huber.tol_svd = 0.000001;
+							ceilingWorkspace.huber.itermax = huber_maximumNumberOfIterations;
+							ceilingWorkspace.lpcFrom = raw_VEC (predictionOrder);
+						}
+					}
+					workspace.polynomial = Polynomial_create (-1.0, 1.0, predictionOrder);
+					workspace.roots = Roots_create (predictionOrder);
+					workspace.rootsWorkspace = raw_VEC ((predictionOrder + 1) * (predictionOrder + 10));
+				},
+				[&] (FormantPath_Workspace& workspace, integer iitem) {
+					const integer icg = (iitem - 1) / numberOfFrames + 1, iframe = (iitem - 1) % numberOfFrames + 1;
+					const FormantPath_Ceiling& ceiling = ceilings [integer_to_uinteger (icg - 1)];
+					FormantPath_CeilingWorkspace& ceilingWorkspace = workspace.ceilings [integer_to_uinteger (icg - 1)];
+					const LPC_Frame lpcFrame = & ceiling.lpc -> d_frames [iframe];
+					const double t = Sampled_indexToX (ceiling.lpc.get(), iframe);
+					const Sound sframe = ceilingWorkspace.sframe.get();
+					Sound_into_Sound (ceiling.sound.get(), sframe, t - 0.5 * ceiling.windowDuration);
+					Vector_subtractMean (sframe);
+					Sounds_multiply (sframe, ceiling.window.get());
+					(void) Sound_into_LPC_Frame (sframe, lpcFrame, lpcMethod, marple_tol1, marple_tol2, ceilingWorkspace.lpcWorkspace.get());
+					if (robust) {
+						Sound robustSframe = sframe;
+						if (ceiling.robustWindow) {
+							robustSframe = ceilingWorkspace.robustSframe.get();
+							Sound_into_Sound (ceiling.sound.get(), robustSframe, t - 0.5 * ceiling.robustWindowDuration);
+							Vector_subtractMean (robustSframe);
+							Sounds_multiply (robustSframe, ceiling.robustWindow.get());
+						}
+						VEC lpcFrom = ceilingWorkspace.lpcFrom.part (1, lpcFrame -> nCoefficients);
+						lpcFrom  <<=  lpcFrame -> a.all();
+						if (! huber_struct_minimize (& ceilingWorkspace.huber, robustSframe -> z.row (1), lpcFrom, lpcFrame -> a.get()))
+							frameErrorCount ++;
+					}
+					if (! LPC_Frame_into_Formant_Frame_mt (lpcFrame, & ceiling.formant -> frames [iframe], ceiling.sound -> dx, formantSafetyMargin,
+						workspace.polynomial.get(), workspace.roots.get(), workspace.rootsWorkspace.get()))
+						suspectFrameCount ++;
+				}, U"FormantPath analysis"
+			);
+			numberOfFrameErrors += frameErrorCount;
+			numberOfSuspectFrames += suspectFrameCount;
+			for (integer ic = firstCeilingNumber; ic <= lastCeilingNumber; ic ++) {
+				FormantPath_Ceiling& ceiling = ceilings [integer_to_uinteger (ic - firstCeilingNumber)];
+				Formant_sort (ceiling.formant.get());
+				thy formants . addItem_move (ceiling.formant.move());
+				if (out_sourcesMultiChannel) {
+					autoSound source = LPC_Sound_filterInverse (ceiling.lpc.get(), ceiling.original.get());
+					autoSound source_resampled = Sound_resample (source.get(), 2.0 * middleCeiling, 50);
+					const integer numberOfSamples = std::min (multiChannelSound -> nx, source_resampled -> nx);
+					multiChannelSound -> z.row (ic).part (1, numberOfSamples) <<= source_resampled -> z.row (1).part (1, numberOfSamples);
+				}
 			}
 		}
+		if (numberOfFrameErrors > 0)
+			Melder_warning (U"Results of ", numberOfFrameErrors, U" frame(s) out of ", numberOfCeilings * numberOfFrames,
+				U" could not be optimised.");
+		if (numberOfSuspectFrames > 0)
+			Melder_warning (numberOfSuspectFrames, U" formant frames out of ", numberOfCeilings * numberOfFrames, U" are suspect.");
 		/*
 			Maintain invariants
 		*/
 		Melder_assert (thy formants . size == numberOfCeilings);
 		thy path = raw_INTVEC (thy nx);
 		for (integer i = 1; i <= thy path.size; i++)
-			thy path [i] = numberOfStepsToACeiling + 1;
+			thy path [i] = middleCeilingNumber;
 		if (out_sourcesMultiChannel)
 			*out_sourcesMultiChannel = multiChannelSound.move();
 		return thee;
@@ -25,9 +25,7 @@
 #include "LPC_and_Formant.h"
 #include "LPC_and_Polynomial.h"
 #include "NUM2.h"
-#include <thread>
-#include <atomic>
-#include <vector>
+#include "MelderThread.h"
 
 void Formant_Frame_init (Formant_Frame me, integer numberOfFormants) {
 	if (numberOfFormants > 0)
@@ -78,74 +76,30 @@ void LPC_Frame_into_Formant_Frame (LPC_Frame me, Formant_Frame thee, double samp
 	Roots_into_Formant_Frame (r.get(), thee, 1.0 / samplingPeriod, margin);
 }
 
-void LPC_Frame_into_Formant_Frame_mt (LPC_Frame me, Formant_Frame thee, double samplingPeriod, double margin, Polynomial p, Roots r, VEC const& workspace) {
+bool LPC_Frame_into_Formant_Frame_mt (LPC_Frame me, Formant_Frame thee, double samplingPeriod, double margin, Polynomial p, Roots r, VEC const& workspace) {
 	Melder_assert (my nCoefficients == my a.size); // check invariant
 	thy intensity = my gain;
 	if (my nCoefficients == 0) {
 		thy formant.resize (0);
 		thy numberOfFormants = thy formant.size; // maintain invariant
-		return;
+		return true;
 	}
 	LPC_Frame_into_Polynomial (me, p);
-	Polynomial_into_Roots (p, r, workspace);
+	if (! Polynomial_into_Roots (p, r, workspace))
+		return false;
 	Roots_fixIntoUnitCircle (r);
 	Roots_into_Formant_Frame (r, thee, 1.0 / samplingPeriod, margin);
+	return true;
 }
 
-autoFormant LPC_to_Formant_noThreads (LPC me, double margin) {
-	try {
-		const double samplingFrequency = 1.0 / my samplingPeriod;
-		/*
-			In very extreme case all roots of the lpc polynomial might be real.
-			A real root gives either a frequency at 0 Hz or at the Nyquist frequency.
-			If margin > 0 these frequencies are filtered out and the number of formants can never exceed
-			my maxnCoefficients / 2.
-		*/
-		const integer maximumNumberOfFormants = ( margin == 0.0 ? my maxnCoefficients : (my maxnCoefficients + 1) / 2 );
-		const integer maximumNumberOfPolynomialCoefficients = my maxnCoefficients + 1;
-		integer numberOfSuspectFrames = 0;
-		const integer interval = ( my maxnCoefficients > 20 ? 1 : 10 );
-		Melder_require (my maxnCoefficients < 100,
-			U"We cannot find the roots of a polynomial of order > 99.");
-		Melder_require (margin < samplingFrequency / 4.0,
-			U"Margin should be smaller than ", samplingFrequency / 4.0, U".");
-		autoFormant thee = Formant_create (my xmin, my xmax, my nx, my dx, my x1, maximumNumberOfFormants);
-		autoPolynomial polynomial = Polynomial_create (-1.0, 1.0, my maxnCoefficients);
-		autoRoots roots = Roots_create (my maxnCoefficients);
-		autoVEC workspace = raw_VEC (maximumNumberOfPolynomialCoefficients * (maximumNumberOfPolynomialCoefficients + 9));
-		autoMelderProgress progress (U"LPC to Formant");
-		for (integer iframe = 1; iframe <= my nx; iframe ++) {
-			const LPC_Frame lpcFrame = & my d_frames [iframe];
-			const Formant_Frame formantFrame = & thy frames [iframe];
-			Formant_Frame_init (formantFrame, maximumNumberOfFormants);
-			try {
-				LPC_Frame_into_Formant_Frame_mt (lpcFrame, formantFrame, my samplingPeriod, margin, polynomial.get(), roots.get(), workspace.get());
-				//LPC_Frame_into_Formant_Frame (lpcFrame, formant, my samplingPeriod, margin);
-			} catch (MelderError) {
-				Melder_clearError();
-				numberOfSuspectFrames ++;
-			}
-			if (interval == 1 || iframe % interval == 1)
-				Melder_progress ((double) iframe / my nx, U"LPC to Formant: frame ", iframe, U" out of ", my nx, U".");
-		}
-		Formant_sort (thee.get());
-		if (numberOfSuspectFrames > 0)
-			Melder_warning (numberOfSuspectFrames, U" formant frames out of ", my nx, U" are suspect.");
-		return thee;
-	} catch (MelderError) {
-		Melder_throw (me, U": no Formant created.");
-	}
-}
+struct LPC_to_Formant_Workspace {
+	autoPolynomial polynomial;
+	autoRoots roots;
+	autoVEC workspace;
+};
 
 autoFormant LPC_to_Formant (LPC me, double margin) {
 	try {
-		const integer numberOfProcessors = std::thread::hardware_concurrency ();
-		if (numberOfProcessors  <= 1) {
-			/*
-				We cannot use multithreading.
-			*/
-			return LPC_to_Formant_noThreads (me, margin);
-		}
 		const double samplingFrequency = 1.0 / my samplingPeriod;
 		Melder_require (my maxnCoefficients < 100,
 			U"We cannot find the roots of a polynomial of order > 99.");
@@ -168,56 +122,26 @@ autoFormant LPC_to_Formant (LPC me, double margin) {
 			const Formant_Frame formantFrame = & thy frames [iframe];
 			Formant_Frame_init (formantFrame, maximumNumberOfFormants);
 		}
-		
-		constexpr integer maximumNumberOfThreads = 16;
-		integer numberOfThreads, numberOfFramesPerThread = 25;
-		NUMgetThreadingInfo (numberOfFrames, std::min (numberOfProcessors, maximumNumberOfThreads), & numberOfFramesPerThread, & numberOfThreads);
+
+		autoMelderProgress progress (U"LPC to Formant");
+		std::atomic <integer> numberOfSuspectFrames (0);
 		/*
 			Reserve working memory for each thread
 		*/
-		autoPolynomial polynomials [maximumNumberOfThreads + 1];
-		autoRoots roots [maximumNumberOfThreads + 1];
-		for (integer ithread = 1; ithread <= numberOfThreads; ithread ++) {
-			polynomials [ithread] = Polynomial_create (-1.0, 1.0, my maxnCoefficients);
-			roots [ithread] = Roots_create (my maxnCoefficients);
-		}
-		autoMAT workspaces = raw_MAT (numberOfThreads, maximumNumberOfPolynomialCoefficients * (maximumNumberOfPolynomialCoefficients + 9));
-		std::vector <std::thread> thread (numberOfThreads);
-		std::atomic<integer> numberOfSuspectFrames (0);
-		
-		try {
-			for (integer ithread = 1; ithread <= numberOfThreads; ithread ++) {
-				Polynomial p = polynomials [ithread]. get ();
-				Roots r = roots [ithread]. get ();
-				Formant formant = thee. get ();
-				LPC lpc = me;
-				VEC workspace = workspaces. row (ithread);
-				const integer firstFrame = 1 + (ithread - 1) * numberOfFramesPerThread;
-				const integer lastFrame = ( ithread == numberOfThreads ? numberOfFrames : firstFrame + numberOfFramesPerThread - 1 );
-
-				thread [ithread - 1] = std::thread ([=, & numberOfSuspectFrames] () {
-					for (integer iframe = firstFrame; iframe <= lastFrame; iframe ++) {
-						const LPC_Frame lpcFrame = & lpc -> d_frames [iframe];
-						const Formant_Frame formantFrame = & formant -> frames [iframe];
-						try {
-							LPC_Frame_into_Formant_Frame_mt (lpcFrame, formantFrame, my samplingPeriod, margin, p, r, workspace);
-						} catch (MelderError) {
-							numberOfSuspectFrames ++;
-						}
-					}
-				});
-			}
-		} catch (MelderError) {
-			for (integer ithread = 1; ithread <= numberOfThreads; ithread ++) {
-				if (thread [ithread - 1]. joinable ())
-					thread [ithread - 1]. join ();
-			}
-			throw;
-		}
-		for (integer ithread = 1; ithread <= numberOfThreads; ithread ++)
-			thread [ithread - 1]. join ();
-	
-				
+		MelderThread_runFrames <LPC_to_Formant_Workspace> (numberOfFrames, 25,
+			[&] (LPC_to_Formant_Workspace& workspace) {
+				workspace.polynomial = Polynomial_create (-1.0, 1.0, my maxnCoefficients);
+				workspace.roots = Roots_create (my maxnCoefficients);
+				workspace.workspace = raw_VEC (maximumNumberOfPolynomialCoefficients * (maximumNumberOfPolynomialCoefficients + 9));
+			},
+			[&] (LPC_to_Formant_Workspace& workspace, integer iframe) {
+				const LPC_Frame lpcFrame = & my d_frames [iframe];
+				const Formant_Frame formantFrame = & thy frames [iframe];
+				if (! LPC_Frame_into_Formant_Frame_mt (lpcFrame, formantFrame, my samplingPeriod, margin,
+					workspace.polynomial.get(), workspace.roots.get(), workspace.workspace.get()))
+					numberOfSuspectFrames ++;
+			}, U"LPC to Formant"
+		);
 		Formant_sort (thee. get ());
 		if (numberOfSuspectFrames > 0)
 			Melder_warning ((integer) numberOfSuspectFrames, U" formant frames out of ", numberOfFrames, U" are suspect.");
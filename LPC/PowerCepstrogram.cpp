@@ -21,6 +21,7 @@
 #include "NUM2.h"
 #include "Sound_and_Spectrum.h"
 #include "Sound_extensions.h"
+#include "MelderThread.h"
 
 
 #define TOLOG(x) ((1 / NUMln10) * log ((x) + 1e-30))
@@ -327,13 +328,12 @@ autoPowerCepstrogram Sound_to_PowerCepstrogram (Sound me, double pitchFloor, dou
 		Sound_preEmphasis (sound.get(), preEmphasisFrequency);
 		double t1;
 		Sampled_shortTermAnalysis (me, windowDuration, dt, & nFrames, & t1);
-		autoSound sframe = Sound_createSimple (1, windowDuration, samplingFrequency);
 		autoSound window = Sound_createGaussian (windowDuration, samplingFrequency);
 		/*
 			Find out the size of the FFT
 		*/
 		integer nfft = 2;
-		while (nfft < sframe -> nx)
+		while (nfft < window -> nx)
 			nfft *= 2;
 		const integer nq = nfft / 2 + 1;
 		const double qmax = 0.5 * nfft / samplingFrequency, dq = qmax / (nq - 1);
@@ -341,20 +341,62 @@ autoPowerCepstrogram Sound_to_PowerCepstrogram (Sound me, double pitchFloor, dou
 
 		autoMelderProgress progress (U"Cepstrogram analysis");
 
-		for (integer iframe = 1; iframe <= nFrames; iframe++) {
-			const double t = Sampled_indexToX (thee.get(), iframe);
-			Sound_into_Sound (sound.get(), sframe.get(), t - windowDuration / 2);
-			Vector_subtractMean (sframe.get());
-			Sounds_multiply (sframe.get(), window.get());
-			autoSpectrum spec = Sound_to_Spectrum (sframe.get(), true);   // FFT yes
-			autoPowerCepstrum cepstrum = Spectrum_to_PowerCepstrum (spec.get());
-			for (integer i = 1; i <= nq; i ++)
-				thy z [i] [iframe] = cepstrum -> z [1] [i];
-
-			if ((iframe % 10) == 1)
-				Melder_progress ((double) iframe / nFrames, U"PowerCepstrogram analysis of frame ",
-					iframe, U" out of ", nFrames, U".");
-		}
+		/*
+			The frames of a chunk go through the two FFTs together;
+			the arithmetic is that of Sound_to_Spectrum and Spectrum_to_PowerCepstrum.
+		*/
+		struct Workspace {
+			autoSound sframe;
+			autoNUMfft_Table fftTable;
+			autoMAT frames;   // one row per frame of a chunk
+		};
+		constexpr integer numberOfFramesPerChunk = 20;
+		MelderThread_runFrameChunks <Workspace> (nFrames, numberOfFramesPerChunk,
+			[&] (Workspace& workspace) {
+				workspace.sframe = Sound_createSimple (1, windowDuration, samplingFrequency);
+				Melder_assert (workspace.sframe -> nx == window -> nx);
+				NUMfft_Table_init (& workspace.fftTable, nfft);
+				workspace.frames = zero_MAT (numberOfFramesPerChunk, nfft);
+			},
+			[&] (Workspace& workspace, integer firstFrame, integer lastFrame) {
+				Sound sframe = workspace.sframe.get();
+				MAT frames (workspace.frames.cells, lastFrame - firstFrame + 1, nfft);
+				for (integer iframe = firstFrame; iframe <= lastFrame; iframe ++) {
+					const double t = Sampled_indexToX (thee.get(), iframe);
+					Sound_into_Sound (sound.get(), sframe, t - windowDuration / 2);
+					Vector_subtractMean (sframe);
+					Sounds_multiply (sframe, window.get());
+					VEC frame = frames.row (iframe - firstFrame + 1);
+					frame.part (1, sframe -> nx)  <<=  sframe -> z.row (1);
+					frame.part (sframe -> nx + 1, nfft)  <<=  0.0;
+				}
+				NUMfft_forward_batch (& workspace.fftTable, frames);   // spectra
+				/*
+					The log power spectrum is real and even, so its inverse transform needs only the cosine terms.
+				*/
+				const double timeScaling = sframe -> dx, frequencyScaling = 1.0 / (sframe -> dx * nfft);
+				auto logPower = [&] (double re, double im) {
+					re *= timeScaling;
+					im *= timeScaling;
+					return log (re * re + im * im + 1e-300) * frequencyScaling;
+				};
+				for (integer irow = 1; irow <= frames.nrow; irow ++) {
+					VEC frame = frames.row (irow);
+					frame [1] = logPower (frame [1], 0.0);
+					for (integer i = 2; i < nq; i ++) {
+						frame [i + i - 2] = logPower (frame [i + i - 2], frame [i + i - 1]);
+						frame [i + i - 1] = 0.0;
+					}
+					frame [nfft] = logPower (frame [nfft], 0.0);
+				}
+				NUMfft_backward_batch (& workspace.fftTable, frames);   // cepstra
+				for (integer iframe = firstFrame; iframe <= lastFrame; iframe ++) {
+					constVEC frame = frames.row (iframe - firstFrame + 1);
+					for (integer i = 1; i <= nq; i ++)
+						thy z [i] [iframe] = frame [i] * frame [i];
+				}
+			}, U"PowerCepstrogram analysis"
+		);
 		return thee;
 	} catch (MelderError) {
 		Melder_throw (me, U": no PowerCepstrogram created.");
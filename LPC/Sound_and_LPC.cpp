@@ -29,11 +29,9 @@
 #include "Sound_extensions.h"
 #include "Vector.h"
 #include "Spectrum.h"
-#include <thread>
 #include <atomic>
-#include <functional>
-#include <vector>
 #include "NUM2.h"
+#include "MelderThread.h"
 
 #define LPC_METHOD_AUTO 1
 #define LPC_METHOD_COVAR 2
@@ -72,7 +70,7 @@ static integer getLPCAnalysisWorkspaceSize (integer numberOfSamples, integer num
 	return size;
 }
 
-static autoVEC getLPCAnalysisWorkspace (integer numberOfSamples, integer numberOfCoefficients, kLPC_Analysis method) {
+autoVEC Sound_into_LPC_Frame_createWorkspace (integer numberOfSamples, integer numberOfCoefficients, kLPC_Analysis method) {
 	integer size = getLPCAnalysisWorkspaceSize (numberOfSamples, numberOfCoefficients, method);
 	autoVEC result = raw_VEC (size);
 	return result;
@@ -434,66 +432,25 @@ end:
 	return status == 1 || status == 4 || status == 5;
 }
 
-static void Sound_into_LPC_noThreads (Sound me, LPC thee, double analysisWidth, double preEmphasisFrequency, kLPC_Analysis method, double tol1, double tol2) {
-	Melder_require (my xmin == thy xmin && my xmax == thy xmax, 
-		U"The Sound and the LPC should have the same domain.");
-	const double samplingFrequency = 1.0 / my dx;
-	double windowDuration = 2.0 * analysisWidth; // Gaussian window
-	const integer predictionOrder = thy maxnCoefficients;
-	Melder_require (Melder_roundDown (windowDuration / my dx) > predictionOrder,
-		U"Analysis window duration too short.\n For a prediction order of ", predictionOrder,
-		U" the analysis window duration should be greater than ", my dx * (predictionOrder + 1),
-		U" s. Please increase the analysis window duration.");
-	/*
-		Convenience: analyse the whole sound into one LPC_frame.
-	*/
-	if (windowDuration > my dx * my nx)
-		windowDuration = my dx * my nx;
-	integer numberOfFrames = thy nx;
-	autoSound sound = Data_copy (me);
-	autoSound sframe = Sound_createSimple (1, windowDuration, samplingFrequency);
-	autoSound window = Sound_createGaussian (windowDuration, samplingFrequency);
-	for (integer iframe = 1; iframe <= numberOfFrames; iframe ++) {
-		const LPC_Frame lpcFrame = & thy d_frames [iframe];
-		LPC_Frame_init (lpcFrame, predictionOrder);
-	}
-
-	autoVEC workspace = getLPCAnalysisWorkspace (sframe -> nx, predictionOrder, method);
-	autoMelderProgress progress (U"LPC analysis");
-
-	if (preEmphasisFrequency < samplingFrequency / 2.0)
-		Sound_preEmphasis (sound.get(), preEmphasisFrequency);
-	integer frameErrorCount = 0;
-	for (integer iframe = 1; iframe <= numberOfFrames; iframe ++) {
-		const LPC_Frame lpcframe = & thy d_frames [iframe];
-		const double t = Sampled_indexToX (thee, iframe);
-		Sound_into_Sound (sound.get(), sframe.get(), t - 0.5 * windowDuration);
-		Vector_subtractMean (sframe.get());
-		Sounds_multiply (sframe.get(), window.get());
-		integer status = 1;
-		if (method == kLPC_Analysis :: AUTOCORRELATION)
-			status = Sound_into_LPC_Frame_auto (sframe.get(), lpcframe, workspace.get());
-		else if (method == kLPC_Analysis :: COVARIANCE)
-			status = Sound_into_LPC_Frame_covar (sframe.get(), lpcframe, workspace.get());
-		else if (method == kLPC_Analysis :: BURG)
-			status = Sound_into_LPC_Frame_burg (sframe.get(), lpcframe, workspace.get());
-		else if (method == kLPC_Analysis :: MARPLE)
-			status = Sound_into_LPC_Frame_marple (sframe.get(), lpcframe, tol1, tol2, workspace.get());
-		if (status != 0)
-			frameErrorCount ++;
-		if (iframe % 10 == 1)
-			Melder_progress (double (iframe) / numberOfFrames, U"LPC analysis of frame ", iframe, U" out of ", numberOfFrames, U".");
-	}
+int Sound_into_LPC_Frame (Sound me, LPC_Frame thee, kLPC_Analysis method, double tol1, double tol2, VEC const& workspace) {
+	int status = 1;
+	if (method == kLPC_Analysis :: AUTOCORRELATION)
+		status = Sound_into_LPC_Frame_auto (me, thee, workspace);
+	else if (method == kLPC_Analysis :: COVARIANCE)
+		status = Sound_into_LPC_Frame_covar (me, thee, workspace);
+	else if (method == kLPC_Analysis :: BURG)
+		status = Sound_into_LPC_Frame_burg (me, thee, workspace);
+	else if (method == kLPC_Analysis :: MARPLE)
+		status = Sound_into_LPC_Frame_marple (me, thee, tol1, tol2, workspace);
+	return status;
 }
 
+struct Sound_into_LPC_Workspace {
+	autoSound sframe;
+	autoVEC workspace;
+};
+
 void Sound_into_LPC (Sound me, LPC thee, double analysisWidth, double preEmphasisFrequency, kLPC_Analysis method, double tol1, double tol2) {
-	const integer numberOfProcessors = std::thread::hardware_concurrency ();
-	if (numberOfProcessors <= 1) {
-		/*
-			We cannot use multithreading.
-		*/
-		Sound_into_LPC_noThreads (me, thee, analysisWidth, preEmphasisFrequency, method, tol1, tol2);
-	}
 	const double samplingFrequency = 1.0 / my dx;
 	Melder_require (my xmin == thy xmin && my xmax == thy xmax, 
 		U"The Sound and the LPC should have the same domain.");
@@ -521,63 +478,29 @@ void Sound_into_LPC (Sound me, LPC thee, double analysisWidth, double preEmphasi
 	}
 	if (preEmphasisFrequency < samplingFrequency / 2.0)
 		Sound_preEmphasis (sound.get(), preEmphasisFrequency);
-	
-	constexpr integer maximumNumberOfThreads = 16;
-	integer numberOfThreads, numberOfFramesPerThread = 25;
-	NUMgetThreadingInfo (numberOfFrames, std::min (numberOfProcessors, maximumNumberOfThreads), & numberOfFramesPerThread, & numberOfThreads);
+
+	autoMelderProgress progress (U"LPC analysis");
+	std::atomic <integer> frameErrorCount (0);
 	/*
 		We have to reserve all the needed working memory for each thread beforehand.
 	*/
-	autoSound sframe [maximumNumberOfThreads + 1];
-	for (integer ithread = 1; ithread <= numberOfThreads; ithread ++)
-		sframe [ithread] = Sound_createSimple (1, windowDuration, samplingFrequency);
-	
-	const integer workspaceSize = getLPCAnalysisWorkspaceSize (sframe [1] -> nx, predictionOrder, method);
-	Melder_require (workspaceSize > 0,
-		U"The workspace size is not properly defined.");
-	autoMAT workspace = raw_MAT (numberOfThreads, workspaceSize);
-
-	std::vector <std::thread> thread (numberOfThreads);
-	std::atomic<integer> frameErrorCount (0);
-	
-	try {
-		for (integer ithread = 1; ithread <= numberOfThreads; ithread ++) {
-			Sound soundFrame = sframe [ithread]. get(), fullsound = sound.get(), windowFrame = window.get();
-			VEC threadWorkspace = workspace. row (ithread);
-			const integer firstFrame = 1 + (ithread - 1) * numberOfFramesPerThread;
-			const integer lastFrame = ( ithread == numberOfThreads ? numberOfFrames : firstFrame + numberOfFramesPerThread - 1 );
-			
-			thread [ithread - 1] = std::thread ([=, & frameErrorCount]() {
-				for (integer iframe = firstFrame; iframe <= lastFrame; iframe ++) {
-					const LPC_Frame lpcframe = & thy d_frames [iframe];
-					const double t = Sampled_indexToX (thee, iframe);
-					Sound_into_Sound (fullsound, soundFrame, t - 0.5 * windowDuration);
-					Vector_subtractMean (soundFrame);
-					Sounds_multiply (soundFrame, windowFrame);
-					integer status = 1;
-					if (method == kLPC_Analysis :: AUTOCORRELATION)
-						status = Sound_into_LPC_Frame_auto (soundFrame, lpcframe, threadWorkspace);
-					else if (method == kLPC_Analysis :: COVARIANCE)
-						status = Sound_into_LPC_Frame_covar (soundFrame, lpcframe, threadWorkspace);
-					else if (method == kLPC_Analysis :: BURG)
-						status = Sound_into_LPC_Frame_burg (soundFrame, lpcframe, threadWorkspace);
-					else if (method == kLPC_Analysis :: MARPLE)
-						status = Sound_into_LPC_Frame_marple (soundFrame, lpcframe, tol1, tol2, threadWorkspace);
-					if (status != 0)
-						++ frameErrorCount;
-				}
-			});
-		}
-	} catch (MelderError) {
-		for (integer ithread = 1; ithread <= numberOfThreads; ithread ++) {
-			if (thread [ithread - 1]. joinable ())
-				thread [ithread - 1]. join ();
-		}
-		throw;
-	}
-	for (integer ithread = 1; ithread <= numberOfThreads; ithread ++)
-		thread [ithread - 1]. join ();
-
+	MelderThread_runFrames <Sound_into_LPC_Workspace> (numberOfFrames, 25,
+		[&] (Sound_into_LPC_Workspace& workspace) {
+			workspace.sframe = Sound_createSimple (1, windowDuration, samplingFrequency);
+			workspace.workspace = Sound_into_LPC_Frame_createWorkspace (workspace.sframe -> nx, predictionOrder, method);
+		},
+		[&] (Sound_into_LPC_Workspace& workspace, integer iframe) {
+			const Sound soundFrame = workspace.sframe.get();
+			const LPC_Frame lpcframe = & thy d_frames [iframe];
+			const double t = Sampled_indexToX (thee, iframe);
+			Sound_into_Sound (sound.get(), soundFrame, t - 0.5 * windowDuration);
+			Vector_subtractMean (soundFrame);
+			Sounds_multiply (soundFrame, window.get());
+			const int status = Sound_into_LPC_Frame (soundFrame, lpcframe, method, tol1, tol2, workspace.workspace.get());
+			if (status != 0)
+				++ frameErrorCount;
+		}, U"LPC analysis"
+	);
 }
 
 static autoLPC Sound_to_LPC (Sound me, int predictionOrder, double analysisWidth, double dt, double preEmphasisFrequency, kLPC_Analysis method, double tol1, double tol2) {
@@ -66,6 +66,17 @@ void Sound_into_LPC (Sound me, LPC thee, double analysisWidth, double preEmphasi
  *	tol2 : stop iteration when (E(m)-E(m-1)) / E(m-1) < tol2,
  */
 
+autoVEC Sound_into_LPC_Frame_createWorkspace (integer numberOfSamples, integer predictionOrder, kLPC_Analysis method);
+int Sound_into_LPC_Frame (Sound me, LPC_Frame thee, kLPC_Analysis method, double tol1, double tol2, VEC const& workspace);
+/*
+	Analyses one windowed frame (the first channel of `me`) into `thee`,
+	which has to be initialized with the prediction order beforehand.
+	The workspace has to be created with the number of samples of `me`.
+	Does not allocate and does not throw, so that it can be called on multiple threads,
+	each with its own frame and workspace.
+	Returns the status of the analysis method.
+*/
+
 autoSound LPC_Sound_filter (LPC me, Sound thee, bool useGain);
 /*
 	E(z) = X(z)A(z),
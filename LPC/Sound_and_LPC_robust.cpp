@@ -30,24 +30,11 @@
 #include "Sound_and_LPC.h"
 #include "Sound_and_LPC_robust.h"
 #include "Sound_extensions.h"
-#include "SVD.h"
 #include "Vector.h"
 #include "NUM2.h"
+#include "MelderThread.h"
 
-struct huber_struct {
-	autoVEC error;
-	double k_stdev, tol, tol_svd;
-	integer numberOfSamples, predictionOrder, maximumPredictionOrder;
-	integer iter, itermax, huber_iterations = 5;
-	bool wantlocation, wantscale;
-	double location, scale;
-	autoVEC workSpace;
-	autoVEC weights, coefficients, covariancesw;
-	autoMAT covarmatrixw;
-	autoSVD svd;
-};
-
-static void huber_struct_init (struct huber_struct *me, integer numberOfSamples, integer maximumPredictionOrder, double location, bool wantlocation) {
+void huber_struct_init (struct huber_struct *me, integer numberOfSamples, integer maximumPredictionOrder, double location, bool wantlocation) {
 	my numberOfSamples = numberOfSamples;
 	my error = zero_VEC (numberOfSamples);
 	my k_stdev = my tol = my tol_svd = my scale = 0.0;
@@ -104,7 +91,7 @@ static void huber_struct_getWeightedCovars (struct huber_struct *me, constVEC co
 	}
 }
 
-static void huber_struct_solvelpc (struct huber_struct *me) {
+static bool huber_struct_solvelpc (struct huber_struct *me) {
 	// we cannot resize the svd-matrices therefore add zero's and svd the full matrix
 	if (my predictionOrder < my maximumPredictionOrder) {
 		my covarmatrixw. part (my predictionOrder + 1, my maximumPredictionOrder, 1, my maximumPredictionOrder) <<= 0.0;
@@ -113,12 +100,14 @@ static void huber_struct_solvelpc (struct huber_struct *me) {
 	}
 	my svd -> u.all()  <<=  my covarmatrixw.all();
 	SVD_setTolerance (my svd.get(), my tol_svd);
-	SVD_compute (my svd.get());
-	SVD_solve_preallocated (my svd.get(), my covariancesw.get(), my coefficients.get());
+	const bool solved = SVD_tryToCompute (my svd.get());
+	if (solved)
+		SVD_solve_preallocated (my svd.get(), my covariancesw.get(), my coefficients.get());
 	my coefficients.resize (my predictionOrder); // maintain invariant
+	return solved;
 }
 
-void huber_struct_minimize (struct huber_struct *me, constVEC const& sound, constVEC const& lpcFrom, VEC const& lpcTo) {
+bool huber_struct_minimize (struct huber_struct *me, constVEC const& sound, constVEC const& lpcFrom, VEC const& lpcTo) {
 	Melder_assert (lpcFrom.size == lpcTo.size);
 	Melder_assert (lpcFrom.size <= my predictionOrder);
 	Melder_assert (sound.size == my numberOfSamples);
@@ -137,20 +126,23 @@ void huber_struct_minimize (struct huber_struct *me, constVEC const& sound, cons
 		/*
 			Solve C a = [-] c
 		*/
-		try {
-			huber_struct_solvelpc (me);
-		} catch (MelderError) {
+		if (! huber_struct_solvelpc (me)) {
 			lpcTo  <<=  lpcFrom; // No change could be made
-			throw MelderError();
+			return false;
 		}
 		lpcTo  <<=  my coefficients.all();
 		farFromScale = ( fabs (my scale - previousScale) > std::max (my tol * fabs (my scale), NUMeps) );
 	} while (++ my iter < my itermax && farFromScale);
+	return true;
 }
 
+struct LPC_Sound_to_LPC_robust_Workspace {
+	autoSound sframe;
+	struct huber_struct huber;
+};
+
 autoLPC LPC_Sound_to_LPC_robust (LPC thee, Sound me, double analysisWidth, double preEmphasisFrequency, double k_stdev,
 	integer itermax, double tol, bool wantlocation) {
-	struct huber_struct struct_huber;
 	try {
 		const double samplingFrequency = 1.0 / my dx, tol_svd = 0.000001;
 		const double windowDuration = 2 * analysisWidth; /* Gaussian window */
@@ -168,44 +160,52 @@ autoLPC LPC_Sound_to_LPC_robust (LPC thee, Sound me, double analysisWidth, doubl
 			U"Incorrect retrieved analysis width.");
 
 		autoSound sound = Data_copy (me);
-		autoSound sframe = Sound_createSimple (1, windowDuration, samplingFrequency);
 		autoSound window = Sound_createGaussian (windowDuration, samplingFrequency);
 		autoLPC him = Data_copy (thee);
-		double location = 0.0;
-		huber_struct_init (& struct_huber, window -> nx, predictionOrder, location, wantlocation);
-		struct_huber.k_stdev = k_stdev;
-		struct_huber.tol = tol;
-		struct_huber.tol_svd = tol_svd;
-		struct_huber.itermax = itermax;
 
 		autoMelderProgress progess (U"LPC analysis");
 
 		Sound_preEmphasis (sound.get(), preEmphasisFrequency);
-		integer frameErrorCount = 0, iter = 0;
-		for (integer iframe = 1; iframe <= numberOfFrames; iframe ++) {
-			const LPC_Frame lpc = & thy d_frames [iframe];
-			const LPC_Frame lpcto = & his d_frames [iframe];
-			const double t = Sampled_indexToX (thee, iframe);
-
-			Sound_into_Sound (sound.get(), sframe.get(), t - windowDuration / 2);
-			Vector_subtractMean (sframe.get());
-			Sounds_multiply (sframe.get(), window.get());
-			//huber_struct_resize (& struct_huber, lpc -> nCoefficients);
-			try {
-				huber_struct_minimize (& struct_huber, sframe -> z.row(1), lpc -> a.get(), lpcto -> a.get());
-			} catch (MelderError) {
-				frameErrorCount ++;
-			}
-
-			iter += struct_huber.iter;
-
-			if (iframe % 10 == 1)
-				Melder_progress ((double) iframe / numberOfFrames,
-					U"LPC analysis of frame ", iframe, U" out of ", numberOfFrames, U".");
-		}
+		/*
+			Each thread has its own frame and huber_struct.
+			The number of iterations differs strongly between frames,
+			so the frames are handed out to the threads in small chunks.
+			The frames do not depend on each other (the location and scale are estimated anew in every frame),
+			and the sums of the counts do not depend on the order in which the frames are done,
+			so the result does not depend on the number of threads.
+			The workspaces are initialized on the calling thread, so that SVD_create
+			sets up the LAPACK machine constants before any thread runs an SVD.
+		*/
+		std::atomic <integer> frameErrorCount (0), numberOfIterations (0);
+		MelderThread_runFrames <LPC_Sound_to_LPC_robust_Workspace> (numberOfFrames, 5,
+			[&] (LPC_Sound_to_LPC_robust_Workspace& workspace) {
+				workspace.sframe = Sound_createSimple (1, windowDuration, samplingFrequency);
+				const double location = 0.0;
+				huber_struct_init (& workspace.huber, window -> nx, predictionOrder, location, wantlocation);
+				workspace.huber.k_stdev = k_stdev;
+				workspace.huber.tol = tol;
+				workspace.huber.tol_svd = tol_svd;
+				workspace.huber.itermax = itermax;
+			},
+			[&] (LPC_Sound_to_LPC_robust_Workspace& workspace, integer iframe) {
+				const Sound sframe = workspace.sframe.get();
+				const LPC_Frame lpc = & thy d_frames [iframe];
+				const LPC_Frame lpcto = & his d_frames [iframe];
+				const double t = Sampled_indexToX (thee, iframe);
+
+				Sound_into_Sound (sound.get(), sframe, t - windowDuration / 2);
+				Vector_subtractMean (sframe);
+				Sounds_multiply (sframe, window.get());
+				//huber_struct_resize (& workspace.huber, lpc -> nCoefficients);
+				if (! huber_struct_minimize (& workspace.huber, sframe -> z.row(1), lpc -> a.get(), lpcto -> a.get()))
+					frameErrorCount ++;
+				numberOfIterations += workspace.huber.iter;
+			}, U"LPC analysis"
+		);
+		trace ((integer) numberOfIterations, U" iterations in ", numberOfFrames, U" frames.");
 
 		if (frameErrorCount > 0)
-			Melder_warning (U"Results of ", frameErrorCount, U" frame(s) out of ", numberOfFrames, 
+			Melder_warning (U"Results of ", (integer) frameErrorCount, U" frame(s) out of ", numberOfFrames, 
 				U" could not be optimised.");
 		return him;
 	} catch (MelderError) {
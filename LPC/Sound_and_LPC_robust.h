@@ -25,6 +25,32 @@
 #include "LPC.h"
 #include "Formant.h"
 #include "Sound.h"
+#include "SVD.h"
+
+/*
+	The workspace of the robust analysis of one frame.
+	Threads that analyse frames at the same time should each have their own.
+*/
+struct huber_struct {
+	autoVEC error;
+	double k_stdev, tol, tol_svd;
+	integer numberOfSamples, predictionOrder, maximumPredictionOrder;
+	integer iter, itermax, huber_iterations = 5;
+	bool wantlocation, wantscale;
+	double location, scale;
+	autoVEC workSpace;
+	autoVEC weights, coefficients, covariancesw;
+	autoMAT covarmatrixw;
+	autoSVD svd;
+};
+
+void huber_struct_init (struct huber_struct *me, integer numberOfSamples, integer maximumPredictionOrder, double location, bool wantlocation);
+
+bool huber_struct_minimize (struct huber_struct *me, constVEC const& sound, constVEC const& lpcFrom, VEC const& lpcTo);
+/*
+	Iteratively reweighted least squares, starting from lpcFrom, which has to have the same size as lpcTo.
+	Returns false if the weighted equations cannot be solved; lpcTo then equals lpcFrom.
+*/
 
 void LPC_Frames_Sound_huber (LPC_Frame me, Sound thee, LPC_Frame him, struct huber_struct *hs);
 /*int LPC_Frames_Sound_huber (LPC_Frame me, Sound thee, LPC_Frame him, void *huber);
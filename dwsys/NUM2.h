@@ -1034,6 +1034,13 @@ struct structNUMfft_Table
   integer n;
   autoVEC trigcache;
   autoINTVEC splitcache;
+  /*
+	For powers of two from 16 on, a faster engine (NUMfft_pow2.h) is used instead of FFTPACK,
+	unless Melder_debug was 58 when the table was initialised.
+  */
+  bool powerOfTwoEngine = false;
+  autoVEC twiddles;
+  autoINTVEC reversal;
 };
 
 typedef struct structNUMfft_Table *NUMfft_Table;
@@ -1125,6 +1132,19 @@ void NUMfft_backward (NUMfft_Table table, VEC data);
 	sequence by n.
 */
 
+void NUMfft_forward_batch (NUMfft_Table table, MAT frames);
+void NUMfft_backward_batch (NUMfft_Table table, MAT frames);
+/*
+	Function:
+		Performs NUMfft_forward or NUMfft_backward on each row of `frames`,
+		with the same result as frame-by-frame calls.
+		For powers of two, a few frames at a time go through each stage together,
+		sharing the twiddle factors.
+	Preconditions:
+		frames.ncol == table -> n
+		table must have been initialised with NUMfft_Table_init
+*/
+
 /**** Compatibility with NR fft's */
 
 void NUMforwardRealFastFourierTransform (VEC data);
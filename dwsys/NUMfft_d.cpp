@@ -1,6 +1,6 @@
 /* NUMfft_d.cpp
  *
- * Copyright (C) 1997-2011 David Weenink, Paul Boersma 2016-2018,2020
+ * Copyright (C) 1997-2011 David Weenink, Paul Boersma 2016-2018,2020,2021
  *
  * This code is free software; you can redistribute it and/or modify
  * it under the terms of the GNU General Public License as published by
@@ -26,6 +26,7 @@
 
 #define FFT_DATA_TYPE double
 #include "NUMfft_core.h"
+#include "NUMfft_pow2.h"
 
 void NUMforwardRealFastFourierTransform (VEC data) {
 	autoNUMfft_Table table;
@@ -61,6 +62,13 @@ void NUMfft_forward (NUMfft_Table me, VEC data) {
 	if (my n == 1)
 		return;
 	Melder_assert (my n == data.size);
+	if (my powerOfTwoEngine) {
+		NUMfft_pow2::transformBatch <false> (my n, data.asArgumentToFunctionThatExpectsZeroBasedArray(), my n, 1,
+			my reversal.asArgumentToFunctionThatExpectsZeroBasedArray(),
+			my twiddles.asArgumentToFunctionThatExpectsZeroBasedArray()
+		);
+		return;
+	}
 	drftf1 (my n, data.asArgumentToFunctionThatExpectsZeroBasedArray(),
 		my trigcache.asArgumentToFunctionThatExpectsZeroBasedArray(),
 		my trigcache.asArgumentToFunctionThatExpectsZeroBasedArray() + my n,
@@ -72,6 +80,13 @@ void NUMfft_backward (NUMfft_Table me, VEC data) {
 	if (my n == 1)
 		return;
 	Melder_assert (my n == data.size);
+	if (my powerOfTwoEngine) {
+		NUMfft_pow2::transformBatch <true> (my n, data.asArgumentToFunctionThatExpectsZeroBasedArray(), my n, 1,
+			my reversal.asArgumentToFunctionThatExpectsZeroBasedArray(),
+			my twiddles.asArgumentToFunctionThatExpectsZeroBasedArray()
+		);
+		return;
+	}
 	drftb1 (my n, data.asArgumentToFunctionThatExpectsZeroBasedArray(),
 		my trigcache.asArgumentToFunctionThatExpectsZeroBasedArray(),
 		my trigcache.asArgumentToFunctionThatExpectsZeroBasedArray() + my n,
@@ -79,8 +94,51 @@ void NUMfft_backward (NUMfft_Table me, VEC data) {
 	);
 }
 
+void NUMfft_forward_batch (NUMfft_Table me, MAT frames) {
+	if (my n == 1 || frames.nrow == 0)
+		return;
+	Melder_assert (my n == frames.ncol);
+	if (my powerOfTwoEngine) {
+		NUMfft_pow2::transformBatch <false> (my n, & frames [1] [1], frames.ncol, frames.nrow,
+			my reversal.asArgumentToFunctionThatExpectsZeroBasedArray(),
+			my twiddles.asArgumentToFunctionThatExpectsZeroBasedArray()
+		);
+		return;
+	}
+	for (integer iframe = 1; iframe <= frames.nrow; iframe ++)
+		NUMfft_forward (me, frames.row (iframe));
+}
+
+void NUMfft_backward_batch (NUMfft_Table me, MAT frames) {
+	if (my n == 1 || frames.nrow == 0)
+		return;
+	Melder_assert (my n == frames.ncol);
+	if (my powerOfTwoEngine) {
+		NUMfft_pow2::transformBatch <true> (my n, & frames [1] [1], frames.ncol, frames.nrow,
+			my reversal.asArgumentToFunctionThatExpectsZeroBasedArray(),
+			my twiddles.asArgumentToFunctionThatExpectsZeroBasedArray()
+		);
+		return;
+	}
+	for (integer iframe = 1; iframe <= frames.nrow; iframe ++)
+		NUMfft_backward (me, frames.row (iframe));
+}
+
 void NUMfft_Table_init (NUMfft_Table me, integer n) {
 	my n = n;
+	my powerOfTwoEngine = ( n >= 16 && (n & (n - 1)) == 0 && Melder_debug != 58 );
+	if (my powerOfTwoEngine) {
+		const integer m = n / 2;
+		my twiddles = zero_VEC (NUMfft_pow2::getTwiddlesSize (m));
+		my reversal = zero_INTVEC (m);
+		NUMfft_pow2::makeTwiddles (m, my twiddles.asArgumentToFunctionThatExpectsZeroBasedArray());
+		NUMfft_pow2::makeReversal (m, my reversal.asArgumentToFunctionThatExpectsZeroBasedArray());
+		my trigcache = autoVEC ();
+		my splitcache = autoINTVEC ();
+		return;
+	}
+	my twiddles = autoVEC ();
+	my reversal = autoINTVEC ();
 	my trigcache = zero_VEC (3 * n);
 	my splitcache = zero_INTVEC (32);
 	NUMrffti (n, my trigcache.asArgumentToFunctionThatExpectsZeroBasedArray(),
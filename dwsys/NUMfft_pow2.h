@@ -0,0 +1,353 @@
+/* NUMfft_pow2.h
+ *
+ * Copyright (C) 2021 Paul Boersma
+ *
+ * This code is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or (at
+ * your option) any later version.
+ *
+ * This code is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this work. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/*
+	A real FFT for sizes n that are powers of two,
+	with the same input and output layout as FFTPACK's drftf1 and drftb1 (NUMfft_core.h).
+
+	The n real numbers are regarded as n/2 complex numbers (even samples real, odd samples imaginary),
+	which are transformed in place by an iterative radix-4 complex FFT (plus one radix-2 stage if needed);
+	the n/2 complex results are then split into the spectrum of the n real numbers.
+	A complex number occupies two adjacent doubles, i.e. exactly one 128-bit SIMD register,
+	so that every butterfly is a handful of SSE2 (x86-64) or NEON (ARM64) instructions;
+	on other processors the same butterflies are written out in scalar code.
+	SSE2 and 64-bit NEON are part of the base instruction sets of these processors,
+	so no run-time check is needed.
+
+	The twiddle factors are computed with cos() and sin() for each index separately
+	(no recursion), so the rounding errors are about as small as those of FFTPACK.
+*/
+
+#if defined (__SSE2__) || defined (_M_X64) || (defined (_M_IX86_FP) && _M_IX86_FP >= 2)
+	#include <emmintrin.h>
+	#define NUMfft_pow2_SSE2  1
+#elif defined (__aarch64__) && defined (__ARM_NEON)
+	#include <arm_neon.h>
+	#define NUMfft_pow2_NEON  1
+#endif
+
+namespace NUMfft_pow2 {
+
+#if defined (NUMfft_pow2_SSE2)
+	struct Complex {
+		__m128d v;
+		static inline Complex load (const double *p) { return { _mm_loadu_pd (p) }; }
+		inline void store (double *p) const { _mm_storeu_pd (p, v); }
+		inline Complex operator+ (Complex other) const { return { _mm_add_pd (v, other.v) }; }
+		inline Complex operator- (Complex other) const { return { _mm_sub_pd (v, other.v) }; }
+		inline Complex swapped () const { return { _mm_shuffle_pd (v, v, 1) }; }
+		inline Complex timesPairs (const double *p) const { return { _mm_mul_pd (v, _mm_loadu_pd (p)) }; }
+		inline Complex timesPairs (Complex other) const { return { _mm_mul_pd (v, other.v) }; }
+	};
+#elif defined (NUMfft_pow2_NEON)
+	struct Complex {
+		float64x2_t v;
+		static inline Complex load (const double *p) { return { vld1q_f64 (p) }; }
+		inline void store (double *p) const { vst1q_f64 (p, v); }
+		inline Complex operator+ (Complex other) const { return { vaddq_f64 (v, other.v) }; }
+		inline Complex operator- (Complex other) const { return { vsubq_f64 (v, other.v) }; }
+		inline Complex swapped () const { return { vextq_f64 (v, v, 1) }; }
+		inline Complex timesPairs (const double *p) const { return { vmulq_f64 (v, vld1q_f64 (p)) }; }
+		inline Complex timesPairs (Complex other) const { return { vmulq_f64 (v, other.v) }; }
+	};
+#else
+	struct Complex {
+		double re, im;
+		static inline Complex load (const double *p) { return { p [0], p [1] }; }
+		inline void store (double *p) const { p [0] = re; p [1] = im; }
+		inline Complex operator+ (Complex other) const { return { re + other.re, im + other.im }; }
+		inline Complex operator- (Complex other) const { return { re - other.re, im - other.im }; }
+		inline Complex swapped () const { return { im, re }; }
+		inline Complex timesPairs (const double *p) const { return { re * p [0], im * p [1] }; }
+		inline Complex timesPairs (Complex other) const { return { re * other.re, im * other.im }; }
+	};
+#endif
+
+/*
+	A twiddle factor w = c - i s is stored as the four numbers c, c, s, -s,
+	so that multiplication by w (forward) or by its conjugate (backward)
+	takes two multiplications, one swap and one addition or subtraction.
+	A batch of frames shares the loaded twiddle factor.
+*/
+struct Twiddle {
+	Complex cc, ss;
+	static inline Twiddle load (const double *w) { return { Complex::load (w), Complex::load (w + 2) }; }
+};
+template <bool backward>
+static inline Complex twiddle (Complex z, Twiddle w) {
+	return backward ?
+		z.timesPairs (w.cc) - z.swapped ().timesPairs (w.ss) :
+		z.timesPairs (w.cc) + z.swapped ().timesPairs (w.ss);
+}
+
+/*
+	Multiplication by -i (forward) or by +i (backward).
+*/
+static const double minusI [2] = { 1.0, -1.0 }, plusI [2] = { -1.0, 1.0 };
+template <bool backward>
+static inline Complex rotate (Complex z) {
+	return z.swapped ().timesPairs (backward ? plusI : minusI);
+}
+
+static inline integer log2 (integer n) {
+	integer result = 0;
+	while ((integer (1) << result) < n)
+		result ++;
+	return result;
+}
+
+static void makeReversal (integer m, integer *reversal) {
+	const integer numberOfBits = log2 (m);
+	for (integer i = 0; i < m; i ++) {
+		integer j = 0;
+		for (integer ibit = 0; ibit < numberOfBits; ibit ++)
+			j |= ( (i >> ibit) & 1 ) << (numberOfBits - 1 - ibit);
+		reversal [i] = j;
+	}
+}
+
+/*
+	Twiddle factors for the complex FFT of size m: for every radix-4 stage with a quarter length q > 1,
+	at offset 12 * q, for k = 0 .. q-1, the three factors e^(-2 pi i j k / (4 q)) for j = 1, 2, 3.
+	For the split into a real spectrum, the factors e^(-2 pi i k / (2 m)) for k = 0 .. m/2 - 1
+	are stored at offset 8 * m.
+*/
+static integer getTwiddlesSize (integer m) {
+	return 8 * m + 4 * (m / 2);
+}
+
+static void storeTwiddle (double *w, double phase) {
+	const double c = cos (phase), s = sin (phase);
+	w [0] = c;
+	w [1] = c;
+	w [2] = s;
+	w [3] = - s;
+}
+
+static void makeTwiddles (integer m, double *twiddles) {
+	const integer firstSize = ( log2 (m) % 2 == 1 ? 8 : 16 );
+	for (integer size = firstSize; size <= m; size *= 4) {
+		const integer q = size / 4;
+		for (integer k = 0; k < q; k ++)
+			for (integer j = 1; j <= 3; j ++)
+				storeTwiddle (& twiddles [12 * q + 12 * k + 4 * (j - 1)], 2.0 * NUMpi * double (j * k) / double (size));
+	}
+	for (integer k = 0; k < m / 2; k ++)
+		storeTwiddle (& twiddles [8 * m + 4 * k], NUMpi * double (k) / double (m));
+}
+
+template <bool backward>
+static inline void butterfly4 (double *z0, double *z1, double *z2, double *z3,
+	Complex a0, Complex a1, Complex a2, Complex a3)
+{
+	const Complex sum02 = a0 + a2, difference02 = a0 - a2;
+	const Complex sum13 = a1 + a3, difference13 = rotate <backward> (a1 - a3);
+	(sum02 + sum13). store (z0);
+	(difference02 + difference13). store (z1);
+	(sum02 - sum13). store (z2);
+	(difference02 - difference13). store (z3);
+}
+
+/*
+	In-place complex FFT of the m complex numbers in z [0 .. 2 m - 1] (real and imaginary parts alternating),
+	for each of the `numberOfFrames` frames z = frame [0] .. frame [numberOfFrames - 1].
+	Unnormalized, with e^(-2 pi i ...) for the forward and e^(+2 pi i ...) for the backward transform.
+
+	After the bit-reversal permutation, a radix-4 stage of size 4 q finds the four sub-transforms (of size q)
+	of the inputs that are 0, 2, 1 and 3 modulo 4 in its four quarters, in that order.
+	If log2 (m) is odd, a radix-2 stage without twiddle factors comes first.
+
+	The frames go through every butterfly together, so that each twiddle factor is loaded once per batch,
+	and the butterflies of different frames, which are independent, can overlap in the processor's pipelines.
+*/
+template <bool backward, integer numberOfFrames>
+static void complexTransform (integer m, double *const *frame, const integer *reversal, const double *twiddles) {
+	for (integer i = 0; i < m; i ++) {
+		const integer j = reversal [i];
+		if (i < j) {
+			for (integer iframe = 0; iframe < numberOfFrames; iframe ++) {
+				double *z = frame [iframe];
+				const Complex zi = Complex::load (& z [2 * i]), zj = Complex::load (& z [2 * j]);
+				zj. store (& z [2 * i]);
+				zi. store (& z [2 * j]);
+			}
+		}
+	}
+	integer size = 1;
+	if (log2 (m) % 2 == 1) {
+		for (integer iframe = 0; iframe < numberOfFrames; iframe ++) {
+			double *z = frame [iframe];
+			for (integer start = 0; start < m; start += 2) {
+				double *z0 = & z [2 * start];
+				const Complex a = Complex::load (z0), b = Complex::load (z0 + 2);
+				(a + b). store (z0);
+				(a - b). store (z0 + 2);
+			}
+		}
+		size = 2;
+	}
+	for (size *= 4; size <= m; size *= 4) {
+		const integer q = size / 4;
+		if (q == 1) {
+			for (integer iframe = 0; iframe < numberOfFrames; iframe ++) {
+				double *z = frame [iframe];
+				for (integer start = 0; start < m; start += 4) {
+					double *z0 = & z [2 * start];
+					butterfly4 <backward> (z0, z0 + 2, z0 + 4, z0 + 6,
+						Complex::load (z0), Complex::load (z0 + 4), Complex::load (z0 + 2), Complex::load (z0 + 6));
+				}
+			}
+			continue;
+		}
+		const double *stageTwiddles = & twiddles [12 * q];
+		for (integer start = 0; start < m; start += size) {
+			const double *w = stageTwiddles;
+			for (integer offset = 2 * start; offset < 2 * (start + q); offset += 2, w += 12) {
+				const Twiddle w1 = Twiddle::load (w), w2 = Twiddle::load (w + 4), w3 = Twiddle::load (w + 8);
+				for (integer iframe = 0; iframe < numberOfFrames; iframe ++) {
+					double *z0 = frame [iframe] + offset, *z1 = z0 + 2 * q, *z2 = z1 + 2 * q, *z3 = z2 + 2 * q;
+					butterfly4 <backward> (z0, z1, z2, z3,
+						Complex::load (z0),
+						twiddle <backward> (Complex::load (z2), w1),
+						twiddle <backward> (Complex::load (z1), w2),
+						twiddle <backward> (Complex::load (z3), w3)
+					);
+				}
+			}
+		}
+	}
+}
+
+/*
+	Forward real FFT of each frame d [0 .. n - 1], n = 2 m, with FFTPACK's output layout.
+*/
+template <integer numberOfFrames>
+static void forward (integer n, double *const *frame, const integer *reversal, const double *twiddles) {
+	const integer m = n / 2;
+	complexTransform <false, numberOfFrames> (m, frame, reversal, twiddles);
+	/*
+		Split. Z_k is at d [2k], d [2k+1]. The real spectrum X_k (k = 0 .. m) is first computed
+		in the same layout, with X_0 and X_m (both real) sharing the first slot.
+	*/
+	for (integer iframe = 0; iframe < numberOfFrames; iframe ++) {
+		double *d = frame [iframe];
+		const double z0re = d [0], z0im = d [1];
+		d [0] = z0re + z0im;   // X_0
+		d [1] = z0re - z0im;   // X_m
+	}
+	const double *w = & twiddles [8 * m];
+	for (integer k = 1; k < m / 2; k ++) {
+		const integer kk = m - k;
+		const double c = w [4 * k], s = w [4 * k + 2];   // W^k = c - i s
+		for (integer iframe = 0; iframe < numberOfFrames; iframe ++) {
+			double *d = frame [iframe];
+			const double are = d [2 * k], aim = d [2 * k + 1], bre = d [2 * kk], bim = - d [2 * kk + 1];
+			const double ere = 0.5 * (are + bre), eim = 0.5 * (aim + bim);
+			const double ore = 0.5 * (aim - bim), oim = - 0.5 * (are - bre);   // O = -i (A - B) / 2
+			const double tre = c * ore + s * oim, tim = c * oim - s * ore;   // W^k O
+			d [2 * k] = ere + tre;
+			d [2 * k + 1] = eim + tim;
+			d [2 * kk] = ere - tre;   // X_(m-k) = conj (E - W^k O)
+			d [2 * kk + 1] = - (eim - tim);
+		}
+	}
+	for (integer iframe = 0; iframe < numberOfFrames; iframe ++) {
+		double *d = frame [iframe];
+		if (m >= 2)
+			d [m + 1] = - d [m + 1];   // X_(m/2) = conj (Z_(m/2))
+		/*
+			Go to FFTPACK's layout: X_0, Re X_1, Im X_1, ..., Re X_(m-1), Im X_(m-1), X_m.
+		*/
+		const double xm = d [1];
+		memmove (& d [1], & d [2], size_t (n - 2) * sizeof (double));
+		d [n - 1] = xm;
+	}
+}
+
+/*
+	Backward real FFT of each frame d [0 .. n - 1], n = 2 m, with FFTPACK's input layout; unnormalized.
+*/
+template <integer numberOfFrames>
+static void backward (integer n, double *const *frame, const integer *reversal, const double *twiddles) {
+	const integer m = n / 2;
+	for (integer iframe = 0; iframe < numberOfFrames; iframe ++) {
+		double *d = frame [iframe];
+		const double xm = d [n - 1];
+		memmove (& d [2], & d [1], size_t (n - 2) * sizeof (double));
+		const double x0 = d [0];
+		d [0] = x0 + xm;
+		d [1] = x0 - xm;
+	}
+	const double *w = & twiddles [8 * m];
+	for (integer k = 1; k < m / 2; k ++) {
+		const integer kk = m - k;
+		const double c = w [4 * k], s = w [4 * k + 2];   // conj (W^k) = c + i s
+		for (integer iframe = 0; iframe < numberOfFrames; iframe ++) {
+			double *d = frame [iframe];
+			const double are = d [2 * k], aim = d [2 * k + 1], bre = d [2 * kk], bim = - d [2 * kk + 1];   // B = conj (X_(m-k))
+			const double ere = are + bre, eim = aim + bim;
+			const double dre = are - bre, dim = aim - bim;
+			const double ore = c * dre - s * dim, oim = c * dim + s * dre;
+			d [2 * k] = ere - oim;   // Z'_k = E' + i O'
+			d [2 * k + 1] = eim + ore;
+			d [2 * kk] = ere + oim;   // Z'_(m-k) = conj (E') + i conj (O')
+			d [2 * kk + 1] = - eim + ore;
+		}
+	}
+	if (m >= 2) {
+		for (integer iframe = 0; iframe < numberOfFrames; iframe ++) {
+			double *d = frame [iframe];
+			d [m] *= 2.0;   // Z'_(m/2) = 2 conj (X_(m/2))
+			d [m + 1] *= -2.0;
+		}
+	}
+	complexTransform <true, numberOfFrames> (m, frame, reversal, twiddles);
+}
+
+/*
+	Transform the frames first, first + stride, ..., four at a time if four frames fit in the level-1 cache
+	(beyond that, batching makes the transform up to twice as slow, because the frames evict each other).
+*/
+constexpr integer batchSize = 4, maximumBatchedFrameSize = 1024;
+
+template <bool backward_>
+static void transformBatch (integer n, double *first, integer stride, integer numberOfFrames,
+	const integer *reversal, const double *twiddles)
+{
+	integer iframe = 0;
+	if (n <= maximumBatchedFrameSize) for (; iframe + batchSize <= numberOfFrames; iframe += batchSize) {
+		double *frame [batchSize];
+		for (integer i = 0; i < batchSize; i ++)
+			frame [i] = first + (iframe + i) * stride;
+		if (backward_)
+			backward <batchSize> (n, frame, reversal, twiddles);
+		else
+			forward <batchSize> (n, frame, reversal, twiddles);
+	}
+	for (; iframe < numberOfFrames; iframe ++) {
+		double *frame [1] = { first + iframe * stride };
+		if (backward_)
+			backward <1> (n, frame, reversal, twiddles);
+		else
+			forward <1> (n, frame, reversal, twiddles);
+	}
+}
+
+}   // end of namespace NUMfft_pow2
+
+/* End of file NUMfft_pow2.h */
@@ -221,13 +221,13 @@ autoRoots Polynomial_to_Roots (Polynomial me) {
 		+ 2 * n 	; for real and imaginary parts
 		+ 6 * n		; the maximum for dhseqr_
 */
-void Polynomial_into_Roots (Polynomial me, Roots r, VEC const& workspace) {
+bool Polynomial_into_Roots (Polynomial me, Roots r, VEC const& workspace) {
 	Melder_assert (my numberOfCoefficients == my coefficients.size); // check invariant
 	r -> roots.resize (0);
 	r -> numberOfRoots = r -> roots.size; 	
 	integer np1 = my numberOfCoefficients, n = np1 - 1;
 	if (n == 0)
-		return;
+		return true;
 	/*
 		Use the workspace reserve storage for Hessenberg matrix (n * n)
 	*/
@@ -261,11 +261,11 @@ void Polynomial_into_Roots (Polynomial me, Roots r, VEC const& workspace) {
 		WR and WI contain those eigenvalues which have been successfully computed
 		*/
 		numberOfEigenvaluesFound -= info;
-		Melder_require (numberOfEigenvaluesFound > 0,
-			U"No eigenvalues found.");
+		if (numberOfEigenvaluesFound <= 0)
+			return false;   // no eigenvalues found
 		ioffset = info;
 	} else if (info < 0) {
-		Melder_throw (U"NUMlapack_dhseqr_ returns error ", info, U".");
+		return false;   // NUMlapack_dhseqr_ reports an illegal argument
 	}
 
 	for (integer i = 1; i <= numberOfEigenvaluesFound; i ++) {
@@ -275,6 +275,7 @@ void Polynomial_into_Roots (Polynomial me, Roots r, VEC const& workspace) {
 	}
 	r -> numberOfRoots = r -> roots . size; // maintain invariant
 	Roots_Polynomial_polish (r, me);
+	return true;
 }
 
 void Roots_sort (Roots me) {
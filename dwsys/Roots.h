@@ -62,6 +62,8 @@ autoPolynomial Roots_to_Polynomial (Roots me, bool rootsAreReal);
 		n * n		; for hessenberg matrix
 		+ 2 * n 	; for real and imaginary parts
 		+ n			; for dhseqr_
+	Returns false (with r empty) if no roots could be found.
+	Does not throw, so that threads can call it without touching the error buffer.
 */
-void Polynomial_into_Roots (Polynomial me, Roots r, VEC const& workspace);
+bool Polynomial_into_Roots (Polynomial me, Roots r, VEC const& workspace);
 #endif /* _Roots_h_ */
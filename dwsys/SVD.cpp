@@ -124,31 +124,40 @@ double SVD_getTolerance (SVD me) {
 	return my tolerance;
 }
 
+static integer SVD_computeWithLapack (SVD me) {
+	const integer m = my numberOfColumns; // number of rows of input matrix
+	const integer n = my numberOfRows; // number of columns of input matrix
+	double wtmp;
+	integer lwork = -1, info;
+	NUMlapack_dgesvd_ ("S", "O", m, n, & my u [1] [1], m, & my d [1], & my v [1] [1], m, nullptr, m, & wtmp, lwork, & info);
+	if (info != 0)
+		return info;
+	lwork =  Melder_roundUp (wtmp);
+	autoVEC work = raw_VEC (lwork);
+	NUMlapack_dgesvd_ ("S", "O", m, n, & my u [1] [1], m, & my d [1], & my v [1] [1], m, nullptr, m, & work [1], lwork, & info);
+	if (info != 0)
+		return info;
+	/*
+		Because we store the eigenvectors row-wise, they must be transposed
+	*/
+	transpose_mustBeSquare_MAT_inout (my v.get());
+	return 0;
+}
+
 void SVD_compute (SVD me) {
 	try {
-		autoMAT a = copy_MAT (my u.get());
-		integer m = my numberOfColumns; // number of rows of input matrix
-		integer n = my numberOfRows; // number of columns of input matrix
-		double wtmp;
-		integer lwork = -1, info;
-		NUMlapack_dgesvd_ ("S", "O", m, n, & my u [1] [1], m, & my d [1], & my v [1] [1], m, nullptr, m, & wtmp, lwork, & info);
-		Melder_require (info == 0,
-			U"NUMlapack_dgesvd_ query returns error ", info, U".");
-		
-		lwork =  Melder_roundUp (wtmp);
-		autoVEC work = raw_VEC (lwork);
-		NUMlapack_dgesvd_ ("S", "O", m, n, & my u [1] [1], m, & my d [1], & my v [1] [1], m, nullptr, m, & work [1], lwork, & info);		
+		const integer info = SVD_computeWithLapack (me);
 		Melder_require (info == 0,
 			U"NUMlapack_dgesvd_ returns error ", info, U".");
-		/*
-			Because we store the eigenvectors row-wise, they must be transposed
-		*/
-		transpose_mustBeSquare_MAT_inout (my v.get());
 	} catch (MelderError) {
 		Melder_throw (me, U": SVD could not be computed.");
 	}
 }
 
+bool SVD_tryToCompute (SVD me) {
+	return SVD_computeWithLapack (me) == 0;
+}
+
 // V D^2 V'or V D^-2 V
 void SVD_getSquared_preallocated (SVD me, bool inverse, MAT const& m) {
 	Melder_assert (m.nrow == m.ncol && m.ncol == my numberOfColumns);
@@ -46,6 +46,12 @@ void SVD_update (SVD me, constMATVU const& m);
 
 void SVD_compute (SVD me);
 
+bool SVD_tryToCompute (SVD me);
+/*
+	As SVD_compute, but returns false instead of throwing if LAPACK cannot decompose the matrix,
+	so that it can be called for single frames of an analysis on any thread.
+*/
+
 /* Solve Ax = b */
 void SVD_solve_preallocated (SVD me, constVECVU const& b, VECVU const& result);
 autoVEC SVD_solve (SVD me, constVECVU const& b);
@@ -31,6 +31,7 @@
 #include "Sound_to_Pitch.h"
 #include "Vector.h"
 #include "NUM2.h"
+#include "MelderThread.h"
 
 autoSound BandFilterSpectrogram_as_Sound (BandFilterSpectrogram me, int to_dB);
 
@@ -43,6 +44,19 @@ autoSound BandFilterSpectrogram_as_Sound (BandFilterSpectrogram me, int to_dB);
 	where erf(x) = 1 - erfc(x) and n is the windowLength in samples.
 	To compare with the rectangular window we need to divide this by the window width (n -1) x 1^2.
 */
+/*
+	Each thread analyses its frames in its own frame Sound;
+	the window is shared, because it is only read.
+	The windowed frames of a chunk are Fourier-transformed together (NUMfft_forward_batch),
+	after which each frame's power spectrum is handed to the filter bank in turn.
+*/
+struct Sound_into_Spectrogram_extensions_Workspace {
+	autoSound sframe;
+	autoNUMfft_Table fftTable;
+	autoMAT frames;   // one row per frame of a chunk
+	autoSpectrum powerSpectrum;
+};
+
 static void _Spectrogram_windowCorrection (Spectrogram me, integer numberOfSamples_window) {
 	double windowFactor = 1.0;
 	if (numberOfSamples_window > 1) {
@@ -57,34 +71,81 @@ static void _Spectrogram_windowCorrection (Spectrogram me, integer numberOfSampl
 	my z.get()  /=  windowFactor;
 }
 
-static autoSpectrum Sound_to_Spectrum_power (Sound me) {
-	try {
-		autoSpectrum thee = Sound_to_Spectrum (me, true);
-		double scale = 2.0 * thy dx / (my xmax - my xmin);
-		/*
-			factor '2' because we combine positive and negative frequencies
-			thy dx : width of frequency bin
-			my xmax - my xmin : duration of sound
-		*/
-		VEC re = thy z.row (1), im = thy z.row (2);
-		for (integer i = 1; i <= thy nx; i ++) {
-			const double power = scale * (re [i] * re [i] + im [i] * im [i]);
-			re [i] = power;
-			im [i] = 0.0;
-		}
-		/*
-			Correction of frequency bins at 0 Hz and nyquist: don't count for two.
-		*/
-		re [1] *= 0.5;
-		re [thy nx] *= 0.5;
-		return thee;
-	} catch (MelderError) {
-		Melder_throw (me, U": no Spectrum with spectral power created.");
-	}
+/*
+	The same as Sound_to_Spectrum (sframe, true) followed by conversion to power:
+	the spectral power in each bin, with the positive and negative frequencies combined.
+*/
+static void Sound_into_Spectrogram_extensions_getPowerSpectrum (Sound sframe, constVEC const& fft, Spectrum thee) {
+	const integer numberOfSamples = fft.size, numberOfFrequencies = thy nx;
+	Melder_assert (numberOfFrequencies == numberOfSamples / 2 + 1);
+	const double scaling = sframe -> dx;
+	const double scale = 2.0 * thy dx / (sframe -> xmax - sframe -> xmin);
+	/*
+		factor '2' because we combine positive and negative frequencies
+		thy dx : width of frequency bin
+		sframe -> xmax - sframe -> xmin : duration of sound
+	*/
+	VEC re = thy z.row (1), im = thy z.row (2);
+	auto power = [&] (double real, double imaginary) {
+		real *= scaling;
+		imaginary *= scaling;
+		return scale * (real * real + imaginary * imaginary);
+	};
+	re [1] = power (fft [1], 0.0);
+	for (integer i = 2; i < numberOfFrequencies; i ++)
+		re [i] = power (fft [i + i - 2], fft [i + i - 1]);
+	re [numberOfFrequencies] = power (fft [numberOfSamples], 0.0);
+	im  <<=  0.0;
+	/*
+		Correction of frequency bins at 0 Hz and nyquist: don't count for two.
+	*/
+	re [1] *= 0.5;
+	re [numberOfFrequencies] *= 0.5;
+}
+
+/*
+	Window the frames, compute their power spectra, and call `analysePowerSpectrum (powerSpectrum, iframe)` for each.
+*/
+template <typename AnalysePowerSpectrum>
+static void Sound_into_Spectrogram_extensions_runFrames (Sound me, Sampled thee, Sound window, double windowDuration,
+	AnalysePowerSpectrum analysePowerSpectrum, conststring32 progressMessage)
+{
+	const double samplingFrequency = 1.0 / my dx;
+	constexpr integer numberOfFramesPerChunk = 20;
+	MelderThread_runFrameChunks <Sound_into_Spectrogram_extensions_Workspace> (thy nx, numberOfFramesPerChunk,
+		[&] (Sound_into_Spectrogram_extensions_Workspace& workspace) {
+			workspace.sframe = Sound_createSimple (1, windowDuration, samplingFrequency);
+			integer nfft = 2;
+			while (nfft < workspace.sframe -> nx)
+				nfft *= 2;
+			NUMfft_Table_init (& workspace.fftTable, nfft);
+			workspace.frames = zero_MAT (numberOfFramesPerChunk, nfft);
+			workspace.powerSpectrum = Spectrum_create (0.5 / workspace.sframe -> dx, nfft / 2 + 1);
+			workspace.powerSpectrum -> dx = 1.0 / (workspace.sframe -> dx * nfft);   // override, as in Sound_to_Spectrum
+		},
+		[&] (Sound_into_Spectrogram_extensions_Workspace& workspace, integer firstFrame, integer lastFrame) {
+			Sound sframe = workspace.sframe.get();
+			const integer numberOfFramesInChunk = lastFrame - firstFrame + 1;
+			MAT frames (workspace.frames.cells, numberOfFramesInChunk, workspace.frames.ncol);
+			for (integer iframe = firstFrame; iframe <= lastFrame; iframe ++) {
+				const double t = Sampled_indexToX (thee, iframe);
+				Sound_into_Sound (me, sframe, t - windowDuration / 2.0);
+				Sounds_multiply (sframe, window);
+				VEC frame = frames.row (iframe - firstFrame + 1);
+				frame.part (1, sframe -> nx)  <<=  sframe -> z.row (1);
+				frame.part (sframe -> nx + 1, frame.size)  <<=  0.0;
+			}
+			NUMfft_forward_batch (& workspace.fftTable, frames);
+			for (integer iframe = firstFrame; iframe <= lastFrame; iframe ++) {
+				Sound_into_Spectrogram_extensions_getPowerSpectrum (sframe, frames.row (iframe - firstFrame + 1),
+						workspace.powerSpectrum.get());
+				analysePowerSpectrum (workspace.powerSpectrum.get(), iframe);
+			}
+		}, progressMessage
+	);
 }
 
-static void Sound_into_BarkSpectrogram_frame (Sound me, BarkSpectrogram thee, integer frame) {
-	autoSpectrum him = Sound_to_Spectrum_power (me);
+static void Spectrum_into_BarkSpectrogram_frame (Spectrum him, BarkSpectrogram thee, integer frame) {
 	integer numberOfFrequencies = his nx;
 
 	autoVEC z = raw_VEC (numberOfFrequencies);
@@ -134,23 +195,16 @@ autoBarkSpectrogram Sound_to_BarkSpectrogram (Sound me, double analysisWidth, do
 		integer numberOfFrames;
 		double t1;
 		Sampled_shortTermAnalysis (me, windowDuration, dt, & numberOfFrames, & t1);
-		autoSound sframe = Sound_createSimple (1, windowDuration, samplingFrequency);
 		autoSound window = Sound_createGaussian (windowDuration, samplingFrequency);
 		autoBarkSpectrogram thee = BarkSpectrogram_create (my xmin, my xmax, numberOfFrames, dt, t1, fmin_bark, fmax_bark, numberOfFilters, df_bark, f1_bark);
 
 		autoMelderProgress progess (U"BarkSpectrogram analysis");
 
-		for (integer iframe = 1; iframe <= numberOfFrames; iframe ++) {
-			const double t = Sampled_indexToX (thee.get(), iframe);
-
-			Sound_into_Sound (me, sframe.get(), t - windowDuration / 2.0);
-			Sounds_multiply (sframe.get(), window.get());
-			Sound_into_BarkSpectrogram_frame (sframe.get(), thee.get(), iframe);
-
-			if (iframe % 10 == 1)
-				Melder_progress ( (double) iframe / numberOfFrames,  U"BarkSpectrogram analysis: frame ",
-					iframe, U" from ", numberOfFrames, U".");
-		}
+		Sound_into_Spectrogram_extensions_runFrames (me, thee.get(), window.get(), windowDuration,
+			[&] (Spectrum powerSpectrum, integer iframe) {
+				Spectrum_into_BarkSpectrogram_frame (powerSpectrum, thee.get(), iframe);
+			}, U"BarkSpectrogram analysis"
+		);
 		
 		_Spectrogram_windowCorrection ((Spectrogram) thee.get(), window -> nx);
 
@@ -160,8 +214,7 @@ autoBarkSpectrogram Sound_to_BarkSpectrogram (Sound me, double analysisWidth, do
 	}
 }
 
-static void Sound_into_MelSpectrogram_frame (Sound me, MelSpectrogram thee, integer frame) {
-	autoSpectrum him = Sound_to_Spectrum_power (me);
+static void Spectrum_into_MelSpectrogram_frame (Spectrum him, MelSpectrogram thee, integer frame) {
 
 	for (integer ifilter = 1; ifilter <= thy ny; ifilter ++) {
 		longdouble power = 0.0;
@@ -170,7 +223,7 @@ static void Sound_into_MelSpectrogram_frame (Sound me, MelSpectrogram thee, inte
 		const double fl_hz = thy v_frequencyToHertz (fc_mel - thy dy);
 		const double fh_hz =  thy v_frequencyToHertz (fc_mel + thy dy);
 		integer ifrom, ito;
-		Sampled_getWindowSamples (him.get(), fl_hz, fh_hz, & ifrom, & ito);
+		Sampled_getWindowSamples (him, fl_hz, fh_hz, & ifrom, & ito);
 		for (integer i = ifrom; i <= ito; i ++) {
 			/*
 				Bin with a triangular filter the power (= amplitude-squared)
@@ -211,21 +264,16 @@ autoMelSpectrogram Sound_to_MelSpectrogram (Sound me, double analysisWidth, doub
 		integer numberOfFrames;
 		double t1;
 		Sampled_shortTermAnalysis (me, windowDuration, dt, & numberOfFrames, & t1);
-		autoSound sframe = Sound_createSimple (1, windowDuration, samplingFrequency);
 		autoSound window = Sound_createGaussian (windowDuration, samplingFrequency);
 		autoMelSpectrogram thee = MelSpectrogram_create (my xmin, my xmax, numberOfFrames, dt, t1, fmin_mel, fmax_mel, numberOfFilters, df_mel, f1_mel);
 
 		autoMelderProgress progress (U"MelSpectrograms analysis");
 
-		for (integer iframe = 1; iframe <= numberOfFrames; iframe ++) {
-			const double t = Sampled_indexToX (thee.get(), iframe);
-			Sound_into_Sound (me, sframe.get(), t - windowDuration / 2.0);
-			Sounds_multiply (sframe.get(), window.get());
-			Sound_into_MelSpectrogram_frame (sframe.get(), thee.get(), iframe);
-			
-			if (iframe % 10 == 1)
-				Melder_progress ((double) iframe / numberOfFrames, U"Frame ", iframe, U" out of ", numberOfFrames, U".");
-		}
+		Sound_into_Spectrogram_extensions_runFrames (me, thee.get(), window.get(), windowDuration,
+			[&] (Spectrum powerSpectrum, integer iframe) {
+				Spectrum_into_MelSpectrogram_frame (powerSpectrum, thee.get(), iframe);
+			}, U"MelSpectrogram analysis"
+		);
 		
 		_Spectrogram_windowCorrection ((Spectrogram) thee.get(), window -> nx);
 
@@ -239,9 +287,8 @@ autoMelSpectrogram Sound_to_MelSpectrogram (Sound me, double analysisWidth, doub
 	Analog formant filter response :
 	H(f) = i f B / (f1^2 - f^2 + i f B)
 */
-static int Sound_into_Spectrogram_frame (Sound me, Spectrogram thee, integer frame, double bw) {
+static int Spectrum_into_Spectrogram_frame (Spectrum him, Spectrogram thee, integer frame, double bw) {
 	Melder_assert (bw > 0.0);
-	autoSpectrum him = Sound_to_Spectrum_power (me);
 
 	for (integer ifilter = 1; ifilter <= thy ny; ifilter ++) {
 		const double fc = thy y1 + (ifilter - 1) * thy dy;
@@ -311,33 +358,27 @@ autoSpectrogram Sound_Pitch_to_Spectrogram (Sound me, Pitch thee, double analysi
 		const integer numberOfFilters = Melder_iround ( (fmax_hz - f1_hz) / df_hz);
 
 		double t1;
-		integer numberOfFrames, numberOfUndefinedPitchFrames = 0;
+		integer numberOfFrames;
+		std::atomic <integer> numberOfUndefinedPitchFrames (0);
 		Sampled_shortTermAnalysis (me, windowDuration, dt, & numberOfFrames, & t1);
 		autoSpectrogram him = Spectrogram_create (my xmin, my xmax, numberOfFrames, dt, t1, fmin_hz, fmax_hz, numberOfFilters, df_hz, f1_hz);
 
 		// Temporary objects
 
-		autoSound sframe = Sound_createSimple (1, windowDuration, samplingFrequency);
 		autoSound window = Sound_createGaussian (windowDuration, samplingFrequency);
 		autoMelderProgress progress (U"Sound & Pitch: To FormantFilter");
-		for (integer iframe = 1; iframe <= numberOfFrames; iframe ++) {
-			const double t = Sampled_indexToX (him.get(), iframe);
-			double f0 = Pitch_getValueAtTime (thee, t, kPitch_unit::HERTZ, 0);
-
-			if (isundef (f0) || f0 == 0.0) {
-				numberOfUndefinedPitchFrames ++;
-				f0 = f0_median;
-			}
-			const double b = relative_bw * f0;
-			Sound_into_Sound (me, sframe.get(), t - windowDuration / 2.0);
-			Sounds_multiply (sframe.get(), window.get());
-
-			Sound_into_Spectrogram_frame (sframe.get(), him.get(), iframe, b);
-
-			if (iframe % 10 == 1)
-				Melder_progress ((double) iframe / numberOfFrames, U"Frame ", iframe, U" out of ",
-					numberOfFrames, U".");
-		}
+		Sound_into_Spectrogram_extensions_runFrames (me, him.get(), window.get(), windowDuration,
+			[&] (Spectrum powerSpectrum, integer iframe) {
+				const double t = Sampled_indexToX (him.get(), iframe);
+				double f0 = Pitch_getValueAtTime (thee, t, kPitch_unit::HERTZ, 0);
+				if (isundef (f0) || f0 == 0.0) {
+					numberOfUndefinedPitchFrames ++;
+					f0 = f0_median;
+				}
+				const double b = relative_bw * f0;
+				Spectrum_into_Spectrogram_frame (powerSpectrum, him.get(), iframe, b);
+			}, U"Sound & Pitch: To FormantFilter"
+		);
 		
 		_Spectrogram_windowCorrection (him.get(), window -> nx);
 
@@ -1,6 +1,6 @@
 /* LongSound.cpp
  *
- * Copyright (C) 1992-2008,2010-2019 Paul Boersma, 2007 Erez Volk (for FLAC and MP3)
+ * Copyright (C) 1992-2008,2010-2019,2021 Paul Boersma, 2007 Erez Volk (for FLAC and MP3)
  *
  * This code is free software; you can redistribute it and/or modify
  * it under the terms of the GNU General Public License as published by
@@ -39,12 +39,26 @@
  * pb 2011/06/02 C++
  * pb 2011/07/05 C++
  * pb 2014/06/16 more support for more than 2 channels
+ * pb 2021/06/05 memory-mapped reading of uncompressed files
+ * pb 2021/06/07 reading ahead in a background thread; stall times
  */
 
 #include "LongSound.h"
 #include "Preferences.h"
 #include "flac_FLAC_stream_decoder.h"
 #include "mp3.h"
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+
+#if defined (UNIX) || defined (macintosh)
+	#include <sys/mman.h>
+	#include <sys/stat.h>
+	#include <unistd.h>
+	#define USE_MMAP  1
+#else
+	#define USE_MMAP  0
+#endif
 
 Thing_implement (LongSound, Sampled, 0);
 Thing_implement (SoundAndLongSoundList, Ordered, 0);
@@ -70,12 +84,78 @@ void LongSound_setBufferSizePref_seconds (integer size) {
 	prefs_bufferLength = Melder_clipped (minimumBufferDuration, size, maximumBufferDuration);
 }
 
+/*
+	Reading ahead.
+	After each buffer refill, a background thread reads the window that will probably be asked for next
+	(the one after the buffer when scrolling or playing forward, the one before it when scrolling backward).
+	It has its own LongSound, i.e. its own file pointer and decoder, so that it never disturbs the main one,
+	and the buffer of that LongSound is the second half of a double buffer:
+	a refill that finds its samples there is a memcpy rather than a seek and a decode.
+*/
+struct LongSoundPrefetcher {
+	autoLongSound reader;   // the samples that are ready are reader -> buffer [reader -> imin .. reader -> imax]
+	autoBYTEVEC bytes;   // the undecoded samples, if the reader has to read them from the file
+	std::thread thread;
+	std::mutex mutex;
+	std::condition_variable changed;
+	integer requestedImin = 1, requestedImax = 0;   // what the thread should read next
+	integer busyImin = 1, busyImax = 0;   // what the thread is reading now
+	bool busy = false, stopping = false;
+};
+
+static bool _LongSound_tryToReadAudioToShort (LongSound me, int16 *buffer, integer firstSample, integer numberOfSamples, BYTEVEC const& bytes);
+
+static void LongSoundPrefetcher_work (LongSoundPrefetcher *me) {
+	std::unique_lock <std::mutex> lock (my mutex);
+	for (;;) {
+		my changed.wait (lock, [&] { return my stopping || my requestedImax >= my requestedImin; });
+		if (my stopping)
+			return;
+		LongSound reader = my reader.get();
+		my busyImin = my requestedImin;
+		my busyImax = my requestedImax;
+		my requestedImin = 1;
+		my requestedImax = 0;
+		my busy = true;
+		reader -> invalidateBuffer ();
+		lock.unlock ();
+		/*
+			This thread must not throw, because the error buffer belongs to the main thread.
+		*/
+		const bool succeeded = _LongSound_tryToReadAudioToShort (reader, reader -> buffer.asArgumentToFunctionThatExpectsZeroBasedArray(),
+				my busyImin, my busyImax - my busyImin + 1, my bytes.get());
+		lock.lock ();
+		my busy = false;
+		if (succeeded) {
+			reader -> imin = my busyImin;
+			reader -> imax = my busyImax;
+		}   // otherwise, the main thread will read these samples itself, and report any problem
+		my changed.notify_all ();
+	}
+}
+
+static void LongSoundPrefetcher_delete (LongSoundPrefetcher *me) {
+	{
+		std::lock_guard <std::mutex> lock (my mutex);
+		my stopping = true;
+	}
+	my changed.notify_all ();
+	my thread. join ();
+	delete me;
+}
+
 void structLongSound :: v_destroy () noexcept {
 	/*
 		The play callback may contain a pointer to my buffer.
 		That pointer is about to dangle, so kill the playback.
 	*/
 	MelderAudio_stopPlaying (MelderAudio_IMPLICIT);
+	if (prefetcher)
+		LongSoundPrefetcher_delete (prefetcher);
+	#if USE_MMAP
+		if (mappedFile)
+			munmap ((void *) mappedFile, mappedFileSize);
+	#endif
 	if (mp3f)
 		mp3f_delete (mp3f);
 	if (flacDecoder) {
@@ -106,6 +186,13 @@ void structLongSound :: v_info () {
 	MelderInfo_writeLine (U"Sampling frequency: ", sampleRate, U" Hz");
 	MelderInfo_writeLine (U"Size: ", nx, U" samples");
 	MelderInfo_writeLine (U"Start of sample data: ", startOfData, U" bytes from the start of the file");
+	MelderInfo_writeLine (U"Reading: ", samplesAreMapped ? U"memory-mapped, without buffering" : mappedFile ? U"memory-mapped" : U"buffered",
+			prefetchable ? U", read ahead in the background" : U"");
+	MelderInfo_writeLine (U"Buffer refills: ", numberOfRefills, U" (", numberOfReadsFromPrefetch, U" reads found read ahead)");
+	if (numberOfRefills > 0) {
+		MelderInfo_writeLine (U"   Stall time per refill: ", Melder_fixed (1000.0 * totalStallTime / numberOfRefills, 3),
+				U" ms on average, ", Melder_fixed (1000.0 * maximumStallTime, 3), U" ms at most, ", Melder_fixed (1000.0 * lastStallTime, 3), U" ms last");
+	}
 }
 
 static void _LongSound_FLAC_convertFloats (LongSound me, const int32 * const samples[], integer bitsPerSample, integer numberOfSamples) {
@@ -203,6 +290,58 @@ static void _LongSound_MP3_convert (const MP3F_SAMPLE *channels [MP3F_MAX_CHANNE
 	my compressedSamplesLeft -= numberOfSamples;
 }
 
+/*
+	Map uncompressed files into memory, so that samples can be decoded from memory instead of read with fread.
+	Debug 59 switches this off, so that the two ways of reading can be compared.
+*/
+static void _LongSound_mapFile (LongSound me) {
+	#if USE_MMAP
+		if (my flacDecoder || my mp3f || Melder_debug == 59)
+			return;
+		const double numberOfBytesNeeded = my startOfData + (double) my nx * my numberOfChannels * my numberOfBytesPerSamplePoint;
+		struct stat status;
+		if (fstat (fileno (my f), & status) != 0 || status.st_size < numberOfBytesNeeded || (double) status.st_size > (double) SIZE_MAX)
+			return;   // a file that is too short is left to fread, which pads it with zeroes and warns
+		void *address = mmap (nullptr, (size_t) status.st_size, PROT_READ, MAP_SHARED, fileno (my f), 0);
+		if (address == MAP_FAILED)
+			return;   // e.g. a file system that cannot map; fread will do
+		my mappedFile = (const uint8 *) address;
+		my mappedFileSize = (size_t) status.st_size;
+		static const uint16 byteOrderTest = 1;
+		const bool hostIsLittleEndian = ( * (const uint8 *) & byteOrderTest == 1 );
+		my samplesAreMapped = my startOfData % 2 == 0 && (
+			(my encoding == Melder_LINEAR_16_LITTLE_ENDIAN && hostIsLittleEndian) ||
+			(my encoding == Melder_LINEAR_16_BIG_ENDIAN && ! hostIsLittleEndian)
+		);
+	#else
+		(void) me;
+	#endif
+}
+
+static const uint8 * _LongSound_mappedSample (LongSound me, integer isamp) {
+	return my mappedFile + my startOfData + (isamp - 1) * my numberOfChannels * my numberOfBytesPerSamplePoint;
+}
+
+/*
+	Ask the system to start reading the pages of samples imin..imax (clipped to the file) in the background.
+*/
+static void _LongSound_adviseWillNeed (LongSound me, integer imin, integer imax) {
+	#if USE_MMAP
+		Melder_clipLeft (1_integer, & imin);
+		Melder_clipRight (& imax, my nx);
+		if (! my mappedFile || imax < imin)
+			return;
+		const uintptr_t pageSize = (uintptr_t) sysconf (_SC_PAGESIZE);
+		const uintptr_t first = (uintptr_t) _LongSound_mappedSample (me, imin) / pageSize * pageSize;
+		const uintptr_t end = (uintptr_t) _LongSound_mappedSample (me, imax + 1);
+		(void) madvise ((void *) first, end - first, MADV_WILLNEED);
+	#else
+		(void) me;
+		(void) imin;
+		(void) imax;
+	#endif
+}
+
 static void LongSound_init (LongSound me, MelderFile file) {
 	MelderFile_copy (file, & my file);
 	MelderFile_open (file);   // BUG: should be auto, but that requires an implemented .transfer()
@@ -234,6 +373,7 @@ static void LongSound_init (LongSound me, MelderFile file) {
 	}
 	my imin = 1;
 	my imax = 0;
+	my samples = my buffer.asArgumentToFunctionThatExpectsZeroBasedArray();
 	my flacDecoder = nullptr;
 	if (my audioFileType == Melder_FLAC) {
 		my flacDecoder = FLAC__stream_decoder_new ();
@@ -249,12 +389,30 @@ static void LongSound_init (LongSound me, MelderFile file) {
 		Melder_warning (U"Time measurements in MP3 files can be off by several tens of milliseconds. "
 			U"Please convert to WAV file if you need time precision or annotation.");
 	}
+	my mappedFile = nullptr;
+	my samplesAreMapped = false;
+	_LongSound_mapFile (me);
+	const double numberOfBytesNeeded = my startOfData + (double) my nx * my numberOfChannels * my numberOfBytesPerSamplePoint;
+	/*
+		Reading ahead pays off for decoding and for fread, not for mapped files, where the system reads ahead for us.
+		Debug 60 switches it off, so that playing with and without reading ahead can be compared.
+	*/
+	my prefetchable = ( my flacDecoder || my mp3f ||
+			(! my mappedFile && MelderFile_length (& my file) >= numberOfBytesNeeded) ) &&   // not for short files, which the main thread has to read and warn about anyway
+			Melder_debug != 60;
+	my prefetcher = nullptr;
+	my previousRequestedImin = 0;
+	my scrollDirection = +1;
+	my numberOfRefills = my numberOfReadsFromPrefetch = 0;
+	my totalStallTime = my maximumStallTime = my lastStallTime = 0.0;
 }
 
 void structLongSound :: v_copy (Daata thee_Daata) {
 	LongSound thee = static_cast <LongSound> (thee_Daata);
 	thy f = nullptr;
 	thy buffer.releaseToAmbiguousOwner();   // this may have been shallow-copied, so undangle and nullify
+	thy mappedFile = nullptr;   // likewise; the copy gets its own mapping
+	thy prefetcher = nullptr;   // likewise; the copy gets its own thread
 	LongSound_init (thee, & our file);   // this recreates a new buffer
 }
 
@@ -268,16 +426,27 @@ autoLongSound LongSound_open (MelderFile file) {
 	}
 }
 
-static void _LongSound_FLAC_process (LongSound me, integer firstSample, integer numberOfSamples) {
-	my compressedSamplesLeft = numberOfSamples - 1;
-	if (! FLAC__stream_decoder_seek_absolute (my flacDecoder, firstSample))
-		Melder_throw (U"Cannot seek in FLAC file ", & my file, U".");
+/*
+	Decode `numberOfSamples` samples, starting with sample number `firstSample` (counted from 1),
+	into the compressed buffers.
+	The _tryTo versions do not throw and do not touch the error buffer, so that they can run in the read-ahead thread.
+*/
+static bool _LongSound_FLAC_tryToProcess (LongSound me, integer firstSample, integer numberOfSamples) {
+	my compressedSamplesLeft = numberOfSamples;
+	if (! FLAC__stream_decoder_seek_absolute (my flacDecoder, firstSample - 1))   // FLAC counts from 0
+		return false;
 	while (my compressedSamplesLeft > 0) {
 		if (FLAC__stream_decoder_get_state (my flacDecoder) == FLAC__STREAM_DECODER_END_OF_STREAM)
-			Melder_throw (U"FLAC file ", & my file, U" too short.");
+			return false;   // file too short
 		if (! FLAC__stream_decoder_process_single (my flacDecoder))
-			Melder_throw (U"Error decoding FLAC file ", & my file, U".");
+			return false;
 	}
+	return true;
+}
+
+static void _LongSound_FLAC_process (LongSound me, integer firstSample, integer numberOfSamples) {
+	if (! _LongSound_FLAC_tryToProcess (me, firstSample, numberOfSamples))
+		Melder_throw (U"Cannot decode FLAC file ", & my file, U" from sample ", firstSample, U" on.");
 }
 
 static void _LongSound_FILE_seekSample (LongSound me, integer firstSample) {
@@ -288,21 +457,25 @@ static void _LongSound_FILE_seekSample (LongSound me, integer firstSample) {
 static void _LongSound_FLAC_readAudioToShort (LongSound me, int16 *buffer, integer firstSample, integer numberOfSamples) {
 	my compressedMode = COMPRESSED_MODE_READ_SHORT;
 	my compressedShorts = buffer + 1;
-	_LongSound_FLAC_process (me, firstSample, numberOfSamples);
+	_LongSound_FLAC_process (me, firstSample + 1, numberOfSamples - 1);
 }
 
-static void _LongSound_MP3_process (LongSound me, integer firstSample, integer numberOfSamples) {
-	if (! mp3f_seek (my mp3f, firstSample))
-		Melder_throw (U"Cannot seek in MP3 file ", & my file, U".");
+static bool _LongSound_MP3_tryToProcess (LongSound me, integer firstSample, integer numberOfSamples) {
+	if (! mp3f_seek (my mp3f, firstSample - 1))   // mp3f counts from 0
+		return false;
 	my compressedSamplesLeft = numberOfSamples;
-	if (! mp3f_read (my mp3f, numberOfSamples))
-		Melder_throw (U"Error decoding MP3 file ", & my file, U".");
+	return mp3f_read (my mp3f, numberOfSamples) != 0;
+}
+
+static void _LongSound_MP3_process (LongSound me, integer firstSample, integer numberOfSamples) {
+	if (! _LongSound_MP3_tryToProcess (me, firstSample, numberOfSamples))
+		Melder_throw (U"Cannot decode MP3 file ", & my file, U" from sample ", firstSample, U" on.");
 }
 
 static void _LongSound_MP3_readAudioToShort (LongSound me, int16 *buffer, integer firstSample, integer numberOfSamples) {
 	my compressedMode = COMPRESSED_MODE_READ_SHORT;
 	my compressedShorts = buffer + 1;
-	_LongSound_MP3_process (me, firstSample, numberOfSamples - 1);
+	_LongSound_MP3_process (me, firstSample + 1, numberOfSamples - 1);
 }
 
 void LongSound_readAudioToFloat (LongSound me, MAT buffer, integer firstSample) {
@@ -319,6 +492,9 @@ void LongSound_readAudioToFloat (LongSound me, MAT buffer, integer firstSample)
 			my compressedFloats [ichan - 1] = & buffer [ichan] [1];
 		}
 		_LongSound_MP3_process (me, firstSample, buffer.ncol);
+	} else if (my mappedFile) {
+		Melder_assert (firstSample >= 1 && firstSample - 1 + buffer.ncol <= my nx);
+		Melder_decodeAudioToFloat (_LongSound_mappedSample (me, firstSample), my encoding, buffer);
 	} else {
 		_LongSound_FILE_seekSample (me, firstSample);
 		Melder_readAudioToFloat (my f, my encoding, buffer);
@@ -330,12 +506,47 @@ void LongSound_readAudioToShort (LongSound me, int16 *buffer, integer firstSampl
 		_LongSound_FLAC_readAudioToShort (me, buffer, firstSample, numberOfSamples);
 	} else if (my encoding == Melder_MPEG_COMPRESSION_16) {
 		_LongSound_MP3_readAudioToShort (me, buffer, firstSample, numberOfSamples);
+	} else if (my mappedFile) {
+		Melder_assert (firstSample >= 1 && firstSample - 1 + numberOfSamples <= my nx);
+		Melder_decodeAudioToShort (_LongSound_mappedSample (me, firstSample), my numberOfChannels, my encoding, buffer, numberOfSamples);
 	} else {
 		_LongSound_FILE_seekSample (me, firstSample);
 		Melder_readAudioToShort (my f, my numberOfChannels, my encoding, buffer, numberOfSamples);
 	}
 }
 
+/*
+	As LongSound_readAudioToShort (), but for the read-ahead thread:
+	instead of throwing, or warning about a file that is too short, return false.
+	Uncompressed files that are not mapped are read into `bytes` and decoded from there.
+*/
+static bool _LongSound_tryToReadAudioToShort (LongSound me, int16 *buffer, integer firstSample, integer numberOfSamples, BYTEVEC const& bytes) {
+	if (my encoding == Melder_FLAC_COMPRESSION_16) {
+		my compressedMode = COMPRESSED_MODE_READ_SHORT;
+		my compressedShorts = buffer + 1;
+		return _LongSound_FLAC_tryToProcess (me, firstSample + 1, numberOfSamples - 1);
+	} else if (my encoding == Melder_MPEG_COMPRESSION_16) {
+		my compressedMode = COMPRESSED_MODE_READ_SHORT;
+		my compressedShorts = buffer + 1;
+		return _LongSound_MP3_tryToProcess (me, firstSample + 1, numberOfSamples - 1);
+	} else if (my mappedFile) {
+		if (firstSample < 1 || firstSample - 1 + numberOfSamples > my nx)
+			return false;
+		Melder_decodeAudioToShort (_LongSound_mappedSample (me, firstSample), my numberOfChannels, my encoding, buffer, numberOfSamples);
+		return true;
+	} else {
+		const integer numberOfBytes = numberOfSamples * my numberOfChannels * my numberOfBytesPerSamplePoint;
+		if (numberOfBytes > bytes.size)
+			return false;
+		if (fseek (my f, my startOfData + (firstSample - 1) * my numberOfChannels * my numberOfBytesPerSamplePoint, SEEK_SET))
+			return false;
+		if (fread (bytes.asArgumentToFunctionThatExpectsZeroBasedArray(), 1, (size_t) numberOfBytes, my f) != (size_t) numberOfBytes)
+			return false;
+		Melder_decodeAudioToShort (bytes.asArgumentToFunctionThatExpectsZeroBasedArray(), my numberOfChannels, my encoding, buffer, numberOfSamples);
+		return true;
+	}
+}
+
 autoSound LongSound_extractPart (LongSound me, double tmin, double tmax, bool preserveTimes) {
 	try {
 		Function_unidirectionalAutowindow (me, & tmin, & tmax);
@@ -361,8 +572,79 @@ autoSound LongSound_extractPart (LongSound me, double tmin, double tmax, bool pr
 	}
 }
 
+static LongSoundPrefetcher * _LongSound_getPrefetcher (LongSound me) {
+	if (! my prefetcher && my prefetchable) {
+		try {
+			autoMelderWarningOff nowarn;   // no second MP3 warning
+			autoLongSound reader = LongSound_open (& my file);
+			autoBYTEVEC bytes;
+			if (! reader -> flacDecoder && ! reader -> mp3f && ! reader -> mappedFile)
+				bytes = raw_BYTEVEC (reader -> nmax * reader -> numberOfChannels * reader -> numberOfBytesPerSamplePoint);
+			LongSoundPrefetcher *prefetcher = new LongSoundPrefetcher;
+			prefetcher -> reader = reader.move();
+			prefetcher -> bytes = bytes.move();
+			prefetcher -> thread = std::thread (LongSoundPrefetcher_work, prefetcher);
+			my prefetcher = prefetcher;
+		} catch (MelderError) {
+			Melder_clearError ();
+			my prefetchable = false;   // read synchronously, as before
+		}
+	}
+	return my prefetcher;
+}
+
+/*
+	Ask for the window of n samples after the buffer (direction +1) or before it (direction -1).
+*/
+static void _LongSound_prefetch (LongSound me, int direction, integer n) {
+	LongSoundPrefetcher *prefetcher = _LongSound_getPrefetcher (me);
+	if (! prefetcher || my imax < my imin)
+		return;
+	LongSound reader = prefetcher -> reader.get();
+	n = Melder_clippedRight (n, reader -> nmax);
+	const integer imin = ( direction > 0 ? my imax + 1 : Melder_clippedLeft (1_integer, my imin - n) );
+	const integer imax = ( direction > 0 ? Melder_clippedRight (my imax + n, my nx) : my imin - 1 );
+	if (imax < imin)
+		return;   // at the edge of the file
+	{
+		std::lock_guard <std::mutex> lock (prefetcher -> mutex);
+		const bool isReady = ! prefetcher -> busy && imin >= reader -> imin && imax <= reader -> imax;
+		const bool isBeingRead = prefetcher -> busy && imin >= prefetcher -> busyImin && imax <= prefetcher -> busyImax;
+		if (isReady || isBeingRead)
+			return;
+		prefetcher -> requestedImin = imin;
+		prefetcher -> requestedImax = imax;
+	}
+	prefetcher -> changed.notify_all ();
+}
+
+/*
+	Copy samples imin..imax from the read-ahead buffer, if they are there,
+	or are being read or about to be read there (waiting for that is never slower than reading them ourselves).
+*/
+static bool _LongSound_copyPrefetchedSamples (LongSound me, int16 *buffer, integer imin, integer imax) {
+	LongSoundPrefetcher *prefetcher = my prefetcher;
+	if (! prefetcher)
+		return false;
+	std::unique_lock <std::mutex> lock (prefetcher -> mutex);
+	prefetcher -> changed.wait (lock, [&] {
+		const bool isBeingRead = prefetcher -> busy && imin >= prefetcher -> busyImin && imax <= prefetcher -> busyImax;
+		const bool isAboutToBeRead = imin >= prefetcher -> requestedImin && imax <= prefetcher -> requestedImax;
+		return ! isBeingRead && ! isAboutToBeRead;
+	});
+	LongSound reader = prefetcher -> reader.get();
+	if (prefetcher -> busy || imin < reader -> imin || imax > reader -> imax)
+		return false;
+	memcpy (buffer, reader -> buffer.asArgumentToFunctionThatExpectsZeroBasedArray() + (imin - reader -> imin) * my numberOfChannels,
+			(size_t) ((imax - imin + 1) * my numberOfChannels) * sizeof (int16));
+	return true;
+}
+
 static void _LongSound_readSamples (LongSound me, int16 *buffer, integer imin, integer imax) {
-	LongSound_readAudioToShort (me, buffer, imin, imax - imin + 1);
+	if (_LongSound_copyPrefetchedSamples (me, buffer, imin, imax))
+		my numberOfReadsFromPrefetch += 1;
+	else
+		LongSound_readAudioToShort (me, buffer, imin, imax - imin + 1);
 }
 
 static void writePartToOpenFile (LongSound me, int audioFileType, integer imin, integer n, MelderFile file, int numberOfChannels_override, int numberOfBitsPerSamplePoint) {
@@ -415,14 +697,8 @@ void LongSound_saveChannelAsAudioFile (LongSound me, int audioFileType, integer
 	}
 }
 
-static void _LongSound_haveSamples (LongSound me, integer imin, integer imax) {
+static void _LongSound_refillBuffer (LongSound me, integer imin, integer imax) {
 	integer n = imax - imin + 1;
-	Melder_assert (n <= my nmax);
-	/*
-		Included?
-	*/
-	if (imin >= my imin && imax <= my imax)
-		return;
 	/*
 		Extendable?
 	*/
@@ -500,6 +776,40 @@ static void _LongSound_haveSamples (LongSound me, integer imin, integer imax) {
 	my imax = imax;
 }
 
+static void _LongSound_haveSamples (LongSound me, integer imin, integer imax) {
+	const integer n = imax - imin + 1;
+	Melder_assert (n <= my nmax);
+	/*
+		Read ahead by one window on either side, for scrolling and playing in either direction.
+	*/
+	_LongSound_adviseWillNeed (me, imin - n, imax + n);
+	if (my samplesAreMapped) {
+		my imin = 1;
+		my imax = my nx;
+		my samples = (const int16 *) _LongSound_mappedSample (me, 1);
+		return;
+	}
+	my samples = my buffer.asArgumentToFunctionThatExpectsZeroBasedArray();
+	if (imin != my previousRequestedImin && my previousRequestedImin != 0)
+		my scrollDirection = ( imin > my previousRequestedImin ? +1 : -1 );
+	my previousRequestedImin = imin;
+	/*
+		Included?
+	*/
+	if (imin < my imin || imax > my imax) {
+		const double startTime = Melder_clock ();
+		const integer numberOfReadsFromPrefetch = my numberOfReadsFromPrefetch;
+		_LongSound_refillBuffer (me, imin, imax);
+		my lastStallTime = Melder_clock () - startTime;
+		my numberOfRefills += 1;
+		my totalStallTime += my lastStallTime;
+		Melder_clipLeft (my lastStallTime, & my maximumStallTime);
+		trace (U"refill ", my numberOfRefills, U" of samples ", my imin, U"..", my imax, U": stalled ", 1000.0 * my lastStallTime, U" ms",
+				my numberOfReadsFromPrefetch > numberOfReadsFromPrefetch ? U" (read ahead)" : U"");
+	}
+	_LongSound_prefetch (me, my scrollDirection, Melder_ifloor ((1.0 + 2.0 * MARGIN) * n) + 1);
+}
+
 bool LongSound_haveWindow (LongSound me, double tmin, double tmax) {
 	integer imin, imax;
 	const integer n = Sampled_getWindowSamples (me, tmin, tmax, & imin, & imax);
@@ -522,7 +832,7 @@ void LongSound_getWindowExtrema (LongSound me, double tmin, double tmax, integer
 	}
 	integer minimum_int = 32767, maximum_int = -32768;
 	for (integer i = imin; i <= imax; i ++) {
-		const integer value = my buffer [(i - my imin) * my numberOfChannels + channel];
+		const integer value = my samples [(i - my imin) * my numberOfChannels + channel - 1];
 		if (value < minimum_int)
 			minimum_int = value;
 		if (value > maximum_int)
@@ -587,12 +897,12 @@ void LongSound_playPart (LongSound me, double tmin, double tmax,
 			if (thy silenceBefore > 0 || thy silenceAfter > 0 || 1) {
 				thy resampledBuffer = Melder_calloc (int16, (thy silenceBefore + thy numberOfSamples + thy silenceAfter) * my numberOfChannels);
 				memcpy (& thy resampledBuffer [thy silenceBefore * my numberOfChannels],
-						my buffer.asArgumentToFunctionThatExpectsZeroBasedArray() + (i1 - my imin) * my numberOfChannels,
+						my samples + (i1 - my imin) * my numberOfChannels,
 						thy numberOfSamples * sizeof (int16) * my numberOfChannels);
 				MelderAudio_play16 (thy resampledBuffer, my sampleRate, thy silenceBefore + thy numberOfSamples + thy silenceAfter,
 						my numberOfChannels, melderPlayCallback, thee);
 			} else {
-				MelderAudio_play16 (my buffer.asArgumentToFunctionThatExpectsZeroBasedArray() + (i1 - my imin) * my numberOfChannels, my sampleRate,
+				MelderAudio_play16 (const_cast <int16 *> (my samples) + (i1 - my imin) * my numberOfChannels, my sampleRate,
 				   thy numberOfSamples, my numberOfChannels, melderPlayCallback, thee);
 			}
 		} else {
@@ -601,7 +911,7 @@ void LongSound_playPart (LongSound me, double tmin, double tmax,
 			const integer silenceBefore = Melder_iroundTowardsZero (newSampleRate * MelderAudio_getOutputSilenceBefore ());
 			const integer silenceAfter = Melder_iroundTowardsZero (newSampleRate * MelderAudio_getOutputSilenceAfter ());
 			int16 *resampledBuffer = Melder_calloc (int16, (silenceBefore + newN + silenceAfter) * my numberOfChannels);
-			int16 *from = my buffer.asArgumentToFunctionThatExpectsZeroBasedArray() + (i1 - my imin) * my numberOfChannels;   // guaranteed: from [0 .. (my imax - my imin + 1) * nchan]
+			const int16 *from = my samples + (i1 - my imin) * my numberOfChannels;   // guaranteed: from [0 .. (my imax - my imin + 1) * nchan]
 			const double t1 = my x1, dt = 1.0 / newSampleRate;
 			thy numberOfSamples = newN;
 			thy dt = dt;
@@ -2,7 +2,7 @@
 #define _LongSound_h_
 /* LongSound.h
  *
- * Copyright (C) 1992-2005,2007,2008,2010-2012,2015-2019 Paul Boersma, 2007 Erez Volk (for FLAC, MP3)
+ * Copyright (C) 1992-2005,2007,2008,2010-2012,2015-2019,2021 Paul Boersma, 2007 Erez Volk (for FLAC, MP3)
  *
  * This code is free software; you can redistribute it and/or modify
  * it under the terms of the GNU General Public License as published by
@@ -41,6 +41,27 @@ Thing_define (LongSound, Sampled) {
 	autovector <int16> buffer;   // this is always 16-bit, because we will always play sounds in 16-bit, even those from 24-bit files
 	integer imin, imax;
 	void invalidateBuffer () noexcept { our imin = 1; our imax = 0; }
+	const int16 *samples;   // base-0, interleaved, samples imin..imax; points into the buffer, or into the mapped file
+
+	/*
+		Uncompressed files are memory-mapped where the platform allows it,
+		so that reading samples is a decoding from memory instead of a seek and an fread.
+		Native-endian 16-bit files need no decoding at all: the mapped file itself serves as the buffer.
+	*/
+	const uint8 *mappedFile;
+	size_t mappedFileSize;
+	bool samplesAreMapped;
+
+	/*
+		Files whose samples are slow to get (FLAC, MP3, or unmapped files) are read ahead in the background (see LongSound.cpp).
+		The statistics tell how long the buffer refills kept the caller waiting.
+	*/
+	bool prefetchable;
+	struct LongSoundPrefetcher *prefetcher;
+	integer previousRequestedImin;
+	int scrollDirection;   // +1 or -1
+	integer numberOfRefills, numberOfReadsFromPrefetch;
+	double totalStallTime, maximumStallTime, lastStallTime;   // seconds
 
 	struct FLAC__StreamDecoder *flacDecoder;
 	struct _MP3_FILE *mp3f;
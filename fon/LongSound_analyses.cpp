@@ -0,0 +1,220 @@
+/* LongSound_analyses.cpp
+ *
+ * Copyright (C) 2021 Paul Boersma
+ *
+ * This code is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or (at
+ * your option) any later version.
+ *
+ * This code is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ * See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this work. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "LongSound_analyses.h"
+#include "Sound_to_Pitch.h"
+#include "Sound_to_Intensity.h"
+#include "Sound_to_Formant.h"
+
+/*
+	The analyses read the file in blocks as long as the buffer of the LongSound,
+	which was set from the preferences when the file was opened.
+*/
+static double LongSound_getBlockDuration (LongSound me) {
+	return my bufferLength;
+}
+
+static bool LongSound_fitsInOneBlock (LongSound me) {
+	return my nx * my dx <= LongSound_getBlockDuration (me);
+}
+
+/*
+	Read samples `firstSample` through `lastSample` of all channels, as floating-point numbers,
+	into a Sound with the original times.
+	This bypasses the 16-bit buffer of the LongSound, so that the analysis has the full precision of the file,
+	and a LongSound editor that shows the same file keeps its buffer.
+*/
+static autoSound LongSound_extractSamples (LongSound me, integer firstSample, integer lastSample) {
+	Melder_assert (firstSample >= 1 && lastSample <= my nx && lastSample >= firstSample);
+	const double x1 = Sampled_indexToX (me, firstSample);
+	autoSound thee = Sound_create (my numberOfChannels, x1 - 0.5 * my dx, Sampled_indexToX (me, lastSample) + 0.5 * my dx,
+			lastSample - firstSample + 1, my dx, x1);
+	LongSound_readAudioToFloat (me, thy z.get(), firstSample);
+	return thee;
+}
+
+/*
+	Analyse the frames of `analysis` in blocks of `blockDuration` seconds.
+	For every block, `readPart (firstSample, lastSample)` has to return the samples (on the sampling grid `grid`)
+	that lie within `margin` seconds from the centres of the frames of the block,
+	after which `analyseBlock (part, firstFrame, lastFrame)` computes those frames.
+*/
+template <typename ReadPart, typename AnalyseBlock>
+static void analyseInBlocks (double blockDuration, Sampled grid, Sampled analysis, double margin,
+	ReadPart readPart, AnalyseBlock analyseBlock)
+{
+	const integer numberOfFramesPerBlock = std::max (1_integer, Melder_ifloor (blockDuration / analysis -> dx));
+	for (integer firstFrame = 1; firstFrame <= analysis -> nx; firstFrame += numberOfFramesPerBlock) {
+		const integer lastFrame = std::min (firstFrame + numberOfFramesPerBlock - 1, analysis -> nx);
+		const integer firstSample = std::max (1_integer,
+				Sampled_xToLowIndex (grid, Sampled_indexToX (analysis, firstFrame) - margin) - 1);
+		const integer lastSample = std::min (grid -> nx,
+				Sampled_xToHighIndex (grid, Sampled_indexToX (analysis, lastFrame) + margin) + 1);
+		autoSound part = readPart (firstSample, lastSample);
+		analyseBlock (part.get(), firstFrame, lastFrame);
+	}
+}
+
+/*
+	The maximum absolute deviation of the samples from the mean of their channel, as in Sound_to_Pitch_any (),
+	computed from the sum, minimum and maximum of every channel in a single pass through the file.
+*/
+static double LongSound_getGlobalPeak (LongSound me) {
+	const integer numberOfSamplesPerBlock = std::min (my nx, std::max (1_integer, Melder_ifloor (LongSound_getBlockDuration (me) / my dx)));
+	autoMAT buffer = raw_MAT (my numberOfChannels, numberOfSamplesPerBlock);
+	autoVEC sum = zero_VEC (my numberOfChannels), minimum = raw_VEC (my numberOfChannels), maximum = raw_VEC (my numberOfChannels);
+	for (integer firstSample = 1; firstSample <= my nx; firstSample += numberOfSamplesPerBlock) {
+		const integer numberOfSamplesInBlock = std::min (numberOfSamplesPerBlock, my nx - firstSample + 1);
+		MAT block (buffer.cells, my numberOfChannels, numberOfSamplesInBlock);
+		LongSound_readAudioToFloat (me, block, firstSample);
+		for (integer ichan = 1; ichan <= my numberOfChannels; ichan ++) {
+			sum [ichan] += NUMsum (block.row (ichan));
+			const MelderRealRange extrema = NUMextrema (block.row (ichan));
+			if (firstSample == 1 || extrema.min < minimum [ichan])
+				minimum [ichan] = extrema.min;
+			if (firstSample == 1 || extrema.max > maximum [ichan])
+				maximum [ichan] = extrema.max;
+		}
+	}
+	double globalPeak = 0.0;
+	for (integer ichan = 1; ichan <= my numberOfChannels; ichan ++) {
+		const double mean = sum [ichan] / my nx;
+		Melder_clipLeft (maximum [ichan] - mean, & globalPeak);
+		Melder_clipLeft (mean - minimum [ichan], & globalPeak);
+	}
+	return globalPeak;
+}
+
+autoPitch LongSound_to_Pitch_any (LongSound me,
+	double dt, double minimumPitch, double periodsPerWindow, integer maxnCandidates, int method,
+	double silenceThreshold, double voicingThreshold,
+	double octaveCost, double octaveJumpCost, double voicedUnvoicedCost, double ceiling)
+{
+	try {
+		if (LongSound_fitsInOneBlock (me)) {
+			autoSound sound = LongSound_extractPart (me, my xmin, my xmax, true);
+			return Sound_to_Pitch_any (sound.get(), dt, minimumPitch, periodsPerWindow, maxnCandidates, method,
+				silenceThreshold, voicingThreshold, octaveCost, octaveJumpCost, voicedUnvoicedCost, ceiling);
+		}
+		autoPitch thee = Pitch_createForAnalysis (me, dt, minimumPitch, periodsPerWindow, maxnCandidates, method, ceiling);
+		const double globalPeak = LongSound_getGlobalPeak (me);
+		if (globalPeak == 0.0)
+			return thee;
+
+		autoMelderProgress progress (U"LongSound to Pitch...");
+		/*
+			A frame needs the samples within one longest period plus one (Gaussian, i.e. double) window
+			from its centre (cross-correlation needs half of this, autocorrelation even less).
+		*/
+		const double margin = (1.0 + 2.0 * periodsPerWindow) / minimumPitch;
+		analyseInBlocks (LongSound_getBlockDuration (me), me, thee.get(), margin,
+			[&] (integer firstSample, integer lastSample) {
+				return LongSound_extractSamples (me, firstSample, lastSample);
+			},
+			[&] (Sound part, integer firstFrame, integer lastFrame) {
+				Sound_into_Pitch (part, me, thee.get(), firstFrame, lastFrame, globalPeak,
+					minimumPitch, periodsPerWindow, method, voicingThreshold, octaveCost);
+			}
+		);
+
+		Melder_progress (0.95, U"LongSound to Pitch: path finder");
+		Pitch_pathFinder (thee.get(), silenceThreshold, voicingThreshold,
+			octaveCost, octaveJumpCost, voicedUnvoicedCost, thy ceiling, Melder_debug == 31 ? true : false);
+		return thee;
+	} catch (MelderError) {
+		Melder_throw (me, U": pitch analysis not performed.");
+	}
+}
+
+autoPitch LongSound_to_Pitch (LongSound me, double timeStep, double minimumPitch, double maximumPitch) {
+	return LongSound_to_Pitch_any (me, timeStep, minimumPitch,
+		3.0, 15, 0, 0.03, 0.45, 0.01, 0.35, 0.14, maximumPitch);
+}
+
+autoIntensity LongSound_to_Intensity (LongSound me, double minimumPitch, double timeStep, bool subtractMean) {
+	try {
+		if (LongSound_fitsInOneBlock (me)) {
+			autoSound sound = LongSound_extractPart (me, my xmin, my xmax, true);
+			return Sound_to_Intensity (sound.get(), minimumPitch, timeStep, subtractMean);
+		}
+		autoIntensity thee = Intensity_createForAnalysis (me, minimumPitch, timeStep);
+		autoMelderProgress progress (U"LongSound to Intensity...");
+		const double margin = 3.2 / minimumPitch;   // half the physical window
+		analyseInBlocks (LongSound_getBlockDuration (me), me, thee.get(), margin,
+			[&] (integer firstSample, integer lastSample) {
+				return LongSound_extractSamples (me, firstSample, lastSample);
+			},
+			[&] (Sound part, integer firstFrame, integer lastFrame) {
+				Sound_into_Intensity (part, me, thee.get(), firstFrame, lastFrame, minimumPitch, subtractMean);
+			}
+		);
+		return thee;
+	} catch (MelderError) {
+		Melder_throw (me, U": intensity analysis not performed.");
+	}
+}
+
+autoFormant LongSound_to_Formant_burg (LongSound me, double dt, double nFormants, double maximumFrequency,
+	double halfdt_window, double preemphasisFrequency)
+{
+	try {
+		if (LongSound_fitsInOneBlock (me)) {
+			autoSound sound = LongSound_extractPart (me, my xmin, my xmax, true);
+			return Sound_to_Formant_burg (sound.get(), dt, nFormants, maximumFrequency, halfdt_window, preemphasisFrequency);
+		}
+		const integer numberOfPoles = Melder_iround (2.0 * nFormants);
+		/*
+			The sampling grid of the sound that Sound_to_Formant_any () would analyse,
+			i.e. the grid that Sound_resample () would create.
+		*/
+		const double nyquist = 0.5 / my dx;
+		const bool mustResample = ! (maximumFrequency <= 0.0 || fabs (maximumFrequency / nyquist - 1) < 1.0e-12);
+		const double samplingFrequency = ( mustResample ? 2.0 * maximumFrequency : 1.0 / my dx );
+		autoSampled grid = Sampled_createResampledGrid (me, samplingFrequency);
+		autoFormant thee = Formant_createForAnalysis (grid.get(), dt, numberOfPoles, halfdt_window);
+
+		autoMelderProgress progress (U"LongSound to Formant...");
+		/*
+			A frame needs half a window from its centre, plus one sample to the left for the pre-emphasis.
+			For resampling, every block is read with extra samples on both sides,
+			so that the resampling filter sees the same samples as in the whole sound.
+		*/
+		const double margin = halfdt_window + grid -> dx;
+		const integer resamplingMargin = Sound_getResamplingMargin (my dx, grid -> dx, 50);
+		analyseInBlocks (LongSound_getBlockDuration (me), grid.get(), thee.get(), margin,
+			[&] (integer firstSample, integer lastSample) {
+				if (! mustResample)
+					return LongSound_extractSamples (me, firstSample, lastSample);
+				autoSound original = LongSound_extractSamples (me,
+					std::max (1_integer, Sampled_xToLowIndex (me, Sampled_indexToX (grid.get(), firstSample)) - resamplingMargin),
+					std::min (my nx, Sampled_xToHighIndex (me, Sampled_indexToX (grid.get(), lastSample)) + resamplingMargin)
+				);
+				return Sound_resampleOntoGrid (original.get(), grid.get(), firstSample, lastSample, 50);
+			},
+			[&] (Sound part, integer firstFrame, integer lastFrame) {
+				Sound_into_Formant (part, grid.get(), thee.get(), firstFrame, lastFrame, numberOfPoles, halfdt_window, 1, preemphasisFrequency, 50.0);
+			}
+		);
+		Formant_sort (thee.get());
+		return thee;
+	} catch (MelderError) {
+		Melder_throw (me, U": formant analysis (Burg) not performed.");
+	}
+}
+
+/* End of file LongSound_analyses.cpp */
@@ -0,0 +1,54 @@
+#ifndef _LongSound_analyses_h_
+#define _LongSound_analyses_h_
+/* LongSound_analyses.h
+ *
+ * Copyright (C) 2021 Paul Boersma
+ *
+ * This code is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or (at
+ * your option) any later version.
+ *
+ * This code is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ * See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this work. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "LongSound.h"
+#include "Pitch.h"
+#include "Intensity.h"
+#include "Formant.h"
+
+/*
+	Analyses of a LongSound that never hold the whole sound in memory.
+	The file is read in blocks with the duration of the buffer of the LongSound (see LongSound_getBufferSizePref_seconds),
+	each block overlapping its neighbours by the analysis window;
+	the frames that each block can analyse completely are computed into the single resulting object.
+	The results are the same as those of the analysis of the whole extracted Sound,
+	except that for the formant analysis the resampling is done per block,
+	which can make a difference in the last few bits.
+	This holds for every encoding, because the blocks are read with LongSound_readAudioToFloat (),
+	just as LongSound_extractPart () reads the whole sound, i.e. with the full precision of the file.
+	Sounds that fit into a single block are simply extracted and analysed as a whole.
+*/
+
+autoPitch LongSound_to_Pitch_any (LongSound me,
+	double dt, double minimumPitch, double periodsPerWindow, integer maxnCandidates, int method,
+	double silenceThreshold, double voicingThreshold,
+	double octaveCost, double octaveJumpCost, double voicedUnvoicedCost, double maximumPitch);
+/* The same arguments as Sound_to_Pitch_any (). */
+
+autoPitch LongSound_to_Pitch (LongSound me, double timeStep, double minimumPitch, double maximumPitch);
+/* The same defaults as Sound_to_Pitch (). */
+
+autoIntensity LongSound_to_Intensity (LongSound me, double minimumPitch, double timeStep, bool subtractMean);
+
+autoFormant LongSound_to_Formant_burg (LongSound me, double timeStep, double maximumNumberOfFormants,
+	double maximumFormantFrequency, double windowLength, double preemphasisFrequency);
+
+/* End of file LongSound_analyses.h */
+#endif
@@ -1,6 +1,6 @@
 /* Matrix.cpp
  *
- * Copyright (C) 1992-2020 Paul Boersma
+ * Copyright (C) 1992-2021 Paul Boersma
  *
  * This code is free software; you can redistribute it and/or modify
  * it under the terms of the GNU General Public License as published by
@@ -19,6 +19,7 @@
 #include "Matrix.h"
 #include "NUM2.h"
 #include "Formula.h"
+#include "MelderThread.h"
 #include "Eigen.h"
 
 #include "oo_DESTROY.h"
@@ -665,18 +666,99 @@ void Matrix_writeToHeaderlessSpreadsheetFile (Matrix me, MelderFile file) {
 	}
 }
 
+/*
+	Compute the cells iymin..iymax x ixmin..ixmax of `target` with a compiled formula.
+	The cells are cut into chunks of consecutive cells (in row-major order);
+	if the formula permits, the chunks are computed on several threads,
+	and the part of each row that lies in a chunk is computed at once.
+*/
+static void Matrix_runFormula (Matrix me, FormulaProgram program, integer ixmin, integer ixmax, integer iymin, integer iymax, Matrix target) {
+	const integer numberOfColumns = ixmax - ixmin + 1, numberOfRows = iymax - iymin + 1;
+	if (numberOfColumns < 1 || numberOfRows < 1)
+		return;
+	const integer numberOfCells = numberOfRows * numberOfColumns;
+	constexpr integer numberOfCellsPerChunk = 4096;
+	const integer numberOfChunks = (numberOfCells - 1) / numberOfCellsPerChunk + 1;
+	const bool perRow = FormulaProgram_canRunCells (program);
+	/*
+		The cells icol..lastColumn of row irow, all at once or one by one;
+		nothing is written into a cell whose computation fails.
+	*/
+	auto computeCells = [=] (integer irow, integer icol, integer lastColumn) {
+		if (perRow) {
+			FormulaProgram_runCells (program, irow, icol, target -> z.row (irow). part (icol, lastColumn));
+		} else {
+			Formula_Result result;
+			for (integer jcol = icol; jcol <= lastColumn; jcol ++) {
+				FormulaProgram_run (program, irow, jcol, & result);
+				target -> z [irow] [jcol] = result. numericResult;
+			}
+		}
+	};
+	struct CellRange {
+		integer row, firstColumn, lastColumn;
+	};
+	auto computeChunk = [=] (integer ichunk, CellRange *out_current) {
+		const integer firstCell = (ichunk - 1) * numberOfCellsPerChunk;   // counting from 0
+		integer numberOfCellsToGo = std::min (numberOfCellsPerChunk, numberOfCells - firstCell);
+		integer irow = iymin + firstCell / numberOfColumns, icol = ixmin + firstCell % numberOfColumns;
+		while (numberOfCellsToGo > 0) {
+			const integer lastColumn = std::min (ixmax, icol + numberOfCellsToGo - 1);
+			if (perRow) {
+				*out_current = { irow, icol, lastColumn };
+				computeCells (irow, icol, lastColumn);
+			} else {
+				for (integer jcol = icol; jcol <= lastColumn; jcol ++) {
+					*out_current = { irow, jcol, jcol };
+					computeCells (irow, jcol, jcol);
+				}
+			}
+			numberOfCellsToGo -= lastColumn - icol + 1;
+			icol = ixmin;
+			irow ++;
+		}
+	};
+	if (numberOfCells >= 2 * numberOfCellsPerChunk && FormulaProgram_canRunInParallel (program, target == me)) {
+		/*
+			Only the calling thread may throw (see MelderThread_runTasks),
+			so a chunk that fails records where it failed, and the chunks after it are skipped.
+			The first failing cells are then computed again on this thread,
+			which throws the error that a computation on a single thread would have thrown.
+		*/
+		std::vector <CellRange> failures (integer_to_uinteger (numberOfChunks));
+		std::atomic <integer> firstFailingChunk (INTEGER_MAX);
+		MelderThread_runTasks (numberOfChunks, MelderThread_getNumberOfThreads (),
+			[&] (integer /* threadNumber */, integer ichunk) {
+				if (ichunk > firstFailingChunk)
+					return;
+				CellRange& failure = failures [integer_to_uinteger (ichunk - 1)];
+				try {
+					computeChunk (ichunk, & failure);
+				} catch (MelderError) {
+					integer chunk = firstFailingChunk;
+					while (ichunk < chunk && ! firstFailingChunk.compare_exchange_weak (chunk, ichunk)) { }
+				}
+			}
+		);
+		if (firstFailingChunk != INTEGER_MAX) {
+			Melder_clearError ();   // the messages of chunks that failed at the same time may have been garbled
+			const CellRange& failure = failures [integer_to_uinteger (firstFailingChunk - 1)];
+			computeCells (failure.row, failure.firstColumn, failure.lastColumn);
+			Melder_throw (U"Formula not run.");   // not reached for formulas that fail in the same way every time
+		}
+	} else {
+		CellRange current;
+		for (integer ichunk = 1; ichunk <= numberOfChunks; ichunk ++)
+			computeChunk (ichunk, & current);
+	}
+}
+
 void Matrix_formula (Matrix me, conststring32 expression, Interpreter interpreter, Matrix target) {
 	try {
-		Formula_compile (interpreter, me, expression, kFormula_EXPRESSION_TYPE_NUMERIC, true);
-		Formula_Result result;
+		autoFormulaProgram program = FormulaProgram_create (interpreter, me, expression, kFormula_EXPRESSION_TYPE_NUMERIC, true);
 		if (! target)
 			target = me;
-		for (integer irow = 1; irow <= my ny; irow ++) {
-			for (integer icol = 1; icol <= my nx; icol ++) {
-				Formula_run (irow, icol, & result);
-				target -> z [irow] [icol] = result. numericResult;
-			}
-		}
+		Matrix_runFormula (me, program.get(), 1, my nx, 1, my ny, target);
 	} catch (MelderError) {
 		Melder_throw (me, U": formula not completed.");
 	}
@@ -694,16 +776,10 @@ void Matrix_formula_part (Matrix me, double xmin, double xmax, double ymin, doub
 		integer ixmin, ixmax, iymin, iymax;
 		(void) Matrix_getWindowSamplesX (me, xmin, xmax, & ixmin, & ixmax);
 		(void) Matrix_getWindowSamplesY (me, ymin, ymax, & iymin, & iymax);
-		Formula_compile (interpreter, me, expression, kFormula_EXPRESSION_TYPE_NUMERIC, true);
-		Formula_Result result;
+		autoFormulaProgram program = FormulaProgram_create (interpreter, me, expression, kFormula_EXPRESSION_TYPE_NUMERIC, true);
 		if (! target)
 			target = me;
-		for (integer irow = iymin; irow <= iymax; irow ++) {
-			for (integer icol = ixmin; icol <= ixmax; icol ++) {
-				Formula_run (irow, icol, & result);
-				target -> z [irow] [icol] = result. numericResult;
-			}
-		}
+		Matrix_runFormula (me, program.get(), ixmin, ixmax, iymin, iymax, target);
 	} catch (MelderError) {
 		Melder_throw (me, U": formula not completed.");
 	}
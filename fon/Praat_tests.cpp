@@ -1,6 +1,6 @@
 /* Praat_tests.cpp
  *
- * Copyright (C) 2001-2007,2009,2011-2020 Paul Boersma
+ * Copyright (C) 2001-2007,2009,2011-2021 Paul Boersma
  *
  * This code is free software; you can redistribute it and/or modify
  * it under the terms of the GNU General Public License as published by
@@ -491,6 +491,60 @@ int Praat_tests (kPraatTests itest, conststring32 arg1, conststring32 arg2, cons
 			MelderInfo_writeLine (sum, U" should be ", size1 * size2 * size3 * 30.0);
 			//Melder_require (NUMequal (result.get(), constantHH (size, size, size * 30.0).get()), U"...");
 		} break;
+		case kPraatTests::TIME_MATMUL_FAST: {
+			/*
+				The product of two square matrices with mul_fast##, counted as 2 n^3 floating-point operations.
+				The third argument says which operands are transposed: XY, X'Y, XY' or X'Y'.
+			*/
+			const integer size = Melder_atoi (arg2);
+			const bool transposeX = str32equ (arg3, U"X'Y") || str32equ (arg3, U"X'Y'");
+			const bool transposeY = str32equ (arg3, U"XY'") || str32equ (arg3, U"X'Y'");
+			autoMAT const x = randomGauss_MAT (size, size, 0.0, 1.0);
+			autoMAT const y = randomGauss_MAT (size, size, 0.0, 1.0);
+			autoMAT const result = raw_MAT (size, size);
+			constMATVU const x_op = ( transposeX ? x.transpose() : x.all() );
+			constMATVU const y_op = ( transposeY ? y.transpose() : y.all() );
+			Melder_stopwatch ();
+			for (int64 iteration = 1; iteration <= n; iteration ++)
+				mul_fast_MAT_out (result.all(), x_op, y_op);
+			t = Melder_stopwatch () / (2.0 * size * size * size);
+			autoMAT const reference = mul_MAT (x_op, y_op);
+			double maximumError = 0.0;
+			for (integer irow = 1; irow <= size; irow ++)
+				for (integer icol = 1; icol <= size; icol ++)
+					maximumError = std::max (maximumError, fabs (result [irow] [icol] - reference [irow] [icol]));
+			MelderInfo_writeLine (maximumError, U" maximum deviation from mul##");
+		} break;
+		case kPraatTests::TIME_FFT: {
+			/*
+				A forward and a backward real FFT, counted as 2 * 2.5 n log2 (n) floating-point operations.
+			*/
+			const integer size = Melder_atoi (arg2);
+			autoNUMfft_Table table;
+			NUMfft_Table_init (& table, size);
+			autoVEC x = randomGauss_VEC (size, 0.0, 1.0);
+			Melder_stopwatch ();
+			for (int64 i = 1; i <= n; i ++) {
+				NUMfft_forward (& table, x.get());
+				NUMfft_backward (& table, x.get());
+				x.all()  *=  1.0 / size;
+			}
+			t = Melder_stopwatch () / (5.0 * size * log2 (size));
+			MelderInfo_writeLine (t * 5.0 * size * log2 (size) / n * 1e9, U" nanoseconds per forward and backward transform");
+		} break;
+		case kPraatTests::CHECK_RESAMPLED_GRID: {
+			/*
+				The time axis that Sampled_createResampledGrid () makes for a sound
+				with a duration of arg2 seconds, sampled at arg3 Hz, when it is resampled to arg4 Hz.
+			*/
+			autoSound sound = Sound_createSimple (1, Melder_atof (arg2), Melder_atof (arg3));
+			autoSampled grid = Sampled_createResampledGrid (sound.get(), Melder_atof (arg4));
+			MelderInfo_writeLine (U"xmin ", grid -> xmin);
+			MelderInfo_writeLine (U"xmax ", grid -> xmax);
+			MelderInfo_writeLine (U"nx ", grid -> nx);
+			MelderInfo_writeLine (U"dx ", grid -> dx);
+			MelderInfo_writeLine (U"x1 ", grid -> x1);
+		} break;
 		case kPraatTests::THING_AUTO: {
 			integer numberOfThingsBefore = theTotalNumberOfThings;
 			{
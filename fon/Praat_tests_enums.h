@@ -1,6 +1,6 @@
 /* Praat_tests_enums.h
  *
- * Copyright (C) 2001-2005,2009,2013-2018,2020 Paul Boersma
+ * Copyright (C) 2001-2005,2009,2013-2018,2020,2021 Paul Boersma
  *
  * This code is free software; you can redistribute it and/or modify
  * it under the terms of the GNU General Public License as published by
@@ -62,6 +62,9 @@ enums_begin (kPraatTests, 0)
 	enums_add (kPraatTests, 42, TIME_MATMUL, U"TimeMatMul")
 	enums_add (kPraatTests, 43, THING_AUTO, U"ThingAuto")
 	enums_add (kPraatTests, 44, FILEINMEMORYMANAGER_IO, U"FileInMemoryManager_io")
-enums_end (kPraatTests, 45, CHECK_RANDOM_1009_2009)
+	enums_add (kPraatTests, 45, TIME_FFT, U"TimeFFT")
+	enums_add (kPraatTests, 46, TIME_MATMUL_FAST, U"TimeMatMulFast")
+	enums_add (kPraatTests, 47, CHECK_RESAMPLED_GRID, U"CheckResampledGrid")
+enums_end (kPraatTests, 47, CHECK_RANDOM_1009_2009)
 
 /* End of file Praat_tests_enums.h */
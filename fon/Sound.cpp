@@ -1,6 +1,6 @@
 /* Sound.cpp
  *
- * Copyright (C) 1992-2020 Paul Boersma
+ * Copyright (C) 1992-2021 Paul Boersma
  *
  * This code is free software; you can redistribute it and/or modify
  * it under the terms of the GNU General Public License as published by
@@ -25,6 +25,15 @@
 #include "Sound.h"
 #include "Sound_extensions.h"
 #include "NUM2.h"
+#include "MelderThread.h"
+
+#if defined (__SSE2__) || defined (_M_X64) || (defined (_M_IX86_FP) && _M_IX86_FP >= 2)
+	#include <emmintrin.h>
+	#define Sound_SSE2  1
+#elif defined (__aarch64__) && defined (__ARM_NEON)
+	#include <arm_neon.h>
+	#define Sound_NEON  1
+#endif
 
 #include "enums_getText.h"
 #include "Sound_enums.h"
@@ -392,47 +401,263 @@ autoSound Sound_upsample (Sound me) {
 	}
 }
 
-autoSound Sound_resample (Sound me, double samplingFrequency, integer precision) {
-	double upfactor = samplingFrequency * my dx;
-	if (fabs (upfactor - 2.0) < 1e-6)
-		return Sound_upsample (me);
-	if (fabs (upfactor - 1.0) < 1e-6)
-		return Data_copy (me);
-	try {
-		integer numberOfSamples = Melder_iround ((my xmax - my xmin) * samplingFrequency);
-		if (numberOfSamples < 1)
-			Melder_throw (U"The resampled Sound would have no samples.");
-		autoSound filtered;
-		bool weNeedAnAntiAliasingFilter = ( upfactor < 1.0 );
-		if (weNeedAnAntiAliasingFilter) {
-			constexpr integer antiTurnAround = 1000;
-			constexpr integer numberOfPaddingSides = 2;   // namely beginning and end
-			integer nfft = 1;
-			while (nfft < my nx + antiTurnAround * numberOfPaddingSides) nfft *= 2;
-			autoVEC data = raw_VEC (nfft);   // will be zeroed in every turn of the loop
-			filtered = Sound_create (my ny, my xmin, my xmax, my nx, my dx, my x1);
-			for (integer ichan = 1; ichan <= my ny; ichan ++) {
-				for (integer i = 1; i <= nfft; i ++)
-					data [i] = 0.0;
-				data.part (antiTurnAround + 1, antiTurnAround + my nx)  <<=  my z.row (ichan);
-				NUMrealft (data.get(), 1);   // go to the frequency domain
-				for (integer i = Melder_ifloor (upfactor * nfft); i <= nfft; i ++)
-					data [i] = 0.0;   // filter away high frequencies
-				data [2] = 0.0;
-				NUMrealft (data.get(), -1);   // return to the time domain
-				double factor = 1.0 / nfft;
-				VEC to = filtered -> z.row (ichan);
-				for (integer i = 1; i <= my nx; i ++)
-					to [i] = data [i + antiTurnAround] * factor;
+/*
+	Resampling with a windowed sinc filter.
+
+	Every new sample is the inner product of the old samples around its time with a sinc function
+	that has its cutoff at the lower of the two Nyquist frequencies (so that downsampling needs no separate anti-aliasing filter),
+	multiplied by a Hann window that reaches zero `depth` zero crossings of the sinc away from the centre;
+	the coefficients are normalized to a sum of 1. Old samples outside the sound count as zero.
+	If the ratio of the sampling frequencies is a ratio of small integers (e.g. 441/160 for going from 44.1 to 16 kHz),
+	the new samples run through a fixed cycle of positions relative to the old samples,
+	so that the coefficients can be computed in advance for each of these positions ("phases").
+	For other ratios, the coefficients are tabulated for a fine grid of positions and interpolated in between.
+	Either way, memory use is only that of the filter, not of the sound,
+	and the blocks of new samples are computed on multiple threads.
+*/
+#if defined (Sound_SSE2)
+	struct resample_Pair {
+		__m128d v;
+		static inline resample_Pair zero () { return { _mm_setzero_pd () }; }
+		static inline resample_Pair load (const double *p) { return { _mm_loadu_pd (p) }; }
+		inline void addProduct (resample_Pair a, resample_Pair b) { v = _mm_add_pd (v, _mm_mul_pd (a.v, b.v)); }
+		inline double sum () const { return _mm_cvtsd_f64 (v) + _mm_cvtsd_f64 (_mm_unpackhi_pd (v, v)); }
+	};
+#elif defined (Sound_NEON)
+	struct resample_Pair {
+		float64x2_t v;
+		static inline resample_Pair zero () { return { vdupq_n_f64 (0.0) }; }
+		static inline resample_Pair load (const double *p) { return { vld1q_f64 (p) }; }
+		inline void addProduct (resample_Pair a, resample_Pair b) { v = vfmaq_f64 (v, a.v, b.v); }
+		inline double sum () const { return vaddvq_f64 (v); }
+	};
+#else
+	struct resample_Pair {
+		double v0, v1;
+		static inline resample_Pair zero () { return { 0.0, 0.0 }; }
+		static inline resample_Pair load (const double *p) { return { p [0], p [1] }; }
+		inline void addProduct (resample_Pair a, resample_Pair b) { v0 += a.v0 * b.v0; v1 += a.v1 * b.v1; }
+		inline double sum () const { return v0 + v1; }
+	};
+#endif
+
+static double resample_inner (const double *x, const double *filter, integer numberOfTaps) noexcept {
+	resample_Pair sum1 = resample_Pair::zero (), sum2 = resample_Pair::zero ();
+	integer itap = 0;
+	for (; itap + 4 <= numberOfTaps; itap += 4) {
+		sum1. addProduct (resample_Pair::load (x + itap), resample_Pair::load (filter + itap));
+		sum2. addProduct (resample_Pair::load (x + itap + 2), resample_Pair::load (filter + itap + 2));
+	}
+	double sum = sum1.sum () + sum2.sum ();
+	for (; itap < numberOfTaps; itap ++)
+		sum += x [itap] * filter [itap];
+	return sum;
+}
+
+/*
+	The filter for a new sample at `fraction` (usually between 0 and 1) to the right of an old sample m:
+	the taps are for the old samples m - numberOfTapsPerSide + 1 through m + numberOfTapsPerSide.
+*/
+static void resample_computeFilter (double fraction, double cutoff, double depth, VEC const& filter) {
+	const integer numberOfTapsPerSide = filter.size / 2;
+	const double halfWindowLength = depth / cutoff;   // in old samples
+	/*
+		The distance of the first tap is `firstDistance`, and each next tap is 1 further;
+		the sines and cosines therefore follow from the previous ones by rotation (as in NUM_interpolate_sinc),
+		which is much faster than computing them anew for every tap.
+	*/
+	const double firstDistance = 1 - numberOfTapsPerSide - fraction;   // in old samples
+	const double sincStep = NUMpi * cutoff, windowStep = NUMpi / halfWindowLength;
+	const double cosSincStep = cos (sincStep), sinSincStep = sin (sincStep);
+	const double cosWindowStep = cos (windowStep), sinWindowStep = sin (windowStep);
+	double sinSinc = sin (sincStep * firstDistance), cosSinc = cos (sincStep * firstDistance);
+	double sinWindow = sin (windowStep * firstDistance), cosWindow = cos (windowStep * firstDistance);
+	double sum = 0.0;
+	for (integer itap = 1; itap <= filter.size; itap ++) {
+		const double distance = firstDistance + (itap - 1);
+		double value = 0.0;
+		if (fabs (distance) < halfWindowLength) {
+			const double phase = sincStep * distance;
+			value = ( phase == 0.0 ? 1.0 : sinSinc / phase ) * (0.5 + 0.5 * cosWindow);
+		}
+		filter [itap] = value;
+		sum += value;
+		const double newSinSinc = sinSinc * cosSincStep + cosSinc * sinSincStep;
+		cosSinc = cosSinc * cosSincStep - sinSinc * sinSincStep;
+		sinSinc = newSinSinc;
+		const double newSinWindow = sinWindow * cosWindowStep + cosWindow * sinWindowStep;
+		cosWindow = cosWindow * cosWindowStep - sinWindow * sinWindowStep;
+		sinWindow = newSinWindow;
+	}
+	filter  *=  1.0 / sum;
+}
+
+static double resample_filterAt (constVEC const& x, integer firstSample, constVEC const& filter) noexcept {
+	const integer lastSample = firstSample + filter.size - 1;
+	if (firstSample >= 1 && lastSample <= x.size)
+		return resample_inner (& x [firstSample], & filter [1], filter.size);
+	double sum = 0.0;
+	for (integer isample = std::max (firstSample, 1_integer); isample <= std::min (lastSample, x.size); isample ++)
+		sum += x [isample] * filter [isample - firstSample + 1];
+	return sum;
+}
+
+/*
+	When downsampling, the filter is also the anti-aliasing filter.
+	The transition band of a Hann-windowed sinc with a depth of `depth` zero crossings
+	stretches from cutoff * (1 - 2 / depth) to cutoff * (1 + 2 / depth),
+	so we lower the cutoff until the whole transition band lies below the new Nyquist frequency.
+*/
+static double resample_getCutoff (double step, integer depth) {
+	return ( step > 1.0 ? (1.0 - 2.0 / depth) / step : 1.0 );   // relative to the old Nyquist frequency
+}
+
+static integer resample_getNumberOfTapsPerSide (double cutoff, integer depth) {
+	return Melder_iceiling (depth / cutoff) + 1;   // one spare tap for the interpolated table
+}
+
+static void Sound_into_Sound_resampleWithWindowedSinc (Sound me, Sound thee, integer depth) {
+	const double step = thy dx / my dx;   // the number of old samples per new sample
+	const double cutoff = resample_getCutoff (step, depth);
+	const integer numberOfTapsPerSide = resample_getNumberOfTapsPerSide (cutoff, depth);
+	const integer numberOfTaps = 2 * numberOfTapsPerSide;
+	const double firstIndex = Sampled_xToIndex (me, thy x1);   // the position of the first new sample among the old samples
+	constexpr integer maximumFilterBankSize = 1 << 20;
+	/*
+		Is `step` a ratio of small integers, numberOfOldSamplesPerCycle / numberOfPhases?
+		Then the filter bank has a row for each phase.
+	*/
+	constexpr integer maximumNumberOfPhases = 1000;
+	integer numberOfPhases = 0, numberOfOldSamplesPerCycle = 0;
+	for (integer iphase = 1; iphase <= maximumNumberOfPhases && iphase * numberOfTaps <= maximumFilterBankSize; iphase ++) {
+		const double oldSamplesPerCycle = step * iphase;
+		if (fabs (oldSamplesPerCycle - round (oldSamplesPerCycle)) < 1e-12 * oldSamplesPerCycle) {
+			numberOfPhases = iphase;
+			numberOfOldSamplesPerCycle = Melder_iround (oldSamplesPerCycle);
+			break;
+		}
+	}
+	autoMAT filterBank;
+	autoINTVEC firstSampleOfPhase;
+	constexpr integer minimumNumberOfFractions = 256;
+	integer numberOfFractions = 0;
+	if (numberOfPhases > 0) {
+		filterBank = raw_MAT (numberOfPhases, numberOfTaps);
+		firstSampleOfPhase = raw_INTVEC (numberOfPhases);
+		for (integer iphase = 1; iphase <= numberOfPhases; iphase ++) {
+			const double index = firstIndex + double ((iphase - 1) * numberOfOldSamplesPerCycle) / numberOfPhases;
+			const integer leftSample = Melder_ifloor (index);
+			firstSampleOfPhase [iphase] = leftSample - numberOfTapsPerSide + 1;
+			resample_computeFilter (index - leftSample, cutoff, depth, filterBank.row (iphase));
+		}
+	} else if ((minimumNumberOfFractions + 3) * numberOfTaps <= maximumFilterBankSize) {
+		/*
+			Otherwise, the filter bank has a row for each of `numberOfFractions` equidistant fractions
+			(plus one below and two above), and the filter for a new sample is interpolated cubically
+			between the four nearest rows; the interpolation error in the coefficients is of the order of
+			(pi / numberOfFractions)^4, i.e. below 1e-9 for the smallest number of fractions.
+		*/
+		numberOfFractions = std::min (maximumFilterBankSize / numberOfTaps - 3, 4096_integer);
+		filterBank = raw_MAT (numberOfFractions + 3, numberOfTaps);
+		for (integer irow = 1; irow <= numberOfFractions + 3; irow ++)
+			resample_computeFilter (double (irow - 2) / numberOfFractions, cutoff, depth, filterBank.row (irow));
+	}
+	constexpr integer numberOfSamplesPerBlock = 4096;
+	const integer numberOfBlocksPerChannel = (thy nx - 1) / numberOfSamplesPerBlock + 1;
+	const integer numberOfBlocks = my ny * numberOfBlocksPerChannel;
+	const double numberOfMultiplications = double (thy ny) * double (thy nx) * double (numberOfTaps);
+	const integer maximumNumberOfThreads = ( numberOfMultiplications < 1e6 ? 1 : numberOfBlocks );
+	/*
+		If the filter is so long (i.e. the sampling frequency goes down by so much) that not even the smallest table fits,
+		the filter is computed anew for every new sample, in a buffer per thread;
+		this costs a few times as much as the inner product itself.
+	*/
+	const bool weComputeEveryFilter = ( numberOfPhases == 0 && numberOfFractions == 0 );
+	const integer numberOfThreads = std::min (maximumNumberOfThreads, MelderThread_getNumberOfThreads ());
+	autoMAT filterPerThread = ( weComputeEveryFilter ? raw_MAT (numberOfThreads, numberOfTaps) : autoMAT () );
+	MelderThread_runTasks (numberOfBlocks, numberOfThreads, [&] (integer threadNumber, integer iblock) {
+		const integer channel = (iblock - 1) / numberOfBlocksPerChannel + 1;
+		const integer firstNewSample = ((iblock - 1) % numberOfBlocksPerChannel) * numberOfSamplesPerBlock + 1;
+		const integer lastNewSample = std::min (firstNewSample + numberOfSamplesPerBlock - 1, thy nx);
+		constVEC from = my z.row (channel);
+		VEC to = thy z.row (channel);
+		for (integer isample = firstNewSample; isample <= lastNewSample; isample ++) {
+			if (weComputeEveryFilter) {
+				const double index = firstIndex + (isample - 1) * step;
+				const integer leftSample = Melder_ifloor (index);
+				VEC filter = filterPerThread.row (threadNumber);
+				resample_computeFilter (index - leftSample, cutoff, depth, filter);
+				to [isample] = resample_filterAt (from, leftSample - numberOfTapsPerSide + 1, filter);
+			} else if (numberOfPhases > 0) {
+				const integer numberOfCycles = (isample - 1) / numberOfPhases;
+				const integer iphase = (isample - 1) % numberOfPhases + 1;
+				to [isample] = resample_filterAt (from,
+						firstSampleOfPhase [iphase] + numberOfCycles * numberOfOldSamplesPerCycle, filterBank.row (iphase));
+			} else {
+				const double index = firstIndex + (isample - 1) * step;
+				const integer leftSample = Melder_ifloor (index);
+				const integer firstSample = leftSample - numberOfTapsPerSide + 1;
+				const double position = (index - leftSample) * numberOfFractions;
+				integer irow = Melder_ifloor (position);
+				Melder_clip (0_integer, & irow, numberOfFractions - 1);
+				const double a = position - irow;   // between 0 and 1
+				const double weight0 = - a * (a - 1.0) * (a - 2.0) / 6.0, weight1 = (a + 1.0) * (a - 1.0) * (a - 2.0) / 2.0,
+					weight2 = - (a + 1.0) * a * (a - 2.0) / 2.0, weight3 = (a + 1.0) * a * (a - 1.0) / 6.0;
+				to [isample] =
+					weight0 * resample_filterAt (from, firstSample, filterBank.row (irow + 1)) +
+					weight1 * resample_filterAt (from, firstSample, filterBank.row (irow + 2)) +
+					weight2 * resample_filterAt (from, firstSample, filterBank.row (irow + 3)) +
+					weight3 * resample_filterAt (from, firstSample, filterBank.row (irow + 4));
 			}
-			me = filtered.get();   // reference copy; remove at end
 		}
-		autoSound thee = Sound_create (my ny, my xmin, my xmax, numberOfSamples, 1.0 / samplingFrequency,
+	});
+}
+
+autoSampled Sampled_createResampledGrid (Sampled me, double samplingFrequency) {
+	const double upfactor = samplingFrequency * my dx;
+	autoSampled grid = Thing_new (Sampled);
+	if (fabs (upfactor - 1.0) < 1e-6) {
+		Sampled_init (grid.get(), my xmin, my xmax, my nx, my dx, my x1);
+	} else if (fabs (upfactor - 2.0) < 1e-6) {
+		const double newDx = 0.5 * my dx;
+		Sampled_init (grid.get(), my xmin, my xmax, 2 * my nx, newDx, my x1 - 0.5 * (my dx - newDx));
+	} else {
+		const integer numberOfSamples = Melder_iround ((my xmax - my xmin) * samplingFrequency);
+		if (numberOfSamples < 1)
+			Melder_throw (U"The resampled Sound would have no samples.");
+		Sampled_init (grid.get(), my xmin, my xmax, numberOfSamples, 1.0 / samplingFrequency,
 				0.5 * (my xmin + my xmax - (numberOfSamples - 1) / samplingFrequency));
+	}
+	return grid;
+}
+
+/*
+	Fill the samples of `thee` (usually on a different sampling grid) from those of `me`.
+*/
+static void Sound_into_Sound_resample (Sound me, Sound thee, integer precision) {
+	const double upfactor = my dx / thy dx;
+	if (fabs (upfactor - 1.0) < 1e-6) {
+		for (integer isample = 1; isample <= thy nx; isample ++) {
+			const integer oldSample = Sampled_xToNearestIndex (me, Sampled_indexToX (thee, isample));
+			for (integer ichan = 1; ichan <= my ny; ichan ++)
+				thy z [ichan] [isample] = ( oldSample < 1 || oldSample > my nx ? 0.0 : my z [ichan] [oldSample] );
+		}
+		return;
+	}
+	const bool weNeedAnAntiAliasingFilter = ( upfactor < 1.0 );
+	if (weNeedAnAntiAliasingFilter) {
+		/*
+			The filter that interpolates is also the anti-aliasing filter,
+			so we do not let a low precision spoil the anti-aliasing.
+		*/
+		Sound_into_Sound_resampleWithWindowedSinc (me, thee, std::max (precision, 50_integer));
+	} else if (precision > NUM_VALUE_INTERPOLATE_CUBIC) {
+		Sound_into_Sound_resampleWithWindowedSinc (me, thee, precision);
+	} else {
 		for (integer ichan = 1; ichan <= my ny; ichan ++) {
 			if (precision <= 1) {
-				for (integer i = 1; i <= numberOfSamples; i ++) {
-					double x = Sampled_indexToX (thee.get(), i);
+				for (integer i = 1; i <= thy nx; i ++) {
+					double x = Sampled_indexToX (thee, i);
 					double index = Sampled_xToIndex (me, x);
 					integer leftSample = Melder_ifloor (index);
 					double fraction = index - leftSample;
@@ -440,13 +665,50 @@ autoSound Sound_resample (Sound me, double samplingFrequency, integer precision)
 							(1 - fraction) * my z [ichan] [leftSample] + fraction * my z [ichan] [leftSample + 1] );
 				}
 			} else {
-				for (integer i = 1; i <= numberOfSamples; i ++) {
-					double x = Sampled_indexToX (thee.get(), i);
+				for (integer i = 1; i <= thy nx; i ++) {
+					double x = Sampled_indexToX (thee, i);
 					double index = Sampled_xToIndex (me, x);
 					thy z [ichan] [i] = NUM_interpolate_sinc (my z.row (ichan), index, precision);
 				}
 			}
 		}
+	}
+}
+
+integer Sound_getResamplingMargin (double oldSamplingPeriod, double newSamplingPeriod, integer precision) {
+	const double step = newSamplingPeriod / oldSamplingPeriod;
+	if (fabs (step - 1.0) < 1e-6)
+		return 0;
+	const bool weNeedAnAntiAliasingFilter = ( step > 1.0 );
+	if (! weNeedAnAntiAliasingFilter && precision <= NUM_VALUE_INTERPOLATE_CUBIC)
+		return 2;
+	const integer depth = ( weNeedAnAntiAliasingFilter ? std::max (precision, 50_integer) : precision );
+	return resample_getNumberOfTapsPerSide (resample_getCutoff (step, depth), depth);
+}
+
+autoSound Sound_resampleOntoGrid (Sound me, Sampled grid, integer firstSample, integer lastSample, integer precision) {
+	try {
+		Melder_assert (firstSample >= 1 && lastSample <= grid -> nx && lastSample >= firstSample);
+		const double x1 = Sampled_indexToX (grid, firstSample);
+		autoSound thee = Sound_create (my ny, x1 - 0.5 * grid -> dx, Sampled_indexToX (grid, lastSample) + 0.5 * grid -> dx,
+				lastSample - firstSample + 1, grid -> dx, x1);
+		Sound_into_Sound_resample (me, thee.get(), precision);
+		return thee;
+	} catch (MelderError) {
+		Melder_throw (me, U": not resampled.");
+	}
+}
+
+autoSound Sound_resample (Sound me, double samplingFrequency, integer precision) {
+	const double upfactor = samplingFrequency * my dx;
+	if (fabs (upfactor - 2.0) < 1e-6)
+		return Sound_upsample (me);
+	if (fabs (upfactor - 1.0) < 1e-6)
+		return Data_copy (me);
+	try {
+		autoSampled grid = Sampled_createResampledGrid (me, samplingFrequency);
+		autoSound thee = Sound_create (my ny, grid -> xmin, grid -> xmax, grid -> nx, grid -> dx, grid -> x1);
+		Sound_into_Sound_resample (me, thee.get(), precision);
 		return thee;
 	} catch (MelderError) {
 		Melder_throw (me, U": not resampled.");
@@ -537,6 +799,83 @@ autoSound Sounds_concatenate (OrderedOf<structSound>& list, double overlapTime)
 	}
 }
 
+/*
+	Convolution in blocks ("uniformly partitioned overlap-save").
+
+	The shorter of the two signals serves as the filter. Its spectrum is computed once per channel,
+	with an FFT size of a few times its length (a power of two, at least 256, but not more than needed for the whole result).
+	The result is then computed in blocks of `nfft - filterLength + 1` samples:
+	for each block, `nfft` samples of the longer signal (the block itself and the `filterLength - 1` samples before it)
+	are transformed, multiplied by the spectrum of the filter and transformed back;
+	the first `filterLength - 1` samples of the back-transform are wrapped around and discarded.
+	Memory use beyond the result is therefore proportional to the length of the shorter signal (per thread),
+	not to the length of the result, and all blocks of all channels are computed on multiple threads.
+
+	If `reverseMe` is true, `me` is time-reversed on the fly, which turns the convolution into a cross-correlation.
+	The result is the plain sum, i.e. with the scaling "sum".
+*/
+struct Sounds_convolve_Workspace {
+	autoNUMfft_Table fftTable;
+	autoVEC buffer;
+};
+static void Sounds_into_Sound_convolve_inBlocks (Sound me, Sound thee, bool reverseMe, Sound him, conststring32 progressMessage) {
+	const integer n3 = my nx + thy nx - 1;
+	Melder_assert (his nx == n3);
+	const bool iAmTheFilter = ( my nx <= thy nx );
+	const Sound filter = ( iAmTheFilter ? me : thee ), signal = ( iAmTheFilter ? thee : me );
+	const bool filterIsReversed = ( reverseMe && iAmTheFilter ), signalIsReversed = ( reverseMe && ! iAmTheFilter );
+	const integer filterLength = filter -> nx, signalLength = signal -> nx;
+	integer nfft = 2;
+	while (nfft < n3 && (nfft < 4 * filterLength || nfft < 256))
+		nfft *= 2;
+	const integer blockSize = nfft - filterLength + 1;
+	const integer numberOfBlocks = (n3 - 1) / blockSize + 1;
+
+	autoNUMfft_Table fftTable;
+	NUMfft_Table_init (& fftTable, nfft);
+	autoMAT filterSpectra = zero_MAT (filter -> ny, nfft);
+	for (integer channel = 1; channel <= filter -> ny; channel ++) {
+		VEC spectrum = filterSpectra.row (channel);
+		for (integer i = 1; i <= filterLength; i ++)
+			spectrum [i] = filter -> z [channel] [filterIsReversed ? filterLength + 1 - i : i];
+		NUMfft_forward (& fftTable, spectrum);
+	}
+	const double scaling = 1.0 / nfft;   // NUMfft_backward does not normalize
+
+	MelderThread_runFrames <Sounds_convolve_Workspace> (his ny * numberOfBlocks, 1,
+		[&] (Sounds_convolve_Workspace& workspace) {
+			NUMfft_Table_init (& workspace.fftTable, nfft);
+			workspace.buffer = raw_VEC (nfft);
+		},
+		[&] (Sounds_convolve_Workspace& workspace, integer iframe) {
+			const integer channel = (iframe - 1) / numberOfBlocks + 1;
+			const integer firstSampleOfBlock = ((iframe - 1) % numberOfBlocks) * blockSize + 1;
+			const integer lastSampleOfBlock = std::min (firstSampleOfBlock + blockSize - 1, n3);
+			const constVEC x = signal -> z.row (signal -> ny == 1 ? 1 : channel);
+			const constVEC filterSpectrum = filterSpectra.row (filter -> ny == 1 ? 1 : channel);
+			const VEC buffer = workspace.buffer.get();
+			const integer offset = firstSampleOfBlock - filterLength;   // buffer [i] contains sample `offset + i` of the signal
+			for (integer i = 1; i <= nfft; i ++) {
+				const integer isample = offset + i;
+				buffer [i] = ( isample < 1 || isample > signalLength ? 0.0 :
+						x [signalIsReversed ? signalLength + 1 - isample : isample] );
+			}
+			NUMfft_forward (& workspace.fftTable, buffer);
+			buffer [1] *= filterSpectrum [1];
+			for (integer i = 2; i < nfft; i += 2) {
+				const double re = buffer [i] * filterSpectrum [i] - buffer [i + 1] * filterSpectrum [i + 1];
+				buffer [i + 1] = buffer [i] * filterSpectrum [i + 1] + buffer [i + 1] * filterSpectrum [i];
+				buffer [i] = re;
+			}
+			buffer [nfft] *= filterSpectrum [nfft];
+			NUMfft_backward (& workspace.fftTable, buffer);
+			for (integer isample = firstSampleOfBlock; isample <= lastSampleOfBlock; isample ++)
+				his z [channel] [isample] = buffer [isample - offset] * scaling;
+		},
+		progressMessage
+	);
+}
+
 autoSound Sounds_convolve (Sound me, Sound thee, kSounds_convolve_scaling scaling, kSounds_convolve_signalOutsideTimeDomain signalOutsideTimeDomain) {
 	try {
 		if (my ny > 1 && thy ny > 1 && my ny != thy ny)
@@ -544,38 +883,11 @@ autoSound Sounds_convolve (Sound me, Sound thee, kSounds_convolve_scaling scalin
 		if (my dx != thy dx)
 			Melder_throw (U"The sampling frequencies of the two sounds have to be equal.");
 		integer n1 = my nx, n2 = thy nx;
-		integer n3 = n1 + n2 - 1, nfft = 1;
-		while (nfft < n3)
-			nfft *= 2;
-		autoVEC data1 = raw_VEC (nfft);
-		autoVEC data2 = raw_VEC (nfft);
+		integer n3 = n1 + n2 - 1;
 		integer numberOfChannels = std::max (my ny, thy ny);
 		autoSound him = Sound_create (numberOfChannels, my xmin + thy xmin, my xmax + thy xmax, n3, my dx, my x1 + thy x1);
-		for (integer channel = 1; channel <= numberOfChannels; channel ++) {
-			double *a = & my z [my ny == 1 ? 1 : channel] [0];
-			for (integer i = n1; i > 0; i --)
-				data1 [i] = a [i];
-			for (integer i = n1 + 1; i <= nfft; i ++)
-				data1 [i] = 0.0;
-			a = & thy z [thy ny == 1 ? 1 : channel] [0];
-			for (integer i = n2; i > 0; i --)
-				data2 [i] = a [i];
-			for (integer i = n2 + 1; i <= nfft; i ++)
-				data2 [i] = 0.0;
-			NUMrealft (data1.get(), 1);
-			NUMrealft (data2.get(), 1);
-			data2 [1] *= data1 [1];
-			data2 [2] *= data1 [2];
-			for (integer i = 3; i <= nfft; i += 2) {
-				double temp = data1 [i] * data2 [i] - data1 [i + 1] * data2 [i + 1];
-				data2 [i + 1] = data1 [i] * data2 [i + 1] + data1 [i + 1] * data2 [i];
-				data2 [i] = temp;
-			}
-			NUMrealft (data2.get(), -1);
-			a = & him -> z [channel] [0];
-			for (integer i = 1; i <= n3; i ++)
-				a [i] = data2 [i];
-		}
+		autoMelderProgress progress (U"Convolving...");
+		Sounds_into_Sound_convolve_inBlocks (me, thee, false, him.get(), U"Convolving");
 		switch (signalOutsideTimeDomain) {
 			case kSounds_convolve_signalOutsideTimeDomain::ZERO: {
 				// do nothing
@@ -598,15 +910,15 @@ autoSound Sounds_convolve (Sound me, Sound thee, kSounds_convolve_scaling scalin
 		}
 		switch (scaling) {
 			case kSounds_convolve_scaling::INTEGRAL: {
-				Vector_multiplyByScalar (him.get(), my dx / nfft);
+				Vector_multiplyByScalar (him.get(), my dx);
 			} break;
 			case kSounds_convolve_scaling::SUM: {
-				Vector_multiplyByScalar (him.get(), 1.0 / nfft);
+				// the result is already the sum
 			} break;
 			case kSounds_convolve_scaling::NORMALIZE: {
 				double normalizationFactor = Matrix_getNorm (me) * Matrix_getNorm (thee);
 				if (normalizationFactor != 0.0)
-					Vector_multiplyByScalar (him.get(), 1.0 / nfft / normalizationFactor);
+					Vector_multiplyByScalar (him.get(), 1.0 / normalizationFactor);
 			} break;
 			case kSounds_convolve_scaling::PEAK_099: {
 				Vector_scale (him.get(), 0.99);
@@ -627,40 +939,11 @@ autoSound Sounds_crossCorrelate (Sound me, Sound thee, kSounds_convolve_scaling
 			Melder_throw (U"The sampling frequencies of the two sounds have to be equal.");
 		integer numberOfChannels = my ny > thy ny ? my ny : thy ny;
 		integer n1 = my nx, n2 = thy nx;
-		integer n3 = n1 + n2 - 1, nfft = 1;
-		while (nfft < n3)
-			nfft *= 2;
-		autoVEC data1 = raw_VEC (nfft);
-		autoVEC data2 = raw_VEC (nfft);
+		integer n3 = n1 + n2 - 1;
 		double my_xlast = my x1 + (n1 - 1) * my dx;
 		autoSound him = Sound_create (numberOfChannels, thy xmin - my xmax, thy xmax - my xmin, n3, my dx, thy x1 - my_xlast);
-		for (integer channel = 1; channel <= numberOfChannels; channel ++) {
-			double *a = & my z [my ny == 1 ? 1 : channel] [0];
-			for (integer i = n1; i > 0; i --)
-				data1 [i] = a [i];
-			for (integer i = n1 + 1; i <= nfft; i ++)
-				data1 [i] = 0.0;
-			a = & thy z [thy ny == 1 ? 1 : channel] [0];
-			for (integer i = n2; i > 0; i --)
-				data2 [i] = a [i];
-			for (integer i = n2 + 1; i <= nfft; i ++)
-				data2 [i] = 0.0;
-			NUMrealft (data1.get(), 1);
-			NUMrealft (data2.get(), 1);
-			data2 [1] *= data1 [1];
-			data2 [2] *= data1 [2];
-			for (integer i = 3; i <= nfft; i += 2) {
-				double temp = data1 [i] * data2 [i] + data1 [i + 1] * data2 [i + 1];   // reverse me by taking the conjugate of data1
-				data2 [i + 1] = data1 [i] * data2 [i + 1] - data1 [i + 1] * data2 [i];   // reverse me by taking the conjugate of data1
-				data2 [i] = temp;
-			}
-			NUMrealft (data2.get(), -1);
-			a = & him -> z [channel] [0];
-			for (integer i = 1; i < n1; i ++)
-				a [i] = data2 [i + (nfft - (n1 - 1))];   // data for the first part ("negative lags") is at the end of data2
-			for (integer i = 1; i <= n2; i ++)
-				a [i + (n1 - 1)] = data2 [i];   // data for the second part ("positive lags") is at the beginning of data2
-		}
+		autoMelderProgress progress (U"Cross-correlating...");
+		Sounds_into_Sound_convolve_inBlocks (me, thee, true, him.get(), U"Cross-correlating");   // convolve `thee` with the time-reversed `me`
 		switch (signalOutsideTimeDomain) {
 			case kSounds_convolve_signalOutsideTimeDomain::ZERO: {
 				// do nothing
@@ -683,15 +966,15 @@ autoSound Sounds_crossCorrelate (Sound me, Sound thee, kSounds_convolve_scaling
 		}
 		switch (scaling) {
 			case kSounds_convolve_scaling::INTEGRAL: {
-				Vector_multiplyByScalar (him.get(), my dx / nfft);
+				Vector_multiplyByScalar (him.get(), my dx);
 			} break;
 			case kSounds_convolve_scaling::SUM: {
-				Vector_multiplyByScalar (him.get(), 1.0 / nfft);
+				// the result is already the sum
 			} break;
 			case kSounds_convolve_scaling::NORMALIZE: {
 				double normalizationFactor = Matrix_getNorm (me) * Matrix_getNorm (thee);
 				if (normalizationFactor != 0.0)
-					Vector_multiplyByScalar (him.get(), 1.0 / nfft / normalizationFactor);
+					Vector_multiplyByScalar (him.get(), 1.0 / normalizationFactor);
 			} break;
 			case kSounds_convolve_scaling::PEAK_099: {
 				Vector_scale (him.get(), 0.99);
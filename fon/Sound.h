@@ -2,7 +2,7 @@
 #define _Sound_h_
 /* Sound.h
  *
- * Copyright (C) 1992-2005,2006-2008,2010-2019 Paul Boersma
+ * Copyright (C) 1992-2005,2006-2008,2010-2019,2021 Paul Boersma
  *
  * This code is free software; you can redistribute it and/or modify
  * it under the terms of the GNU General Public License as published by
@@ -114,7 +114,31 @@ autoSound Sound_resample (Sound me, double samplingFrequency, integer precision)
 /*
 	Method:
 		precision <= 1: linear interpolation.
-		precision >= 2: sinx/x interpolation with maximum depth equal to 'precision'.
+		precision == 2: cubic interpolation.
+		precision >= 3: sinx/x interpolation with a Hann window and a depth equal to 'precision'.
+	When downsampling, the sinx/x filter is also the anti-aliasing filter, and its depth is at least 50.
+*/
+
+autoSampled Sampled_createResampledGrid (Sampled me, double samplingFrequency);
+/*
+	The time axis of the Sound that Sound_resample () would create from a sound with the time axis of `me`,
+	for analysing the resampled sound in parts.
+*/
+
+autoSound Sound_resampleOntoGrid (Sound me, Sampled grid, integer firstSample, integer lastSample, integer precision);
+/*
+	The samples `firstSample` through `lastSample` of `grid`, resampled from `me` as Sound_resample () would;
+	the result has a domain that just contains these samples.
+	Typically, `grid` comes from Sampled_createResampledGrid () for a whole sound, of which `me` is a part.
+	The result is then the same as the corresponding part of Sound_resample () on the whole sound,
+	except for rounding in the last few bits, if `me` contains at least Sound_getResamplingMargin () samples
+	on either side of the requested times (or reaches the edge of the whole sound);
+	only for upsampling by a factor of 2, which Sound_resample () does with Sound_upsample (), are the results further apart.
+*/
+
+integer Sound_getResamplingMargin (double oldSamplingPeriod, double newSamplingPeriod, integer precision);
+/*
+	The number of old samples that the resampling filter reaches to either side of a new sample.
 */
 
 autoSound Sounds_append (Sound me, double silenceDuration, Sound thee);
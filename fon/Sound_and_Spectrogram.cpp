@@ -1,6 +1,6 @@
 /* Sound_and_Spectrogram.cpp
  *
- * Copyright (C) 1992-2011,2014-2020 Paul Boersma
+ * Copyright (C) 1992-2011,2014-2021 Paul Boersma
  *
  * This code is free software; you can redistribute it and/or modify
  * it under the terms of the GNU General Public License as published by
@@ -18,12 +18,19 @@
 
 #include "Sound_and_Spectrogram.h"
 #include "NUM2.h"
+#include "MelderThread.h"
 
 #include "enums_getText.h"
 #include "Sound_and_Spectrogram_enums.h"
 #include "enums_getValue.h"
 #include "Sound_and_Spectrogram_enums.h"
 
+struct Sound_into_Spectrogram_Workspace {
+	autoNUMfft_Table fftTable;
+	autoMAT data;   // one row per channel per frame of a chunk
+	autoVEC spectrum;
+};
+
 autoSpectrogram Sound_to_Spectrogram (Sound me, double effectiveAnalysisWidth, double fmax,
 	double minimumTimeStep1, double minimumFreqStep1, kSound_to_Spectrogram_windowShape windowType,
 	double maximumTimeOversampling, double maximumFreqOversampling)
@@ -118,69 +125,80 @@ autoSpectrogram Sound_to_Spectrogram (Sound me, double effectiveAnalysisWidth, d
 		}
 		const double oneByBinWidth = 1.0 / double (windowssq) / binWidth_samples;
 
-		autoVEC data = zero_VEC (nsampFFT);
-		autoVEC spectrum = zero_VEC (half_nsampFFT + 1);
-		autoNUMfft_Table fftTable;
-		NUMfft_Table_init (& fftTable, nsampFFT);
-
 		autoMelderProgress progress (U"Sound to Spectrogram...");
 
-		for (integer iframe = 1; iframe <= numberOfTimes; iframe ++) {
-			const double t = Sampled_indexToX (thee.get(), iframe);
-			const integer leftSample = Sampled_xToLowIndex (me, t), rightSample = leftSample + 1;
-			const integer startSample = rightSample - halfnsamp_window;
-			const integer endSample = leftSample + halfnsamp_window;
-			Melder_assert (startSample >= 1);
-			Melder_assert (endSample <= my nx);
-
-			spectrum.all()  <<=  0.0;
-			/*
-				For multichannel sounds, the power spectrogram should represent the
-				average power in the channels,
-				so that the result for a stereo sound in which the
-				left channel has the same waveform as the right channel,
-				is identical to the result for the corresponding mono (= averaged) sound.
-				Averaging starts by adding up the powers of the channels.
-			*/
-			for (integer channel = 1; channel <= my ny; channel ++) {
-				for (integer j = 1, i = startSample; j <= nsamp_window; j ++)
-					data [j] = my z [channel] [i ++] * window [j];
-				for (integer j = nsamp_window + 1; j <= nsampFFT; j ++)
-					data [j] = 0.0f;
-
-				Melder_progress (iframe / (numberOfTimes + 1.0),
-					U"Sound to Spectrogram: analysis of frame ", iframe, U" out of ", numberOfTimes);
-
-				/*
-					Compute the Fast Fourier Transform of the frame.
-				*/
-				NUMfft_forward (& fftTable, data.get());   // data := complex spectrum
+		constexpr integer numberOfFramesPerChunk = 20;
+		MelderThread_runFrameChunks <Sound_into_Spectrogram_Workspace> (numberOfTimes, numberOfFramesPerChunk,
+			[&] (Sound_into_Spectrogram_Workspace& workspace) {
+				NUMfft_Table_init (& workspace.fftTable, nsampFFT);
+				workspace.data = zero_MAT (numberOfFramesPerChunk * my ny, nsampFFT);
+				workspace.spectrum = zero_VEC (half_nsampFFT + 1);
+			},
+			[&] (Sound_into_Spectrogram_Workspace& workspace, integer firstFrame, integer lastFrame) {
+				const integer numberOfFramesInChunk = lastFrame - firstFrame + 1;
+				MAT data (workspace.data.cells, numberOfFramesInChunk * my ny, nsampFFT);
+				VEC spectrum = workspace.spectrum.get();
+				for (integer iframe = firstFrame; iframe <= lastFrame; iframe ++) {
+					const double t = Sampled_indexToX (thee.get(), iframe);
+					const integer leftSample = Sampled_xToLowIndex (me, t), rightSample = leftSample + 1;
+					const integer startSample = rightSample - halfnsamp_window;
+					const integer endSample = leftSample + halfnsamp_window;
+					Melder_assert (startSample >= 1);
+					Melder_assert (endSample <= my nx);
+					for (integer channel = 1; channel <= my ny; channel ++) {
+						VEC frame = data.row ((iframe - firstFrame) * my ny + channel);
+						for (integer j = 1, i = startSample; j <= nsamp_window; j ++)
+							frame [j] = my z [channel] [i ++] * window [j];
+						for (integer j = nsamp_window + 1; j <= nsampFFT; j ++)
+							frame [j] = 0.0f;
+					}
+				}
 
 				/*
-					Convert from complex to power spectrum,
-					accumulating the power spectra of the channels.
+					Compute the Fast Fourier Transforms of all frames (and channels) of the chunk.
 				*/
-				spectrum [1] += data [1] * data [1];   // DC component
-				for (integer i = 2; i <= half_nsampFFT; i ++)
-					spectrum [i] += data [i + i - 2] * data [i + i - 2] + data [i + i - 1] * data [i + i - 1];
-				spectrum [half_nsampFFT + 1] += data [nsampFFT] * data [nsampFFT];   // Nyquist frequency. Correct??
-			}
-			/*
-				Power averaging ends by dividing the summed power by the number of channels,
-			*/
-			if (my ny > 1 )
-				spectrum.all()  /=  my ny;
-
-			/*
-				Binning.
-			*/
-			for (integer iband = 1; iband <= numberOfFreqs; iband ++) {
-				const integer lowerSample = (iband - 1) * binWidth_samples + 1;
-				const integer higherSample = lowerSample + binWidth_samples;
-				const double power = NUMsum (spectrum.part (lowerSample, higherSample - 1));
-				thy z [iband] [iframe] = power * oneByBinWidth;
-			}
-		}
+				NUMfft_forward_batch (& workspace.fftTable, data);   // data := complex spectra
+
+				for (integer iframe = firstFrame; iframe <= lastFrame; iframe ++) {
+					spectrum  <<=  0.0;
+					/*
+						For multichannel sounds, the power spectrogram should represent the
+						average power in the channels,
+						so that the result for a stereo sound in which the
+						left channel has the same waveform as the right channel,
+						is identical to the result for the corresponding mono (= averaged) sound.
+						Averaging starts by adding up the powers of the channels.
+					*/
+					for (integer channel = 1; channel <= my ny; channel ++) {
+						constVEC frame = data.row ((iframe - firstFrame) * my ny + channel);
+						/*
+							Convert from complex to power spectrum,
+							accumulating the power spectra of the channels.
+						*/
+						spectrum [1] += frame [1] * frame [1];   // DC component
+						for (integer i = 2; i <= half_nsampFFT; i ++)
+							spectrum [i] += frame [i + i - 2] * frame [i + i - 2] + frame [i + i - 1] * frame [i + i - 1];
+						spectrum [half_nsampFFT + 1] += frame [nsampFFT] * frame [nsampFFT];   // Nyquist frequency. Correct??
+					}
+					/*
+						Power averaging ends by dividing the summed power by the number of channels,
+					*/
+					if (my ny > 1 )
+						spectrum  /=  my ny;
+
+					/*
+						Binning.
+					*/
+					for (integer iband = 1; iband <= numberOfFreqs; iband ++) {
+						const integer lowerSample = (iband - 1) * binWidth_samples + 1;
+						const integer higherSample = lowerSample + binWidth_samples;
+						const double power = NUMsum (spectrum.part (lowerSample, higherSample - 1));
+						thy z [iband] [iframe] = power * oneByBinWidth;
+					}
+				}
+			},
+			U"Sound to Spectrogram"
+		);
 		return thee;
 	} catch (MelderError) {
 		Melder_throw (me, U": spectrogram analysis not performed.");
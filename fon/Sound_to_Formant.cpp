@@ -1,6 +1,6 @@
 /* Sound_to_Formant.cpp
  *
- * Copyright (C) 1992-2008,2010-2012,2014-2020 Paul Boersma
+ * Copyright (C) 1992-2008,2010-2012,2014-2021 Paul Boersma
  *
  * This code is free software; you can redistribute it and/or modify
  * it under the terms of the GNU General Public License as published by
@@ -32,8 +32,13 @@
 #include "NUM2.h"
 #include "Polynomial.h"
 #include "Roots.h"
+#include "MelderThread.h"
 
-static void burg (constVEC samples, VEC coefficients,
+/*
+	Returns false (with the frame left empty) if the roots of the polynomial cannot be found;
+	does not throw, because it runs in any thread.
+*/
+static bool burg (constVEC samples, VEC coefficients, Polynomial polynomial, Roots roots, VEC const& rootsWorkspace,
 	Formant_Frame frame, double nyquistFrequency, double safetyMargin)
 {
 	double a0 = VECburg (coefficients, samples);
@@ -41,7 +46,7 @@ static void burg (constVEC samples, VEC coefficients,
 	/*
 		Convert LP coefficients to polynomial.
 	 */
-	autoPolynomial polynomial = Polynomial_create (-1, 1, coefficients.size);
+	Melder_assert (polynomial -> numberOfCoefficients == coefficients.size + 1);
 	for (integer i = 1; i <= coefficients.size; i ++)
 		polynomial -> coefficients [i] = - coefficients [coefficients.size - i + 1];
 	polynomial -> coefficients [coefficients.size + 1] = 1.0;
@@ -49,8 +54,9 @@ static void burg (constVEC samples, VEC coefficients,
 	/*
 		Find the roots of the polynomial.
 	 */
-	autoRoots roots = Polynomial_to_Roots (polynomial.get());
-	Roots_fixIntoUnitCircle (roots.get());
+	if (! Polynomial_into_Roots (polynomial, roots, rootsWorkspace))
+		return false;
+	Roots_fixIntoUnitCircle (roots);
 
 	Melder_assert (frame -> numberOfFormants == 0 && NUMisEmpty (frame -> formant.get()));
 
@@ -86,6 +92,7 @@ static void burg (constVEC samples, VEC coefficients,
 			}
 		}
 	Melder_assert (iformant == frame -> numberOfFormants);   // may fail if some frequency is NaN
+	return true;
 }
 
 static int findOneZero (integer ijt, double vcx [], double a, double b, double *zero) {
@@ -94,16 +101,8 @@ static int findOneZero (integer ijt, double vcx [], double a, double b, double *
 		fa = vcx [k] + a * fa;
 		fb = vcx [k] + b * fb;
 	}
-	if (fa * fb >= 0.0) {   // there should be a zero between a and b
-		Melder_casual (
-			U"There is no zero between ,", Melder_single (a),
-			U" and ", Melder_single (b),
-			U".\n    The function values are ", Melder_single (fa),
-			U" and ", Melder_single (fb),
-			U", respectively."
-		);
-		return 0;
-	}
+	if (fa * fb >= 0.0)   // there should be a zero between a and b
+		return 0;   // reported by the caller of splitLevinson (), which may run in any thread
 	do {
 		fx = 0.0;
 		/*x = fa == fb ? 0.5 * (a + b) : a + fa * (a - b) / (fb - fa);*/
@@ -148,13 +147,8 @@ static int findNewZeroes (integer ijt, double ppORIG [], integer degree,
 	/* Fill an array with the new zeroes, which lie between the old zeroes. */
 	newZeroes [0] = 1.0;
 	for (integer i = 1; i <= half_degree; i ++) {
-		if (! findOneZero (ijt, px, zeroes [i - 1], zeroes [i], & newZeroes [i])) {
-			Melder_casual (
-				U"Degree ", degree,
-				U" not completed."
-			);
+		if (! findOneZero (ijt, px, zeroes [i - 1], zeroes [i], & newZeroes [i]))
 			return 0;
-		}
 	}
 	newZeroes [half_degree + 1] = -1.0;
 	/*
@@ -293,31 +287,45 @@ void Formant_sort (Formant me) {
 	}
 }
 
-static autoFormant Sound_to_Formant_any_inplace (Sound me, double dt_in, integer numberOfPoles,
-	double halfdt_window, int which, double preemphasisFrequency, double safetyMargin)
-{
+struct Sound_into_Formant_Workspace {
+	autoVEC frameBuffer, coefficients;
+	autoPolynomial polynomial;
+	autoRoots roots;
+	autoVEC rootsWorkspace;
+};
+
+autoFormant Formant_createForAnalysis (Sampled sound, double dt_in, integer numberOfPoles, double halfdt_window) {
 	const double dt = ( dt_in > 0.0 ? dt_in : halfdt_window / 4.0 );
-	const double physicalDuration = my nx * my dx;
-	double dt_window = 2.0 * halfdt_window;
+	const double physicalDuration = sound -> nx * sound -> dx;
+	const double dt_window = 2.0 * halfdt_window;
 	integer nFrames = 1 + Melder_ifloor ((physicalDuration - dt_window) / dt);
-	integer nsamp_window = Melder_ifloor (dt_window / my dx), halfnsamp_window = nsamp_window / 2;
+	const integer nsamp_window = Melder_ifloor (dt_window / sound -> dx);
 
 	if (nsamp_window < numberOfPoles + 1)
 		Melder_throw (U"Window too short.");
-	double t1 = my x1 + 0.5 * (physicalDuration - my dx - (nFrames - 1) * dt);   // centre of first frame
+	double t1 = sound -> x1 + 0.5 * (physicalDuration - sound -> dx - (nFrames - 1) * dt);   // centre of first frame
 	if (nFrames < 1) {
 		nFrames = 1;
-		t1 = my x1 + 0.5 * physicalDuration;
-		dt_window = physicalDuration;
-		nsamp_window = my nx;
+		t1 = sound -> x1 + 0.5 * physicalDuration;
 	}
-	autoFormant thee = Formant_create (my xmin, my xmax, nFrames, dt, t1, (numberOfPoles + 1) / 2);   // e.g. 11 poles -> maximally 6 formants
+	return Formant_create (sound -> xmin, sound -> xmax, nFrames, dt, t1, (numberOfPoles + 1) / 2);   // e.g. 11 poles -> maximally 6 formants
+}
 
-	autoMelderProgress progress (U"Formant analysis...");
+void Sound_into_Formant (Sound me, Sampled whole, Formant thee, integer firstFrame, integer lastFrame,
+	integer numberOfPoles, double halfdt_window, int which, double preemphasisFrequency, double safetyMargin)
+{
+	/*
+		Sample numbers are computed on the time axis of the whole sound,
+		so that analysing the sound in parts gives exactly the same results as analysing it as a whole.
+	*/
+	const integer sampleOffset = Sampled_xToNearestIndex (whole, my x1) - 1;
 
 	/* Pre-emphasis. */
 	Sound_preEmphasis (me, preemphasisFrequency);
 
+	integer nsamp_window = Melder_ifloor (2.0 * halfdt_window / my dx), halfnsamp_window = nsamp_window / 2;
+	Melder_clipRight (& nsamp_window, my nx);   // only if the whole sound is shorter than the window, in which case there is a single frame
+
 	/* Gaussian window. */
 	autoVEC window = raw_VEC (nsamp_window);
 	for (integer i = 1; i <= nsamp_window; i ++) {
@@ -325,47 +333,75 @@ static autoFormant Sound_to_Formant_any_inplace (Sound me, double dt_in, integer
 		window [i] = (exp (-48.0 * (i - imid) * (i - imid) / (nsamp_window + 1) / (nsamp_window + 1)) - edge) / (1.0 - edge);
 	}
 
-	integer maximumFrameLength = nsamp_window;
-	auto frameBuffer = raw_VEC (maximumFrameLength);
-	auto coefficients = raw_VEC (numberOfPoles);   // superfluous if which==2, but nobody uses that anyway
-	for (integer iframe = 1; iframe <= nFrames; iframe ++) {
-		const double t = Sampled_indexToX (thee.get(), iframe);
-		const integer leftSample = Sampled_xToLowIndex (me, t);
-		const integer rightSample = leftSample + 1;
-		integer startSample = rightSample - halfnsamp_window;
-		integer endSample = leftSample + halfnsamp_window;
-		double maximumIntensity = 0.0;
-		Melder_clipLeft (1_integer, & startSample);   // this should not be more than a rounding problem
-		Melder_clipRight (& endSample, my nx);   // this should not be more than a rounding problem
-		for (integer i = startSample; i <= endSample; i ++) {
-			const double value = Sampled_getValueAtSample (me, i, Sound_LEVEL_MONO, 0);
-			if (value * value > maximumIntensity)
-				maximumIntensity = value * value;
-		}
-		thy frames [iframe]. intensity = maximumIntensity;
-		if (maximumIntensity == 0.0)
-			continue;   // Burg cannot stand all zeroes
-
-		/* Copy a pre-emphasized window to a frame. */
-		const integer actualFrameLength = endSample - startSample + 1;   // should rarely be less than nsamp_window
-		VEC frame = frameBuffer.part (1, actualFrameLength);
-		const integer offset = startSample - 1;
-		for (integer isamp = 1; isamp <= actualFrameLength; isamp ++)
-			frame [isamp] = Sampled_getValueAtSample (me, offset + isamp, Sound_LEVEL_MONO, 0) * window [isamp];
-
-		if (which == 1) {
-			burg (frame, coefficients.get(), & thy frames [iframe], 0.5 / my dx, safetyMargin);
-		} else if (which == 2) {
-			if (! splitLevinson (frame, numberOfPoles, & thy frames [iframe], 0.5 / my dx)) {
-				Melder_clearError ();
-				Melder_casual (U"(Sound_to_Formant:)"
-					U" Analysis results of frame ", iframe,
-					U" will be wrong."
-				);
+	/*
+		Each thread analyses frames into the frames of the Formant,
+		using only its own frame buffer, coefficients and root finder,
+		so that the result does not depend on the number of threads.
+		The threads only count the frames that burg () or splitLevinson () could not complete;
+		these are reported once, after all threads have finished.
+	*/
+	std::atomic <integer> numberOfWrongFrames (0);
+	MelderThread_runFrames <Sound_into_Formant_Workspace> (lastFrame - firstFrame + 1, 20,
+		[&] (Sound_into_Formant_Workspace& workspace) {
+			workspace.frameBuffer = raw_VEC (nsamp_window);
+			workspace.coefficients = raw_VEC (numberOfPoles);   // superfluous if which==2, but nobody uses that anyway
+			if (which == 1) {
+				workspace.polynomial = Polynomial_create (-1.0, 1.0, numberOfPoles);
+				workspace.roots = Roots_create (numberOfPoles);
+				workspace.rootsWorkspace = raw_VEC (numberOfPoles * (numberOfPoles + 9));   // see Polynomial_into_Roots ()
 			}
-		}
-		Melder_progress ((double) iframe / (double) nFrames, U"Formant analysis: frame ", iframe);
-	}
+		},
+		[&] (Sound_into_Formant_Workspace& workspace, integer iframeInPart) {
+			const integer iframe = firstFrame - 1 + iframeInPart;
+			const double t = Sampled_indexToX (thee, iframe);
+			const integer leftSample = Sampled_xToLowIndex (whole, t) - sampleOffset;
+			const integer rightSample = leftSample + 1;
+			integer startSample = rightSample - halfnsamp_window;
+			integer endSample = leftSample + halfnsamp_window;
+			double maximumIntensity = 0.0;
+			Melder_clipLeft (1_integer, & startSample);   // this should not be more than a rounding problem
+			Melder_clipRight (& endSample, my nx);   // this should not be more than a rounding problem
+			for (integer i = startSample; i <= endSample; i ++) {
+				const double value = Sampled_getValueAtSample (me, i, Sound_LEVEL_MONO, 0);
+				if (value * value > maximumIntensity)
+					maximumIntensity = value * value;
+			}
+			thy frames [iframe]. intensity = maximumIntensity;
+			if (maximumIntensity == 0.0)
+				return;   // Burg cannot stand all zeroes
+
+			/* Copy a pre-emphasized window to a frame. */
+			const integer actualFrameLength = endSample - startSample + 1;   // should rarely be less than nsamp_window
+			VEC frame = workspace.frameBuffer.part (1, actualFrameLength);
+			const integer offset = startSample - 1;
+			for (integer isamp = 1; isamp <= actualFrameLength; isamp ++)
+				frame [isamp] = Sampled_getValueAtSample (me, offset + isamp, Sound_LEVEL_MONO, 0) * window [isamp];
+
+			if (which == 1) {
+				if (! burg (frame, workspace.coefficients.get(), workspace.polynomial.get(), workspace.roots.get(),
+						workspace.rootsWorkspace.get(), & thy frames [iframe], 0.5 / my dx, safetyMargin))
+					numberOfWrongFrames ++;
+			} else if (which == 2) {
+				if (! splitLevinson (frame, numberOfPoles, & thy frames [iframe], 0.5 / my dx))
+					numberOfWrongFrames ++;
+			}
+		},
+		U"Formant analysis"
+	);
+	if (numberOfWrongFrames > 0)
+		Melder_casual (U"(Sound_to_Formant:)"
+			U" Analysis results of ", (integer) numberOfWrongFrames,
+			U" out of ", lastFrame - firstFrame + 1, U" frames will be wrong."
+		);
+}
+
+static autoFormant Sound_to_Formant_any_inplace (Sound me, double dt_in, integer numberOfPoles,
+	double halfdt_window, int which, double preemphasisFrequency, double safetyMargin)
+{
+	autoFormant thee = Formant_createForAnalysis (me, dt_in, numberOfPoles, halfdt_window);
+
+	autoMelderProgress progress (U"Formant analysis...");
+	Sound_into_Formant (me, me, thee.get(), 1, thy nx, numberOfPoles, halfdt_window, which, preemphasisFrequency, safetyMargin);
 	Formant_sort (thee.get());
 	return thee;
 }
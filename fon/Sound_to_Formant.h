@@ -1,6 +1,6 @@
 /* Sound_to_Formant.h
  *
- * Copyright (C) 1992-2011,2015,2019 Paul Boersma
+ * Copyright (C) 1992-2011,2015,2019,2021 Paul Boersma
  *
  * This code is free software; you can redistribute it and/or modify
  * it under the terms of the GNU General Public License as published by
@@ -26,6 +26,18 @@ autoFormant Sound_to_Formant_any (Sound me, double timeStep, integer numberOfPol
 	Which = 2: Split-Levinson
 */
 
+autoFormant Formant_createForAnalysis (Sampled sound, double timeStep, integer numberOfPoles, double halfdt_window);
+void Sound_into_Formant (Sound me, Sampled whole, Formant thee, integer firstFrame, integer lastFrame,
+	integer numberOfPoles, double halfdt_window, int which, double preemphasisFrequency, double safetyMargin);
+/*
+	The two halves of Sound_to_Formant_any () after resampling,
+	for analysing a sound that is not in memory as a whole (e.g. a LongSound) in parts.
+	Formant_createForAnalysis () creates the Formant with the frames for the resampled `sound`;
+	Sound_into_Formant () analyses frames `firstFrame` through `lastFrame`
+	from a part `me` of the resampled sound `whole` (with the original times) that contains the whole windows
+	of these frames plus one sample; this part is pre-emphasized in place, and `whole` is only used for its time axis. The caller sorts the formants afterwards.
+*/
+
 autoFormant Sound_to_Formant_burg (Sound me, double timeStep, double maximumNumberOfFormants,
 	double maximumFormantFrequency, double windowLength, double preemphasisFrequency);
 /* Throws away all formants below 50 Hz and above Nyquist minus 50 Hz. */
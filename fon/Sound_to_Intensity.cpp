@@ -1,6 +1,6 @@
 /* Sound_to_Intensity.cpp
  *
- * Copyright (C) 1992-2012,2014-2020 Paul Boersma
+ * Copyright (C) 1992-2012,2014-2021 Paul Boersma
  *
  * This code is free software; you can redistribute it and/or modify
  * it under the terms of the GNU General Public License as published by
@@ -32,62 +32,96 @@
  */
 
 #include "Sound_to_Intensity.h"
+#include "MelderThread.h"
 
-static autoIntensity Sound_to_Intensity_ (Sound me, double minimumPitch, double timeStep, bool subtractMeanPressure) {
+static double Intensity_getPhysicalWindowDuration (double minimumPitch) {
+	constexpr double minimumNumberOfPeriodsNeededForReliablePitchMeasurement = 3.2;
+	const double maximumPeriod = 1.0 / minimumPitch;
+	const double logicalWindowDuration = minimumNumberOfPeriodsNeededForReliablePitchMeasurement * maximumPeriod;   // == 3.2 / minimumPitch
+	return 2.0 * logicalWindowDuration;   // == 6.4 / minimumPitch
+}
+
+autoIntensity Intensity_createForAnalysis (Sampled sound, double minimumPitch, double timeStep) {
+	/*
+		Preconditions.
+	*/
+	Melder_require (isdefined (minimumPitch),
+		U"Minimum pitch is undefined.");
+	Melder_require (isdefined (timeStep),
+		U"Time step is undefined.");
+	Melder_require (timeStep >= 0.0,
+		U"Time step should be zero (= automatic) or positive, instead of ", timeStep, U" seconds.");
+	Melder_require (sound -> dx > 0.0,
+		U"The Sound's time step should be positive, instead of ", sound -> dx, U" seconds.");
+	Melder_require (minimumPitch > 0.0,
+		U"Minimum pitch should be positive, instead of ", minimumPitch, U" Hz.");
+	/*
+		Defaults.
+	*/
+	const double physicalWindowDuration = Intensity_getPhysicalWindowDuration (minimumPitch);
+	if (timeStep == 0.0) {
+		constexpr double defaultOversampling = 4.0;
+		timeStep = 0.5 * physicalWindowDuration / defaultOversampling;   // == 0.8 / minimumPitch
+	}
+	Melder_assert (physicalWindowDuration > 0.0);
+
+	integer numberOfFrames;
+	double thyFirstTime;
 	try {
-		/*
-			Preconditions.
-		*/
-		Melder_require (isdefined (minimumPitch),
-			U"Minimum pitch is undefined.");
-		Melder_require (isdefined (timeStep),
-			U"Time step is undefined.");
-		Melder_require (timeStep >= 0.0,
-			U"Time step should be zero (= automatic) or positive, instead of ", timeStep, U" seconds.");
-		Melder_require (my dx > 0.0,
-			U"The Sound's time step should be positive, instead of ", my dx, U" seconds.");
-		Melder_require (minimumPitch > 0.0,
-			U"Minimum pitch should be positive, instead of ", minimumPitch, U" Hz.");
-		/*
-			Defaults.
-		*/
-		constexpr double minimumNumberOfPeriodsNeededForReliablePitchMeasurement = 3.2;
-		const double maximumPeriod = 1.0 / minimumPitch;
-		const double logicalWindowDuration = minimumNumberOfPeriodsNeededForReliablePitchMeasurement * maximumPeriod;   // == 3.2 / minimumPitch
-		if (timeStep == 0.0) {
-			constexpr double defaultOversampling = 4.0;
-			timeStep = logicalWindowDuration / defaultOversampling;   // == 0.8 / minimumPitch
-		}
+		Sampled_shortTermAnalysis (sound, physicalWindowDuration, timeStep, & numberOfFrames, & thyFirstTime);
+	} catch (MelderError) {
+		const double physicalSoundDuration = sound -> nx * sound -> dx;
+		Melder_throw (U"The physical duration of the sound (the number of samples times the sampling period) in an intensity analysis "
+			"should be at least 6.4 divided by the minimum pitch (", minimumPitch, U" Hz), "
+			U"i.e. at least ", physicalWindowDuration, U" s, instead of ", physicalSoundDuration, U" s.");
+	}
+	return Intensity_create (sound -> xmin, sound -> xmax, numberOfFrames, timeStep, thyFirstTime);
+}
 
-		const double physicalWindowDuration = 2.0 * logicalWindowDuration;   // == 6.4 / minimumPitch
-		Melder_assert (physicalWindowDuration > 0.0);
-		const double halfWindowDuration = 0.5 * physicalWindowDuration;
-		const integer halfWindowSamples = Melder_ifloor (halfWindowDuration / my dx);
-		const integer windowNumberOfSamples = 2 * halfWindowSamples + 1;
-		autoVEC amplitude = zero_VEC (windowNumberOfSamples);
-		autoVEC window = zero_VEC (windowNumberOfSamples);
-		const integer windowCentreSampleNumber = halfWindowSamples + 1;
+void Sound_into_Intensity (Sound me, Sampled whole, Intensity thee, integer firstFrame, integer lastFrame,
+	double minimumPitch, bool subtractMeanPressure)
+{
+	/*
+		Sample numbers are computed on the time axis of the whole sound,
+		so that analysing the sound in parts gives exactly the same results as analysing it as a whole.
+	*/
+	const integer sampleOffset = Sampled_xToNearestIndex (whole, my x1) - 1;
+	const double physicalWindowDuration = Intensity_getPhysicalWindowDuration (minimumPitch);
+	const double halfWindowDuration = 0.5 * physicalWindowDuration;
+	const integer halfWindowSamples = Melder_ifloor (halfWindowDuration / my dx);
+	const integer windowNumberOfSamples = 2 * halfWindowSamples + 1;
+	autoVEC window = zero_VEC (windowNumberOfSamples);
+	const integer windowCentreSampleNumber = halfWindowSamples + 1;
 
-		for (integer i = 1; i <= windowNumberOfSamples; i ++) {
-			const double x = (i - windowCentreSampleNumber) * my dx / halfWindowDuration;
-			const double root = sqrt (Melder_clippedLeft (0.0, 1.0 - sqr (x)));   // clipping should be rare
-			window [i] = NUMbessel_i0_f ((2.0 * NUMpi * NUMpi + 0.5) * root);
-		}
+	for (integer i = 1; i <= windowNumberOfSamples; i ++) {
+		const double x = (i - windowCentreSampleNumber) * my dx / halfWindowDuration;
+		const double root = sqrt (Melder_clippedLeft (0.0, 1.0 - sqr (x)));   // clipping should be rare
+		window [i] = NUMbessel_i0_f ((2.0 * NUMpi * NUMpi + 0.5) * root);
+	}
 
-		integer numberOfFrames;
-		double thyFirstTime;
-		try {
-			Sampled_shortTermAnalysis (me, physicalWindowDuration, timeStep, & numberOfFrames, & thyFirstTime);
-		} catch (MelderError) {
-			const double physicalSoundDuration = my nx * my dx;
-			Melder_throw (U"The physical duration of the sound (the number of samples times the sampling period) in an intensity analysis "
-				"should be at least 6.4 divided by the minimum pitch (", minimumPitch, U" Hz), "
-				U"i.e. at least ", physicalWindowDuration, U" s, instead of ", physicalSoundDuration, U" s.");
-		}
-		autoIntensity thee = Intensity_create (my xmin, my xmax, numberOfFrames, timeStep, thyFirstTime);
-		for (integer iframe = 1; iframe <= numberOfFrames; iframe ++) {
-			const double midTime = Sampled_indexToX (thee.get(), iframe);
-			const integer soundCentreSampleNumber = Sampled_xToNearestIndex (me, midTime);   // time accuracy is half a sampling period
+	/*
+		For all frames that lie completely within the sound,
+		the sum of the window weights is the same,
+		so we compute it only once, in the same order as in the frame loop below,
+		so that the result does not depend on the engine.
+	*/
+	longdouble completeWindowSumw = 0.0;
+	for (integer ichan = 1; ichan <= my ny; ichan ++)
+		for (integer isamp = 1; isamp <= windowNumberOfSamples; isamp ++)
+			completeWindowSumw += window [isamp];
+	const bool useOldEngine = ( Melder_debug == 56 );
+	struct Workspace {
+		autoVEC amplitude;
+	};
+	MelderThread_runFrames <Workspace> (lastFrame - firstFrame + 1, 100,
+		[&] (Workspace& workspace) {
+			if (useOldEngine)
+				workspace.amplitude = zero_VEC (windowNumberOfSamples);
+		},
+		[&] (Workspace& workspace, integer iframeInPart) {
+			const integer iframe = firstFrame - 1 + iframeInPart;
+			const double midTime = Sampled_indexToX (thee, iframe);
+			const integer soundCentreSampleNumber = Sampled_xToNearestIndex (whole, midTime) - sampleOffset;   // time accuracy is half a sampling period
 
 			integer leftSample = soundCentreSampleNumber - halfWindowSamples;
 			integer rightSample = soundCentreSampleNumber + halfWindowSamples;
@@ -100,17 +134,37 @@ static autoIntensity Sound_to_Intensity_ (Sound me, double minimumPitch, double
 				U"Unexpected edge case: right sample (", rightSample, U") less than left sample (", leftSample, U").");
 
 			const integer windowFromSoundOffset = windowCentreSampleNumber - soundCentreSampleNumber;
-			VEC amplitudePart = amplitude.part (windowFromSoundOffset + leftSample, windowFromSoundOffset + rightSample);
 			constVEC windowPart = window.part (windowFromSoundOffset + leftSample, windowFromSoundOffset + rightSample);
 			longdouble sumxw = 0.0, sumw = 0.0;
-			for (integer ichan = 1; ichan <= my ny; ichan ++) {
-				amplitudePart  <<=  my z [ichan].part (leftSample, rightSample);
-				if (subtractMeanPressure)
-					centre_VEC_inout (amplitudePart);
-				for (integer isamp = 1; isamp <= amplitudePart.size; isamp ++) {
-					sumxw += sqr (amplitudePart [isamp]) * windowPart [isamp];
-					sumw += windowPart [isamp];
+			if (useOldEngine) {
+				VEC amplitudePart = workspace.amplitude.part (windowFromSoundOffset + leftSample, windowFromSoundOffset + rightSample);
+				for (integer ichan = 1; ichan <= my ny; ichan ++) {
+					amplitudePart  <<=  my z [ichan].part (leftSample, rightSample);
+					if (subtractMeanPressure)
+						centre_VEC_inout (amplitudePart);
+					for (integer isamp = 1; isamp <= amplitudePart.size; isamp ++) {
+						sumxw += sqr (amplitudePart [isamp]) * windowPart [isamp];
+						sumw += windowPart [isamp];
+					}
 				}
+			} else {
+				/*
+					Fused engine: no copying of the samples into the window buffer,
+					and no separate pass for subtracting the mean.
+				*/
+				const bool isCompleteFrame = ( windowPart.size == windowNumberOfSamples );
+				for (integer ichan = 1; ichan <= my ny; ichan ++) {
+					constVEC soundPart = my z [ichan].part (leftSample, rightSample);
+					const double mean = ( subtractMeanPressure ? NUMmean (soundPart) : 0.0 );
+					const double *psound = & soundPart [1], *pwindow = & windowPart [1];
+					for (integer isamp = 1; isamp <= soundPart.size; isamp ++)
+						sumxw += sqr (*psound ++ - mean) * *pwindow ++;
+					if (! isCompleteFrame)
+						for (integer isamp = 1; isamp <= windowPart.size; isamp ++)
+							sumw += windowPart [isamp];
+				}
+				if (isCompleteFrame)
+					sumw = completeWindowSumw;
 			}
 			const double intensity_in_Pa2 = double (sumxw / sumw);
 			constexpr double hearingThreshold_in_Pa = 2.0e-5;
@@ -119,7 +173,14 @@ static autoIntensity Sound_to_Intensity_ (Sound me, double minimumPitch, double
 			const double intensity_in_dB_re_hearingThreshold = ( intensity_re_hearingThreshold < 1.0e-30 ? -300.0 :
 					10.0 * log10 (intensity_re_hearingThreshold) );
 			thy z [1] [iframe] = intensity_in_dB_re_hearingThreshold;
-		}
+		}, U"Intensity analysis"
+	);
+}
+
+static autoIntensity Sound_to_Intensity_ (Sound me, double minimumPitch, double timeStep, bool subtractMeanPressure) {
+	try {
+		autoIntensity thee = Intensity_createForAnalysis (me, minimumPitch, timeStep);
+		Sound_into_Intensity (me, me, thee.get(), 1, thy nx, minimumPitch, subtractMeanPressure);
 		return thee;
 	} catch (MelderError) {
 		Melder_throw (me, U": intensity analysis not performed.");
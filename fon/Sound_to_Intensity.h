@@ -1,6 +1,6 @@
 /* Sound_to_Intensity.h
  *
- * Copyright (C) 1992-2011,2015,2017 Paul Boersma
+ * Copyright (C) 1992-2011,2015,2017,2021 Paul Boersma
  *
  * This code is free software; you can redistribute it and/or modify
  * it under the terms of the GNU General Public License as published by
@@ -47,4 +47,16 @@ autoIntensity Sound_to_Intensity (Sound me, double minimumPitch, double timeStep
 
 autoIntensityTier Sound_to_IntensityTier (Sound me, double minimumPitch, double timeStep, bool subtractMean);
 
+/*
+	For analysing a sound that is not in memory as a whole (e.g. a LongSound) in parts:
+	Intensity_createForAnalysis () creates the Intensity with the frames that Sound_to_Intensity () would give,
+	and Sound_into_Intensity () computes frames `firstFrame` through `lastFrame` of it
+	from a part `me` of the sound `whole` (with the original times) that contains all the samples
+	within 3.2 / `minimumPitch` seconds from the centres of these frames;
+	`whole` is only used for its time axis.
+*/
+autoIntensity Intensity_createForAnalysis (Sampled sound, double minimumPitch, double timeStep);
+void Sound_into_Intensity (Sound me, Sampled whole, Intensity thee, integer firstFrame, integer lastFrame,
+	double minimumPitch, bool subtractMean);
+
 /* End of file Sound_to_Intensity.h */
@@ -1,6 +1,6 @@
 /* Sound_to_Pitch.cpp
  *
- * Copyright (C) 1992-2005,2007-2012,2014-2020 Paul Boersma
+ * Copyright (C) 1992-2005,2007-2012,2014-2021 Paul Boersma
  *
  * This code is free software; you can redistribute it and/or modify
  * it under the terms of the GNU General Public License as published by
@@ -41,15 +41,16 @@
 #define FCC_NORMAL  2
 #define FCC_ACCURATE  3
 
-static void Sound_into_PitchFrame (Sound me, Pitch_Frame pitchFrame, double t,
-	double minimumPitch, int maxnCandidates, int method, double voicingThreshold, double octaveCost,
-	NUMfft_Table fftTable, double dt_window, integer nsamp_window, integer halfnsamp_window,
-	integer maximumLag, integer nsampFFT, integer nsamp_period, integer halfnsamp_period,
-	integer brent_ixmax, integer brent_depth, double globalPeak,
-	MAT const& frame, VEC const& ac, VEC const& window, VEC const& windowR,
-	double *r, INTVEC const& imax, VEC const& localMean)
+/*
+	Copy the windowed frame of each channel, minus its local mean, to a row of `frame`,
+	and compute the intensity of the pitch frame. Returns the local peak.
+	`leftSample` is the last sample of `me` before the centre of the frame.
+*/
+static double Sound_into_PitchFrame_window (Sound me, Pitch_Frame pitchFrame, integer leftSample, int method,
+	integer nsamp_window, integer halfnsamp_window, integer nsampFFT, integer nsamp_period, integer halfnsamp_period,
+	double globalPeak, MAT const& frame, VEC const& window, VEC const& localMean)
 {
-	integer leftSample = Sampled_xToLowIndex (me, t), rightSample = leftSample + 1;
+	integer rightSample = leftSample + 1;
 	integer startSample, endSample;
 
 	for (integer channel = 1; channel <= my ny; channel ++) {
@@ -100,69 +101,70 @@ static void Sound_into_PitchFrame (Sound me, Pitch_Frame pitchFrame, double t,
 		}
 	}
 	pitchFrame -> intensity = ( localPeak > globalPeak ? 1.0 : localPeak / globalPeak );
+	return localPeak;
+}
 
-	/*
-		Compute the correlation into the array 'r'.
-	*/
-	if (method >= FCC_NORMAL) {
-		double startTime = t - 0.5 * (1.0 / minimumPitch + dt_window);
-		integer localSpan = maximumLag + nsamp_window, localMaximumLag, offset;
-		if ((startSample = Sampled_xToLowIndex (me, startTime)) < 1)
-			startSample = 1;
-		if (localSpan > my nx + 1 - startSample)
-			localSpan = my nx + 1 - startSample;
-		localMaximumLag = localSpan - nsamp_window;
-		offset = startSample - 1;
-		longdouble sumx2 = 0.0;   // sum of squares
+/*
+	Compute the forward cross-correlation of the frame that starts at `startSample` into the array 'r'.
+*/
+static void Sound_into_PitchFrame_crossCorrelate (Sound me, integer startSample,
+	integer nsamp_window, integer maximumLag, VEC const& localMean, double *r)
+{
+	integer localSpan = maximumLag + nsamp_window, localMaximumLag, offset;
+	if (startSample < 1)
+		startSample = 1;
+	if (localSpan > my nx + 1 - startSample)
+		localSpan = my nx + 1 - startSample;
+	localMaximumLag = localSpan - nsamp_window;
+	offset = startSample - 1;
+	longdouble sumx2 = 0.0;   // sum of squares
+	for (integer channel = 1; channel <= my ny; channel ++) {
+		double *amp = & my z [channel] [0] + offset;
+		for (integer i = 1; i <= nsamp_window; i ++) {
+			const double x = amp [i] - localMean [channel];
+			sumx2 += x * x;
+		}
+	}
+	longdouble sumy2 = sumx2;   // at zero lag, these are still equal
+	r [0] = 1.0;
+	for (integer i = 1; i <= localMaximumLag; i ++) {
+		longdouble product = 0.0;
 		for (integer channel = 1; channel <= my ny; channel ++) {
 			double *amp = & my z [channel] [0] + offset;
-			for (integer i = 1; i <= nsamp_window; i ++) {
-				const double x = amp [i] - localMean [channel];
-				sumx2 += x * x;
-			}
-		}
-		longdouble sumy2 = sumx2;   // at zero lag, these are still equal
-		r [0] = 1.0;
-		for (integer i = 1; i <= localMaximumLag; i ++) {
-			longdouble product = 0.0;
-			for (integer channel = 1; channel <= my ny; channel ++) {
-				double *amp = & my z [channel] [0] + offset;
-				double y0 = amp [i] - localMean [channel];
-				double yZ = amp [i + nsamp_window] - localMean [channel];
-				sumy2 += yZ * yZ - y0 * y0;
-				for (integer j = 1; j <= nsamp_window; j ++) {
-					double x = amp [j] - localMean [channel];
-					double y = amp [i + j] - localMean [channel];
-					product += x * y;
-				}
+			double y0 = amp [i] - localMean [channel];
+			double yZ = amp [i + nsamp_window] - localMean [channel];
+			sumy2 += yZ * yZ - y0 * y0;
+			for (integer j = 1; j <= nsamp_window; j ++) {
+				double x = amp [j] - localMean [channel];
+				double y = amp [i + j] - localMean [channel];
+				product += x * y;
 			}
-			r [- i] = r [i] = (double) product / sqrt ((double) sumx2 * (double) sumy2);
 		}
-	} else {
-
-		/*
-			The FFT of the autocorrelation is the power spectrum.
-		*/
-		for (integer i = 1; i <= nsampFFT; i ++)
-			ac [i] = 0.0;
-		for (integer channel = 1; channel <= my ny; channel ++) {
-			NUMfft_forward (fftTable, VEC (& frame [channel] [1], fftTable->n));   // complex spectrum
-			ac [1] += frame [channel] [1] * frame [channel] [1];   // DC component
-			for (integer i = 2; i < nsampFFT; i += 2)
-				ac [i] += frame [channel] [i] * frame [channel] [i] + frame [channel] [i+1] * frame [channel] [i+1];   // power spectrum
-			ac [nsampFFT] += frame [channel] [nsampFFT] * frame [channel] [nsampFFT];   // Nyquist frequency
-		}
-		NUMfft_backward (fftTable, ac);   // autocorrelation
-
-		/*
-			Normalize the autocorrelation to the value with zero lag,
-			and divide it by the normalized autocorrelation of the window.
-		*/
-		r [0] = 1.0;
-		for (integer i = 1; i <= brent_ixmax; i ++)
-			r [- i] = r [i] = ac [i + 1] / (ac [1] * windowR [i + 1]);
+		r [- i] = r [i] = (double) product / sqrt ((double) sumx2 * (double) sumy2);
 	}
+}
+
+/*
+	Compute the normalized autocorrelation into the array 'r', from the power spectrum in 'ac',
+	which has been transformed back into the (unnormalized) autocorrelation.
+*/
+static void PitchFrame_autocorrelationToR (constVEC const& ac, integer brent_ixmax, VEC const& windowR, double *r) {
+	/*
+		Normalize the autocorrelation to the value with zero lag,
+		and divide it by the normalized autocorrelation of the window.
+	*/
+	r [0] = 1.0;
+	for (integer i = 1; i <= brent_ixmax; i ++)
+		r [- i] = r [i] = ac [i + 1] / (ac [1] * windowR [i + 1]);
+}
 
+/*
+	Find the candidates of the pitch frame from the correlation 'r'.
+*/
+static void PitchFrame_findCandidates (Sound me, Pitch_Frame pitchFrame, double localPeak,
+	double minimumPitch, int maxnCandidates, int method, double voicingThreshold, double octaveCost,
+	integer maximumLag, integer brent_ixmax, integer brent_depth, double *r, INTVEC const& imax)
+{
 	/*
 		Register the first candidate, which is always present: voicelessness.
 	*/
@@ -258,156 +260,281 @@ static void Sound_into_PitchFrame (Sound me, Pitch_Frame pitchFrame, double t,
 	}
 }
 
-Thing_define (Sound_into_Pitch_Args, Thing) { public:
-	Sound sound;
-	Pitch pitch;
-	integer firstFrame, lastFrame;
-	double minimumPitch;
-	int maxnCandidates, method;
-	double voicingThreshold, octaveCost, dt_window;
-	integer nsamp_window, halfnsamp_window, maximumLag, nsampFFT, nsamp_period, halfnsamp_period, brent_ixmax, brent_depth;
-	double globalPeak;
-	VEC window, windowR;
-	bool isMainThread;
-	volatile int *cancelled;
+struct Sound_into_Pitch_Workspace {
 	autoNUMfft_Table fftTable;
-	autoMAT frame;
-	autoVEC ac, rbuffer, localMean;
+	autoMAT frame;   // one row per channel per frame of a chunk
+	autoMAT ac;   // one row per frame of a chunk
+	autoVEC rbuffer, localMean, localPeak;
 	double *r;
 	autoINTVEC imax;
 };
 
-Thing_implement (Sound_into_Pitch_Args, Thing, 0);
-
-static void Sound_into_Pitch (Sound_into_Pitch_Args me)
+autoPitch Pitch_createForAnalysis (Sampled sound,
+	double dt, double minimumPitch, double periodsPerWindow, integer maxnCandidates, int method, double ceiling)
 {
-	for (integer iframe = my firstFrame; iframe <= my lastFrame; iframe ++) {
-		const Pitch_Frame pitchFrame = & my pitch -> frames [iframe];
-		const double t = Sampled_indexToX (my pitch, iframe);
-		if (my isMainThread) {
-			try {
-				Melder_progress (0.1 + 0.8 * (iframe - my firstFrame) / (my lastFrame - my firstFrame),
-					U"Sound to Pitch: analysing ", my lastFrame, U" frames");
-			} catch (MelderError) {
-				*my cancelled = 1;
-				throw;
-			}
-		} else if (*my cancelled) {
-			return;
-		}
-		Sound_into_PitchFrame (my sound, pitchFrame, t,
-			my minimumPitch, my maxnCandidates, my method, my voicingThreshold, my octaveCost,
-			& my fftTable, my dt_window, my nsamp_window, my halfnsamp_window,
-			my maximumLag, my nsampFFT, my nsamp_period, my halfnsamp_period,
-			my brent_ixmax, my brent_depth, my globalPeak,
-			my frame.get(), my ac.get(), my window, my windowR,
-			my r, my imax.get(), my localMean.get()
-		);
+	Melder_assert (maxnCandidates >= 2);
+	Melder_assert (method >= AC_HANNING && method <= FCC_ACCURATE);
+
+	if (maxnCandidates < ceiling / minimumPitch)
+		maxnCandidates = Melder_ifloor (ceiling / minimumPitch);
+
+	if (dt <= 0.0)
+		dt = periodsPerWindow / minimumPitch / 4.0;   // e.g. 3 periods, 75 Hz: 10 milliseconds
+
+	if (method == AC_GAUSS)
+		periodsPerWindow *= 2;   // because Gaussian window is twice as long
+	double duration = sound -> dx * sound -> nx;
+	if (minimumPitch < periodsPerWindow / duration)
+		Melder_throw (U"To analyse this Sound, “minimum pitch” must not be less than ", periodsPerWindow / duration, U" Hz.");
+
+	Melder_clipRight (& ceiling, 0.5 / sound -> dx);
+
+	/*
+		Determine window duration in seconds and in samples.
+	*/
+	double dt_window = periodsPerWindow / minimumPitch;
+	integer nsamp_window = Melder_ifloor (dt_window / sound -> dx);
+	integer halfnsamp_window = nsamp_window / 2 - 1;
+	if (halfnsamp_window < 2)
+		Melder_throw (U"Analysis window too short.");
+
+	/*
+	 * Determine the number of frames.
+	 * Fit as many frames as possible symmetrically in the total duration.
+	 * We do this even for the forward cross-correlation method,
+	 * because that allows us to compare the two methods.
+	 */
+	integer numberOfFrames;
+	double t1;
+	try {
+		Sampled_shortTermAnalysis (sound, method >= FCC_NORMAL ? 1.0 / minimumPitch + dt_window : dt_window, dt, & numberOfFrames, & t1);
+	} catch (MelderError) {
+		Melder_throw (U"The pitch analysis would give zero pitch frames.");
 	}
+
+	/*
+		Create the resulting pitch contour.
+	*/
+	autoPitch thee = Pitch_create (sound -> xmin, sound -> xmax, numberOfFrames, dt, t1, ceiling, maxnCandidates);
+
+	/*
+		Create (too much) space for candidates.
+	*/
+	for (integer iframe = 1; iframe <= numberOfFrames; iframe ++) {
+		const Pitch_Frame pitchFrame = & thy frames [iframe];
+		Pitch_Frame_init (pitchFrame, maxnCandidates);
+	}
+	return thee;
 }
 
-autoPitch Sound_to_Pitch_any (Sound me,
-	double dt, double minimumPitch, double periodsPerWindow, integer maxnCandidates,
-	int method,
-	double silenceThreshold, double voicingThreshold,
-	double octaveCost, double octaveJumpCost, double voicedUnvoicedCost, double ceiling)
+void Sound_into_Pitch (Sound me, Sampled whole, Pitch thee, integer firstFrame, integer lastFrame, double globalPeak,
+	double minimumPitch, double periodsPerWindow, int method, double voicingThreshold, double octaveCost)
 {
-	try {
-		autoNUMfft_Table fftTable;
-		double t1;
-		integer numberOfFrames;
-		integer nsampFFT;
-		double interpolation_depth;
-		integer brent_ixmax, brent_depth;
-		double globalPeak;
-
-		Melder_assert (maxnCandidates >= 2);
-		Melder_assert (method >= AC_HANNING && method <= FCC_ACCURATE);
-
-		if (maxnCandidates < ceiling / minimumPitch)
-			maxnCandidates = Melder_ifloor (ceiling / minimumPitch);
-
-		if (dt <= 0.0)
-			dt = periodsPerWindow / minimumPitch / 4.0;   // e.g. 3 periods, 75 Hz: 10 milliseconds
-
-		switch (method) {
-			case AC_HANNING:
-				brent_depth = NUM_PEAK_INTERPOLATE_SINC70;
-				interpolation_depth = 0.5;
-				break;
-			case AC_GAUSS:
-				periodsPerWindow *= 2;   // because Gaussian window is twice as long
-				brent_depth = NUM_PEAK_INTERPOLATE_SINC700;
-				interpolation_depth = 0.25;   // because Gaussian window is twice as long
-				break;
-			case FCC_NORMAL:
-				brent_depth = NUM_PEAK_INTERPOLATE_SINC70;
-				interpolation_depth = 1.0;
-				break;
-			case FCC_ACCURATE:
-				brent_depth = NUM_PEAK_INTERPOLATE_SINC700;
-				interpolation_depth = 1.0;
-				break;
-		}
-		double duration = my dx * my nx;
-		if (minimumPitch < periodsPerWindow / duration)
-			Melder_throw (U"To analyse this Sound, “minimum pitch” must not be less than ", periodsPerWindow / duration, U" Hz.");
+	/*
+		Sample numbers are computed on the time axis of the whole sound,
+		so that analysing the sound in parts gives exactly the same results as analysing it as a whole.
+	*/
+	const integer sampleOffset = Sampled_xToNearestIndex (whole, my x1) - 1;
+	autoNUMfft_Table fftTable;
+	integer nsampFFT;
+	double interpolation_depth;
+	integer brent_ixmax, brent_depth;
+	const integer maxnCandidates = thy maxnCandidates;
+
+	switch (method) {
+		case AC_HANNING:
+			brent_depth = NUM_PEAK_INTERPOLATE_SINC70;
+			interpolation_depth = 0.5;
+			break;
+		case AC_GAUSS:
+			periodsPerWindow *= 2;   // because Gaussian window is twice as long
+			brent_depth = NUM_PEAK_INTERPOLATE_SINC700;
+			interpolation_depth = 0.25;   // because Gaussian window is twice as long
+			break;
+		case FCC_NORMAL:
+			brent_depth = NUM_PEAK_INTERPOLATE_SINC70;
+			interpolation_depth = 1.0;
+			break;
+		case FCC_ACCURATE:
+			brent_depth = NUM_PEAK_INTERPOLATE_SINC700;
+			interpolation_depth = 1.0;
+			break;
+	}
 
-		/*
-			Determine the number of samples in the longest period.
-			We need this to compute the local mean of the sound (looking one period in both directions),
-			and to compute the local peak of the sound (looking half a period in both directions).
-		*/
-		integer nsamp_period = Melder_ifloor (1.0 / my dx / minimumPitch);
-		integer halfnsamp_period = nsamp_period / 2 + 1;
+	/*
+		Determine the number of samples in the longest period.
+		We need this to compute the local mean of the sound (looking one period in both directions),
+		and to compute the local peak of the sound (looking half a period in both directions).
+	*/
+	integer nsamp_period = Melder_ifloor (1.0 / my dx / minimumPitch);
+	integer halfnsamp_period = nsamp_period / 2 + 1;
 
-		Melder_clipRight (& ceiling, 0.5 / my dx);
+	/*
+		Determine window duration in seconds and in samples.
+	*/
+	double dt_window = periodsPerWindow / minimumPitch;
+	integer nsamp_window = Melder_ifloor (dt_window / my dx);
+	integer halfnsamp_window = nsamp_window / 2 - 1;
+	Melder_assert (halfnsamp_window >= 2);   // checked in Pitch_createForAnalysis ()
+	nsamp_window = halfnsamp_window * 2;
 
-		/*
-			Determine window duration in seconds and in samples.
-		*/
-		double dt_window = periodsPerWindow / minimumPitch;
-		integer nsamp_window = Melder_ifloor (dt_window / my dx);
-		integer halfnsamp_window = nsamp_window / 2 - 1;
-		if (halfnsamp_window < 2)
-			Melder_throw (U"Analysis window too short.");
-		nsamp_window = halfnsamp_window * 2;
+	/*
+	 * Determine the maximum lag.
+	 */
+	const integer maximumLag = std::min (Melder_ifloor (nsamp_window / periodsPerWindow) + 2, nsamp_window);
+
+	autoVEC window, windowR;
+	if (method >= FCC_NORMAL) {   // for cross-correlation analysis
+
+		nsampFFT = 0;
+		brent_ixmax = Melder_ifloor (nsamp_window * interpolation_depth);
+
+	} else {   // for autocorrelation analysis
 
 		/*
-		 * Determine the minimum and maximum lags.
-		 */
-		const integer minimumLag = std::max (2_integer, Melder_ifloor (1.0 / my dx / ceiling));
-		const integer maximumLag = std::min (Melder_ifloor (nsamp_window / periodsPerWindow) + 2, nsamp_window);
+			Compute the number of samples needed for doing FFT.
+			To avoid edge effects, we have to append zeroes to the window.
+			The maximum lag considered for maxima is maximumLag.
+			The maximum lag used in interpolation is nsamp_window * interpolation_depth.
+		*/
+		nsampFFT = 1;
+		while (nsampFFT < nsamp_window * (1 + interpolation_depth))
+			nsampFFT *= 2;
 
 		/*
-		 * Determine the number of frames.
-		 * Fit as many frames as possible symmetrically in the total duration.
-		 * We do this even for the forward cross-correlation method,
-		 * because that allows us to compare the two methods.
-		 */
-		try {
-			Sampled_shortTermAnalysis (me, method >= FCC_NORMAL ? 1.0 / minimumPitch + dt_window : dt_window, dt, & numberOfFrames, & t1);
-		} catch (MelderError) {
-			Melder_throw (U"The pitch analysis would give zero pitch frames.");
-		}
+			Create buffers for autocorrelation analysis.
+		*/
+		windowR. resize (nsampFFT);
+		window. resize (nsamp_window);
+		NUMfft_Table_init (& fftTable, nsampFFT);
 
 		/*
-			Create the resulting pitch contour.
+			A Gaussian or Hanning window is applied against phase effects.
+			The Hanning window is 2 to 5 dB better for 3 periods/window.
+			The Gaussian window is 25 to 29 dB better for 6 periods/window.
 		*/
-		autoPitch thee = Pitch_create (my xmin, my xmax, numberOfFrames, dt, t1, ceiling, maxnCandidates);
+		if (method == AC_GAUSS) {   // Gaussian window
+			double imid = 0.5 * (nsamp_window + 1), edge = exp (-12.0);
+			for (integer i = 1; i <= nsamp_window; i ++)
+				window [i] = (exp (-48.0 * (i - imid) * (i - imid) /
+						(nsamp_window + 1) / (nsamp_window + 1)) - edge) / (1.0 - edge);
+		} else {   // Hanning window
+			for (integer i = 1; i <= nsamp_window; i ++)
+				window [i] = 0.5 - 0.5 * cos (i * 2 * NUMpi / (nsamp_window + 1));
+		}
 
 		/*
-			Create (too much) space for candidates.
+			Compute the normalized autocorrelation of the window.
 		*/
-		for (integer iframe = 1; iframe <= numberOfFrames; iframe ++) {
-			const Pitch_Frame pitchFrame = & thy frames [iframe];
-			Pitch_Frame_init (pitchFrame, maxnCandidates);
+		for (integer i = 1; i <= nsamp_window; i ++)
+			windowR [i] = window [i];
+		NUMfft_forward (& fftTable, windowR.get());
+		windowR [1] *= windowR [1];   // DC component
+		for (integer i = 2; i < nsampFFT; i += 2) {
+			windowR [i] = windowR [i] * windowR [i] + windowR [i + 1] * windowR [i + 1];
+			windowR [i + 1] = 0.0;   // power spectrum: square and zero
 		}
+		windowR [nsampFFT] *= windowR [nsampFFT];   // Nyquist frequency
+		NUMfft_backward (& fftTable, windowR.get());   // autocorrelation
+		for (integer i = 2; i <= nsamp_window; i ++)
+			windowR [i] /= windowR [1];   // normalize
+		windowR [1] = 1.0;   // normalize
+
+		brent_ixmax = Melder_ifloor (nsamp_window * interpolation_depth);
+	}
+
+	constexpr integer numberOfFramesPerChunk = 20;
+	MelderThread_runFrameChunks <Sound_into_Pitch_Workspace> (lastFrame - firstFrame + 1, numberOfFramesPerChunk,
+		[&] (Sound_into_Pitch_Workspace& workspace) {
+			if (method >= FCC_NORMAL) {   // cross-correlation
+				workspace.frame = zero_MAT (my ny, nsamp_window);
+			} else {   // autocorrelation
+				NUMfft_Table_init (& workspace.fftTable, nsampFFT);
+				workspace.frame = zero_MAT (numberOfFramesPerChunk * my ny, nsampFFT);
+				workspace.ac = zero_MAT (numberOfFramesPerChunk, nsampFFT);
+			}
+			workspace.rbuffer = zero_VEC (2 * nsamp_window + 1);
+			workspace.r = & workspace.rbuffer [1 + nsamp_window];
+			workspace.imax = zero_INTVEC (maxnCandidates);
+			workspace.localMean = zero_VEC (my ny);
+			workspace.localPeak = zero_VEC (numberOfFramesPerChunk);
+		},
+		[&] (Sound_into_Pitch_Workspace& workspace, integer firstFrameInPart, integer lastFrameInPart) {
+			const integer firstChunkFrame = firstFrame - 1 + firstFrameInPart, lastChunkFrame = firstFrame - 1 + lastFrameInPart;
+			if (method >= FCC_NORMAL) {
+				for (integer iframe = firstChunkFrame; iframe <= lastChunkFrame; iframe ++) {
+					const Pitch_Frame pitchFrame = & thy frames [iframe];
+					const double t = Sampled_indexToX (thee, iframe);
+					const double localPeak = Sound_into_PitchFrame_window (me, pitchFrame,
+						Sampled_xToLowIndex (whole, t) - sampleOffset, method,
+						nsamp_window, halfnsamp_window, nsampFFT, nsamp_period, halfnsamp_period,
+						globalPeak, workspace.frame.get(), window.get(), workspace.localMean.get()
+					);
+					const double startTime = t - 0.5 * (1.0 / minimumPitch + dt_window);
+					Sound_into_PitchFrame_crossCorrelate (me, Sampled_xToLowIndex (whole, startTime) - sampleOffset,
+						nsamp_window, maximumLag, workspace.localMean.get(), workspace.r);
+					PitchFrame_findCandidates (me, pitchFrame, localPeak,
+						minimumPitch, maxnCandidates, method, voicingThreshold, octaveCost,
+						maximumLag, brent_ixmax, brent_depth, workspace.r, workspace.imax.get());
+				}
+				return;
+			}
+			/*
+				Autocorrelation: window all frames of the chunk,
+				so that their spectra and autocorrelations can be computed in batches.
+			*/
+			const integer numberOfFramesInChunk = lastChunkFrame - firstChunkFrame + 1;
+			MAT frames (workspace.frame.cells, numberOfFramesInChunk * my ny, nsampFFT);
+			MAT acs (workspace.ac.cells, numberOfFramesInChunk, nsampFFT);
+			for (integer iframe = firstChunkFrame; iframe <= lastChunkFrame; iframe ++) {
+				const integer iframeInChunk = iframe - firstChunkFrame + 1;
+				workspace.localPeak [iframeInChunk] = Sound_into_PitchFrame_window (me, & thy frames [iframe],
+					Sampled_xToLowIndex (whole, Sampled_indexToX (thee, iframe)) - sampleOffset, method,
+					nsamp_window, halfnsamp_window, nsampFFT, nsamp_period, halfnsamp_period, globalPeak,
+					MAT (& frames [(iframeInChunk - 1) * my ny + 1] [1], my ny, nsampFFT),
+					window.get(), workspace.localMean.get()
+				);
+			}
+			NUMfft_forward_batch (& workspace.fftTable, frames);   // complex spectra
+			/*
+				The FFT of the autocorrelation is the power spectrum.
+			*/
+			acs  <<=  0.0;
+			for (integer iframeInChunk = 1; iframeInChunk <= numberOfFramesInChunk; iframeInChunk ++) {
+				VEC ac = acs.row (iframeInChunk);
+				for (integer channel = 1; channel <= my ny; channel ++) {
+					constVEC spectrum = frames.row ((iframeInChunk - 1) * my ny + channel);
+					ac [1] += spectrum [1] * spectrum [1];   // DC component
+					for (integer i = 2; i < nsampFFT; i += 2)
+						ac [i] += spectrum [i] * spectrum [i] + spectrum [i+1] * spectrum [i+1];   // power spectrum
+					ac [nsampFFT] += spectrum [nsampFFT] * spectrum [nsampFFT];   // Nyquist frequency
+				}
+			}
+			NUMfft_backward_batch (& workspace.fftTable, acs);   // autocorrelations
+			for (integer iframe = firstChunkFrame; iframe <= lastChunkFrame; iframe ++) {
+				const integer iframeInChunk = iframe - firstChunkFrame + 1;
+				PitchFrame_autocorrelationToR (acs.row (iframeInChunk), brent_ixmax, windowR.get(), workspace.r);
+				PitchFrame_findCandidates (me, & thy frames [iframe], workspace.localPeak [iframeInChunk],
+					minimumPitch, maxnCandidates, method, voicingThreshold, octaveCost,
+					maximumLag, brent_ixmax, brent_depth, workspace.r, workspace.imax.get());
+			}
+		}, U"Sound to Pitch"
+	);
+}
+
+autoPitch Sound_to_Pitch_any (Sound me,
+	double dt, double minimumPitch, double periodsPerWindow, integer maxnCandidates,
+	int method,
+	double silenceThreshold, double voicingThreshold,
+	double octaveCost, double octaveJumpCost, double voicedUnvoicedCost, double ceiling)
+{
+	try {
+		autoPitch thee = Pitch_createForAnalysis (me, dt, minimumPitch, periodsPerWindow, maxnCandidates, method, ceiling);
 
 		/*
 			Compute the global absolute peak for determination of silence threshold.
 		*/
-		globalPeak = 0.0;
+		double globalPeak = 0.0;
 		for (integer ichan = 1; ichan <= my ny; ichan ++) {
 			const double mean = NUMmean (my z.row (ichan));
 			for (integer i = 1; i <= my nx; i ++) {
@@ -419,126 +546,13 @@ autoPitch Sound_to_Pitch_any (Sound me,
 		if (globalPeak == 0.0)
 			return thee;
 
-		autoVEC window, windowR;
-		if (method >= FCC_NORMAL) {   // for cross-correlation analysis
-
-			nsampFFT = 0;
-			brent_ixmax = Melder_ifloor (nsamp_window * interpolation_depth);
-
-		} else {   // for autocorrelation analysis
-
-			/*
-				Compute the number of samples needed for doing FFT.
-				To avoid edge effects, we have to append zeroes to the window.
-				The maximum lag considered for maxima is maximumLag.
-				The maximum lag used in interpolation is nsamp_window * interpolation_depth.
-			*/
-			nsampFFT = 1;
-			while (nsampFFT < nsamp_window * (1 + interpolation_depth))
-				nsampFFT *= 2;
-
-			/*
-				Create buffers for autocorrelation analysis.
-			*/
-			windowR. resize (nsampFFT);
-			window. resize (nsamp_window);
-			NUMfft_Table_init (& fftTable, nsampFFT);
-
-			/*
-				A Gaussian or Hanning window is applied against phase effects.
-				The Hanning window is 2 to 5 dB better for 3 periods/window.
-				The Gaussian window is 25 to 29 dB better for 6 periods/window.
-			*/
-			if (method == AC_GAUSS) {   // Gaussian window
-				double imid = 0.5 * (nsamp_window + 1), edge = exp (-12.0);
-				for (integer i = 1; i <= nsamp_window; i ++)
-					window [i] = (exp (-48.0 * (i - imid) * (i - imid) /
-							(nsamp_window + 1) / (nsamp_window + 1)) - edge) / (1.0 - edge);
-			} else {   // Hanning window
-				for (integer i = 1; i <= nsamp_window; i ++)
-					window [i] = 0.5 - 0.5 * cos (i * 2 * NUMpi / (nsamp_window + 1));
-			}
-
-			/*
-				Compute the normalized autocorrelation of the window.
-			*/
-			for (integer i = 1; i <= nsamp_window; i ++)
-				windowR [i] = window [i];
-			NUMfft_forward (& fftTable, windowR.get());
-			windowR [1] *= windowR [1];   // DC component
-			for (integer i = 2; i < nsampFFT; i += 2) {
-				windowR [i] = windowR [i] * windowR [i] + windowR [i + 1] * windowR [i + 1];
-				windowR [i + 1] = 0.0;   // power spectrum: square and zero
-			}
-			windowR [nsampFFT] *= windowR [nsampFFT];   // Nyquist frequency
-			NUMfft_backward (& fftTable, windowR.get());   // autocorrelation
-			for (integer i = 2; i <= nsamp_window; i ++)
-				windowR [i] /= windowR [1];   // normalize
-			windowR [1] = 1.0;   // normalize
-
-			brent_ixmax = Melder_ifloor (nsamp_window * interpolation_depth);
-		}
-
 		autoMelderProgress progress (U"Sound to Pitch...");
-
-		integer numberOfFramesPerThread = 20;
-		integer numberOfThreads = (numberOfFrames - 1) / numberOfFramesPerThread + 1;
-		const integer numberOfProcessors = MelderThread_getNumberOfProcessors ();
-		trace (numberOfProcessors, U" processors");
-		Melder_clipRight (& numberOfThreads, numberOfProcessors);
-		Melder_clip (1_integer, & numberOfThreads, 16_integer);
-		numberOfFramesPerThread = (numberOfFrames - 1) / numberOfThreads + 1;
-
-		autoSound_into_Pitch_Args args [16];
-		integer firstFrame = 1, lastFrame = numberOfFramesPerThread;
-		volatile int cancelled = 0;
-		for (int ithread = 1; ithread <= numberOfThreads; ithread ++) {
-			if (ithread == numberOfThreads)
-				lastFrame = numberOfFrames;
-			autoSound_into_Pitch_Args arg = Thing_new (Sound_into_Pitch_Args);
-			arg -> sound = me;
-			arg -> pitch = thee.get();
-			arg -> firstFrame = firstFrame;
-			arg -> lastFrame = lastFrame;
-			arg -> minimumPitch = minimumPitch;
-			arg -> maxnCandidates = maxnCandidates;
-			arg -> method = method;
-			arg -> voicingThreshold = voicingThreshold;
-			arg -> octaveCost = octaveCost;
-			arg -> dt_window = dt_window;
-			arg -> nsamp_window = nsamp_window;
-			arg -> halfnsamp_window = halfnsamp_window;
-			arg -> maximumLag = maximumLag;
-			arg -> nsampFFT = nsampFFT;
-			arg -> nsamp_period = nsamp_period;
-			arg -> halfnsamp_period = halfnsamp_period;
-			arg -> brent_ixmax = brent_ixmax;
-			arg -> brent_depth = brent_depth;
-			arg -> globalPeak = globalPeak;
-			arg -> window = window.get();
-			arg -> windowR = windowR.get();
-			arg -> isMainThread = ( ithread == numberOfThreads );
-			arg -> cancelled = & cancelled;
-			if (method >= FCC_NORMAL) {   // cross-correlation
-				arg -> frame = zero_MAT (my ny, nsamp_window);
-			} else {   // autocorrelation
-				NUMfft_Table_init (& arg -> fftTable, nsampFFT);
-				arg -> frame = zero_MAT (my ny, nsampFFT);
-				arg -> ac = zero_VEC (nsampFFT);
-			}
-			arg -> rbuffer = zero_VEC (2 * nsamp_window + 1);
-			arg -> r = & arg -> rbuffer [1 + nsamp_window];
-			arg -> imax = zero_INTVEC (maxnCandidates);
-			arg -> localMean = zero_VEC (my ny);
-			args [ithread - 1] = std::move (arg);
-			firstFrame = lastFrame + 1;
-			lastFrame += numberOfFramesPerThread;
-		}
-		MelderThread_run (Sound_into_Pitch, args, numberOfThreads);
+		Sound_into_Pitch (me, me, thee.get(), 1, thy nx, globalPeak,
+			minimumPitch, periodsPerWindow, method, voicingThreshold, octaveCost);
 
 		Melder_progress (0.95, U"Sound to Pitch: path finder");
 		Pitch_pathFinder (thee.get(), silenceThreshold, voicingThreshold,
-			octaveCost, octaveJumpCost, voicedUnvoicedCost, ceiling, Melder_debug == 31 ? true : false);
+			octaveCost, octaveJumpCost, voicedUnvoicedCost, thy ceiling, Melder_debug == 31 ? true : false);
 
 		return thee;
 	} catch (MelderError) {
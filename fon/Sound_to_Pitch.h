@@ -1,6 +1,6 @@
 /* Sound_to_Pitch.h
  *
- * Copyright (C) 1992-2011,2015,2019 Paul Boersma
+ * Copyright (C) 1992-2011,2015,2019,2021 Paul Boersma
  *
  * This code is free software; you can redistribute it and/or modify
  * it under the terms of the GNU General Public License as published by
@@ -84,4 +84,19 @@ autoPitch Sound_to_Pitch_any (Sound me,
 		pitches above a certain value "voiceless".
 */
 
+autoPitch Pitch_createForAnalysis (Sampled sound,
+	double dt, double minimumPitch, double periodsPerWindow, integer maxnCandidates, int method, double maximumPitch);
+void Sound_into_Pitch (Sound me, Sampled whole, Pitch thee, integer firstFrame, integer lastFrame, double globalPeak,
+	double minimumPitch, double periodsPerWindow, int method, double voicingThreshold, double octaveCost);
+/*
+	The two halves of Sound_to_Pitch_any () before the path finder,
+	for analysing a sound that is not in memory as a whole (e.g. a LongSound) in parts.
+	Pitch_createForAnalysis () creates the Pitch with empty frames (and checks the arguments);
+	Sound_into_Pitch () computes the candidates of frames `firstFrame` through `lastFrame`
+	from a part `me` of the sound `whole` (with the original times) that contains all the samples
+	within 1 / minimumPitch + the window duration from the centres of these frames;
+	`whole` is only used for its time axis.
+	`globalPeak` is the maximum absolute deviation from the mean in the whole sound (it has to be positive).
+*/
+
 /* End of file Sound_to_Pitch.h */
@@ -1,6 +1,6 @@
 /* TimeSoundAnalysisEditor.cpp
  *
- * Copyright (C) 1992-2020 Paul Boersma
+ * Copyright (C) 1992-2021 Paul Boersma
  *
  * This code is free software; you can redistribute it and/or modify
  * it under the terms of the GNU General Public License as published by
@@ -34,6 +34,7 @@
 #include "enums_getValue.h"
 #include "TimeSoundAnalysisEditor_enums.h"
 
+Thing_implement (TimeSoundAnalysisEditor_Tile, Thing, 0);
 Thing_implement (TimeSoundAnalysisEditor, TimeSoundEditor, 0);
 
 #include "prefs_define.h"
@@ -126,6 +127,7 @@ void structTimeSoundAnalysisEditor :: v_info () {
 }
 
 void structTimeSoundAnalysisEditor :: v_reset_analysis () {
+	d_tiles. removeAllItems ();
 	d_spectrogram. reset();
 	d_pitch. reset();
 	d_intensity. reset();
@@ -539,6 +541,16 @@ static autoSound extractSound (TimeSoundAnalysisEditor me, double tmin, double t
 	return sound;
 }
 
+/*
+	As extractSound (), but where tmin..tmax extends beyond the sound, the part is padded with zeroes instead of clipped.
+*/
+static autoSound extractSoundWithZeroPadding (TimeSoundAnalysisEditor me, double tmin, double tmax) {
+	autoSound sound = extractSound (me, tmin, tmax);
+	if (sound && (sound -> xmin > tmin || sound -> xmax < tmax))
+		sound = Sound_extractPart (sound.get(), tmin, tmax, kSound_windowShape::RECTANGULAR, 1.0, true);
+	return sound;
+}
+
 static void menu_cb_extractVisibleSpectrogram (TimeSoundAnalysisEditor me, EDITOR_ARGS_DIRECT) {
 	if (! my p_spectrogram_show)
 		Melder_throw (U"No spectrogram is visible.\nFirst choose \"Show spectrogram\" from the Spectrum menu.");
@@ -1565,22 +1577,221 @@ void structTimeSoundAnalysisEditor :: v_createMenuItems_pulses_picture (EditorMe
 	EditorMenu_addCommand (menu, U"Draw visible pulses...", 0, menu_cb_drawVisiblePulses);
 }
 
+/********** TILE CACHE **********/
+
+/*
+	The spectrogram, intensity and formant analyses are computed in tiles,
+	i.e. in stretches of about `theTileDuration` seconds of the frames of the analysis of the whole sound.
+	The tiles are kept in a cache, keyed by the kind of analysis and its settings,
+	so that scrolling computes only the frames that come into view,
+	and going back to an earlier view or to earlier settings computes nothing at all.
+	When the tiles take up more than `theMaximumNumberOfBytesInTileCache`,
+	the tiles that were used least recently are thrown away.
+	The frames are those of the analysis of the whole sound, so they do not move when the view scrolls.
+	For the intensity and the formants, the values are those of the whole analysis as well,
+	except for rounding in the last few bits;
+	the spectrogram of a tile is computed with Sound_to_Spectrogram () on a part that is symmetric around the frames of the tile
+	(padded with zeroes at the edges of the sound), so that its frames lie within a sample from those of the grid.
+
+	The pitch analysis is not tiled, because its path finder looks at all frames at once,
+	so the pitch of a frame depends on which other frames are in view; the pulses depend on the pitch.
+*/
+static constexpr double theTileDuration = 1.0;   // seconds
+static constexpr double theMaximumNumberOfBytesInTileCache = 200e6;
+
+static Sampled getWholeSound (TimeSoundAnalysisEditor me) {
+	if (my d_longSound.data)
+		return my d_longSound.data;
+	return my d_sound.data;
+}
+
+static TimeSoundAnalysisEditor_Tile findTile (TimeSoundAnalysisEditor me, conststring32 key, integer tileNumber) {
+	for (integer itile = 1; itile <= my d_tiles.size; itile ++) {
+		const TimeSoundAnalysisEditor_Tile tile = my d_tiles.at [itile];
+		if (tile -> tileNumber == tileNumber && str32equ (tile -> key.get(), key)) {
+			tile -> lastUse = my d_tileUse;
+			return tile;
+		}
+	}
+	return nullptr;
+}
+
+static TimeSoundAnalysisEditor_Tile addTile (TimeSoundAnalysisEditor me, conststring32 key, integer tileNumber,
+	autoSampled analysis, double numberOfBytes)
+{
+	autoTimeSoundAnalysisEditor_Tile tile = Thing_new (TimeSoundAnalysisEditor_Tile);
+	tile -> key = Melder_dup (key);
+	tile -> tileNumber = tileNumber;
+	tile -> analysis = analysis.move();
+	tile -> numberOfBytes = numberOfBytes;
+	tile -> lastUse = my d_tileUse;
+	return my d_tiles.addItem_move (tile.move());
+}
+
+/*
+	Throw away the least recently used tiles until the cache fits within its budget,
+	but keep all the tiles of the current view.
+*/
+static void removeOldTiles (TimeSoundAnalysisEditor me) {
+	for (;;) {
+		double totalNumberOfBytes = 0.0;
+		integer oldestTile = 0;
+		for (integer itile = 1; itile <= my d_tiles.size; itile ++) {
+			const TimeSoundAnalysisEditor_Tile tile = my d_tiles.at [itile];
+			totalNumberOfBytes += tile -> numberOfBytes;
+			if (tile -> lastUse < my d_tileUse && (oldestTile == 0 || tile -> lastUse < my d_tiles.at [oldestTile] -> lastUse))
+				oldestTile = itile;
+		}
+		if (totalNumberOfBytes <= theMaximumNumberOfBytesInTileCache || oldestTile == 0)
+			return;
+		my d_tiles.removeItem (oldestTile);
+	}
+}
+
+static integer getNumberOfFramesPerTile (Sampled grid) {
+	return std::max (1_integer, Melder_iround (theTileDuration / grid -> dx));
+}
+
+/*
+	Make sure that the cache contains the frame grid of the whole analysis (created by `createGrid ()`)
+	and all the tiles with frames in view (the missing ones computed by `analyseTile (grid, firstFrame, lastFrame, & numberOfBytes)`).
+	Returns the grid, and the frames in view plus one on either side, for a smooth drawing at the edges of the view;
+	there are no frames in view if `*out_firstFrame > *out_lastFrame`.
+*/
+template <typename CreateGrid, typename AnalyseTile>
+static Sampled getTiles (TimeSoundAnalysisEditor me, conststring32 key, CreateGrid createGrid, AnalyseTile analyseTile,
+	integer *out_firstFrame, integer *out_lastFrame)
+{
+	my d_tileUse += 1;
+	TimeSoundAnalysisEditor_Tile gridTile = findTile (me, key, 0);
+	if (! gridTile)
+		gridTile = addTile (me, key, 0, createGrid (), 0.0);
+	const Sampled grid = gridTile -> analysis.get();
+	const integer firstFrame = std::max (1_integer, Sampled_xToLowIndex (grid, my startWindow));
+	const integer lastFrame = std::min (grid -> nx, Sampled_xToHighIndex (grid, my endWindow));
+	const integer numberOfFramesPerTile = getNumberOfFramesPerTile (grid);
+	for (integer itile = (firstFrame - 1) / numberOfFramesPerTile + 1; itile <= (lastFrame - 1) / numberOfFramesPerTile + 1; itile ++) {
+		if (! findTile (me, key, itile)) {
+			const integer firstFrameOfTile = (itile - 1) * numberOfFramesPerTile + 1;
+			const integer lastFrameOfTile = std::min (itile * numberOfFramesPerTile, grid -> nx);
+			double numberOfBytes;
+			autoSampled analysis = analyseTile (grid, firstFrameOfTile, lastFrameOfTile, & numberOfBytes);
+			addTile (me, key, itile, analysis.move(), numberOfBytes);
+		}
+	}
+	removeOldTiles (me);
+	*out_firstFrame = firstFrame;
+	*out_lastFrame = lastFrame;
+	return grid;
+}
+
+/*
+	Call `copyFrame (tile, frameNumberInTile, frameNumberInView)` for the frames `firstFrame` through `lastFrame` of the grid.
+*/
+template <typename CopyFrame>
+static void copyFramesFromTiles (TimeSoundAnalysisEditor me, conststring32 key, Sampled grid, integer firstFrame, integer lastFrame,
+	CopyFrame copyFrame)
+{
+	const integer numberOfFramesPerTile = getNumberOfFramesPerTile (grid);
+	for (integer iframe = firstFrame; iframe <= lastFrame; iframe ++) {
+		const integer itile = (iframe - 1) / numberOfFramesPerTile + 1;
+		const TimeSoundAnalysisEditor_Tile tile = findTile (me, key, itile);
+		Melder_assert (tile);
+		copyFrame (tile -> analysis.get(), iframe - (itile - 1) * numberOfFramesPerTile, iframe - firstFrame + 1);
+	}
+}
+
+/*
+	The part of the sound, on the sampling grid `soundGrid`, that contains all the samples within `margin` seconds
+	from the centres of the frames `firstFrame` through `lastFrame` of `grid`, plus one sample on either side.
+*/
+static void getPartDomain (Sampled soundGrid, Sampled grid, integer firstFrame, integer lastFrame, double margin,
+	double *out_tmin, double *out_tmax)
+{
+	const integer firstSample = std::max (1_integer, Sampled_xToLowIndex (soundGrid, Sampled_indexToX (grid, firstFrame) - margin) - 1);
+	const integer lastSample = std::min (soundGrid -> nx, Sampled_xToHighIndex (soundGrid, Sampled_indexToX (grid, lastFrame) + margin) + 1);
+	*out_tmin = Sampled_indexToX (soundGrid, firstSample) - 0.5 * soundGrid -> dx;
+	*out_tmax = Sampled_indexToX (soundGrid, lastSample) + 0.5 * soundGrid -> dx;
+}
+
+static autoSampled createFrameGrid (Sampled analysis) {
+	autoSampled grid = Thing_new (Sampled);
+	Sampled_init (grid.get(), analysis -> xmin, analysis -> xmax, analysis -> nx, analysis -> dx, analysis -> x1);
+	return grid;
+}
+
 void TimeSoundAnalysisEditor_computeSpectrogram (TimeSoundAnalysisEditor me) {
 	autoMelderProgressOff progress;
 	if (my p_spectrogram_show && my endWindow - my startWindow <= my p_longestAnalysis &&
 		(! my d_spectrogram || my d_spectrogram -> xmin != my startWindow || my d_spectrogram -> xmax != my endWindow))
 	{
-		const double margin = ( my p_spectrogram_windowShape == kSound_to_Spectrogram_windowShape::GAUSSIAN ?
-				my p_spectrogram_windowLength : 0.5 * my p_spectrogram_windowLength );
+		const double physicalWindowLength = ( my p_spectrogram_windowShape == kSound_to_Spectrogram_windowShape::GAUSSIAN ?
+				2.0 * my p_spectrogram_windowLength : my p_spectrogram_windowLength );
+		const double margin = 0.5 * physicalWindowLength;
+		/*
+			The time step depends on the duration of the view,
+			which after scrolling can differ in the last few bits.
+			The minimum time step is that of Sound_to_Spectrogram ().
+		*/
+		const double timeStep = std::max (double (float ((my endWindow - my startWindow) / my p_spectrogram_timeSteps)),
+				my p_spectrogram_windowLength / sqrt (NUMpi) / 8.0);
+		const double frequencyStep = my p_spectrogram_viewTo / my p_spectrogram_frequencySteps;
 		my d_spectrogram.reset();
 		try {
-			autoSound sound = extractSound (me, my startWindow - margin, my endWindow + margin);
-			my d_spectrogram = Sound_to_Spectrogram (sound.get(), my p_spectrogram_windowLength,
-				my p_spectrogram_viewTo, (my endWindow - my startWindow) / my p_spectrogram_timeSteps,
-				my p_spectrogram_viewTo / my p_spectrogram_frequencySteps, my p_spectrogram_windowShape, 8.0, 8.0
+			const Sampled wholeSound = getWholeSound (me);
+			autostring32 key = Melder_dup (Melder_cat (U"spectrogram ", my p_spectrogram_windowLength, U" ", my p_spectrogram_viewTo,
+					U" ", timeStep, U" ", frequencyStep, U" ", (int) my p_spectrogram_windowShape));
+			integer firstFrame, lastFrame;
+			const Sampled grid = getTiles (me, key.get(),
+				[&] () -> autoSampled {
+					integer numberOfFrames;
+					double firstTime;
+					Sampled_shortTermAnalysis (wholeSound, physicalWindowLength, timeStep, & numberOfFrames, & firstTime);
+					autoSampled thee = Thing_new (Sampled);
+					Sampled_init (thee.get(), wholeSound -> xmin, wholeSound -> xmax, numberOfFrames, timeStep, firstTime);
+					return thee;
+				},
+				[&] (Sampled grid, integer firstFrame, integer lastFrame, double *out_numberOfBytes) -> autoSampled {
+					const double firstTime = Sampled_indexToX (grid, firstFrame), lastTime = Sampled_indexToX (grid, lastFrame);
+					/*
+						In the first and last tiles, the part reaches beyond the sound by up to a sample;
+						it is padded rather than clipped, so that it stays symmetric around the frames of the tile.
+						The windows of the frames of the grid lie within the sound, so the zeroes are not analysed.
+					*/
+					autoSound part = extractSoundWithZeroPadding (me, firstTime - margin - wholeSound -> dx, lastTime + margin + wholeSound -> dx);
+					autoSpectrogram analysis = Sound_to_Spectrogram (part.get(), my p_spectrogram_windowLength,
+							my p_spectrogram_viewTo, timeStep, frequencyStep, my p_spectrogram_windowShape, 8.0, 8.0);
+					if (! analysis)
+						Melder_throw (U"No frequencies.");
+					/*
+						The frames of the analysis are centred in the part,
+						i.e. they lie within half a sample from the frames of the grid.
+					*/
+					autoSpectrogram tile = Spectrogram_create (firstTime - 0.5 * timeStep, lastTime + 0.5 * timeStep,
+							lastFrame - firstFrame + 1, timeStep, firstTime,
+							analysis -> ymin, analysis -> ymax, analysis -> ny, analysis -> dy, analysis -> y1);
+					for (integer iframe = 1; iframe <= tile -> nx; iframe ++) {
+						const integer analysisFrame = Sampled_xToNearestIndex (analysis.get(), Sampled_indexToX (tile.get(), iframe));
+						if (analysisFrame >= 1 && analysisFrame <= analysis -> nx)
+							tile -> z.column (iframe)  <<=  analysis -> z.column (analysisFrame);
+					}
+					*out_numberOfBytes = double (tile -> nx) * tile -> ny * sizeof (double);
+					return tile.move();
+				},
+				& firstFrame, & lastFrame
+			);
+			if (firstFrame > lastFrame)
+				return;
+			const Spectrogram firstTile = (Spectrogram) findTile (me, key.get(), (firstFrame - 1) / getNumberOfFramesPerTile (grid) + 1) -> analysis.get();
+			autoSpectrogram spectrogram = Spectrogram_create (my startWindow, my endWindow,
+					lastFrame - firstFrame + 1, grid -> dx, Sampled_indexToX (grid, firstFrame),
+					firstTile -> ymin, firstTile -> ymax, firstTile -> ny, firstTile -> dy, firstTile -> y1);
+			copyFramesFromTiles (me, key.get(), grid, firstFrame, lastFrame,
+				[&] (Sampled tile, integer tileFrame, integer frame) {
+					spectrogram -> z.column (frame)  <<=  ((Spectrogram) tile) -> z.column (tileFrame);
+				}
 			);
-			my d_spectrogram -> xmin = my startWindow;
-			my d_spectrogram -> xmax = my endWindow;
+			my d_spectrogram = spectrogram.move();
 		} catch (MelderError) {
 			Melder_clearError ();
 		}
@@ -1629,13 +1840,38 @@ void TimeSoundAnalysisEditor_computeIntensity (TimeSoundAnalysisEditor me) {
 		const double margin = 3.2 / my p_pitch_floor;
 		my d_intensity. reset();
 		try {
-			autoSound sound = extractSound (me, my startWindow - margin, my endWindow + margin);
-			my d_intensity = Sound_to_Intensity (sound.get(), my p_pitch_floor,
-				my endWindow - my startWindow > my p_longestAnalysis ? (my endWindow - my startWindow) / 100 : 0.0,
-				my p_intensity_subtractMeanPressure
+			const Sampled wholeSound = getWholeSound (me);
+			autostring32 key = Melder_dup (Melder_cat (U"intensity ", my p_pitch_floor, U" ", my p_intensity_subtractMeanPressure));
+			integer firstFrame, lastFrame;
+			const Sampled grid = getTiles (me, key.get(),
+				[&] () -> autoSampled {
+					autoIntensity intensity = Intensity_createForAnalysis (wholeSound, my p_pitch_floor, 0.0);
+					return createFrameGrid (intensity.get());
+				},
+				[&] (Sampled grid, integer firstFrame, integer lastFrame, double *out_numberOfBytes) -> autoSampled {
+					double tmin, tmax;
+					getPartDomain (wholeSound, grid, firstFrame, lastFrame, margin, & tmin, & tmax);
+					autoSound part = extractSound (me, tmin, tmax);
+					const double firstTime = Sampled_indexToX (grid, firstFrame), lastTime = Sampled_indexToX (grid, lastFrame);
+					autoIntensity tile = Intensity_create (firstTime - 0.5 * grid -> dx, lastTime + 0.5 * grid -> dx,
+							lastFrame - firstFrame + 1, grid -> dx, firstTime);
+					Sound_into_Intensity (part.get(), wholeSound, tile.get(), 1, tile -> nx,
+							my p_pitch_floor, my p_intensity_subtractMeanPressure);
+					*out_numberOfBytes = double (tile -> nx) * sizeof (double);
+					return tile.move();
+				},
+				& firstFrame, & lastFrame
 			);
-			my d_intensity -> xmin = my startWindow;
-			my d_intensity -> xmax = my endWindow;
+			if (firstFrame > lastFrame)
+				return;
+			autoIntensity intensity = Intensity_create (my startWindow, my endWindow,
+					lastFrame - firstFrame + 1, grid -> dx, Sampled_indexToX (grid, firstFrame));
+			copyFramesFromTiles (me, key.get(), grid, firstFrame, lastFrame,
+				[&] (Sampled tile, integer tileFrame, integer frame) {
+					intensity -> z [1] [frame] = ((Intensity) tile) -> z [1] [tileFrame];
+				}
+			);
+			my d_intensity = intensity.move();
 		} catch (MelderError) {
 			Melder_clearError ();
 		}
@@ -1647,27 +1883,74 @@ void TimeSoundAnalysisEditor_computeFormants (TimeSoundAnalysisEditor me) {
 	if (my p_formant_show && my endWindow - my startWindow <= my p_longestAnalysis &&
 		(! my d_formant || my d_formant -> xmin != my startWindow || my d_formant -> xmax != my endWindow))
 	{
-		const double margin = my p_formant_windowLength;
+		const integer numberOfPoles = Melder_iround (my p_formant_numberOfFormants * 2.0);
+		const integer maximumNumberOfFormants = (numberOfPoles + 1) / 2;
+		const double formantTimeStep = (
+			my p_timeStepStrategy == kTimeSoundAnalysisEditor_timeStepStrategy::FIXED_ ? my p_fixedTimeStep :
+			my p_timeStepStrategy == kTimeSoundAnalysisEditor_timeStepStrategy::VIEW_DEPENDENT ?
+					double (float ((my endWindow - my startWindow) / my p_numberOfTimeStepsPerView)) :   // see computeSpectrogram
+			0.0   // the default: determined by analysis window length
+		);
 		my d_formant. reset();
 		try {
-			autoSound sound = ( my endWindow - my startWindow > my p_longestAnalysis ?
-				extractSound (me,
-					0.5 * (my startWindow + my endWindow - my p_longestAnalysis) - margin,
-					0.5 * (my startWindow + my endWindow + my p_longestAnalysis) + margin
-				) :
-				extractSound (me, my startWindow - margin, my endWindow + margin)
-			);
-			const double formantTimeStep = (
-				my p_timeStepStrategy == kTimeSoundAnalysisEditor_timeStepStrategy::FIXED_ ? my p_fixedTimeStep :
-				my p_timeStepStrategy == kTimeSoundAnalysisEditor_timeStepStrategy::VIEW_DEPENDENT ? (my endWindow - my startWindow) / my p_numberOfTimeStepsPerView :
-				0.0   // the default: determined by analysis window length
+			const Sampled wholeSound = getWholeSound (me);
+			/*
+				The sound is analysed at twice the formant ceiling, as in Sound_to_Formant_any (),
+				and every tile is resampled separately, as in LongSound_to_Formant_burg ().
+			*/
+			const double nyquistFrequency = 0.5 / wholeSound -> dx;
+			const bool mustResample = ! (my p_formant_ceiling <= 0.0 || fabs (my p_formant_ceiling / nyquistFrequency - 1.0) < 1.0e-12);
+			const double samplingFrequency = ( mustResample ? 2.0 * my p_formant_ceiling : 1.0 / wholeSound -> dx );
+			autoSampled soundGrid = Sampled_createResampledGrid (wholeSound, samplingFrequency);
+			const double margin = my p_formant_windowLength + soundGrid -> dx;
+			const integer resamplingMarginInSamples = Sound_getResamplingMargin (wholeSound -> dx, soundGrid -> dx, 50);
+			autostring32 key = Melder_dup (Melder_cat (U"formant ", formantTimeStep, U" ", numberOfPoles, U" ", my p_formant_ceiling,
+					U" ", my p_formant_windowLength, U" ", (int) my p_formant_method, U" ", my p_formant_preemphasisFrom));
+			integer firstFrame, lastFrame;
+			const Sampled grid = getTiles (me, key.get(),
+				[&] () -> autoSampled {
+					autoFormant formant = Formant_createForAnalysis (soundGrid.get(), formantTimeStep, numberOfPoles, my p_formant_windowLength);
+					return createFrameGrid (formant.get());
+				},
+				[&] (Sampled grid, integer firstFrame, integer lastFrame, double *out_numberOfBytes) -> autoSampled {
+					double tmin, tmax;
+					getPartDomain (soundGrid.get(), grid, firstFrame, lastFrame, margin, & tmin, & tmax);
+					autoSound part;
+					if (mustResample) {
+						/*
+							The original is extracted with extra samples on both sides,
+							so that the resampling filter sees the same samples as in the whole sound.
+						*/
+						const integer firstSample = Sampled_xToNearestIndex (soundGrid.get(), tmin + 0.5 * soundGrid -> dx);
+						const integer lastSample = Sampled_xToNearestIndex (soundGrid.get(), tmax - 0.5 * soundGrid -> dx);
+						const double resamplingMargin = (resamplingMarginInSamples + 1) * wholeSound -> dx;
+						autoSound original = extractSound (me, tmin - resamplingMargin, tmax + resamplingMargin);
+						part = Sound_resampleOntoGrid (original.get(), soundGrid.get(), firstSample, lastSample, 50);
+					} else {
+						part = extractSound (me, tmin, tmax);
+					}
+					const double firstTime = Sampled_indexToX (grid, firstFrame), lastTime = Sampled_indexToX (grid, lastFrame);
+					autoFormant tile = Formant_create (firstTime - 0.5 * grid -> dx, lastTime + 0.5 * grid -> dx,
+							lastFrame - firstFrame + 1, grid -> dx, firstTime, maximumNumberOfFormants);
+					Sound_into_Formant (part.get(), soundGrid.get(), tile.get(), 1, tile -> nx, numberOfPoles,
+							my p_formant_windowLength, (int) my p_formant_method, my p_formant_preemphasisFrom, 50.0);
+					Formant_sort (tile.get());
+					*out_numberOfBytes = double (tile -> nx) *
+							(sizeof (structFormant_Frame) + maximumNumberOfFormants * sizeof (structFormant_Formant));
+					return tile.move();
+				},
+				& firstFrame, & lastFrame
 			);
-			my d_formant = Sound_to_Formant_any (sound.get(), formantTimeStep,
-				Melder_iround (my p_formant_numberOfFormants * 2.0), my p_formant_ceiling,
-				my p_formant_windowLength, (int) my p_formant_method, my p_formant_preemphasisFrom, 50.0
+			if (firstFrame > lastFrame)
+				return;
+			autoFormant formant = Formant_create (my startWindow, my endWindow,
+					lastFrame - firstFrame + 1, grid -> dx, Sampled_indexToX (grid, firstFrame), maximumNumberOfFormants);
+			copyFramesFromTiles (me, key.get(), grid, firstFrame, lastFrame,
+				[&] (Sampled tile, integer tileFrame, integer frame) {
+					((Formant) tile) -> frames [tileFrame]. copy (& formant -> frames [frame]);
+				}
 			);
-			my d_formant -> xmin = my startWindow;
-			my d_formant -> xmax = my endWindow;
+			my d_formant = formant.move();
 		} catch (MelderError) {
 			Melder_clearError ();
 		}
@@ -2,7 +2,7 @@
 #define _TimeSoundAnalysisEditor_h_
 /* TimeSoundAnalysisEditor.h
  *
- * Copyright (C) 1992-2007,2009-2016,2018,2020 Paul Boersma
+ * Copyright (C) 1992-2007,2009-2016,2018,2020,2021 Paul Boersma
  *
  * This code is free software; you can redistribute it and/or modify
  * it under the terms of the GNU General Public License as published by
@@ -27,7 +27,20 @@
 
 #include "TimeSoundAnalysisEditor_enums.h"
 
+/*
+	A stretch of consecutive frames of an analysis of the whole sound, as kept in the tile cache of the editor.
+*/
+Thing_define (TimeSoundAnalysisEditor_Tile, Thing) {
+	autostring32 key;   // the kind of analysis and its settings
+	integer tileNumber;   // 0 for the frame grid of the whole analysis, which holds no data
+	autoSampled analysis;
+	double numberOfBytes;
+	integer lastUse;
+};
+
 Thing_define (TimeSoundAnalysisEditor, TimeSoundEditor) {
+	OrderedOf <structTimeSoundAnalysisEditor_Tile> d_tiles;
+	integer d_tileUse;
 	autoSpectrogram d_spectrogram;
 	double d_spectrogram_cursor;
 	autoPitch d_pitch;
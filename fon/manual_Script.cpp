@@ -3792,6 +3792,19 @@ TAG (U"##-u#, ##--utf16#")
 DEFINITION (U"Write the output (e.g. of $writeInfo$) in UTF-16 Little Endian encoding, without Byte Order Mark. "
 	"This format is the default on Windows, "
 	"but you can use it to write the output to a UTF-16LE-encoded file on any platform.")
+
+ENTRY (U"11. Where does my script spend its time?")
+NORMAL (U"If the environment variable $$PRAAT_SCRIPT_PROFILE$ contains a file name when Praat runs a script, "
+	"Praat records for every script line and every menu command how often it was executed, "
+	"how much time it took, and how many memory blocks it allocated. "
+	"When the script finishes, Praat writes this profile to the file, as a table sorted by the time spent in each line or command itself. "
+	"On Linux or the Mac, you can do")
+CODE (U"PRAAT_SCRIPT_PROFILE=profile.txt /usr/bin/praat --run \"my script.praat\"")
+NORMAL (U"The time of a line that calls a procedure includes the time spent in that procedure, "
+	"and the time of a command that runs a script includes the time spent in that script. "
+	"If the file name ends in $$.folded$, the profile is written as %%folded stacks% instead, "
+	"i.e. one line per path of calls with the number of microseconds spent at the end of that path; "
+	"this is the input format of programs that draw flame graphs.")
 MAN_END
 
 MAN_BEGIN (U"Scripting 7. Scripting the editors", U"ppgb", 20040222)
@@ -958,7 +958,7 @@ NORMAL (U"where \\De%t is the sampling period of the sound. Every sample %x__%i_
 FORMULA (U"%x__%i_ = %x__%i_ - %\\al %x__%i-1_")
 MAN_END
 
-MAN_BEGIN (U"Sound: Resample...", U"ppgb", 20040330)
+MAN_BEGIN (U"Sound: Resample...", U"ppgb", 20210601)
 INTRO (U"A command that creates new @Sound objects from the selected Sounds.")
 ENTRY (U"Purpose")
 NORMAL (U"High-precision resampling from any sampling frequency to any other sampling frequency.")
@@ -969,13 +969,14 @@ TAG (U"##Precision")
 DEFINITION (U"the depth of the interpolation, in samples (standard is 50). "
 	"This determines the quality of the interpolation used in resampling.")
 ENTRY (U"Algorithm")
-NORMAL (U"If #Precision is 1, the method is linear interpolation, which is inaccurate but fast.")
-/* BUG */
-NORMAL (U"If #Precision is greater than 1, the method is sin(%x)/%x (\"%sinc\") interpolation, "
-	"with a depth equal to #Precision. "
+NORMAL (U"If #Precision is 1, the method is linear interpolation, which is inaccurate but fast. "
+	"If #Precision is 2, the method is cubic interpolation.")
+NORMAL (U"If #Precision is greater than 2, the method is sin(%x)/%x (\"%sinc\") interpolation, "
+	"with a Hann window and a depth equal to #Precision. "
 	"For higher #Precision, the algorithm is slower but more accurate.")
 NORMAL (U"If ##Sampling frequency# is less than the sampling frequency of the selected sound, "
-	"an anti-aliasing low-pass filtering is performed prior to resampling.")
+	"the sinc function is stretched so that its transition band lies just below the new Nyquist frequency; "
+	"it then also works as an anti-aliasing low-pass filter, with a depth of at least 50.")
 ENTRY (U"Behaviour")
 NORMAL (U"A new Sound will appear in the list of objects, "
 	"bearing the same name as the original Sound, followed by the sampling frequency. "
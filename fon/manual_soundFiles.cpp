@@ -1,6 +1,6 @@
 /* manual_soundFiles.cpp
  *
- * Copyright (C) 1992-2005,2007,2008,2010,2011,2014-2017 Paul Boersma
+ * Copyright (C) 1992-2005,2007,2008,2010,2011,2014-2017,2021 Paul Boersma
  *
  * This code is free software; you can redistribute it and/or modify
  * it under the terms of the GNU General Public License as published by
@@ -362,11 +362,15 @@ LIST_ITEM (U"• @@Save as NIST file...@ (little-endian)")
 LIST_ITEM (U"• @@Save as FLAC file...@")
 MAN_END
 
-MAN_BEGIN (U"LongSound", U"ppgb", 20110131)
+MAN_BEGIN (U"LongSound", U"ppgb", 20210601)
 INTRO (U"One of the @@types of objects@ in Praat. See the @@Sound files@ tutorial.")
 NORMAL (U"A LongSound object gives you the ability to view and label "
 	"a sound file that resides on disk. You will want to use it for sounds "
 	"that are too long to read into memory as a @Sound object (typically, a few minutes).")
+NORMAL (U"A Sound takes 8 bytes per sample in memory, whatever the format of the file it came from, "
+	"so that an hour of stereo sampled at 44.1 kHz takes 2.5 gigabytes; "
+	"a LongSound keeps the samples in the file, and holds only the part that it needs at the moment "
+	"(see the buffer size below).")
 ENTRY (U"How to create a LongSound object")
 NORMAL (U"You create a LongSound object with @@Open long sound file...@ from the @@Open menu@.")
 ENTRY (U"What you can do with a LongSound object")
@@ -379,6 +383,14 @@ NORMAL (U"You can view a LongSound object in a @LongSoundEditor by choosing @@Lo
 	"This also allows you to extract parts of the LongSound as @Sound objects, "
 	"or save these parts as a sound file. "
 	"There are currently no ways to actually change the data in the file.")
+ENTRY (U"How to analyse a LongSound object")
+NORMAL (U"The commands in the Analyse menu (##To Pitch...#, ##To Intensity...# and ##To Formant (burg)...#) "
+	"have the same settings and give the same results as the corresponding commands for a @Sound "
+	"(see @@Sound: To Pitch...@, @@Sound: To Intensity...@ and @@Sound: To Formant (burg)...@), "
+	"but they read the file in parts, so that the whole sound never has to be in memory. "
+	"The size of these parts is the buffer size that you set with ##LongSound preferences...# in the #Preferences submenu. "
+	"The only difference is in the formant analysis: the sound is resampled one part at a time, "
+	"which can make a tiny difference in the formant values.")
 ENTRY (U"How to annotate a LongSound object")
 NORMAL (U"You can label and segment a LongSound object after the following steps:")
 LIST_ITEM (U"1. Select the LongSound object.")
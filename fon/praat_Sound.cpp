@@ -1,6 +1,6 @@
 /* praat_Sound_init.cpp
  *
- * Copyright (C) 1992-2020 Paul Boersma
+ * Copyright (C) 1992-2021 Paul Boersma
  *
  * This code is free software; you can redistribute it and/or modify
  * it under the terms of the GNU General Public License as published by
@@ -17,7 +17,7 @@
  */
 
 #include "Ltas.h"
-#include "LongSound.h"
+#include "LongSound_analyses.h"
 #include "Manipulation.h"
 #include "ParamCurve.h"
 #include "Sound_and_Spectrogram.h"
@@ -148,6 +148,43 @@ DO
 	SAVE_ONE_END
 }
 
+FORM (NEW_LongSound_to_Formant_burg, U"LongSound: To Formant (Burg method)", U"Sound: To Formant (burg)...") {
+	REAL (timeStep, U"Time step (s)", U"0.0 (= auto)")
+	POSITIVE (maximumNumberOfFormants, U"Max. number of formants", U"5.0")
+	REAL (formantCeiling, U"Formant ceiling (Hz)", U"5500.0 (= adult female)")
+	POSITIVE (windowLength, U"Window length (s)", U"0.025")
+	POSITIVE (preEmphasisFrom, U"Pre-emphasis from (Hz)", U"50.0")
+	OK
+DO
+	CONVERT_EACH (LongSound)
+		autoFormant result = LongSound_to_Formant_burg (me, timeStep,
+				maximumNumberOfFormants, formantCeiling, windowLength, preEmphasisFrom);
+	CONVERT_EACH_END (my name.get())
+}
+
+FORM (NEW_LongSound_to_Intensity, U"LongSound: To Intensity", U"Sound: To Intensity...") {
+	POSITIVE (minimumPitch, U"Minimum pitch (Hz)", U"100.0")
+	REAL (timeStep, U"Time step (s)", U"0.0 (= auto)")
+	BOOLEAN (subtractMean, U"Subtract mean", true)
+	OK
+DO
+	CONVERT_EACH (LongSound)
+		autoIntensity result = LongSound_to_Intensity (me,
+				minimumPitch, timeStep, subtractMean);
+	CONVERT_EACH_END (my name.get())
+}
+
+FORM (NEW_LongSound_to_Pitch, U"LongSound: To Pitch", U"Sound: To Pitch...") {
+	REAL (timeStep, U"Time step (s)", U"0.0 (= auto)")
+	POSITIVE (pitchFloor, U"Pitch floor (Hz)", U"75.0")
+	POSITIVE (pitchCeiling, U"Pitch ceiling (Hz)", U"600.0")
+	OK
+DO
+	CONVERT_EACH (LongSound)
+		autoPitch result = LongSound_to_Pitch (me, timeStep, pitchFloor, pitchCeiling);
+	CONVERT_EACH_END (my name.get())
+}
+
 FORM (NEW_LongSound_to_TextGrid, U"LongSound: To TextGrid...", U"LongSound: To TextGrid...") {
 	SENTENCE (tierNames, U"Tier names", U"Mary John bell")
 	SENTENCE (pointTiers, U"Point tiers", U"bell")
@@ -2197,6 +2234,10 @@ void praat_Sound_init () {
 		praat_addAction1 (classLongSound, 1,   U"Get time from index...", U"*Get time from sample number...", praat_DEPTH_2 | praat_DEPRECATED_2004, REAL_LongSound_getTimeFromIndex);
 		praat_addAction1 (classLongSound, 1, U"Get sample number from time...", nullptr, 2, REAL_LongSound_getIndexFromTime);
 		praat_addAction1 (classLongSound, 1,   U"Get index from time...", U"*Get sample number from time...", praat_DEPTH_2 | praat_DEPRECATED_2004, REAL_LongSound_getIndexFromTime);
+	praat_addAction1 (classLongSound, 0, U"Analyse -", nullptr, 0, nullptr);
+		praat_addAction1 (classLongSound, 0, U"To Pitch...", nullptr, 1, NEW_LongSound_to_Pitch);
+		praat_addAction1 (classLongSound, 0, U"To Intensity...", nullptr, 1, NEW_LongSound_to_Intensity);
+		praat_addAction1 (classLongSound, 0, U"To Formant (burg)...", nullptr, 1, NEW_LongSound_to_Formant_burg);
 	praat_addAction1 (classLongSound, 0, U"Annotate -", nullptr, 0, nullptr);
 		praat_addAction1 (classLongSound, 0, U"Annotation tutorial", nullptr, 1, HELP_AnnotationTutorial);
 		praat_addAction1 (classLongSound, 0, U"-- to text grid --", nullptr, 1, nullptr);
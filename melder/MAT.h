@@ -388,7 +388,8 @@ inline autoMAT mul_allowAllocation_MAT (constMATVU const& x, constMATVU const& y
 	return result;
 }
 /*
-	Rough matrix multiplication, using an in-cache inner loop if that is faster.
+	Rough matrix multiplication: blocked, vectorized and on multiple threads for all but small matrices,
+	but not as precise as mul_MAT, which uses pairwise summation.
 */
 extern void _mul_fast_MAT_out (MATVU const& target, constMATVU const& x, constMATVU const& y) noexcept;
 inline void mul_fast_MAT_out  (MATVU const& target, constMATVU const& x, constMATVU const& y) noexcept {
@@ -1,6 +1,6 @@
 /* NUM.cpp
  *
- * Copyright (C) 1992-2020 Paul Boersma
+ * Copyright (C) 1992-2021 Paul Boersma
  *
  * This code is free software; you can redistribute it and/or modify
  * it under the terms of the GNU General Public License as published by
@@ -17,12 +17,91 @@
  */
 
 #include "melder.h"
+#include "../sys/MelderThread.h"
 
 /*
 	Local functions.
 */
 
-static longdouble NUMsum_longdouble (constVECVU const& vec) {
+/*
+	Pairwise sums of long vectors on multiple threads.
+
+	PAIRWISE_SUM first adds the leading n mod 64 terms into the sum,
+	and then puts the sums of the subsequent base cases of 64 terms on a stack,
+	where each element holds the sum of 2^k consecutive base cases that start at a multiple of 2^k base cases
+	(counting from the end of the leading terms); at the end, the elements are added into the sum
+	from the top of the stack down.
+	A chunk of `pairwiseSum_chunkSize` terms (64 times a power of 2) that starts at such a multiple
+	is therefore summed by PAIRWISE_SUM into exactly the number that the stack would hold for it,
+	and an element of the stack that contains 2^k chunks is the pairwise sum (left + right) of their sums.
+	So we can sum the chunks on separate threads, and then combine their sums in the same way as the stack would do,
+	which yields a result that is bit-identical to that of the single-threaded PAIRWISE_SUM,
+	whatever the number of threads.
+
+	Summing is mainly limited by memory bandwidth, and 80-bit accumulators (longdouble on Intel processors)
+	do not exist in vector registers, so we leave the base cases to the compiler.
+*/
+constexpr integer pairwiseSum_chunkSize = 64 << 12;   // 262144 terms, i.e. six seconds of sound sampled at 44.1 kHz
+
+static bool pairwiseSum_wantsThreads (integer numberOfTerms) {
+	return numberOfTerms >= 2 * pairwiseSum_chunkSize + 63 && MelderThread_getNumberOfThreads () > 1 && Melder_debug != 64;
+}
+
+static longdouble pairwiseSum_combineChunks (const longdouble *chunkSums, integer numberOfChunks) {
+	Melder_assert (numberOfChunks > 0 && (numberOfChunks & (numberOfChunks - 1)) == 0);
+	if (numberOfChunks == 1)
+		return chunkSums [0];
+	const integer half = numberOfChunks / 2;
+	return pairwiseSum_combineChunks (chunkSums, half) + pairwiseSum_combineChunks (chunkSums + half, half);
+}
+
+template <typename SumOfPart>
+static longdouble pairwiseSum_multiThreaded (integer numberOfTerms, SumOfPart sumOfPart) noexcept {
+	/*
+		`sumOfPart (first, size)` has to return the PAIRWISE_SUM of the terms `first` through `first + size - 1`.
+	*/
+	const integer numberOfLeadingTerms = numberOfTerms % 64;
+	const integer numberOfChunks = (numberOfTerms - numberOfLeadingTerms) / pairwiseSum_chunkSize;
+	const integer firstTermOfChunks = numberOfLeadingTerms + 1;
+	const integer firstTermOfTail = firstTermOfChunks + numberOfChunks * pairwiseSum_chunkSize;
+	try {
+		std::vector <longdouble> chunkSums (integer_to_uinteger (numberOfChunks));
+		MelderThread_runTasks (numberOfChunks, numberOfChunks, [&] (integer /* threadNumber */, integer ichunk) {
+			chunkSums [uinteger (ichunk - 1)] = sumOfPart (firstTermOfChunks + (ichunk - 1) * pairwiseSum_chunkSize, pairwiseSum_chunkSize);
+		});
+		/*
+			Rebuild the final stack of PAIRWISE_SUM, from the bottom up:
+			first the aligned groups of chunks, then the aligned groups of base cases in the tail.
+		*/
+		longdouble stack [64];
+		int stackPointer = 0;
+		integer firstChunk = 0;
+		for (integer groupSize = integer (1) << 62; groupSize >= 1; groupSize >>= 1) {
+			if (numberOfChunks & groupSize) {
+				stack [stackPointer ++] = pairwiseSum_combineChunks (& chunkSums [uinteger (firstChunk)], groupSize);
+				firstChunk += groupSize;
+			}
+		}
+		const integer numberOfTailTerms = numberOfTerms + 1 - firstTermOfTail;
+		integer firstTerm = firstTermOfTail;
+		for (integer groupSize = pairwiseSum_chunkSize / 2; groupSize >= 64; groupSize >>= 1) {
+			if (numberOfTailTerms & groupSize) {
+				stack [stackPointer ++] = sumOfPart (firstTerm, groupSize);
+				firstTerm += groupSize;
+			}
+		}
+		longdouble sum = sumOfPart (1, numberOfLeadingTerms);
+		while (stackPointer > 0)
+			sum += stack [-- stackPointer];
+		return sum;
+	} catch (MelderError) {
+		Melder_clearError ();
+	} catch (...) {
+	}
+	return sumOfPart (1, numberOfTerms);
+}
+
+static longdouble NUMsum_longdouble_singleThread (constVECVU const& vec) {
 	/*
 		This function started to crash on October 27, 2020.
 		The cause was that if `vec.firstCell == nullptr`,
@@ -58,6 +137,13 @@ static longdouble NUMsum_longdouble (constVECVU const& vec) {
 		return sum;
 	}
 }
+static longdouble NUMsum_longdouble (constVECVU const& vec) {
+	if (! pairwiseSum_wantsThreads (vec.size))
+		return NUMsum_longdouble_singleThread (vec);
+	return pairwiseSum_multiThreaded (vec.size, [&] (integer first, integer size) {
+		return NUMsum_longdouble_singleThread (vec.part (first, first + size - 1));
+	});
+}
 static longdouble NUMsum_longdouble (constMATVU const& mat) {
 	if (mat.nrow <= mat.ncol) {
 		PAIRWISE_SUM (
@@ -79,7 +165,7 @@ static longdouble NUMsum_longdouble (constMATVU const& mat) {
 		return sum;
 	}
 }
-static longdouble NUMsumOfSquaredDifferences_longdouble (constVECVU const& vec, double mean) {
+static longdouble NUMsumOfSquaredDifferences_longdouble_singleThread (constVECVU const& vec, double mean) {
 	if (vec.stride == 1) {
 		PAIRWISE_SUM (
 			longdouble, sum,
@@ -100,7 +186,14 @@ static longdouble NUMsumOfSquaredDifferences_longdouble (constVECVU const& vec,
 		return sum;
 	}
 }
-static longdouble NUMsum2_longdouble (constVECVU const& vec) {
+static longdouble NUMsumOfSquaredDifferences_longdouble (constVECVU const& vec, double mean) {
+	if (! pairwiseSum_wantsThreads (vec.size))
+		return NUMsumOfSquaredDifferences_longdouble_singleThread (vec, mean);
+	return pairwiseSum_multiThreaded (vec.size, [&] (integer first, integer size) {
+		return NUMsumOfSquaredDifferences_longdouble_singleThread (vec.part (first, first + size - 1), mean);
+	});
+}
+static longdouble NUMsum2_longdouble_singleThread (constVECVU const& vec) {
 	if (vec.stride == 1) {
 		PAIRWISE_SUM (
 			longdouble, sum,
@@ -121,6 +214,13 @@ static longdouble NUMsum2_longdouble (constVECVU const& vec) {
 		return sum;
 	}
 }
+static longdouble NUMsum2_longdouble (constVECVU const& vec) {
+	if (! pairwiseSum_wantsThreads (vec.size))
+		return NUMsum2_longdouble_singleThread (vec);
+	return pairwiseSum_multiThreaded (vec.size, [&] (integer first, integer size) {
+		return NUMsum2_longdouble_singleThread (vec.part (first, first + size - 1));
+	});
+}
 static longdouble NUMsum2_longdouble (constMATVU const& mat) {
 	if (mat.nrow <= mat.ncol) {
 		PAIRWISE_SUM (
@@ -234,22 +334,7 @@ struct MelderMeanSumsq_longdouble {
 static MelderMeanSumsq_longdouble NUMmeanSumsq (constVECVU const& vec) noexcept {
 	MelderMeanSumsq_longdouble result;
 	result.mean = NUMsum_longdouble (vec) / vec.size;
-	double mean = double (result.mean);
-	if (vec.stride == 1) {
-		PAIRWISE_SUM (longdouble, sumsq, integer, vec.size,
-			const double *p = vec. firstCell,
-			longdouble (*p - mean) * longdouble (*p - mean),
-			p += 1
-		)
-		result.sumsq = sumsq;
-	} else {
-		PAIRWISE_SUM (longdouble, sumsq, integer, vec.size,
-			const double *p = vec. firstCell,
-			longdouble (*p - mean) * longdouble (*p - mean),
-			p += vec.stride
-		)
-		result.sumsq = sumsq;
-	}
+	result.sumsq = NUMsumOfSquaredDifferences_longdouble (vec, double (result.mean));
 	return result;
 }
 static MelderMeanSumsq_longdouble NUMmeanSumsq (constMATVU const& mat) noexcept {
@@ -287,7 +372,7 @@ double NUMcenterOfGravity (constVECVU const& x) noexcept {
 	return double (weightedSumOfIndexes / sumOfWeights);
 }
 
-double NUMinner (constVECVU const& x, constVECVU const& y) noexcept {
+static longdouble NUMinner_longdouble_singleThread (constVECVU const& x, constVECVU const& y) {
 	if (x.stride == 1) {
 		if (y.stride == 1) {
 			PAIRWISE_SUM (longdouble, sum, integer, x.size,
@@ -296,7 +381,7 @@ double NUMinner (constVECVU const& x, constVECVU const& y) noexcept {
 				longdouble (*px) * longdouble (*py),
 				(px += 1, py += 1)
 			)
-			return double (sum);
+			return sum;
 		} else {
 			PAIRWISE_SUM (longdouble, sum, integer, x.size,
 				const double *px = x. firstCell;
@@ -304,7 +389,7 @@ double NUMinner (constVECVU const& x, constVECVU const& y) noexcept {
 				longdouble (*px) * longdouble (*py),
 				(px += 1, py += y.stride)
 			)
-			return double (sum);
+			return sum;
 		}
 	} else if (y.stride == 1) {
 		PAIRWISE_SUM (longdouble, sum, integer, x.size,
@@ -313,7 +398,7 @@ double NUMinner (constVECVU const& x, constVECVU const& y) noexcept {
 			longdouble (*px) * longdouble (*py),
 			(px += x.stride, py += 1)
 		)
-		return double (sum);
+		return sum;
 	} else {
 		PAIRWISE_SUM (longdouble, sum, integer, x.size,
 			const double *px = x. firstCell;
@@ -321,9 +406,16 @@ double NUMinner (constVECVU const& x, constVECVU const& y) noexcept {
 			longdouble (*px) * longdouble (*py),
 			(px += x.stride, py += y.stride)
 		)
-		return double (sum);
+		return sum;
 	}
 }
+double NUMinner (constVECVU const& x, constVECVU const& y) noexcept {
+	if (! pairwiseSum_wantsThreads (x.size))
+		return double (NUMinner_longdouble_singleThread (x, y));
+	return double (pairwiseSum_multiThreaded (x.size, [&] (integer first, integer size) {
+		return NUMinner_longdouble_singleThread (x.part (first, first + size - 1), y.part (first, first + size - 1));
+	}));
+}
 
 double NUMmean (constVECVU const& vec) {
 	if (vec.size <= 0)
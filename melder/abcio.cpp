@@ -1,6 +1,6 @@
 /* abcio.cpp
  *
- * Copyright (C) 1992-2011,2015,2017-2020 Paul Boersma
+ * Copyright (C) 1992-2011,2015,2017-2021 Paul Boersma
  *
  * This code is free software; you can redistribute it and/or modify
  * it under the terms of the GNU General Public License as published by
@@ -661,6 +661,62 @@ void texputw32 (MelderFile file, conststring32 s, texput_UP_TO_NINE_NULLABLE_STR
 	#define binario_doubleIEEE8lsb 0
 #endif
 
+/*
+	On which machines can we read and write many IEEE numbers at once, by reversing their bytes?
+	This includes the little-endian machines that use the portable routines below for single numbers
+	(e.g. Linux on x86-64 or ARM64); the "many" routines then imitate the portable routines exactly.
+*/
+
+#if defined (__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__ || defined (_WIN32)
+	#define binario_IEEElsb (std::numeric_limits <double>::is_iec559 && std::numeric_limits <float>::is_iec559)
+#else
+	#define binario_IEEElsb 0
+#endif
+
+#if defined (__SSE2__) || defined (_M_X64) || (defined (_M_IX86_FP) && _M_IX86_FP >= 2)
+	#include <emmintrin.h>
+	#define binario_SSE2  1
+#elif defined (__aarch64__) && defined (__ARM_NEON)
+	#include <arm_neon.h>
+	#define binario_NEON  1
+#endif
+
+static void reverseBytes64 (uint64 *x, integer n) {
+	integer i = 0;
+	#if defined (binario_SSE2)
+		for (; i + 2 <= n; i += 2) {
+			__m128i v = _mm_loadu_si128 ((const __m128i *) (x + i));
+			v = _mm_or_si128 (_mm_slli_epi16 (v, 8), _mm_srli_epi16 (v, 8));   // swap the two bytes of each 16-bit word...
+			v = _mm_shufflelo_epi16 (v, _MM_SHUFFLE (0, 1, 2, 3));   // ...then reverse the four words of each 64-bit number
+			v = _mm_shufflehi_epi16 (v, _MM_SHUFFLE (0, 1, 2, 3));
+			_mm_storeu_si128 ((__m128i *) (x + i), v);
+		}
+	#elif defined (binario_NEON)
+		for (; i + 2 <= n; i += 2)
+			vst1q_u8 ((uint8_t *) (x + i), vrev64q_u8 (vld1q_u8 ((const uint8_t *) (x + i))));
+	#endif
+	for (; i < n; i ++)
+		x [i] = __builtin_bswap64 (x [i]);
+}
+
+static void reverseBytes32 (uint32 *x, integer n) {
+	integer i = 0;
+	#if defined (binario_SSE2)
+		for (; i + 4 <= n; i += 4) {
+			__m128i v = _mm_loadu_si128 ((const __m128i *) (x + i));
+			v = _mm_or_si128 (_mm_slli_epi16 (v, 8), _mm_srli_epi16 (v, 8));
+			v = _mm_shufflelo_epi16 (v, _MM_SHUFFLE (2, 3, 0, 1));
+			v = _mm_shufflehi_epi16 (v, _MM_SHUFFLE (2, 3, 0, 1));
+			_mm_storeu_si128 ((__m128i *) (x + i), v);
+		}
+	#elif defined (binario_NEON)
+		for (; i + 4 <= n; i += 4)
+			vst1q_u8 ((uint8_t *) (x + i), vrev32q_u8 (vld1q_u8 ((const uint8_t *) (x + i))));
+	#endif
+	for (; i < n; i ++)
+		x [i] = __builtin_bswap32 (x [i]);
+}
+
 /*
 	The routines bingetr32, bingetr64, binputr32, and binputr64,
 	were implemented by Paul Boersma from the descriptions of the IEEE floating-point formats,
@@ -1223,6 +1279,73 @@ double bingetr64LE (FILE *f) {
 	}
 }
 
+/*
+	The "many" routines transfer chunks of numbers through a buffer of integers,
+	in which we can reverse the bytes without aliasing the numbers.
+*/
+constexpr integer binario_CHUNK_SIZE = 4096;
+
+void bingetr32_many (double *x, integer n, FILE *f) {
+	if (binario_floatIEEE4msb || ! binario_IEEElsb || Melder_debug == 18) {
+		for (integer i = 0; i < n; i ++)
+			x [i] = bingetr32 (f);
+		return;
+	}
+	try {
+		uint32 bits [binario_CHUNK_SIZE];
+		for (integer offset = 0; offset < n; offset += binario_CHUNK_SIZE) {
+			const integer chunkLength = std::min (binario_CHUNK_SIZE, n - offset);
+			if (fread (bits, sizeof (uint32), uinteger (chunkLength), f) != uinteger (chunkLength))
+				readError (f, U"32-bit floating-point numbers.");
+			reverseBytes32 (bits, chunkLength);
+			for (integer i = 0; i < chunkLength; i ++) {
+				if ((bits [i] & 0x7F80'0000) == 0x7F80'0000) {   // Infinity or Not-a-Number, as in bingetr32
+					x [offset + i] = undefined;
+				} else {
+					float value;
+					memcpy (& value, & bits [i], sizeof (float));
+					x [offset + i] = value;
+				}
+			}
+		}
+	} catch (MelderError) {
+		Melder_throw (U"Floating-point numbers not read from binary file.");
+	}
+}
+
+void bingetr64_many (double *x, integer n, FILE *f) {
+	if (! (binario_doubleIEEE8msb || binario_doubleIEEE8lsb || binario_IEEElsb) || Melder_debug == 18) {
+		for (integer i = 0; i < n; i ++)
+			x [i] = bingetr64 (f);
+		return;
+	}
+	try {
+		if (binario_doubleIEEE8msb || Melder_debug == 181) {
+			if (n > 0 && fread (x, sizeof (double), uinteger (n), f) != uinteger (n))
+				readError (f, U"64-bit floating-point numbers.");
+			return;
+		}
+		uint64 bits [binario_CHUNK_SIZE];
+		for (integer offset = 0; offset < n; offset += binario_CHUNK_SIZE) {
+			const integer chunkLength = std::min (binario_CHUNK_SIZE, n - offset);
+			if (fread (bits, sizeof (uint64), uinteger (chunkLength), f) != uinteger (chunkLength))
+				readError (f, U"64-bit floating-point numbers.");
+			reverseBytes64 (bits, chunkLength);
+			if (! binario_doubleIEEE8lsb) {
+				/*
+					Imitate the portable bingetr64.
+				*/
+				for (integer i = 0; i < chunkLength; i ++)
+					if ((bits [i] & 0x7FF0'0000'0000'0000) == 0x7FF0'0000'0000'0000)   // Infinity or Not-a-Number
+						memcpy (& bits [i], & undefined, sizeof (double));
+			}
+			memcpy (x + offset, bits, uinteger (chunkLength) * sizeof (double));
+		}
+	} catch (MelderError) {
+		Melder_throw (U"Floating-point numbers not read from binary file.");
+	}
+}
+
 double bingetr80 (FILE *f) {
 	try {
 		uint8 bytes [10];
@@ -1665,6 +1788,43 @@ void binputr64LE (double x, FILE *f) {
 	}
 }
 
+void binputr64_many (const double *x, integer n, FILE *f) {
+	if (! (binario_doubleIEEE8msb || binario_doubleIEEE8lsb || binario_IEEElsb) || Melder_debug == 18) {
+		for (integer i = 0; i < n; i ++)
+			binputr64 (x [i], f);
+		return;
+	}
+	try {
+		if (binario_doubleIEEE8msb || Melder_debug == 181) {
+			if (n > 0 && fwrite (x, sizeof (double), uinteger (n), f) != uinteger (n))
+				writeError (U"64-bit floating-point numbers.");
+			return;
+		}
+		uint64 bits [binario_CHUNK_SIZE];
+		for (integer offset = 0; offset < n; offset += binario_CHUNK_SIZE) {
+			const integer chunkLength = std::min (binario_CHUNK_SIZE, n - offset);
+			memcpy (bits, x + offset, uinteger (chunkLength) * sizeof (double));
+			if (! binario_doubleIEEE8lsb) {
+				/*
+					Imitate the portable binputr64, which writes minus zero as zero,
+					and NaN as positive infinity.
+				*/
+				for (integer i = 0; i < chunkLength; i ++) {
+					if ((bits [i] & 0x7FFF'FFFF'FFFF'FFFF) == 0)
+						bits [i] = 0;
+					else if ((bits [i] & 0x7FF0'0000'0000'0000) == 0x7FF0'0000'0000'0000)
+						bits [i] = ( (bits [i] & 0x000F'FFFF'FFFF'FFFF) != 0 ? 0x7FF0'0000'0000'0000 : bits [i] );
+				}
+			}
+			reverseBytes64 (bits, chunkLength);
+			if (fwrite (bits, sizeof (uint64), uinteger (chunkLength), f) != uinteger (chunkLength))
+				writeError (U"64-bit floating-point numbers.");
+		}
+	} catch (MelderError) {
+		Melder_throw (U"Floating-point numbers not written to binary file.");
+	}
+}
+
 void binputr80 (double x, FILE *f) {
 	try {
 		unsigned char bytes [10];
@@ -2,7 +2,7 @@
 #define _abcio_h_
 /* abcio.h
  *
- * Copyright (C) 1992-2011,2015,2017-2020 Paul Boersma
+ * Copyright (C) 1992-2011,2015,2017-2021 Paul Boersma
  *
  * This code is free software; you can redistribute it and/or modify
  * it under the terms of the GNU General Public License as published by
@@ -170,6 +170,14 @@ double bingetr64 (FILE *f);   void binputr64 (double x, FILE *f);
 */
 double bingetr64LE (FILE *f);   void binputr64LE (double x, FILE *f);   // least significant bit first
 
+void bingetr32_many (double *x, integer n, FILE *f);
+void bingetr64_many (double *x, integer n, FILE *f);   void binputr64_many (const double *x, integer n, FILE *f);
+/*
+	Read or write x [0] .. x [n-1] in the same format as bingetr32 or bingetr64 and binputr64,
+	but with a single fread or fwrite (and some byte swapping on little-endian machines),
+	which makes reading and writing large vectors and matrices much faster.
+*/
+
 double bingetr80 (FILE *f);   void binputr80 (double x, FILE *f);
 /*
 	Read or write a real number from or to 10 bytes in the stream `f`,
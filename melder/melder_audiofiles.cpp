@@ -1,6 +1,6 @@
 /* melder_audiofiles.cpp
  *
- * Copyright (C) 1992-2008,2010-2019 Paul Boersma & David Weenink, 2007 Erez Volk (for FLAC)
+ * Copyright (C) 1992-2008,2010-2019,2021 Paul Boersma & David Weenink, 2007 Erez Volk (for FLAC)
  *
  * This code is free software; you can redistribute it and/or modify
  * it under the terms of the GNU General Public License as published by
@@ -1365,6 +1365,123 @@ void Melder_readAudioToShort (FILE *f, integer numberOfChannels, int encoding, s
 	}
 }
 
+/*
+	Decoding from bytes in memory, e.g. from a memory-mapped audio file.
+	The results are identical to those of Melder_readAudioToFloat and Melder_readAudioToShort.
+*/
+static inline int32 decode24BE (const uint8 *p) {
+	return (int32) (((uint32) p [0] << 24) | ((uint32) p [1] << 16) | ((uint32) p [2] << 8));
+}
+static inline int32 decode24LE (const uint8 *p) {
+	return (int32) (((uint32) p [2] << 24) | ((uint32) p [1] << 16) | ((uint32) p [0] << 8));
+}
+static inline int32 decode32BE (const uint8 *p) {
+	return (int32) (((uint32) p [0] << 24) | ((uint32) p [1] << 16) | ((uint32) p [2] << 8) | (uint32) p [3]);
+}
+static inline int32 decode32LE (const uint8 *p) {
+	return (int32) (((uint32) p [3] << 24) | ((uint32) p [2] << 16) | ((uint32) p [1] << 8) | (uint32) p [0]);
+}
+static inline double decodeFloat32 (uint32 bits) {
+	float x;
+	memcpy (& x, & bits, 4);   // IEEE, as assumed by bingetr32 on all current platforms
+	return x;
+}
+static inline double decodeFloat64 (uint64 bits) {
+	double x;
+	memcpy (& x, & bits, 8);
+	return x;
+}
+static inline uint64 decode64BE (const uint8 *p) {
+	return (uint64) (uint32) decode32BE (p) << 32 | (uint64) (uint32) decode32BE (p + 4);
+}
+static inline uint64 decode64LE (const uint8 *p) {
+	return (uint64) (uint32) decode32LE (p + 4) << 32 | (uint64) (uint32) decode32LE (p);
+}
+
+template <typename DecodeOneValue>
+static void decodeToFloat (const uint8 *bytes, int numberOfBytesPerValue, MAT buffer, DecodeOneValue decode) {
+	for (integer isamp = 1; isamp <= buffer.ncol; isamp ++)
+		for (integer ichan = 1; ichan <= buffer.nrow; ichan ++, bytes += numberOfBytesPerValue)
+			buffer [ichan] [isamp] = decode (bytes);
+}
+
+void Melder_decodeAudioToFloat (const uint8 *bytes, int encoding, MAT buffer) {
+	switch (encoding) {
+		case Melder_LINEAR_8_SIGNED:
+			decodeToFloat (bytes, 1, buffer, [] (const uint8 *p) { return (int8) p [0] * (1.0 / 128); });
+		break; case Melder_LINEAR_8_UNSIGNED:
+			decodeToFloat (bytes, 1, buffer, [] (const uint8 *p) { return p [0] * (1.0 / 128) - 1.0; });
+		break; case Melder_LINEAR_16_BIG_ENDIAN:
+			decodeToFloat (bytes, 2, buffer, [] (const uint8 *p) { return (int16) (uint16) ((uint16) (p [0] << 8) | p [1]) * (1.0 / 32768); });
+		break; case Melder_LINEAR_16_LITTLE_ENDIAN:
+			decodeToFloat (bytes, 2, buffer, [] (const uint8 *p) { return (int16) (uint16) ((uint16) (p [1] << 8) | p [0]) * (1.0 / 32768); });
+		break; case Melder_LINEAR_24_BIG_ENDIAN:
+			decodeToFloat (bytes, 3, buffer, [] (const uint8 *p) { return decode24BE (p) * (1.0 / 32768 / 65536); });
+		break; case Melder_LINEAR_24_LITTLE_ENDIAN:
+			decodeToFloat (bytes, 3, buffer, [] (const uint8 *p) { return decode24LE (p) * (1.0 / 32768 / 65536); });
+		break; case Melder_LINEAR_32_BIG_ENDIAN:
+			decodeToFloat (bytes, 4, buffer, [] (const uint8 *p) { return decode32BE (p) * (1.0 / 32768 / 65536); });
+		break; case Melder_LINEAR_32_LITTLE_ENDIAN:
+			decodeToFloat (bytes, 4, buffer, [] (const uint8 *p) { return decode32LE (p) * (1.0 / 32768 / 65536); });
+		break; case Melder_IEEE_FLOAT_32_BIG_ENDIAN:
+			decodeToFloat (bytes, 4, buffer, [] (const uint8 *p) { return decodeFloat32 ((uint32) decode32BE (p)); });
+		break; case Melder_IEEE_FLOAT_32_LITTLE_ENDIAN:
+			decodeToFloat (bytes, 4, buffer, [] (const uint8 *p) { return decodeFloat32 ((uint32) decode32LE (p)); });
+		break; case Melder_IEEE_FLOAT_64_BIG_ENDIAN:
+			decodeToFloat (bytes, 8, buffer, [] (const uint8 *p) { return decodeFloat64 (decode64BE (p)); });
+		break; case Melder_IEEE_FLOAT_64_LITTLE_ENDIAN:
+			decodeToFloat (bytes, 8, buffer, [] (const uint8 *p) { return decodeFloat64 (decode64LE (p)); });
+		break; case Melder_MULAW:
+			decodeToFloat (bytes, 1, buffer, [] (const uint8 *p) { return ulaw2linear [p [0]] * (1.0 / 32768); });
+		break; case Melder_ALAW:
+			decodeToFloat (bytes, 1, buffer, [] (const uint8 *p) { return alaw2linear [p [0]] * (1.0 / 32768); });
+		break; default:
+			Melder_throw (U"Cannot decode audio samples with encoding ", encoding, U" from memory.");
+	}
+}
+
+template <typename DecodeOneValue>
+static void decodeToShort (const uint8 *bytes, int numberOfBytesPerValue, short *buffer, integer n, DecodeOneValue decode) {
+	for (integer i = 0; i < n; i ++, bytes += numberOfBytesPerValue)
+		buffer [i] = decode (bytes);
+}
+
+void Melder_decodeAudioToShort (const uint8 *bytes, integer numberOfChannels, int encoding, short *buffer, integer numberOfSamples) {
+	const integer n = numberOfSamples * numberOfChannels;
+	switch (encoding) {
+		case Melder_LINEAR_8_SIGNED:
+			decodeToShort (bytes, 1, buffer, n, [] (const uint8 *p) { return (short) ((int8) p [0] * 256); });
+		break; case Melder_LINEAR_8_UNSIGNED:
+			decodeToShort (bytes, 1, buffer, n, [] (const uint8 *p) { return (short) (p [0] * 256L - 32768); });
+		break; case Melder_LINEAR_16_BIG_ENDIAN:
+			decodeToShort (bytes, 2, buffer, n, [] (const uint8 *p) { return (short) (int16) (uint16) ((uint16) (p [0] << 8) | p [1]); });
+		break; case Melder_LINEAR_16_LITTLE_ENDIAN:
+			decodeToShort (bytes, 2, buffer, n, [] (const uint8 *p) { return (short) (int16) (uint16) ((uint16) (p [1] << 8) | p [0]); });
+		break; case Melder_LINEAR_24_BIG_ENDIAN:
+			decodeToShort (bytes, 3, buffer, n, [] (const uint8 *p) { return (short) ((decode24BE (p) >> 8) / 256); });
+		break; case Melder_LINEAR_24_LITTLE_ENDIAN:
+			decodeToShort (bytes, 3, buffer, n, [] (const uint8 *p) { return (short) ((decode24LE (p) >> 8) / 256); });
+		break; case Melder_LINEAR_32_BIG_ENDIAN:
+			decodeToShort (bytes, 4, buffer, n, [] (const uint8 *p) { return (short) (decode32BE (p) / 65536); });
+		break; case Melder_LINEAR_32_LITTLE_ENDIAN:
+			decodeToShort (bytes, 4, buffer, n, [] (const uint8 *p) { return (short) (decode32LE (p) / 65536); });
+		break; case Melder_IEEE_FLOAT_32_BIG_ENDIAN:
+			decodeToShort (bytes, 4, buffer, n, [] (const uint8 *p) { return (short) (decodeFloat32 ((uint32) decode32BE (p)) * 32768); });
+		break; case Melder_IEEE_FLOAT_32_LITTLE_ENDIAN:
+			decodeToShort (bytes, 4, buffer, n, [] (const uint8 *p) { return (short) (decodeFloat32 ((uint32) decode32LE (p)) * 32768); });
+		break; case Melder_IEEE_FLOAT_64_BIG_ENDIAN:
+			decodeToShort (bytes, 8, buffer, n, [] (const uint8 *p) { return (short) (decodeFloat64 (decode64BE (p)) * 32768); });
+		break; case Melder_IEEE_FLOAT_64_LITTLE_ENDIAN:
+			decodeToShort (bytes, 8, buffer, n, [] (const uint8 *p) { return (short) (decodeFloat64 (decode64LE (p)) * 32768); });
+		break; case Melder_MULAW:
+			decodeToShort (bytes, 1, buffer, n, [] (const uint8 *p) { return (short) ulaw2linear [p [0]]; });
+		break; case Melder_ALAW:
+			decodeToShort (bytes, 1, buffer, n, [] (const uint8 *p) { return (short) alaw2linear [p [0]]; });
+		break; default:
+			Melder_throw (U"Cannot decode audio samples with encoding ", encoding, U" from memory.");
+	}
+}
+
 void MelderFile_writeShortToAudio (MelderFile file, integer numberOfChannels, int encoding, const short *buffer, integer numberOfSamples) {
 	try {
 		FILE *f = file -> filePointer;
@@ -2,7 +2,7 @@
 #define _melder_audiofiles_h_
 /* melder_audiofiles.h
  *
- * Copyright (C) 1992-2019 Paul Boersma
+ * Copyright (C) 1992-2019,2021 Paul Boersma
  *
  * This code is free software; you can redistribute it and/or modify
  * it under the terms of the GNU General Public License as published by
@@ -72,6 +72,11 @@ void Melder_readAudioToShort (FILE *f, integer numberOfChannels, int encoding, s
 /* If stereo, buffer will contain alternating left and right values.
  * Buffer is base-0.
  */
+void Melder_decodeAudioToFloat (const uint8 *bytes, int encoding, MAT buffer);
+void Melder_decodeAudioToShort (const uint8 *bytes, integer numberOfChannels, int encoding, short *buffer, integer numberOfSamples);
+/* The same as the two previous functions, but from samples that are already in memory
+ * (e.g. in a memory-mapped file), interleaved as in the file; uncompressed encodings only.
+ */
 void MelderFile_writeFloatToAudio (MelderFile file, constMATVU const& buffer, int encoding, bool warnIfClipped);
 void MelderFile_writeShortToAudio (MelderFile file, integer numberOfChannels, int encoding, const short *buffer, integer numberOfSamples);
 
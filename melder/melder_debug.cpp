@@ -1,6 +1,6 @@
 /* melder_debug.cpp
  *
- * Copyright (C) 2000-2020 Paul Boersma
+ * Copyright (C) 2000-2021 Paul Boersma
  *
  * This code is free software; you can redistribute it and/or modify
  * it under the terms of the GNU General Public License as published by
@@ -85,6 +85,15 @@ the behaviour of Praat will temporarily change in the following ways:
 53: trace running cursor
 54: ignore gdk_cairo_reset_clip
 55: trace Gui init, draw, destroy
+56: Sound_to_Intensity: use the old engine (copy, centre and weigh each frame separately)
+57: MelderThread: start new threads at every parallel analysis, with a fixed division of the work, instead of using the thread pool
+58: NUMfft: use FFTPACK for all sizes, also for powers of two (takes effect when an FFT table is initialised)
+59: LongSound: read with fread instead of memory mapping (takes effect when the LongSound is opened)
+60: LongSound: do not read ahead in a background thread (takes effect when the LongSound is opened)
+61: Formula: compute every cell separately, also if the formula could be computed for many cells of a row at once
+62: Interpreter: compile every expression anew, instead of reusing the compiled expression from an earlier pass through the same line
+63: mul_fast##: multiply with simple loops, instead of with the blocked and multithreaded kernel
+64: NUMsum, NUMmean, NUMstdev, NUMinner and their relatives: sum long vectors on a single thread
 181: read and write native-endian real64
 900: use DG Meta Serif Science instead of Palatino
 1264: Mac: Sound_record_fixedTime uses microphone "FW Solo (1264)"
@@ -1,6 +1,6 @@
 /* melder_tensorio.cpp
  *
- * Copyright (C) 1992-2018,2020 Paul Boersma
+ * Copyright (C) 1992-2018,2020,2021 Paul Boersma
  *
  * This code is free software; you can redistribute it and/or modify
  * it under the terms of the GNU General Public License as published by
@@ -20,6 +20,53 @@
 
 /*** Typed I/O functions for vectors and matrices. ***/
 
+/*
+	Reading and writing the contiguous elements of a vector or matrix in binary format.
+	Most types go element by element, but the floating-point types,
+	which make up most large objects (sounds, spectrograms), go in bulk.
+*/
+#define ELEMENTS(T,storage)  \
+	static void bingetElements_##storage (T *x, integer n, FILE *f) { \
+		for (integer i = 0; i < n; i ++) \
+			x [i] = binget##storage (f); \
+	} \
+	static void binputElements_##storage (const T *x, integer n, FILE *f) { \
+		for (integer i = 0; i < n; i ++) \
+			binput##storage (x [i], f); \
+	}
+ELEMENTS (signed char, i8)
+ELEMENTS (int, i16)
+ELEMENTS (long, i32)
+ELEMENTS (integer, integer32BE)
+ELEMENTS (integer, integer16BE)
+ELEMENTS (unsigned char, u8)
+ELEMENTS (unsigned int, u16)
+ELEMENTS (unsigned long, u32)
+ELEMENTS (dcomplex, c64)
+ELEMENTS (bool, eb)
+#undef ELEMENTS
+
+static void bingetElements_r32 (double *x, integer n, FILE *f) {
+	bingetr32_many (x, n, f);
+}
+static void binputElements_r32 (const double *x, integer n, FILE *f) {
+	for (integer i = 0; i < n; i ++)
+		binputr32 (x [i], f);   // the portable binputr32 truncates rather than rounds, so it cannot be done in bulk
+}
+static void bingetElements_r64 (double *x, integer n, FILE *f) {
+	bingetr64_many (x, n, f);
+}
+static void binputElements_r64 (const double *x, integer n, FILE *f) {
+	binputr64_many (x, n, f);
+}
+static void bingetElements_c128 (dcomplex *x, integer n, FILE *f) {
+	static_assert (sizeof (dcomplex) == 2 * sizeof (double));
+	bingetr64_many (reinterpret_cast <double *> (x), 2 * n, f);   // real and imaginary parts, as in bingetc128
+}
+static void binputElements_c128 (const dcomplex *x, integer n, FILE *f) {
+	binputr64_many (reinterpret_cast <const double *> (x), 2 * n, f);
+}
+
 #define FUNCTION(T,storage)  \
 	void vector_writeText_##storage (const constvector<T>& vec, MelderFile file, conststring32 name) { \
 		texputintro (file, name, U" []: ", vec.size >= 1 ? nullptr : U"(empty)", 0,0,0); \
@@ -29,8 +76,7 @@
 		if (feof (file -> filePointer) || ferror (file -> filePointer)) Melder_throw (U"Write error."); \
 	} \
 	void vector_writeBinary_##storage (const constvector<T>& vec, FILE *f) { \
-		for (integer i = 1; i <= vec.size; i ++) \
-			binput##storage (vec [i], f); \
+		binputElements_##storage (vec.cells, vec.size, f); \
 		if (feof (f) || ferror (f)) Melder_throw (U"Write error."); \
 	} \
 	autovector<T> vector_readText_##storage (integer size, MelderReadText text, const char *name) { \
@@ -45,10 +91,8 @@
 		return result; \
 	} \
 	autovector<T> vector_readBinary_##storage (integer size, FILE *f) { \
-		autovector<T> result = newvectorzero<T> (size); \
-		for (integer i = 1; i <= size; i ++) { \
-			result [i] = binget##storage (f); \
-		} \
+		autovector<T> result = newvectorraw<T> (size); \
+		bingetElements_##storage (result.cells, size, f); \
 		return result; \
 	} \
 	void matrix_writeText_##storage (const constmatrix<T>& mat, MelderFile file, conststring32 name) { \
@@ -64,10 +108,7 @@
 		if (feof (file -> filePointer) || ferror (file -> filePointer)) Melder_throw (U"Write error."); \
 	} \
 	void matrix_writeBinary_##storage (const constmatrix<T>& mat, FILE *f) { \
-		for (integer irow = 1; irow <= mat.nrow; irow ++) { \
-			for (integer icol = 1; icol <= mat.ncol; icol ++) \
-				binput##storage (mat [irow] [icol], f); \
-		} \
+		binputElements_##storage (mat.cells, mat.nrow * mat.ncol, f);   /* row after row */ \
 		if (feof (f) || ferror (f)) Melder_throw (U"Write error."); \
 	} \
 	automatrix<T> matrix_readText_##storage (integer nrow, integer ncol, MelderReadText text, const char *name) { \
@@ -82,9 +123,8 @@
 		return result; \
 	} \
 	automatrix<T> matrix_readBinary_##storage (integer nrow, integer ncol, FILE *f) { \
-		automatrix<T> result = newmatrixzero<T> (nrow, ncol); \
-		for (integer irow = 1; irow <= nrow; irow ++) for (integer icol = 1; icol <= ncol; icol ++) \
-			result [irow] [icol] = binget##storage (f); \
+		automatrix<T> result = newmatrixraw<T> (nrow, ncol); \
+		bingetElements_##storage (result.cells, nrow * ncol, f);   /* row after row */ \
 		return result; \
 	} \
 	void tensor3_writeText_##storage (const consttensor3<T>& ten3, MelderFile file, conststring32 name) { \
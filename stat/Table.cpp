@@ -1,6 +1,6 @@
 /* Table.cpp
  *
- * Copyright (C) 2002-2020 Paul Boersma
+ * Copyright (C) 2002-2021 Paul Boersma
  *
  * This code is free software; you can redistribute it and/or modify
  * it under the terms of the GNU General Public License as published by
@@ -19,6 +19,7 @@
 #include "Table.h"
 #include "NUM2.h"
 #include "Formula.h"
+#include "MelderThread.h"
 #include "SSCP.h"
 
 #include "oo_DESTROY.h"
@@ -1289,27 +1290,85 @@ void Table_appendQuotientColumn (Table me, integer column1, integer column2, con
 	}
 }
 
+static void Table_setFormulaResult (Table me, integer irow, integer icol, int expressionType, double numericResult, conststring32 stringResult) {
+	if (expressionType == kFormula_EXPRESSION_TYPE_STRING) {
+		Table_setStringValue (me, irow, icol, stringResult);
+	} else if (expressionType == kFormula_EXPRESSION_TYPE_NUMERIC) {
+		Table_setNumericValue (me, irow, icol, numericResult);
+	} else if (expressionType == kFormula_EXPRESSION_TYPE_NUMERIC_VECTOR) {
+		Melder_throw (me, U": cannot put vectors into cells.");
+	} else if (expressionType == kFormula_EXPRESSION_TYPE_NUMERIC_MATRIX) {
+		Melder_throw (me, U": cannot put matrices into cells.");
+	} else if (expressionType == kFormula_EXPRESSION_TYPE_STRING_ARRAY) {
+		Melder_throw (me, U": cannot put string arrays into cells.");
+	}
+}
+
 void Table_formula_columnRange (Table me, integer fromColumn, integer toColumn, conststring32 expression, Interpreter interpreter) {
 	try {
 		Table_checkSpecifiedColumnNumberWithinRange (me, fromColumn);
 		Table_checkSpecifiedColumnNumberWithinRange (me, toColumn);
-		Formula_compile (interpreter, me, expression, kFormula_EXPRESSION_TYPE_UNKNOWN, true);
-		Formula_Result result;
-		for (integer irow = 1; irow <= my rows.size; irow ++) {
-			for (integer icol = fromColumn; icol <= toColumn; icol ++) {
-				Formula_run (irow, icol, & result);
-				if (result. expressionType == kFormula_EXPRESSION_TYPE_STRING) {
-					Table_setStringValue (me, irow, icol, result. stringResult.get());
-				} else if (result. expressionType == kFormula_EXPRESSION_TYPE_NUMERIC) {
-					Table_setNumericValue (me, irow, icol, result. numericResult);
-				} else if (result. expressionType == kFormula_EXPRESSION_TYPE_NUMERIC_VECTOR) {
-					Melder_throw (me, U": cannot put vectors into cells.");
-				} else if (result. expressionType == kFormula_EXPRESSION_TYPE_NUMERIC_MATRIX) {
-					Melder_throw (me, U": cannot put matrices into cells.");
-				} else if (result. expressionType == kFormula_EXPRESSION_TYPE_STRING_ARRAY) {
-					Melder_throw (me, U": cannot put string arrays into cells.");
+		autoFormulaProgram program = FormulaProgram_create (interpreter, me, expression, kFormula_EXPRESSION_TYPE_UNKNOWN, true);
+		const integer numberOfColumns = toColumn - fromColumn + 1, numberOfCells = my rows.size * numberOfColumns;
+		const integer numberOfRowsPerChunk = std::max (1_integer, 1024 / numberOfColumns);
+		const integer numberOfChunks = (my rows.size - 1) / numberOfRowsPerChunk + 1;
+		integer firstSerialCell = 1;   // counting the cells row by row
+		if (numberOfChunks >= 2 && FormulaProgram_canRunInParallel (program.get(), true)) {
+			/*
+				Compute all cells on several threads, then write them into the table on this thread,
+				in the same order as below (Table_setNumericValue converts with Melder_double, which is not reentrant).
+				Only the calling thread may throw (see MelderThread_runTasks),
+				so a chunk that fails records the cell where it failed, and the chunks after it are skipped;
+				the cells before the first failing cell are written, and the rest is computed below,
+				which throws the error that a computation on a single thread would have thrown.
+			*/
+			autoINTVEC expressionTypes = zero_INTVEC (numberOfCells);
+			autoVEC numericResults = zero_VEC (numberOfCells);
+			autoSTRVEC stringResults (numberOfCells);
+			autoINTVEC failingCells = zero_INTVEC (numberOfChunks);
+			std::atomic <integer> firstFailingChunk (INTEGER_MAX);
+			MelderThread_runTasks (numberOfChunks, MelderThread_getNumberOfThreads (),
+				[&] (integer /* threadNumber */, integer ichunk) {
+					if (ichunk > firstFailingChunk)
+						return;
+					const integer firstRow = (ichunk - 1) * numberOfRowsPerChunk + 1;
+					const integer lastRow = std::min (firstRow + numberOfRowsPerChunk - 1, my rows.size);
+					Formula_Result result;
+					try {
+						for (integer irow = firstRow; irow <= lastRow; irow ++) {
+							for (integer icol = fromColumn; icol <= toColumn; icol ++) {
+								const integer icell = (irow - 1) * numberOfColumns + (icol - fromColumn) + 1;
+								failingCells [ichunk] = icell;
+								FormulaProgram_run (program.get(), irow, icol, & result);
+								expressionTypes [icell] = result. expressionType;
+								if (result. expressionType == kFormula_EXPRESSION_TYPE_STRING)
+									stringResults [icell] = result. stringResult. move();
+								else
+									numericResults [icell] = result. numericResult;
+							}
+						}
+					} catch (MelderError) {
+						integer chunk = firstFailingChunk;
+						while (ichunk < chunk && ! firstFailingChunk.compare_exchange_weak (chunk, ichunk)) { }
+					}
 				}
+			);
+			integer numberOfComputedCells = numberOfCells;
+			if (firstFailingChunk != INTEGER_MAX) {
+				Melder_clearError ();   // the messages of chunks that failed at the same time may have been garbled
+				numberOfComputedCells = failingCells [firstFailingChunk] - 1;
 			}
+			for (integer icell = 1; icell <= numberOfComputedCells; icell ++) {
+				const integer irow = (icell - 1) / numberOfColumns + 1, icol = fromColumn + (icell - 1) % numberOfColumns;
+				Table_setFormulaResult (me, irow, icol, expressionTypes [icell], numericResults [icell], stringResults [icell].get());
+			}
+			firstSerialCell = numberOfComputedCells + 1;
+		}
+		Formula_Result result;
+		for (integer icell = firstSerialCell; icell <= numberOfCells; icell ++) {
+			const integer irow = (icell - 1) / numberOfColumns + 1, icol = fromColumn + (icell - 1) % numberOfColumns;
+			FormulaProgram_run (program.get(), irow, icol, & result);
+			Table_setFormulaResult (me, irow, icol, result. expressionType, result. numericResult, result. stringResult.get());
 		}
 	} catch (MelderError) {
 		Melder_throw (me, U": application of formula not completed.");
@@ -30,14 +30,16 @@
 #include "UiPause.h"
 #include "DemoEditor.h"
 
-static Interpreter theInterpreter;
-static autoInterpreter theLocalInterpreter;
-static Daata theSource;
-static conststring32 theExpression;
-static int theLevel = 1;
-#define MAXIMUM_NUMBER_OF_LEVELS  20
-static int theExpressionType [1 + MAXIMUM_NUMBER_OF_LEVELS];
-static bool theOptimize;
+/*
+	The program that is being compiled or run on this thread.
+*/
+static thread_local FormulaProgram theProgram;
+
+/*
+	The state of the compiler, which is used only during compilation.
+*/
+static thread_local autoInterpreter theLocalInterpreter;
+static thread_local conststring32 theExpression;
 
 typedef struct structFormulaInstruction {
 	int symbol;
@@ -51,8 +53,7 @@ typedef struct structFormulaInstruction {
 	} content;
 } *FormulaInstruction;
 
-static FormulaInstruction lexan, parse;
-static int ilabel, ilexan, iparse, numberOfInstructions, numberOfStringConstants;
+static thread_local int ilabel, ilexan, iparse;
 
 enum { NO_SYMBOL_,
 
@@ -321,16 +322,16 @@ static const conststring32 Formula_instructionNames [1 + highestSymbol] = { U"",
 };
 
 #define newlabel (-- ilabel)
-#define newread (lexan [++ ilexan]. symbol)
+#define newread (theProgram -> lexan [++ ilexan]. symbol)
 #define oldread  (-- ilexan)
 
 static void formulaError (conststring32 message, int position) {
-	static MelderString truncatedExpression;
+	static thread_local MelderString truncatedExpression;
 	MelderString_ncopy (& truncatedExpression, theExpression, position + 1);
 	Melder_throw (message, U":\n« ", truncatedExpression.string);
 }
 
-static conststring32 languageNameCompare_searchString;
+static thread_local conststring32 languageNameCompare_searchString;
 
 static int languageNameCompare (const void *first, const void *second) {
 	integer i = * (integer *) first, j = * (integer *) second;
@@ -339,11 +340,11 @@ static int languageNameCompare (const void *first, const void *second) {
 }
 
 static integer Formula_hasLanguageName (conststring32 f) {
-	static autoINTVEC index;
-	if (NUMisEmpty (index)) {
-		index = to_INTVEC (highestInputSymbol);
-		qsort (& index [1], highestInputSymbol, sizeof (integer), languageNameCompare);
-	}
+	static const autoINTVEC index = [] () {   // initialized only once, even if several threads compile at the same time
+		autoINTVEC result = to_INTVEC (highestInputSymbol);
+		qsort (& result [1], highestInputSymbol, sizeof (integer), languageNameCompare);
+		return result;
+	} ();
 	integer dummy = 0, *found;
 	languageNameCompare_searchString = f;
 	found = (integer *) bsearch (& dummy, & index [1], highestInputSymbol, sizeof (integer), languageNameCompare);
@@ -362,12 +363,12 @@ static void Formula_lexan () {
 		if result != 0, then the last symbol is L"END_".
 	Example:
 		the text L"x*7" yields 5 symbols:
-			lexan [0] is empty;
-			lexan [1]. symbol = X_;
-			lexan [2]. symbol = MUL_;
-			lexan [3]. symbol = NUMBER_;
-			lexan [3]. number = 7.00000000e+00;
-			lexan [4]. symbol = END_;
+			theProgram -> lexan [0] is empty;
+			theProgram -> lexan [1]. symbol = X_;
+			theProgram -> lexan [2]. symbol = MUL_;
+			theProgram -> lexan [3]. symbol = NUMBER_;
+			theProgram -> lexan [3]. number = 7.00000000e+00;
+			theProgram -> lexan [4]. symbol = END_;
 */
 	char32 kar;   /* The character most recently read from theExpression. */
 	int ikar = -1;   /* The position of that character in theExpression. */
@@ -375,16 +376,16 @@ static void Formula_lexan () {
 #define oldchar -- ikar
 
 	int itok = 0;   /* Position of most recent symbol in "lexan". */
-#define newtok(s)  { lexan [++ itok]. symbol = s; lexan [itok]. position = ikar; }
-#define toknumber(g)  lexan [itok]. content.number = (g)
-#define tokmatrix(m)  lexan [itok]. content.object = (m)
+#define newtok(s)  { theProgram -> lexan [++ itok]. symbol = s; theProgram -> lexan [itok]. position = ikar; }
+#define toknumber(g)  theProgram -> lexan [itok]. content.number = (g)
+#define tokmatrix(m)  theProgram -> lexan [itok]. content.object = (m)
 
-	static MelderString token;   // string to collect a symbol name in
+	static thread_local MelderString token;   // string to collect a symbol name in
 #define stringtokon MelderString_empty (& token);
 #define stringtokchar { MelderString_appendCharacter (& token, kar); newchar; }
 #define stringtokoff (void) 0
 
-	ilexan = iparse = ilabel = numberOfStringConstants = 0;
+	ilexan = iparse = ilabel = theProgram -> numberOfStringConstants = 0;
 	do {
 		newchar;
 		if (Melder_isHorizontalOrVerticalSpace (kar)) {
@@ -431,8 +432,8 @@ static void Formula_lexan () {
 			}
 		} else if (Melder_isLetter (kar) && ! Melder_isUpperCaseLetter (kar) ||
 				(kar == U'.' && Melder_isLetter (theExpression [ikar + 1]) && ! Melder_isUpperCaseLetter (theExpression [ikar + 1])
-				&& (itok == 0 || (lexan [itok]. symbol != MATRIX_ && lexan [itok]. symbol != MATRIX_STR_
-					&& lexan [itok]. symbol != CLOSING_BRACKET_)))) {
+				&& (itok == 0 || (theProgram -> lexan [itok]. symbol != MATRIX_ && theProgram -> lexan [itok]. symbol != MATRIX_STR_
+					&& theProgram -> lexan [itok]. symbol != CLOSING_BRACKET_)))) {
 			int tok;
 			bool isString = false;
 			int rank = 0;
@@ -511,17 +512,17 @@ static void Formula_lexan () {
 						} else {
 							newtok (INDEXED_NUMERIC_VARIABLE_)
 						}
-						lexan [itok]. content.string = Melder_dup_f (token.string).transfer();
-						numberOfStringConstants ++;
+						theProgram -> lexan [itok]. content.string = Melder_dup_f (token.string).transfer();
+						theProgram -> numberOfStringConstants ++;
 					} else {
 						/*
 							This could be a variable with the same name as a function.
 						*/
-						InterpreterVariable var = Interpreter_hasVariable (theInterpreter, token.string);
+						InterpreterVariable var = Interpreter_hasVariable (theProgram -> interpreter, token.string);
 						if (! var) {
 							newtok (VARIABLE_NAME_)
-							lexan [itok]. content.string = Melder_dup_f (token.string).transfer();
-							numberOfStringConstants ++;
+							theProgram -> lexan [itok]. content.string = Melder_dup_f (token.string).transfer();
+							theProgram -> numberOfStringConstants ++;
 						} else {
 							if (rank == 0) {
 								if (isString) {
@@ -546,7 +547,7 @@ static void Formula_lexan () {
 							} else {
 								formulaError (U"Rank-4 tensors not implemented.", ikar);
 							}
-							lexan [itok]. content.variable = var;
+							theProgram -> lexan [itok]. content.variable = var;
 						}
 					}
 				/*
@@ -558,16 +559,16 @@ static void Formula_lexan () {
 					/*
 						Look back to find out whether this is an attribute.
 					*/
-					if (itok > 0 && lexan [itok]. symbol == PERIOD_) {
+					if (itok > 0 && theProgram -> lexan [itok]. symbol == PERIOD_) {
 						/*
 							This must be an attribute that follows a period.
 						*/
 						newtok (tok)
-					} else if (theSource) {
+					} else if (theProgram -> source) {
 						/*
 							Look for ambiguity.
 						*/
-						if (Interpreter_hasVariable (theInterpreter, token.string))
+						if (Interpreter_hasVariable (theProgram -> interpreter, token.string))
 							Melder_throw (
 								U"«", token.string,
 								U"» is ambiguous: a variable or an attribute of the current object. "
@@ -576,7 +577,7 @@ static void Formula_lexan () {
 							newtok (tok)
 						} else {
 							newtok (MATRIX_)
-							tokmatrix (theSource);
+							tokmatrix (theProgram -> source);
 							newtok (PERIOD_)
 							newtok (tok)
 						}
@@ -592,14 +593,14 @@ static void Formula_lexan () {
 							} else {
 								newtok (INDEXED_NUMERIC_VARIABLE_)
 							}
-							lexan [itok]. content.string = Melder_dup_f (token.string).transfer();
-							numberOfStringConstants ++;
+							theProgram -> lexan [itok]. content.string = Melder_dup_f (token.string).transfer();
+							theProgram -> numberOfStringConstants ++;
 						} else {
-							InterpreterVariable var = Interpreter_hasVariable (theInterpreter, token.string);
+							InterpreterVariable var = Interpreter_hasVariable (theProgram -> interpreter, token.string);
 							if (! var) {
 								newtok (VARIABLE_NAME_)
-								lexan [itok]. content.string = Melder_dup_f (token.string).transfer();
-								numberOfStringConstants ++;
+								theProgram -> lexan [itok]. content.string = Melder_dup_f (token.string).transfer();
+								theProgram -> numberOfStringConstants ++;
 							} else {
 								if (rank == 0) {
 									if (isString) {
@@ -624,7 +625,7 @@ static void Formula_lexan () {
 								} else {
 									formulaError (U"Rank-4 tensors not implemented.", ikar);
 								}
-								lexan [itok]. content.variable = var;
+								theProgram -> lexan [itok]. content.variable = var;
 							}
 						}
 					}
@@ -646,14 +647,14 @@ static void Formula_lexan () {
 					} else {
 						newtok (INDEXED_NUMERIC_VARIABLE_)
 					}
-					lexan [itok]. content.string = Melder_dup_f (token.string).transfer();
-					numberOfStringConstants ++;
+					theProgram -> lexan [itok]. content.string = Melder_dup_f (token.string).transfer();
+					theProgram -> numberOfStringConstants ++;
 				} else {
-					InterpreterVariable var = Interpreter_hasVariable (theInterpreter, token.string);
+					InterpreterVariable var = Interpreter_hasVariable (theProgram -> interpreter, token.string);
 					if (! var) {
 						newtok (VARIABLE_NAME_)
-						lexan [itok]. content.string = Melder_dup_f (token.string).transfer();
-						numberOfStringConstants ++;
+						theProgram -> lexan [itok]. content.string = Melder_dup_f (token.string).transfer();
+						theProgram -> numberOfStringConstants ++;
 					} else {
 						if (rank == 0) {
 							if (isString) {
@@ -678,7 +679,7 @@ static void Formula_lexan () {
 						} else {
 							formulaError (U"Rank-4 tensors not implemented.", ikar);
 						}
-						lexan [itok]. content.variable = var;
+						theProgram -> lexan [itok]. content.variable = var;
 					}
 				}
 			}
@@ -694,15 +695,15 @@ static void Formula_lexan () {
 			 */
 			char32 *underscore = str32chr (token.string, '_');
 			if (str32equ (token.string, U"Self")) {
-				if (! theSource)
+				if (! theProgram -> source)
 					formulaError (U"Cannot use \"Self\" if there is no current object.", ikar);
 				newtok (MATRIX_)
-				tokmatrix (theSource);
+				tokmatrix (theProgram -> source);
 			} else if (str32equ (token.string, U"Self$")) {
-				if (! theSource)
+				if (! theProgram -> source)
 					formulaError (U"Cannot use \"Self$\" if there is no current object.", ikar);
 				newtok (MATRIX_STR_)
-				tokmatrix (theSource);
+				tokmatrix (theProgram -> source);
 			} else if (! underscore) {
 				Melder_throw (
 					U"Unknown symbol «", token.string, U"» in formula "
@@ -735,7 +736,7 @@ static void Formula_lexan () {
 		} else if (kar == U'+') {
 			newtok (ADD_)
 		} else if (kar == U'-') {
-			if (itok == 0 || lexan [itok]. symbol <= MINUS_) {
+			if (itok == 0 || theProgram -> lexan [itok]. symbol <= MINUS_) {
 				newtok (MINUS_)
 			} else {
 				newtok (SUB_)
@@ -805,8 +806,8 @@ static void Formula_lexan () {
 			stringtokoff;
 			oldchar;
 			newtok (CALL_)
-			lexan [itok]. content.string = Melder_dup_f (token.string).transfer();
-			numberOfStringConstants ++;
+			theProgram -> lexan [itok]. content.string = Melder_dup_f (token.string).transfer();
+			theProgram -> numberOfStringConstants ++;
 		} else if (kar == U'\"') {
 			/*
 			 * String constant.
@@ -827,8 +828,8 @@ static void Formula_lexan () {
 			stringtokoff;
 			oldchar;
 			newtok (STRING_)
-			lexan [itok]. content.string = Melder_dup_f (token.string).transfer();
-			numberOfStringConstants ++;
+			theProgram -> lexan [itok]. content.string = Melder_dup_f (token.string).transfer();
+			theProgram -> numberOfStringConstants ++;
 		} else if (kar == U'~') {
 			/*
 				The content of the remainder of the line,
@@ -844,8 +845,8 @@ static void Formula_lexan () {
 			stringtokoff;
 			oldchar;
 			newtok (STRING_)
-			lexan [itok]. content.string = Melder_dup_f (token.string).transfer();
-			numberOfStringConstants ++;
+			theProgram -> lexan [itok]. content.string = Melder_dup_f (token.string).transfer();
+			theProgram -> numberOfStringConstants ++;
 		} else if (kar == U'|') {
 			newtok (OR_)   /* "|" = "or" */
 			newchar;
@@ -871,7 +872,7 @@ static void Formula_lexan () {
 		} else {
 			formulaError (U"Unknown symbol", ikar);
 		}
-	} while (lexan [itok]. symbol != END_);
+	} while (theProgram -> lexan [itok]. symbol != END_);
 }
 
 static void fit (int symbol) {
@@ -879,14 +880,14 @@ static void fit (int symbol) {
 		return;   // success
 	} else {
 		const conststring32 symbolName1 = Formula_instructionNames [symbol];
-		const conststring32 symbolName2 = Formula_instructionNames [lexan [ilexan]. symbol];
+		const conststring32 symbolName2 = Formula_instructionNames [theProgram -> lexan [ilexan]. symbol];
 		const bool needQuotes1 = ! str32chr (symbolName1, U' ');
 		const bool needQuotes2 = ! str32chr (symbolName2, U' ');
-		static MelderString message;
+		static thread_local MelderString message;
 		MelderString_copy (& message,
 			U"Expected ", ( needQuotes1 ? U"\"" : nullptr ), symbolName1, ( needQuotes1 ? U"\"" : nullptr ),
 			U", but found ", ( needQuotes2 ? U"\"" : nullptr ), symbolName2, ( needQuotes2 ? U"\"" : nullptr ));
-		formulaError (message.string, lexan [ilexan]. position);
+		formulaError (message.string, theProgram -> lexan [ilexan]. position);
 	}
 }
 
@@ -894,18 +895,18 @@ static bool fitArguments () {
     int symbol = newread;
     if (symbol == OPENING_PARENTHESIS_) return true;   // success: a function call like: myFunction (...)
     if (symbol == COLON_) return false;   // success: a function call like: myFunction: ...
-    const conststring32 symbolName2 = Formula_instructionNames [lexan [ilexan]. symbol];
+    const conststring32 symbolName2 = Formula_instructionNames [theProgram -> lexan [ilexan]. symbol];
     bool needQuotes2 = ! str32chr (symbolName2, U' ');
-    static MelderString message;
+    static thread_local MelderString message;
     MelderString_copy (& message,
 		U"Expected \"(\" or \":\", but found ", ( needQuotes2 ? U"\"" : nullptr ), symbolName2, ( needQuotes2 ? U"\"" : nullptr ));
-    formulaError (message.string, lexan [ilexan]. position);
+    formulaError (message.string, theProgram -> lexan [ilexan]. position);
     return false;   // will never occur
 }
 
-#define newparse(s)  parse [++ iparse]. symbol = (s)
-#define parsenumber(g)  parse [iparse]. content.number = (g)
-#define parselabel(l)  parse [iparse]. content.label = (l)
+#define newparse(s)  theProgram -> parse [++ iparse]. symbol = (s)
+#define parsenumber(g)  theProgram -> parse [iparse]. content.number = (g)
+#define parselabel(l)  theProgram -> parse [iparse]. content.label = (l)
 
 static void parseExpression ();
 
@@ -914,24 +915,24 @@ static void parsePowerFactor () {
 
 	if (symbol >= LOW_VALUE && symbol <= HIGH_VALUE) {
 		newparse (symbol);
-		if (symbol == NUMBER_) parsenumber (lexan [ilexan]. content.number);
+		if (symbol == NUMBER_) parsenumber (theProgram -> lexan [ilexan]. content.number);
 		return;
 	}
 
 	if (symbol == STRING_) {
 		newparse (symbol);
-		parse [iparse]. content.string = lexan [ilexan]. content.string;   // reference copy!
+		theProgram -> parse [iparse]. content.string = theProgram -> lexan [ilexan]. content.string;   // reference copy!
 		return;
 	}
 
 	if (symbol == NUMERIC_VARIABLE_ || symbol == STRING_VARIABLE_) {
 		newparse (symbol);
-		parse [iparse]. content.variable = lexan [ilexan]. content.variable;
+		theProgram -> parse [iparse]. content.variable = theProgram -> lexan [ilexan]. content.variable;
 		return;
 	}
 
 	if (symbol == INDEXED_NUMERIC_VARIABLE_ || symbol == INDEXED_STRING_VARIABLE_) {
-		char32 *var = lexan [ilexan]. content.string;   // Save before incrementing ilexan.
+		char32 *var = theProgram -> lexan [ilexan]. content.string;   // Save before incrementing ilexan.
 		if (newread == OPENING_BRACKET_) {
 			int n = 0;
 			if (newread != CLOSING_BRACKET_) {
@@ -950,12 +951,12 @@ static void parsePowerFactor () {
 		} else {
 			Melder_fatal (U"Formula:parsePowerFactor (indexed variable): No '['; cannot happen.");
 		}
-		parse [iparse]. content.string = var;
+		theProgram -> parse [iparse]. content.string = var;
 		return;
 	}
 
 	if (symbol == NUMERIC_VECTOR_VARIABLE_) {
-		InterpreterVariable var = lexan [ilexan]. content.variable;   // save before incrementing ilexan
+		InterpreterVariable var = theProgram -> lexan [ilexan]. content.variable;   // save before incrementing ilexan
 		if (newread == OPENING_BRACKET_) {
 			parseExpression ();
 			fit (CLOSING_BRACKET_);
@@ -964,12 +965,12 @@ static void parsePowerFactor () {
 			oldread;
 			newparse (NUMERIC_VECTOR_VARIABLE_);
 		}
-		parse [iparse]. content.variable = var;
+		theProgram -> parse [iparse]. content.variable = var;
 		return;
 	}
 
 	if (symbol == NUMERIC_MATRIX_VARIABLE_) {
-		InterpreterVariable var = lexan [ilexan]. content.variable;   // save before incrementing ilexan
+		InterpreterVariable var = theProgram -> lexan [ilexan]. content.variable;   // save before incrementing ilexan
 		if (newread == OPENING_BRACKET_) {
 			parseExpression ();
 			fit (COMMA_);
@@ -980,12 +981,12 @@ static void parsePowerFactor () {
 			oldread;
 			newparse (NUMERIC_MATRIX_VARIABLE_);
 		}
-		parse [iparse]. content.variable = var;
+		theProgram -> parse [iparse]. content.variable = var;
 		return;
 	}
 
 	if (symbol == STRING_ARRAY_VARIABLE_) {
-		InterpreterVariable var = lexan [ilexan]. content.variable;   // save before incrementing ilexan
+		InterpreterVariable var = theProgram -> lexan [ilexan]. content.variable;   // save before incrementing ilexan
 		if (newread == OPENING_BRACKET_) {
 			parseExpression ();
 			fit (CLOSING_BRACKET_);
@@ -994,16 +995,16 @@ static void parsePowerFactor () {
 			oldread;
 			newparse (STRING_ARRAY_VARIABLE_);
 		}
-		parse [iparse]. content.variable = var;
+		theProgram -> parse [iparse]. content.variable = var;
 		return;
 	}
 
 	if (symbol == VARIABLE_NAME_) {
-		InterpreterVariable var = Interpreter_hasVariable (theInterpreter, lexan [ilexan]. content.string);
+		InterpreterVariable var = Interpreter_hasVariable (theProgram -> interpreter, theProgram -> lexan [ilexan]. content.string);
 		if (! var)
-			formulaError (U"Unknown variable", lexan [ilexan]. position);
+			formulaError (U"Unknown variable", theProgram -> lexan [ilexan]. position);
 		newparse (NUMERIC_VARIABLE_);
-		parse [iparse]. content.variable = var;
+		theProgram -> parse [iparse]. content.variable = var;
 		return;
 	}
 
@@ -1126,7 +1127,7 @@ static void parsePowerFactor () {
 							return;
 						default:
 							formulaError (U"After \"object [number].\" there should be \"xmin\", \"xmax\", \"ymin\", "
-								"\"ymax\", \"nx\", \"ny\", \"dx\", \"dy\", \"nrow\" or \"ncol\"", lexan [ilexan]. position);
+								"\"ymax\", \"nx\", \"ny\", \"dx\", \"dy\", \"nrow\" or \"ncol\"", theProgram -> lexan [ilexan]. position);
 					}
 				} else if (symbol == OPENING_BRACKET_) {
 					parseExpression ();
@@ -1177,7 +1178,7 @@ static void parsePowerFactor () {
 				}
 			}
 		} else {
-			formulaError (U"After \"object\" there should be \"(\" or \"[\"", lexan [ilexan]. position);
+			formulaError (U"After \"object\" there should be \"(\" or \"[\"", theProgram -> lexan [ilexan]. position);
 		}
 		return;
 	}
@@ -1223,7 +1224,7 @@ static void parsePowerFactor () {
 				}
 			}
 		} else {
-			formulaError (U"After \"object$\" there should be \"(\" or \"[\"", lexan [ilexan]. position);
+			formulaError (U"After \"object$\" there should be \"(\" or \"[\"", theProgram -> lexan [ilexan]. position);
 		}
 		return;
 	}
@@ -1251,44 +1252,44 @@ static void parsePowerFactor () {
 	}
 
 	if (symbol == MATRIX_) {
-		Daata thee = lexan [ilexan]. content.object;
+		Daata thee = theProgram -> lexan [ilexan]. content.object;
 		Melder_assert (thee != nullptr);
 		symbol = newread;
 		if (symbol == OPENING_BRACKET_) {
 			if (newread == CLOSING_BRACKET_) {
 				newparse (MATRIX0_);
-				parse [iparse]. content.object = thee;
+				theProgram -> parse [iparse]. content.object = thee;
 			} else {
 				oldread;
 				parseExpression ();
 				if (newread == COMMA_) {
 					parseExpression ();
 					newparse (MATRIX2_);
-					parse [iparse]. content.object = thee;
+					theProgram -> parse [iparse]. content.object = thee;
 					fit (CLOSING_BRACKET_);
 				} else {
 					oldread;
 					newparse (MATRIX1_);
-					parse [iparse]. content.object = thee;
+					theProgram -> parse [iparse]. content.object = thee;
 					fit (CLOSING_BRACKET_);
 				}
 			}
 		} else if (symbol == OPENING_PARENTHESIS_) {
 			if (newread == CLOSING_PARENTHESIS_) {
 				newparse (FUNCTION0_);
-				parse [iparse]. content.object = thee;
+				theProgram -> parse [iparse]. content.object = thee;
 			} else {
 				oldread;
 				parseExpression ();
 				if (newread == COMMA_) {
 					parseExpression ();
 					newparse (FUNCTION2_);
-					parse [iparse]. content.object = thee;
+					theProgram -> parse [iparse]. content.object = thee;
 					fit (CLOSING_PARENTHESIS_);
 				} else {
 					oldread;
 					newparse (FUNCTION1_);
-					parse [iparse]. content.object = thee;
+					theProgram -> parse [iparse]. content.object = thee;
 					fit (CLOSING_PARENTHESIS_);
 				}
 			}
@@ -1296,7 +1297,7 @@ static void parsePowerFactor () {
 			switch (newread) {
 				case XMIN_:
 					if (! thy v_hasGetXmin ()) {
-						formulaError (U"Attribute \"xmin\" not defined for this object", lexan [ilexan]. position);
+						formulaError (U"Attribute \"xmin\" not defined for this object", theProgram -> lexan [ilexan]. position);
 					} else {
 						newparse (NUMBER_);
 						parsenumber (thy v_getXmin ());
@@ -1304,7 +1305,7 @@ static void parsePowerFactor () {
 					}
 				case XMAX_:
 					if (! thy v_hasGetXmax ()) {
-						formulaError (U"Attribute \"xmax\" not defined for this object", lexan [ilexan]. position);
+						formulaError (U"Attribute \"xmax\" not defined for this object", theProgram -> lexan [ilexan]. position);
 					} else {
 						newparse (NUMBER_);
 						parsenumber (thy v_getXmax ());
@@ -1312,7 +1313,7 @@ static void parsePowerFactor () {
 					}
 				case YMIN_:
 					if (! thy v_hasGetYmin ()) {
-						formulaError (U"Attribute \"ymin\" not defined for this object", lexan [ilexan]. position);
+						formulaError (U"Attribute \"ymin\" not defined for this object", theProgram -> lexan [ilexan]. position);
 					} else {
 						newparse (NUMBER_);
 						parsenumber (thy v_getYmin ());
@@ -1320,7 +1321,7 @@ static void parsePowerFactor () {
 					}
 				case YMAX_:
 					if (! thy v_hasGetYmax ()) {
-						formulaError (U"Attribute \"ymax\" not defined for this object", lexan [ilexan]. position);
+						formulaError (U"Attribute \"ymax\" not defined for this object", theProgram -> lexan [ilexan]. position);
 					} else {
 						newparse (NUMBER_);
 						parsenumber (thy v_getYmax ());
@@ -1328,7 +1329,7 @@ static void parsePowerFactor () {
 					}
 				case NX_:
 					if (! thy v_hasGetNx ()) {
-						formulaError (U"Attribute \"nx\" not defined for this object", lexan [ilexan]. position);
+						formulaError (U"Attribute \"nx\" not defined for this object", theProgram -> lexan [ilexan]. position);
 					} else {
 						newparse (NUMBER_);
 						parsenumber (thy v_getNx ());
@@ -1336,7 +1337,7 @@ static void parsePowerFactor () {
 					}
 				case NY_:
 					if (! thy v_hasGetNy ()) {
-						formulaError (U"Attribute \"ny\" not defined for this object", lexan [ilexan]. position);
+						formulaError (U"Attribute \"ny\" not defined for this object", theProgram -> lexan [ilexan]. position);
 					} else {
 						newparse (NUMBER_);
 						parsenumber (thy v_getNy ());
@@ -1344,7 +1345,7 @@ static void parsePowerFactor () {
 					}
 				case DX_:
 					if (! thy v_hasGetDx ()) {
-						formulaError (U"Attribute \"dx\" not defined for this object", lexan [ilexan]. position);
+						formulaError (U"Attribute \"dx\" not defined for this object", theProgram -> lexan [ilexan]. position);
 					} else {
 						newparse (NUMBER_);
 						parsenumber (thy v_getDx ());
@@ -1352,7 +1353,7 @@ static void parsePowerFactor () {
 					}
 				case DY_:
 					if (! thy v_hasGetDy ()) {
-						formulaError (U"Attribute \"dy\" not defined for this object", lexan [ilexan]. position);
+						formulaError (U"Attribute \"dy\" not defined for this object", theProgram -> lexan [ilexan]. position);
 					} else {
 						newparse (NUMBER_);
 						parsenumber (thy v_getDy ());
@@ -1360,7 +1361,7 @@ static void parsePowerFactor () {
 					}
 				case NCOL_:
 					if (! thy v_hasGetNcol ()) {
-						formulaError (U"Attribute \"ncol\" not defined for this object", lexan [ilexan]. position);
+						formulaError (U"Attribute \"ncol\" not defined for this object", theProgram -> lexan [ilexan]. position);
 					} else {
 						newparse (NUMBER_);
 						parsenumber (thy v_getNcol ());
@@ -1368,7 +1369,7 @@ static void parsePowerFactor () {
 					}
 				case NROW_:
 					if (! thy v_hasGetNrow ()) {
-						formulaError (U"Attribute \"nrow\" not defined for this object", lexan [ilexan]. position);
+						formulaError (U"Attribute \"nrow\" not defined for this object", theProgram -> lexan [ilexan]. position);
 					} else {
 						newparse (NUMBER_);
 						parsenumber (thy v_getNrow ());
@@ -1376,59 +1377,59 @@ static void parsePowerFactor () {
 					}
 				case ROW_STR_:
 					if (! thy v_hasGetRowStr ()) {
-						formulaError (U"Attribute \"row$\" not defined for this object", lexan [ilexan]. position);
+						formulaError (U"Attribute \"row$\" not defined for this object", theProgram -> lexan [ilexan]. position);
 					} else {
 						fit (OPENING_BRACKET_);
 						parseExpression ();
 						newparse (ROW_STR_);
-						parse [iparse]. content.object = thee;
+						theProgram -> parse [iparse]. content.object = thee;
 						fit (CLOSING_BRACKET_);
 						return;
 					}
 				case COL_STR_:
 					if (! thy v_hasGetColStr ()) {
-						formulaError (U"Attribute \"col$\" not defined for this object", lexan [ilexan]. position);
+						formulaError (U"Attribute \"col$\" not defined for this object", theProgram -> lexan [ilexan]. position);
 					} else {
 						fit (OPENING_BRACKET_);
 						parseExpression ();
 						newparse (COL_STR_);
-						parse [iparse]. content.object = thee;
+						theProgram -> parse [iparse]. content.object = thee;
 						fit (CLOSING_BRACKET_);
 						return;
 					}
-				default: formulaError (U"Unknown attribute.", lexan [ilexan]. position);
+				default: formulaError (U"Unknown attribute.", theProgram -> lexan [ilexan]. position);
 			}
 		} else {
-			formulaError (U"After a name of a matrix there should be \"(\", \"[\", or \".\"", lexan [ilexan]. position);
+			formulaError (U"After a name of a matrix there should be \"(\", \"[\", or \".\"", theProgram -> lexan [ilexan]. position);
 		}
 		return;
 	}
 
 	if (symbol == MATRIX_STR_) {
-		Daata thee = lexan [ilexan]. content.object;
+		Daata thee = theProgram -> lexan [ilexan]. content.object;
 		Melder_assert (thee != nullptr);
 		symbol = newread;
 		if (symbol == OPENING_BRACKET_) {
 			if (newread == CLOSING_BRACKET_) {
 				newparse (MATRIX0_STR_);
-				parse [iparse]. content.object = thee;
+				theProgram -> parse [iparse]. content.object = thee;
 			} else {
 				oldread;
 				parseExpression ();
 				if (newread == COMMA_) {
 					parseExpression ();
 					newparse (MATRIX2_STR_);
-					parse [iparse]. content.object = thee;
+					theProgram -> parse [iparse]. content.object = thee;
 					fit (CLOSING_BRACKET_);
 				} else {
 					oldread;
 					newparse (MATRIX1_STR_);
-					parse [iparse]. content.object = thee;
+					theProgram -> parse [iparse]. content.object = thee;
 					fit (CLOSING_BRACKET_);
 				}
 			}
 		} else {
-			formulaError (U"After a name of a matrix$ there should be \"[\"", lexan [ilexan]. position);
+			formulaError (U"After a name of a matrix$ there should be \"[\"", theProgram -> lexan [ilexan]. position);
 		}
 		return;
 	}
@@ -1512,7 +1513,7 @@ static void parsePowerFactor () {
 	}
 
 	if (symbol == CALL_) {
-		char32 *procedureName = lexan [ilexan]. content.string;   // reference copy!
+		char32 *procedureName = theProgram -> lexan [ilexan]. content.string;   // reference copy!
 		int n = 0;
 		bool isParenthesis = fitArguments ();
 		if (newread != CLOSING_PARENTHESIS_) {
@@ -1528,7 +1529,7 @@ static void parsePowerFactor () {
 		}
 		newparse (NUMBER_); parsenumber (n);
 		newparse (CALL_);
-		parse [iparse]. content.string = procedureName;
+		theProgram -> parse [iparse]. content.string = procedureName;
 		return;
 	}
 
@@ -1573,7 +1574,7 @@ static void parsePowerFactor () {
 			if (isParenthesis) fit (CLOSING_PARENTHESIS_);
 		} else {
 			oldread;   // needed for retry if we are going to be in a string comparison?
-			formulaError (U"Function expected", lexan [ilexan + 1]. position);
+			formulaError (U"Function expected", theProgram -> lexan [ilexan + 1]. position);
 		}
 		newparse (symbol);
 		return;
@@ -1581,20 +1582,20 @@ static void parsePowerFactor () {
 
 	if (symbol >= LOW_RANGE_FUNCTION && symbol <= HIGH_RANGE_FUNCTION) {
 		if (symbol == SUM_OVER_) {
-			//theOptimize = 1;
+			//theProgram -> optimize = 1;
 			newparse (NUMBER_); parsenumber (0.0);   // initialize the sum
             bool isParenthesis = fitArguments ();
 			int symbol2 = newread;
 			if (symbol2 == NUMERIC_VARIABLE_) {   // an existing variable
 				newparse (VARIABLE_REFERENCE_);
-				InterpreterVariable loopVariable = lexan [ilexan]. content.variable;
-				parse [iparse]. content.variable = loopVariable;
+				InterpreterVariable loopVariable = theProgram -> lexan [ilexan]. content.variable;
+				theProgram -> parse [iparse]. content.variable = loopVariable;
 			} else if (symbol2 == VARIABLE_NAME_) {   // a new variable
-				InterpreterVariable loopVariable = Interpreter_lookUpVariable (theInterpreter, lexan [ilexan]. content.string);
+				InterpreterVariable loopVariable = Interpreter_lookUpVariable (theProgram -> interpreter, theProgram -> lexan [ilexan]. content.string);
 				newparse (VARIABLE_REFERENCE_);
-				parse [iparse]. content.variable = loopVariable;
+				theProgram -> parse [iparse]. content.variable = loopVariable;
 			} else {
-				formulaError (U"Numeric variable expected", lexan [ilexan]. position);
+				formulaError (U"Numeric variable expected", theProgram -> lexan [ilexan]. position);
 			}
 			// now on stack: sum, loop variable
 			if (newread == FROM_) {
@@ -1632,16 +1633,16 @@ static void parsePowerFactor () {
 	}
 
 	oldread;   // needed for retry if we are going to be in a string comparison
-	formulaError (U"Symbol misplaced", lexan [ilexan + 1]. position);
+	formulaError (U"Symbol misplaced", theProgram -> lexan [ilexan + 1]. position);
 }
 
 static void parseFactor ();
 
 static void parsePowerFactors () {
 	if (newread == POWER_) {
-		if (ilexan > 2 && lexan [ilexan - 2]. symbol == MINUS_ && lexan [ilexan - 1]. symbol == NUMBER_) {
+		if (ilexan > 2 && theProgram -> lexan [ilexan - 2]. symbol == MINUS_ && theProgram -> lexan [ilexan - 1]. symbol == NUMBER_) {
 			oldread;
-			formulaError (U"Expressions like -3^4 are ambiguous; use (-3)^4 or -(3^4) or -(3)^4", lexan [ilexan + 1]. position);
+			formulaError (U"Expressions like -3^4 are ambiguous; use (-3)^4 or -(3^4) or -(3)^4", theProgram -> lexan [ilexan + 1]. position);
 		}
 		parseFactor ();   // like a^-b
 		newparse (POWER_);
@@ -1767,23 +1768,23 @@ static void parseExpression () {
 
 static void Formula_parseExpression () {
 	ilabel = ilexan = iparse = 0;
-	if (lexan [1]. symbol == END_) Melder_throw (U"Empty formula.");
+	if (theProgram -> lexan [1]. symbol == END_) Melder_throw (U"Empty formula.");
 	parseExpression ();
 	fit (END_);
 	newparse (END_);
-	numberOfInstructions = iparse;
+	theProgram -> numberOfInstructions = iparse;
 }
 
 static void shift (int begin, int distance) {
-	numberOfInstructions -= distance;
-	for (int j = begin; j <= numberOfInstructions; j ++)
-		parse [j] = parse [j + distance];
+	theProgram -> numberOfInstructions -= distance;
+	for (int j = begin; j <= theProgram -> numberOfInstructions; j ++)
+		theProgram -> parse [j] = theProgram -> parse [j + distance];
 }
 
 static int findLabel (int label) {
-	int result = numberOfInstructions;
-	while (parse [result]. symbol != LABEL_ ||
-			 parse [result]. content.label != label)
+	int result = theProgram -> numberOfInstructions;
+	while (theProgram -> parse [result]. symbol != LABEL_ ||
+			 theProgram -> parse [result]. content.label != label)
 		result --;
 	return result;
 }
@@ -1801,26 +1802,26 @@ static void Formula_optimizeFlow ()
 	int i, j, volg;
 	for (;;) {
 		bool improved = false;
-		for (i = 1; i <= numberOfInstructions; i ++)
+		for (i = 1; i <= theProgram -> numberOfInstructions; i ++)
 		{
 
 /* Optimalisatie 1: */
 /*    true   goto x  ->  goto y  /  __  ...  label x  iftrue y    */
 /*    false  goto x  ->  goto y  /  __  ...  label x  iffalse y   */
 
-			if ((parse [i]. symbol == TRUE_ &&
-				 parse [i + 1]. symbol == GOTO_ &&
-				 parse [volg = findLabel (parse [i + 1]. content.label) + 1]
+			if ((theProgram -> parse [i]. symbol == TRUE_ &&
+				 theProgram -> parse [i + 1]. symbol == GOTO_ &&
+				 theProgram -> parse [volg = findLabel (theProgram -> parse [i + 1]. content.label) + 1]
 							. symbol == IFTRUE_)
 				 ||
-				 (parse [i]. symbol == FALSE_ &&
-				  parse [i + 1]. symbol == GOTO_ &&
-				  parse [volg = findLabel (parse [i + 1]. content.label) + 1]
+				 (theProgram -> parse [i]. symbol == FALSE_ &&
+				  theProgram -> parse [i + 1]. symbol == GOTO_ &&
+				  theProgram -> parse [volg = findLabel (theProgram -> parse [i + 1]. content.label) + 1]
 							. symbol == IFFALSE_))
 			{
 				 improved = true;
-				 parse [i]. symbol = GOTO_;
-				 parse [i]. content.label = parse [volg]. content.label;
+				 theProgram -> parse [i]. symbol = GOTO_;
+				 theProgram -> parse [i]. content.label = theProgram -> parse [volg]. content.label;
 				 shift (i + 1, 1);
 			}
 
@@ -1829,71 +1830,71 @@ static void Formula_optimizeFlow ()
 /*          goto z  ...  label x  iffalse y  label z   */
 /*    en analoog met false en iftrue. */
 
-			if ((parse [i]. symbol == TRUE_ &&
-				 parse [i + 1]. symbol == GOTO_ &&
-				 parse [volg = findLabel (parse [i + 1]. content.label) + 1]
+			if ((theProgram -> parse [i]. symbol == TRUE_ &&
+				 theProgram -> parse [i + 1]. symbol == GOTO_ &&
+				 theProgram -> parse [volg = findLabel (theProgram -> parse [i + 1]. content.label) + 1]
 							. symbol == IFFALSE_)
 				 ||
-				 (parse [i]. symbol == FALSE_ &&
-				  parse [i + 1]. symbol == GOTO_ &&
-				  parse [volg = findLabel (parse [i + 1]. content.label) + 1]
+				 (theProgram -> parse [i]. symbol == FALSE_ &&
+				  theProgram -> parse [i + 1]. symbol == GOTO_ &&
+				  theProgram -> parse [volg = findLabel (theProgram -> parse [i + 1]. content.label) + 1]
 							. symbol == IFTRUE_))
 			{
 				improved = true;
-				parse [i]. symbol = GOTO_;
-				parse [i]. content.label = newlabel;
+				theProgram -> parse [i]. symbol = GOTO_;
+				theProgram -> parse [i]. content.label = newlabel;
 				for (j = i + 1; j < volg; j ++)
-					parse [j] = parse [j + 1];
-				parse [volg]. symbol = LABEL_;
-				parse [volg]. content.label = ilabel;
+					theProgram -> parse [j] = theProgram -> parse [j + 1];
+				theProgram -> parse [volg]. symbol = LABEL_;
+				theProgram -> parse [volg]. content.label = ilabel;
 			}
 
 /* Optimalisatie 3a: */
 /*    iftrue x  goto y  label x  ->  iffalse y  label x   */
 
-			if (parse [i]. symbol == IFTRUE_ &&
-				 parse [i + 1]. symbol == GOTO_ &&
-				 parse [i + 2]. symbol == LABEL_ &&
-				 parse [i]. content.label == parse [i + 2]. content.label)
+			if (theProgram -> parse [i]. symbol == IFTRUE_ &&
+				 theProgram -> parse [i + 1]. symbol == GOTO_ &&
+				 theProgram -> parse [i + 2]. symbol == LABEL_ &&
+				 theProgram -> parse [i]. content.label == theProgram -> parse [i + 2]. content.label)
 			{
 				improved = true;
-				parse [i]. symbol = IFFALSE_;
-				parse [i]. content.label = parse [i + 1]. content.label;
+				theProgram -> parse [i]. symbol = IFFALSE_;
+				theProgram -> parse [i]. content.label = theProgram -> parse [i + 1]. content.label;
 				shift (i + 1, 1);
 			}
 
 /* Optimalisatie 3b: */
 /*    iffalse x  goto y  label x  ->  iftrue y  label x   */
 
-			if (parse [i]. symbol == IFFALSE_ &&
-				 parse [i + 1]. symbol == GOTO_ &&
-				 parse [i + 2]. symbol == LABEL_ &&
-				 parse [i]. content.label == parse [i + 2]. content.label)
+			if (theProgram -> parse [i]. symbol == IFFALSE_ &&
+				 theProgram -> parse [i + 1]. symbol == GOTO_ &&
+				 theProgram -> parse [i + 2]. symbol == LABEL_ &&
+				 theProgram -> parse [i]. content.label == theProgram -> parse [i + 2]. content.label)
 			{
 				improved = true;
-				parse [i]. symbol = IFTRUE_;
-				parse [i]. content.label = parse [i + 1]. content.label;
+				theProgram -> parse [i]. symbol = IFTRUE_;
+				theProgram -> parse [i]. content.label = theProgram -> parse [i + 1]. content.label;
 				shift (i + 1, 1);
 			}
 
 /* Optimalisatie 4: */
 /*    verwijder onbereikbare kode: na een GOTO_ hoort een LABEL_. */
 
-			if (parse [i]. symbol == GOTO_ &&
-				 parse [i + 1]. symbol != LABEL_)
+			if (theProgram -> parse [i]. symbol == GOTO_ &&
+				 theProgram -> parse [i + 1]. symbol != LABEL_)
 			{
 				improved = true;
 				j = i + 2;
-				while (parse [j]. symbol != LABEL_) j ++;
+				while (theProgram -> parse [j]. symbol != LABEL_) j ++;
 				shift (i + 1, j - i - 1);
 			}
 
 /* Optimalisatie 5: */
 /*    goto x  ->  0  /  __  label x   */
 
-			if (parse [i]. symbol == GOTO_ &&
-				 parse [i]. symbol == LABEL_ &&
-				 parse [i]. content.label == parse [i + 1]. content.label)
+			if (theProgram -> parse [i]. symbol == GOTO_ &&
+				 theProgram -> parse [i]. symbol == LABEL_ &&
+				 theProgram -> parse [i]. content.label == theProgram -> parse [i + 1]. content.label)
 			{
 				improved = true;
 				shift (i, 1);
@@ -1903,8 +1904,8 @@ static void Formula_optimizeFlow ()
 /*    true   iffalse x  ->  0  */
 /*    false  iftrue x   ->  0  */
 
-			if ((parse [i]. symbol == TRUE_ && parse [i + 1]. symbol == IFFALSE_)
-				|| (parse [i]. symbol == FALSE_ && parse [i + 1]. symbol == IFTRUE_))
+			if ((theProgram -> parse [i]. symbol == TRUE_ && theProgram -> parse [i + 1]. symbol == IFFALSE_)
+				|| (theProgram -> parse [i]. symbol == FALSE_ && theProgram -> parse [i + 1]. symbol == IFTRUE_))
 			{
 				improved = true;
 				shift (i, 2);
@@ -1914,12 +1915,12 @@ static void Formula_optimizeFlow ()
 /*    true   iftrue x   ->  goto x    */
 /*    false  iffalse x  ->  goto x    */
 
-			if ((parse [i]. symbol == TRUE_ && parse [i + 1]. symbol == IFTRUE_)
-				|| (parse [i]. symbol == FALSE_ && parse [i + 1]. symbol == IFFALSE_))
+			if ((theProgram -> parse [i]. symbol == TRUE_ && theProgram -> parse [i + 1]. symbol == IFTRUE_)
+				|| (theProgram -> parse [i]. symbol == FALSE_ && theProgram -> parse [i + 1]. symbol == IFFALSE_))
 			{
 				improved = true;
-				parse [i]. symbol = GOTO_;
-				parse [i]. content.label = parse [i + 1]. content.label;
+				theProgram -> parse [i]. symbol = GOTO_;
+				theProgram -> parse [i]. content.label = theProgram -> parse [i + 1]. content.label;
 				shift (i + 1, 1);
 			}
 
@@ -1927,32 +1928,32 @@ static void Formula_optimizeFlow ()
 /*    iftrue x   ->  iftrue y   /  __  ...  label x  goto y   */
 /*    iffalse x  ->  iffalse y  /  __  ...  label x  goto y   */
 
-			if ((parse [i]. symbol == IFTRUE_ || parse [i]. symbol == IFFALSE_)
-				&& parse [volg = findLabel (parse [i]. content.label) + 1]. symbol == GOTO_)
+			if ((theProgram -> parse [i]. symbol == IFTRUE_ || theProgram -> parse [i]. symbol == IFFALSE_)
+				&& theProgram -> parse [volg = findLabel (theProgram -> parse [i]. content.label) + 1]. symbol == GOTO_)
 			{
 				improved = true;
-				parse [i]. content.label = parse [volg]. content.label;
+				theProgram -> parse [i]. content.label = theProgram -> parse [volg]. content.label;
 			}
 
 /* Optimalisatie 9a: */
 /*    not  iftrue x  ->  iffalse x   */
 
-			if (parse [i]. symbol == NOT_ && parse [i + 1]. symbol == IFTRUE_)
+			if (theProgram -> parse [i]. symbol == NOT_ && theProgram -> parse [i + 1]. symbol == IFTRUE_)
 			{
 				improved = true;
-				parse [i]. symbol = IFFALSE_;
-				parse [i]. content.label = parse [i + 1]. content.label;
+				theProgram -> parse [i]. symbol = IFFALSE_;
+				theProgram -> parse [i]. content.label = theProgram -> parse [i + 1]. content.label;
 				shift (i + 1, 1);
 			}
 
 /* Optimalisatie 9b: */
 /*    not  iffalse x  ->  iftrue x   */
 
-			if (parse [i]. symbol == NOT_ && parse [i + 1]. symbol == IFFALSE_)
+			if (theProgram -> parse [i]. symbol == NOT_ && theProgram -> parse [i + 1]. symbol == IFFALSE_)
 			{
 				improved = true;
-				parse [i]. symbol = IFTRUE_;
-				parse [i]. content.label = parse [i + 1]. content.label;
+				theProgram -> parse [i]. symbol = IFTRUE_;
+				theProgram -> parse [i]. content.label = theProgram -> parse [i + 1]. content.label;
 				shift (i + 1, 1);
 			}
 
@@ -1964,14 +1965,14 @@ static void Formula_optimizeFlow ()
 
 		/* Verwijder labels waar niet naar verwezen wordt. */
 
-		for (i = 1; i <= numberOfInstructions; i ++)
-			if (parse [i]. symbol == LABEL_)
+		for (i = 1; i <= theProgram -> numberOfInstructions; i ++)
+			if (theProgram -> parse [i]. symbol == LABEL_)
 			{
 				int gevonden = 0;
-				for (j = 1; j <= numberOfInstructions; j ++)
-					if ((parse [j]. symbol == GOTO_ || parse [j]. symbol == IFFALSE_ || parse [j]. symbol == IFTRUE_
-						|| parse [j]. symbol == INCREMENT_GREATER_GOTO_)
-						&& parse [i]. content.label == parse [j]. content.label)
+				for (j = 1; j <= theProgram -> numberOfInstructions; j ++)
+					if ((theProgram -> parse [j]. symbol == GOTO_ || theProgram -> parse [j]. symbol == IFFALSE_ || theProgram -> parse [j]. symbol == IFTRUE_
+						|| theProgram -> parse [j]. symbol == INCREMENT_GREATER_GOTO_)
+						&& theProgram -> parse [i]. content.label == theProgram -> parse [j]. content.label)
 						gevonden = 1;
 				if (! gevonden)
 				{
@@ -1993,7 +1994,7 @@ static int praat_findObjectById (integer id) {
 static int praat_findObjectByName (conststring32 name) {
 	int IOBJECT;
 	if (*name >= U'A' && *name <= U'Z') {
-		static MelderString buffer;
+		static thread_local MelderString buffer;
 		MelderString_copy (& buffer, name);
 		char32 *spaceLocation = str32chr (buffer.string, U' ');
 		if (! spaceLocation)
@@ -2018,54 +2019,54 @@ static int praat_findObjectByName (conststring32 name) {
 static void Formula_evaluateConstants () {
 	for (;;) {
 		bool improved = false;
-		for (int i = 1; i <= numberOfInstructions; i ++) {
+		for (int i = 1; i <= theProgram -> numberOfInstructions; i ++) {
 			int gain = 0;
-			if (parse [i]. symbol == NUMBER_) {
-				if (parse [i]. content.number == 2.0 && parse [i + 1]. symbol == POWER_)
-					{ gain = 1; parse [i]. symbol = SQR_; }
-				else if (parse [i + 1]. symbol == MINUS_)
-					{ gain = 1; parse [i]. content.number = - parse [i]. content.number; }
-				else if (parse [i + 1]. symbol == SQR_)
-					{ gain = 1; parse [i]. content.number *= parse [i]. content.number; }
-				else if (parse [i + 1]. symbol == NUMBER_) {
-					if (parse [i + 2]. symbol == ADD_)
-						{ gain = 2; parse [i]. content.number += parse [i + 1]. content.number; }
-					else if (parse [i + 2]. symbol == SUB_)
-						{ gain = 2; parse [i]. content.number -= parse [i + 1]. content.number; }
-					else if (parse [i + 2]. symbol == MUL_)
-						{ gain = 2; parse [i]. content.number *= parse [i + 1]. content.number; }
-					else if (parse [i + 2]. symbol == RDIV_)
-						{ gain = 2; parse [i]. content.number /= parse [i + 1]. content.number; }
-				} else if (parse [i + 1]. symbol == TO_OBJECT_) {
-					parse [i]. symbol = OBJECT_;
-					int IOBJECT = praat_findObjectById (Melder_iround (parse [i]. content.number));
-					parse [i]. content.object = OBJECT;
+			if (theProgram -> parse [i]. symbol == NUMBER_) {
+				if (theProgram -> parse [i]. content.number == 2.0 && theProgram -> parse [i + 1]. symbol == POWER_)
+					{ gain = 1; theProgram -> parse [i]. symbol = SQR_; }
+				else if (theProgram -> parse [i + 1]. symbol == MINUS_)
+					{ gain = 1; theProgram -> parse [i]. content.number = - theProgram -> parse [i]. content.number; }
+				else if (theProgram -> parse [i + 1]. symbol == SQR_)
+					{ gain = 1; theProgram -> parse [i]. content.number *= theProgram -> parse [i]. content.number; }
+				else if (theProgram -> parse [i + 1]. symbol == NUMBER_) {
+					if (theProgram -> parse [i + 2]. symbol == ADD_)
+						{ gain = 2; theProgram -> parse [i]. content.number += theProgram -> parse [i + 1]. content.number; }
+					else if (theProgram -> parse [i + 2]. symbol == SUB_)
+						{ gain = 2; theProgram -> parse [i]. content.number -= theProgram -> parse [i + 1]. content.number; }
+					else if (theProgram -> parse [i + 2]. symbol == MUL_)
+						{ gain = 2; theProgram -> parse [i]. content.number *= theProgram -> parse [i + 1]. content.number; }
+					else if (theProgram -> parse [i + 2]. symbol == RDIV_)
+						{ gain = 2; theProgram -> parse [i]. content.number /= theProgram -> parse [i + 1]. content.number; }
+				} else if (theProgram -> parse [i + 1]. symbol == TO_OBJECT_) {
+					theProgram -> parse [i]. symbol = OBJECT_;
+					int IOBJECT = praat_findObjectById (Melder_iround (theProgram -> parse [i]. content.number));
+					theProgram -> parse [i]. content.object = OBJECT;
 					gain = 1;
 				}
-			} else if (parse [i]. symbol == STRING_) {
-				if (parse [i + 1]. symbol == TO_OBJECT_) {
-					parse [i]. symbol = OBJECT_;
-					int IOBJECT = praat_findObjectByName (parse [i]. content.string);
-					parse [i]. content.object = OBJECT;
+			} else if (theProgram -> parse [i]. symbol == STRING_) {
+				if (theProgram -> parse [i + 1]. symbol == TO_OBJECT_) {
+					theProgram -> parse [i]. symbol = OBJECT_;
+					int IOBJECT = praat_findObjectByName (theProgram -> parse [i]. content.string);
+					theProgram -> parse [i]. content.object = OBJECT;
 					gain = 1;
 				}
-			} else if (parse [i]. symbol == NUMERIC_VARIABLE_) {
-				parse [i]. symbol = NUMBER_;
-				parse [i]. content.number = parse [i]. content.variable -> numericValue;
+			} else if (theProgram -> parse [i]. symbol == NUMERIC_VARIABLE_) {
+				theProgram -> parse [i]. symbol = NUMBER_;
+				theProgram -> parse [i]. content.number = theProgram -> parse [i]. content.variable -> numericValue;
 				gain = 0;
 				improved = true;
-			} else if (parse [i]. symbol == STRING_VARIABLE_) {
-				parse [i]. symbol = STRING_;
-				parse [i]. content.string = parse [i]. content.variable -> stringValue.get();   // again a reference copy (lexan is still the owner)
+			} else if (theProgram -> parse [i]. symbol == STRING_VARIABLE_) {
+				theProgram -> parse [i]. symbol = STRING_;
+				theProgram -> parse [i]. content.string = theProgram -> parse [i]. content.variable -> stringValue.get();   // again a reference copy (lexan is still the owner)
 				gain = 0;
 				improved = true;
 			#if 0
-			} else if (parse [i]. symbol == ROW_) {
-				if (parse [i + 1]. symbol == COL_ && parse [i + 2]. symbol == SELFMATRIX2_)
-					{ gain = 2; parse [i]. symbol = SELF0_; }   // TODO: SELF0_ may not have the same restrictions as SELFMATRIX2_
-			} else if (parse [i]. symbol == COL_) {
-				if (parse [i + 1]. symbol == SELFMATRIX1_)
-					{ gain = 1; parse [i]. symbol = SELF0_; }
+			} else if (theProgram -> parse [i]. symbol == ROW_) {
+				if (theProgram -> parse [i + 1]. symbol == COL_ && theProgram -> parse [i + 2]. symbol == SELFMATRIX2_)
+					{ gain = 2; theProgram -> parse [i]. symbol = SELF0_; }   // TODO: SELF0_ may not have the same restrictions as SELFMATRIX2_
+			} else if (theProgram -> parse [i]. symbol == COL_) {
+				if (theProgram -> parse [i + 1]. symbol == SELFMATRIX1_)
+					{ gain = 1; theProgram -> parse [i]. symbol = SELF0_; }
 			#endif
 			}
 			if (gain > 0) {
@@ -2081,13 +2082,13 @@ static void Formula_removeLabels () {
 	/*
 	 * First translate symbolic labels (< 0) into instructions locations (> 0).
 	 */
-	for (int i = 1; i <= numberOfInstructions; i ++) {
-		int symboli = parse [i]. symbol;
+	for (int i = 1; i <= theProgram -> numberOfInstructions; i ++) {
+		int symboli = theProgram -> parse [i]. symbol;
 		if (symboli == GOTO_ || symboli == IFTRUE_ || symboli == IFFALSE_ || symboli == INCREMENT_GREATER_GOTO_) {
-			int label = parse [i]. content.label;
-			for (int j = 1; j <= numberOfInstructions; j ++) {
-				if (parse [j]. symbol == LABEL_ && parse [j]. content.label == label) {
-					parse [i]. content.label = j;
+			int label = theProgram -> parse [i]. content.label;
+			for (int j = 1; j <= theProgram -> numberOfInstructions; j ++) {
+				if (theProgram -> parse [j]. symbol == LABEL_ && theProgram -> parse [j]. content.label == label) {
+					theProgram -> parse [i]. content.label = j;
 				}
 			}
 		}
@@ -2096,23 +2097,23 @@ static void Formula_removeLabels () {
 		Then remove the labels,
 		which have become superfluous.
 	*/
-	if (theOptimize) {
+	if (theProgram -> optimize) {
 		int i = 1;
-		while (i <= numberOfInstructions) {
-			int symboli = parse [i]. symbol;
+		while (i <= theProgram -> numberOfInstructions) {
+			int symboli = theProgram -> parse [i]. symbol;
 			if (symboli == LABEL_) {
 				shift (i, 1);   // remove one label
-				for (int j = 1; j <= numberOfInstructions; j ++) {
-					int symbolj = parse [j]. symbol;
-					if ((symbolj == GOTO_ || symbolj == IFTRUE_ || symbolj == IFFALSE_ || symbolj == INCREMENT_GREATER_GOTO_) && parse [j]. content.label > i)
-						parse [j]. content.label --;  /* Pas een label aan. */
+				for (int j = 1; j <= theProgram -> numberOfInstructions; j ++) {
+					int symbolj = theProgram -> parse [j]. symbol;
+					if ((symbolj == GOTO_ || symbolj == IFTRUE_ || symbolj == IFFALSE_ || symbolj == INCREMENT_GREATER_GOTO_) && theProgram -> parse [j]. content.label > i)
+						theProgram -> parse [j]. content.label --;  /* Pas een label aan. */
 				}
 				i --;   // voorkom ophogen i (overbodig?)
 			}
 			i ++;
 		}
 	}
-	numberOfInstructions --;   /* Het END_-symbol hoeft niet geinterpreteerd. */
+	theProgram -> numberOfInstructions --;   /* Het END_-symbol hoeft niet geinterpreteerd. */
 }
 
 #include <inttypes.h>
@@ -2153,59 +2154,241 @@ static void Formula_print (FormulaInstruction f) {
 	} while (symbol != END_);
 }
 
-void Formula_compile (Interpreter interpreter, Daata data, conststring32 expression, int expressionType, bool optimize) {
-	theInterpreter = interpreter;
-	if (! theInterpreter) {
-		if (! theLocalInterpreter)
-			theLocalInterpreter = Interpreter_create (nullptr, nullptr);
-		theInterpreter = theLocalInterpreter.get();
-		theInterpreter -> variablesMap. clear ();
-	}
-	theSource = data;
-	theExpression = expression;
-	theExpressionType [theLevel] = expressionType;
-	theOptimize = optimize;
-	if (! lexan) {
-		lexan = Melder_calloc_f (structFormulaInstruction, Formula_MAXIMUM_STACK_SIZE);
-		lexan [Formula_MAXIMUM_STACK_SIZE - 1]. symbol = END_;   // make sure that cleaning up always terminates
-	}
-	if (! parse)
-		parse = Melder_calloc_f (structFormulaInstruction, Formula_MAXIMUM_STACK_SIZE);
-
+static void FormulaProgram_freeStrings (FormulaProgram me) {
 	/*
-		Clean up strings from the previous call.
 		These strings are in a union, that's why this cannot be done later, when a new string is created.
 	*/
-	if (numberOfStringConstants) {
-		ilexan = 1;
-		for (;;) {
-			int symbol = lexan [ilexan]. symbol;
+	if (my numberOfStringConstants) {
+		for (int i = 1; ; i ++) {
+			const int symbol = my lexan [i]. symbol;
 			if (symbol == STRING_ ||
 				symbol == VARIABLE_NAME_ ||
 				symbol == INDEXED_NUMERIC_VARIABLE_ ||
 				symbol == INDEXED_STRING_VARIABLE_ ||
 				symbol == CALL_
 			) {
-				Melder_free (lexan [ilexan]. content.string);
+				Melder_free (my lexan [i]. content.string);
 			}
 			else if (symbol == END_) break;   // either the end of a formula, or the end of lexan
-			ilexan ++;
 		}
-		numberOfStringConstants = 0;
+		my numberOfStringConstants = 0;
+	}
+}
+
+Thing_implement (FormulaProgram, Thing, 0);
+
+void structFormulaProgram :: v_destroy () noexcept {
+	if (our lexan)
+		FormulaProgram_freeStrings (this);
+	Melder_free (our lexan);
+	Melder_free (our parse);
+	FormulaProgram_Parent :: v_destroy ();
+}
+
+/*
+	The number of rows of cells that FormulaProgram_runCells () needs in order to compute this program,
+	i.e. the maximum height of the stack, or 0 if the program contains other instructions
+	than those that FormulaProgram_runCells () knows about.
+*/
+static int Formula_numberOfRowRegisters () {
+	if (theProgram -> expressionType != kFormula_EXPRESSION_TYPE_NUMERIC)
+		return 0;
+	int height = 0, maximumHeight = 0;
+	for (int i = 1; i <= theProgram -> numberOfInstructions; i ++) {
+		const int symbol = theProgram -> parse [i]. symbol;
+		switch (symbol) {
+			case NUMBER_: case ROW_: case COL_: case X_: case Y_: case SELF0_: case NUMERIC_VARIABLE_:
+				height += 1;
+			break;
+			case ADD_: case SUB_: case MUL_: case RDIV_: case IDIV_: case MOD_: case POWER_:
+				height -= 1;
+			break;
+			case MINUS_: case SQR_: case ABS_: case ROUND_: case FLOOR_: case CEILING_:
+			case SQRT_: case SIN_: case COS_: case TAN_: case ARCSIN_: case ARCCOS_: case ARCTAN_:
+			case EXP_: case SINH_: case COSH_: case TANH_: case LN_: case LOG10_: case LOG2_:
+			break;
+			case END_:
+				return ( height == 1 ? maximumHeight : 0 );
+			default:
+				return 0;
+		}
+		if (height < 1)
+			return 0;
+		maximumHeight = std::max (maximumHeight, height);
+	}
+	return ( height == 1 ? maximumHeight : 0 );
+}
+
+static void Formula_compile_ (Interpreter interpreter, Daata data, conststring32 expression, int expressionType, bool optimize) {
+	theProgram -> interpreter = interpreter;
+	if (! theProgram -> interpreter) {
+		if (! theLocalInterpreter)
+			theLocalInterpreter = Interpreter_create (nullptr, nullptr);
+		theProgram -> interpreter = theLocalInterpreter.get();
+		theProgram -> interpreter -> variablesMap. clear ();
+	}
+	theProgram -> source = data;
+	theExpression = expression;
+	theProgram -> expressionType = expressionType;
+	theProgram -> optimize = optimize;
+	if (! theProgram -> lexan) {
+		theProgram -> lexan = Melder_calloc_f (structFormulaInstruction, Formula_MAXIMUM_STACK_SIZE);
+		theProgram -> lexan [Formula_MAXIMUM_STACK_SIZE - 1]. symbol = END_;   // make sure that cleaning up always terminates
 	}
+	if (! theProgram -> parse)
+		theProgram -> parse = Melder_calloc_f (structFormulaInstruction, Formula_MAXIMUM_STACK_SIZE);
+
+	/*
+		Clean up strings from the previous call.
+	*/
+	FormulaProgram_freeStrings (theProgram);
 
 	Formula_lexan ();
-	if (Melder_debug == 17) Formula_print (lexan);
+	if (Melder_debug == 17) Formula_print (theProgram -> lexan);
 	Formula_parseExpression ();
-	if (Melder_debug == 17) Formula_print (parse);
-	if (theOptimize) {
+	if (Melder_debug == 17) Formula_print (theProgram -> parse);
+	if (theProgram -> optimize) {
 		Formula_optimizeFlow ();
-		if (Melder_debug == 17) Formula_print (parse);
+		if (Melder_debug == 17) Formula_print (theProgram -> parse);
 		Formula_evaluateConstants ();
-		if (Melder_debug == 17) Formula_print (parse);
+		if (Melder_debug == 17) Formula_print (theProgram -> parse);
 	}
 	Formula_removeLabels ();
-	if (Melder_debug == 17) Formula_print (parse);
+	if (Melder_debug == 17) Formula_print (theProgram -> parse);
+	theProgram -> numberOfRowRegisters = Formula_numberOfRowRegisters ();
+}
+
+static void FormulaProgram_compile (FormulaProgram me, Interpreter interpreter, Daata data, conststring32 expression, int expressionType, bool optimize) {
+	const FormulaProgram outerProgram = theProgram;   // compiling can happen while another formula is running on this thread
+	theProgram = me;
+	try {
+		Formula_compile_ (interpreter, data, expression, expressionType, optimize);
+		theProgram = outerProgram;
+	} catch (MelderError) {
+		theProgram = outerProgram;
+		throw;
+	}
+}
+
+autoFormulaProgram FormulaProgram_create (Interpreter interpreter, Daata data, conststring32 expression, int expressionType, bool optimize) {
+	try {
+		autoFormulaProgram me = Thing_new (FormulaProgram);
+		FormulaProgram_compile (me.get(), interpreter, data, expression, expressionType, optimize);
+		return me;
+	} catch (MelderError) {
+		Melder_throw (U"Formula not compiled.");
+	}
+}
+
+static bool symbolIsSafeInParallel (int symbol) {
+	if (symbol < LOW_VALUE)
+		return symbol != CALL_;   // operators and flow
+	if (symbol <= HIGH_VALUE)
+		return true;   // numbers and attributes of the source
+	switch (symbol) {
+		/*
+			Things that change or depend on the state of Praat, of the interpreter or of the random generator,
+			and functions that use static buffers (e.g. Melder_double) or nested formulas.
+		*/
+		case STOPWATCH_: case SLEEP_:
+		case RANDOM_BERNOULLI_: case RANDOM_BERNOULLI_VEC_: case RANDOM_POISSON_:
+		case RANDOM_UNIFORM_: case RANDOM_INTEGER_: case RANDOM_GAUSS_: case RANDOM_BINOMIAL_: case RANDOM_GAMMA_:
+		case EVALUATE_: case EVALUATE_NOCHECK_: case EVALUATE_STR_: case EVALUATE_NOCHECK_STR_:
+		case STRING_STR_:
+		case TRY_TO_WRITE_FILE_: case TRY_TO_APPEND_FILE_: case DELETE_FILE_: case CREATE_FOLDER_: case CREATE_DIRECTORY_:
+		case DATE_STR_: case INFO_STR_: case INDEX_REGEX_: case RINDEX_REGEX_: case REPLACE_REGEX_STR_:
+		case FIXED_STR_: case PERCENT_STR_: case HEXADECIMAL_STR_:
+		case SUM_OVER_: case DECREMENT_AND_ASSIGN_: case INCREMENT_GREATER_GOTO_:
+		case INDEXED_NUMERIC_VARIABLE_: case INDEXED_STRING_VARIABLE_:   // the name of the variable is built with Melder_double
+			return false;
+	}
+	if (symbol >= LOW_FUNCTION_N && symbol <= HIGH_FUNCTION_N) {
+		switch (symbol) {
+			case MIN_: case MAX_: case IMIN_: case IMAX_: case NORM_:
+			case LEFT_STR_: case RIGHT_STR_: case MID_STR_:
+			case ZERO_VEC_: case ZERO_MAT_:
+			case LINEAR_VEC_: case LINEAR_MAT_: case TO_VEC_: case FROM_TO_VEC_: case FROM_TO_BY_VEC_: case FROM_TO_COUNT_VEC_:
+			case BETWEEN_BY_VEC_: case BETWEEN_COUNT_VEC_: case SORT_VEC_:
+			case SIZE_: case NUMBER_OF_ROWS_: case NUMBER_OF_COLUMNS_:
+			case HASH_: case HEX_STR_: case UNHEX_STR_: case EMPTY_STRVEC_: case SPLIT_BY_WHITESPACE_STRVEC_:
+				return true;
+			default:
+				return false;   // object selection, Info window, files, scripts, pause forms, demo window, random vectors...
+		}
+	}
+	return true;
+}
+
+integer FormulaProgram_shrink (FormulaProgram me) {
+	integer lexanLength = 1;
+	while (my lexan [lexanLength]. symbol != END_)
+		lexanLength ++;
+	my lexan = (structFormulaInstruction *) Melder_realloc_f (my lexan, (1 + lexanLength) * (integer) sizeof (structFormulaInstruction));
+	my parse = (structFormulaInstruction *) Melder_realloc_f (my parse, (1 + my numberOfInstructions) * (integer) sizeof (structFormulaInstruction));
+	return (integer) sizeof (structFormulaProgram) + (1 + lexanLength + 1 + my numberOfInstructions) * (integer) sizeof (structFormulaInstruction);
+}
+
+bool FormulaProgram_canBeReused (FormulaProgram me) {
+	for (integer i = 1; ; i ++) {
+		const int symbol = my lexan [i]. symbol;
+		if (symbol == MATRIX_ || symbol == MATRIX_STR_ || symbol == VARIABLE_NAME_)
+			return false;
+		if (symbol == END_)
+			break;
+	}
+	return true;
+}
+
+bool FormulaProgram_canRunInParallel (FormulaProgram me, bool sourceIsWritten) {
+	for (integer i = 1; i <= my numberOfInstructions; i ++) {
+		const structFormulaInstruction& instruction = my parse [i];
+		const int symbol = instruction. symbol;
+		if (! symbolIsSafeInParallel (symbol))
+			return false;
+		if (sourceIsWritten) {
+			/*
+				Cells of the source other than the current one may be written in the same pass,
+				so the result could depend on the order in which the cells are computed.
+			*/
+			switch (symbol) {
+				case SELFMATRIX1_: case SELFMATRIX1_STR_: case SELFMATRIX2_: case SELFMATRIX2_STR_:
+				case SELFFUNCTION1_: case SELFFUNCTION1_STR_: case SELFFUNCTION2_: case SELFFUNCTION2_STR_:
+				case TO_OBJECT_:
+					return false;
+				case OBJECT_: case OBJECT_STR_:
+				case MATRIX0_: case MATRIX0_STR_: case MATRIX1_: case MATRIX1_STR_: case MATRIX2_: case MATRIX2_STR_:
+				case FUNCTION0_: case FUNCTION0_STR_: case FUNCTION1_: case FUNCTION1_STR_: case FUNCTION2_: case FUNCTION2_STR_:
+					if (instruction. content.object == my source)
+						return false;
+			}
+		}
+	}
+	return true;
+}
+
+/*
+	The programs for Formula_compile and Formula_run, one for each nesting level,
+	so that e.g. a script called with runScript from within a formula does not overwrite the formula it is called from.
+*/
+#define MAXIMUM_NUMBER_OF_LEVELS  20
+static thread_local autoFormulaProgram theDefaultPrograms [1 + MAXIMUM_NUMBER_OF_LEVELS];
+static thread_local int theRunDepth;   // the number of formulas that are running on this thread
+
+static FormulaProgram Formula_defaultProgram () {
+	if (theRunDepth >= MAXIMUM_NUMBER_OF_LEVELS)
+		Melder_throw (U"Formulas are nested too deeply.");
+	autoFormulaProgram& program = theDefaultPrograms [1 + theRunDepth];
+	if (! program)
+		program = Thing_new (FormulaProgram);
+	return program.get();
+}
+
+void Formula_compile (Interpreter interpreter, Daata data, conststring32 expression, int expressionType, bool optimize) {
+	FormulaProgram_compile (Formula_defaultProgram (), interpreter, data, expression, expressionType, optimize);
+}
+
+bool Formula_canBeReused () {
+	return FormulaProgram_canBeReused (Formula_defaultProgram ());
 }
 
 /*
@@ -2223,10 +2406,14 @@ conststring32 structStackel :: whichText () {
 		U"???";
 }
 
-static int programPointer;
-
-static Stackel theStack;
-static integer w, wmax;   /* w = stack pointer; */
+/*
+	The state of the virtual machine, which is per thread.
+	A formula that runs within a formula (e.g. from a script called with runScript)
+	gets the part of the stack above everything that the outer formula has used (see autoFormulaRun).
+*/
+static thread_local int programPointer;
+static thread_local Stackel theStack;
+static thread_local integer w, wmax, theStackSize;   /* w = stack pointer; */
 #define pop  & theStack [w --]
 #define topOfStack  & theStack [w]
 inline static void pushNumber (double x) {
@@ -2238,7 +2425,7 @@ inline static void pushNumber (double x) {
 	 * Mac: 3.76 -> 3.20 seconds
 	 */
 	if (++ w > wmax)
-		if (++ wmax > Formula_MAXIMUM_STACK_SIZE)
+		if (++ wmax > theStackSize)
 			Melder_throw (U"Formula: stack overflow. Please simplify your formulas.");
 	Stackel stackel = & theStack [w];
 	stackel -> reset();
@@ -2249,7 +2436,7 @@ inline static void pushNumber (double x) {
 }
 static void pushNumericVector (autoVEC x) {
 	if (++ w > wmax)
-		if (++ wmax > Formula_MAXIMUM_STACK_SIZE)
+		if (++ wmax > theStackSize)
 			Melder_throw (U"Formula: stack overflow. Please simplify your formulas.");
 	Stackel stackel = & theStack [w];
 	stackel -> reset();
@@ -2259,7 +2446,7 @@ static void pushNumericVector (autoVEC x) {
 }
 static void pushNumericVectorReference (VEC x) {
 	if (++ w > wmax)
-		if (++ wmax > Formula_MAXIMUM_STACK_SIZE)
+		if (++ wmax > theStackSize)
 			Melder_throw (U"Formula: stack overflow. Please simplify your formulas.");
 	Stackel stackel = & theStack [w];
 	stackel -> reset();
@@ -2269,7 +2456,7 @@ static void pushNumericVectorReference (VEC x) {
 }
 static void pushNumericMatrix (autoMAT x) {
 	if (++ w > wmax)
-		if (++ wmax > Formula_MAXIMUM_STACK_SIZE)
+		if (++ wmax > theStackSize)
 			Melder_throw (U"Formula: stack overflow. Please simplify your formulas.");
 	Stackel stackel = & theStack [w];
 	stackel -> reset();
@@ -2279,7 +2466,7 @@ static void pushNumericMatrix (autoMAT x) {
 }
 static void pushNumericMatrixReference (MAT x) {
 	if (++ w > wmax)
-		if (++ wmax > Formula_MAXIMUM_STACK_SIZE)
+		if (++ wmax > theStackSize)
 			Melder_throw (U"Formula: stack overflow. Please simplify your formulas.");
 	Stackel stackel = & theStack [w];
 	stackel -> reset();
@@ -2289,7 +2476,7 @@ static void pushNumericMatrixReference (MAT x) {
 }
 static void pushString (autostring32 x) {
 	if (++ w > wmax)
-		if (++ wmax > Formula_MAXIMUM_STACK_SIZE)
+		if (++ wmax > theStackSize)
 			Melder_throw (U"Formula: stack overflow. Please simplify your formulas.");
 	Stackel stackel = & theStack [w];
 	//stackel -> reset();   // incorporated in next statement
@@ -2298,7 +2485,7 @@ static void pushString (autostring32 x) {
 }
 static void pushStringVector (autoSTRVEC x) {
 	if (++ w > wmax)
-		if (++ wmax > Formula_MAXIMUM_STACK_SIZE)
+		if (++ wmax > theStackSize)
 			Melder_throw (U"Formula: stack overflow. Please simplify your formulas.");
 	Stackel stackel = & theStack [w];
 	stackel -> reset();
@@ -2308,7 +2495,7 @@ static void pushStringVector (autoSTRVEC x) {
 }
 static void pushStringVectorReference (STRVEC x) {
 	if (++ w > wmax)
-		if (++ wmax > Formula_MAXIMUM_STACK_SIZE)
+		if (++ wmax > theStackSize)
 			Melder_throw (U"Formula: stack overflow. Please simplify your formulas.");
 	Stackel stackel = & theStack [w];
 	stackel -> reset();
@@ -2318,7 +2505,7 @@ static void pushStringVectorReference (STRVEC x) {
 }
 static void pushObject (Daata object) {
 	if (++ w > wmax)
-		if (++ wmax > Formula_MAXIMUM_STACK_SIZE)
+		if (++ wmax > theStackSize)
 			Melder_throw (U"Formula: stack overflow. Please simplify your formulas.");
 	Stackel stackel = & theStack [w];
 	stackel -> reset();
@@ -2328,7 +2515,7 @@ static void pushObject (Daata object) {
 }
 static void pushVariable (InterpreterVariable var) {
 	if (++ w > wmax)
-		if (++ wmax > Formula_MAXIMUM_STACK_SIZE)
+		if (++ wmax > theStackSize)
 			Melder_throw (U"Formula: stack overflow. Please simplify your formulas.");
 	Stackel stackel = & theStack [w];
 	stackel -> reset();
@@ -3245,7 +3432,7 @@ static void do_function_n_n (double (*f) (double)) {
 	if (x->which == Stackel_NUMBER) {
 		pushNumber (isundef (x->number) ? undefined : f (x->number));
 	} else {
-		Melder_throw (U"The function ", Formula_instructionNames [parse [programPointer]. symbol],
+		Melder_throw (U"The function ", Formula_instructionNames [theProgram -> parse [programPointer]. symbol],
 			U" requires a numeric argument, not ", x->whichText(), U".");
 	}
 }
@@ -3265,7 +3452,7 @@ static void do_functionvec_n_n (double (*f) (double)) {
 			x->owned = true;
 		}
 	} else {
-		Melder_throw (U"The function ", Formula_instructionNames [parse [programPointer]. symbol],
+		Melder_throw (U"The function ", Formula_instructionNames [theProgram -> parse [programPointer]. symbol],
 			U" requires a numeric vector argument, not ", x->whichText(), U".");
 	}
 }
@@ -3292,7 +3479,7 @@ static void do_softmax_VEC () {
 		for (integer i = 1; i <= nelm; i ++)
 			x->numericVector [i] /= (double) sum;
 	} else {
-		Melder_throw (U"The function ", Formula_instructionNames [parse [programPointer]. symbol],
+		Melder_throw (U"The function ", Formula_instructionNames [theProgram -> parse [programPointer]. symbol],
 			U" requires a numeric vector argument, not ", x->whichText(), U".");
 	}
 }
@@ -3321,7 +3508,7 @@ static void do_softmaxPerRow_MAT () {
 				x->numericMatrix [irow] [icol] /= (double) sum;
 		}
 	} else {
-		Melder_throw (U"The function ", Formula_instructionNames [parse [programPointer]. symbol],
+		Melder_throw (U"The function ", Formula_instructionNames [theProgram -> parse [programPointer]. symbol],
 			U" requires a numeric matrix argument, not ", x->whichText(), U".");
 	}
 }
@@ -3592,7 +3779,7 @@ static void do_function_dd_d (double (*f) (double, double)) {
 	if (x->which == Stackel_NUMBER && y->which == Stackel_NUMBER) {
 		pushNumber (isundef (x->number) || isundef (y->number) ? undefined : f (x->number, y->number));
 	} else {
-		Melder_throw (U"The function ", Formula_instructionNames [parse [programPointer]. symbol],
+		Melder_throw (U"The function ", Formula_instructionNames [theProgram -> parse [programPointer]. symbol],
 			U" requires two numeric arguments, not ",
 			x->whichText(), U" and ", y->whichText(), U".");
 	}
@@ -3601,7 +3788,7 @@ static void do_function_VECdd_d (double (*f) (double, double)) {
 	Stackel narg = pop;
 	Melder_assert (narg->which == Stackel_NUMBER);
 	Melder_require (narg->number == 3,
-		U"The function ", Formula_instructionNames [parse [programPointer]. symbol], U" requires three arguments.");
+		U"The function ", Formula_instructionNames [theProgram -> parse [programPointer]. symbol], U" requires three arguments.");
 	Stackel y = pop, x = pop, a = pop;
 	if ((a->which == Stackel_NUMERIC_VECTOR || a->which == Stackel_NUMBER) && x->which == Stackel_NUMBER && y->which == Stackel_NUMBER) {
 		integer numberOfElements = ( a->which == Stackel_NUMBER ? Melder_iround (a->number) : a->numericVector.size );
@@ -3610,7 +3797,7 @@ static void do_function_VECdd_d (double (*f) (double, double)) {
 			newData [ielem] = f (x->number, y->number);
 		pushNumericVector (newData.move());
 	} else {
-		Melder_throw (U"The function ", Formula_instructionNames [parse [programPointer]. symbol],
+		Melder_throw (U"The function ", Formula_instructionNames [theProgram -> parse [programPointer]. symbol],
 			U" requires either three numeric arguments, or one vector argument and two numeric arguments, not ",
 			a->whichText(), U", ", x->whichText(), U" and ", y->whichText(), U".");
 	}
@@ -3629,7 +3816,7 @@ static void do_function_MATdd_d (double (*f) (double, double)) {
 					newData [irow] [icol] = f (x->number, y->number);
 			pushNumericMatrix (newData.move());
 		} else {
-			Melder_throw (U"The function ", Formula_instructionNames [parse [programPointer]. symbol],
+			Melder_throw (U"The function ", Formula_instructionNames [theProgram -> parse [programPointer]. symbol],
 				U" requires one matrix argument and two numeric arguments, not ",
 				model->whichText(), U", ", x->whichText(), U" and ", y->whichText(), U".");
 		}
@@ -3644,19 +3831,19 @@ static void do_function_MATdd_d (double (*f) (double, double)) {
 					newData [irow] [icol] = f (x->number, y->number);
 			pushNumericMatrix (newData.move());
 		} else {
-			Melder_throw (U"The function ", Formula_instructionNames [parse [programPointer]. symbol],
+			Melder_throw (U"The function ", Formula_instructionNames [theProgram -> parse [programPointer]. symbol],
 				U" requires four numeric arguments, not ",
 				nrow->whichText(), U", ", ncol->whichText(), U", ", x->whichText(), U" and ", y->whichText(), U".");
 		}
 	} else
-		Melder_throw (U"The function ", Formula_instructionNames [parse [programPointer]. symbol], U" requires three or four arguments.");
+		Melder_throw (U"The function ", Formula_instructionNames [theProgram -> parse [programPointer]. symbol], U" requires three or four arguments.");
 }
 
 static void do_function_VECll_l (integer (*f) (integer, integer)) {
 	Stackel narg = pop;
 	Melder_assert (narg->which == Stackel_NUMBER);
 	Melder_require (narg-> number == 3,
-		U"The function ", Formula_instructionNames [parse [programPointer]. symbol], U" requires three arguments.");
+		U"The function ", Formula_instructionNames [theProgram -> parse [programPointer]. symbol], U" requires three arguments.");
 	Stackel y = pop, x = pop, a = pop;
 	if ((a->which == Stackel_NUMERIC_VECTOR || a->which == Stackel_NUMBER) && x->which == Stackel_NUMBER) {
 		integer numberOfElements = ( a->which == Stackel_NUMBER ? Melder_iround (a->number) : a->numericVector.size );
@@ -3665,7 +3852,7 @@ static void do_function_VECll_l (integer (*f) (integer, integer)) {
 			newData [ielem] = f (Melder_iround (x->number), Melder_iround (y->number));
 		pushNumericVector (newData.move());
 	} else {
-		Melder_throw (U"The function ", Formula_instructionNames [parse [programPointer]. symbol],
+		Melder_throw (U"The function ", Formula_instructionNames [theProgram -> parse [programPointer]. symbol],
 			U" requires either three numeric arguments, or one vector argument and two numeric arguments, not ",
 			a->whichText(), U", ", x->whichText(), U" and ", y->whichText(), U".");
 	}
@@ -3674,7 +3861,7 @@ static void do_function_MATll_l (integer (*f) (integer, integer)) {
 	Stackel narg = pop;
 	Melder_assert (narg->which == Stackel_NUMBER);
 	Melder_require (narg->number == 3,
-		U"The function ", Formula_instructionNames [parse [programPointer]. symbol], U" requires three arguments.");
+		U"The function ", Formula_instructionNames [theProgram -> parse [programPointer]. symbol], U" requires three arguments.");
 	Stackel y = pop, x = pop, a = pop;
 	if (a->which == Stackel_NUMERIC_MATRIX && x->which == Stackel_NUMBER && y->which == Stackel_NUMBER) {
 		integer numberOfRows = a->numericMatrix.nrow;
@@ -3685,7 +3872,7 @@ static void do_function_MATll_l (integer (*f) (integer, integer)) {
 				newData [irow] [icol] = f (Melder_iround (x->number), Melder_iround (y->number));
 		pushNumericMatrix (newData.move());
 	} else {
-		Melder_throw (U"The function ", Formula_instructionNames [parse [programPointer]. symbol],
+		Melder_throw (U"The function ", Formula_instructionNames [theProgram -> parse [programPointer]. symbol],
 			U" requires one matrix argument and two numeric arguments, not ",
 			a->whichText(), U", ", x->whichText(), U" and ", y->whichText(), U".");
 	}
@@ -3696,7 +3883,7 @@ static void do_function_dl_d (double (*f) (double, integer)) {
 		pushNumber (isundef (x->number) || isundef (y->number) ? undefined :
 			f (x->number, Melder_iround (y->number)));
 	} else {
-		Melder_throw (U"The function ", Formula_instructionNames [parse [programPointer]. symbol],
+		Melder_throw (U"The function ", Formula_instructionNames [theProgram -> parse [programPointer]. symbol],
 			U" requires two numeric arguments, not ",
 			x->whichText(), U" and ", y->whichText(), U".");
 	}
@@ -3707,7 +3894,7 @@ static void do_function_ld_d (double (*f) (integer, double)) {
 		pushNumber (isundef (x->number) || isundef (y->number) ? undefined :
 			f (Melder_iround (x->number), y->number));
 	} else {
-		Melder_throw (U"The function ", Formula_instructionNames [parse [programPointer]. symbol],
+		Melder_throw (U"The function ", Formula_instructionNames [theProgram -> parse [programPointer]. symbol],
 			U" requires two numeric arguments, not ",
 			x->whichText(), U" and ", y->whichText(), U".");
 	}
@@ -3718,7 +3905,7 @@ static void do_function_ll_l (integer (*f) (integer, integer)) {
 		pushNumber (isundef (x->number) || isundef (y->number) ? undefined :
 			f (Melder_iround (x->number), Melder_iround (y->number)));
 	} else {
-		Melder_throw (U"The function ", Formula_instructionNames [parse [programPointer]. symbol],
+		Melder_throw (U"The function ", Formula_instructionNames [theProgram -> parse [programPointer]. symbol],
 			U" requires two numeric arguments, not ",
 			x->whichText(), U" and ", y->whichText(), U".");
 	}
@@ -3751,7 +3938,7 @@ static void do_function_ddd_d (double (*f) (double, double, double)) {
 		pushNumber (isundef (x->number) || isundef (y->number) || isundef (z->number) ? undefined :
 			f (x->number, y->number, z->number));
 	} else {
-		Melder_throw (U"The function ", Formula_instructionNames [parse [programPointer]. symbol],
+		Melder_throw (U"The function ", Formula_instructionNames [theProgram -> parse [programPointer]. symbol],
 			U" requires three numeric arguments, not ", x->whichText(), U", ",
 			y->whichText(), U", and ", z->whichText(), U".");
 	}
@@ -3776,7 +3963,7 @@ static void do_do () {
 		MelderString_appendCharacter (& valueString, 1);   // TODO: check whether this is needed at all, or is just MelderString_empty enough?
 		autoMelderDivertInfo divert (& valueString);
 		autostring32 command2 = Melder_dup (command);   // allow the menu command to reuse the stack (?)
-		Editor_doMenuCommand (praatP. editor, command2.get(), numberOfArguments, & stack [0], nullptr, theInterpreter);
+		Editor_doMenuCommand (praatP. editor, command2.get(), numberOfArguments, & stack [0], nullptr, theProgram -> interpreter);
 		pushNumber (Melder_atof (valueString.string));
 		return;
 	} else if (theCurrentPraatObjects != & theForegroundPraatObjects &&
@@ -3788,8 +3975,8 @@ static void do_do () {
 		MelderString_appendCharacter (& valueString, 1);   // a semaphor to check whether praat_doAction or praat_doMenuCommand wrote anything with MelderInfo
 		autoMelderDivertInfo divert (& valueString);
 		autostring32 command2 = Melder_dup (command);   // allow the menu command to reuse the stack (?)
-		if (! praat_doAction (command2.get(), numberOfArguments, & stack [0], theInterpreter) &&
-		    ! praat_doMenuCommand (command2.get(), numberOfArguments, & stack [0], theInterpreter))
+		if (! praat_doAction (command2.get(), numberOfArguments, & stack [0], theProgram -> interpreter) &&
+		    ! praat_doMenuCommand (command2.get(), numberOfArguments, & stack [0], theProgram -> interpreter))
 		{
 			Melder_throw (U"Command \"", command, U"\" not available for current selection.");
 		}
@@ -3816,7 +4003,7 @@ static void do_evaluate () {
 	Stackel expression = pop;
 	if (expression->which == Stackel_STRING) {
 		double result;
-		Interpreter_numericExpression (theInterpreter, expression->getString(), & result);
+		Interpreter_numericExpression (theProgram -> interpreter, expression->getString(), & result);
 		pushNumber (result);
 	} else Melder_throw (U"The argument of the function \"evaluate\" should be a string with a numeric expression, not ", expression->whichText());
 }
@@ -3825,7 +4012,7 @@ static void do_evaluate_nocheck () {
 	if (expression->which == Stackel_STRING) {
 		try {
 			double result;
-			Interpreter_numericExpression (theInterpreter, expression->getString(), & result);
+			Interpreter_numericExpression (theProgram -> interpreter, expression->getString(), & result);
 			pushNumber (result);
 		} catch (MelderError) {
 			Melder_clearError ();
@@ -3836,7 +4023,7 @@ static void do_evaluate_nocheck () {
 static void do_evaluate_STR () {
 	Stackel expression = pop;
 	if (expression->which == Stackel_STRING) {
-		autostring32 result = Interpreter_stringExpression (theInterpreter, expression->getString());
+		autostring32 result = Interpreter_stringExpression (theProgram -> interpreter, expression->getString());
 		pushString (result.move());
 	} else Melder_throw (U"The argument of the function \"evaluate$\" should be a string with a string expression, not ", expression->whichText());
 }
@@ -3844,7 +4031,7 @@ static void do_evaluate_nocheck_STR () {
 	Stackel expression = pop;
 	if (expression->which == Stackel_STRING) {
 		try {
-			autostring32 result = Interpreter_stringExpression (theInterpreter, expression->getString());
+			autostring32 result = Interpreter_stringExpression (theProgram -> interpreter, expression->getString());
 			pushString (result.move());
 		} catch (MelderError) {
 			Melder_clearError ();
@@ -3868,11 +4055,11 @@ static void do_do_STR () {
 		Melder_throw (U"The first argument of the function \"do$\" should be a string, namely a menu command, and not ", stack [0]. whichText(), U".");
 	conststring32 command = stack [0]. getString();
 	if (theCurrentPraatObjects == & theForegroundPraatObjects && praatP. editor != nullptr) {
-		static MelderString info;
+		static thread_local MelderString info;
 		MelderString_empty (& info);
 		autoMelderDivertInfo divert (& info);
 		autostring32 command2 = Melder_dup (command);
-		Editor_doMenuCommand (praatP. editor, command2.get(), numberOfArguments, & stack [0], nullptr, theInterpreter);
+		Editor_doMenuCommand (praatP. editor, command2.get(), numberOfArguments, & stack [0], nullptr, theProgram -> interpreter);
 		pushString (Melder_dup (info.string));
 		return;
 	} else if (theCurrentPraatObjects != & theForegroundPraatObjects &&
@@ -3880,12 +4067,12 @@ static void do_do_STR () {
 	{
 		Melder_throw (U"Commands that write files (including Quit) are not available inside manuals.");
 	} else {
-		static MelderString info;
+		static thread_local MelderString info;
 		MelderString_empty (& info);
 		autoMelderDivertInfo divert (& info);
 		autostring32 command2 = Melder_dup (command);
-		if (! praat_doAction (command2.get(), numberOfArguments, & stack [0], theInterpreter) &&
-		    ! praat_doMenuCommand (command2.get(), numberOfArguments, & stack [0], theInterpreter))
+		if (! praat_doAction (command2.get(), numberOfArguments, & stack [0], theProgram -> interpreter) &&
+		    ! praat_doMenuCommand (command2.get(), numberOfArguments, & stack [0], theProgram -> interpreter))
 		{
 			Melder_throw (U"Command \"", command, U"\" not available for current selection.");
 		}
@@ -4068,9 +4255,9 @@ static void do_pauseScript () {
 			else if (arg->which == Stackel_STRING)
 				MelderString_append (& buffer, arg->getString());
 		}
-		UiPause_begin (theCurrentPraatApplication -> topShell, U"stop or continue", theInterpreter);
+		UiPause_begin (theCurrentPraatApplication -> topShell, U"stop or continue", theProgram -> interpreter);
 		UiPause_comment (numberOfArguments == 0 ? U"..." : buffer.string);
-		UiPause_end (1, 1, 0, U"Continue", nullptr, nullptr, nullptr, nullptr, nullptr, nullptr, nullptr, nullptr, nullptr, theInterpreter);
+		UiPause_end (1, 1, 0, U"Continue", nullptr, nullptr, nullptr, nullptr, nullptr, nullptr, nullptr, nullptr, nullptr, theProgram -> interpreter);
 	}
 	pushNumber (1);
 }
@@ -4099,14 +4286,7 @@ static void do_runScript () {
 	Stackel fileName = & theStack [w + 1];
 	Melder_require (fileName->which == Stackel_STRING,
 		U"The first argument to \"runScript\" should be a string (the file name), not ", fileName->whichText());
-	theLevel += 1;
-	try {
-		praat_executeScriptFromFileName (fileName->getString(), numberOfArguments - 1, & theStack [w + 1]);
-		theLevel -= 1;
-	} catch (MelderError) {
-		theLevel -= 1;
-		throw;
-	}
+	praat_executeScriptFromFileName (fileName->getString(), numberOfArguments - 1, & theStack [w + 1]);
 	pushNumber (1);
 }
 static void do_runSystem () {
@@ -4541,7 +4721,7 @@ static void do_numberOfRows () {
 	if (array->which == Stackel_NUMERIC_MATRIX) {
 		pushNumber (array->numericMatrix.nrow);
 	} else {
-		Melder_throw (U"The function ", Formula_instructionNames [parse [programPointer]. symbol],
+		Melder_throw (U"The function ", Formula_instructionNames [theProgram -> parse [programPointer]. symbol],
 			U" requires a matrix argument, not ", array->whichText(), U".");
 	}
 }
@@ -4554,7 +4734,7 @@ static void do_numberOfColumns () {
 	if (array->which == Stackel_NUMERIC_MATRIX) {
 		pushNumber (array->numericMatrix.ncol);
 	} else {
-		Melder_throw (U"The function ", Formula_instructionNames [parse [programPointer]. symbol],
+		Melder_throw (U"The function ", Formula_instructionNames [theProgram -> parse [programPointer]. symbol],
 			U" requires a matrix argument, not ", array->whichText(), U".");
 	}
 }
@@ -4562,8 +4742,8 @@ static void do_editor () {
 	Stackel narg = pop;
 	Melder_assert (narg->which == Stackel_NUMBER);
 	if (narg->number == 0) {
-		if (theInterpreter && theInterpreter -> editorClass) {
-			praatP. editor = praat_findEditorFromString (theInterpreter -> environmentName.get());
+		if (theProgram -> interpreter && theProgram -> interpreter -> editorClass) {
+			praatP. editor = praat_findEditorFromString (theProgram -> interpreter -> environmentName.get());
 		} else {
 			Melder_throw (U"The function \"editor\" requires an argument when called from outside an editor.");
 		}
@@ -4740,7 +4920,7 @@ static void do_splitByWhitespace_STRVEC () {
 	pushStringVector (result.move());
 }
 static void do_numericVectorElement () {
-	InterpreterVariable vector = parse [programPointer]. content.variable;
+	InterpreterVariable vector = theProgram -> parse [programPointer]. content.variable;
 	integer element = 1;   // default
 	Stackel r = pop;
 	Melder_require (r->which == Stackel_NUMBER,
@@ -4755,7 +4935,7 @@ static void do_numericVectorElement () {
 	pushNumber (vector->numericVectorValue [element]);
 }
 static void do_numericMatrixElement () {
-	InterpreterVariable matrix = parse [programPointer]. content.variable;
+	InterpreterVariable matrix = theProgram -> parse [programPointer]. content.variable;
 	integer row = 1, column = 1;   // default
 	Stackel c = pop;
 	Melder_require (c->which == Stackel_NUMBER,
@@ -4780,7 +4960,7 @@ static void do_numericMatrixElement () {
 	pushNumber (matrix->numericMatrixValue [row] [column]);
 }
 static void do_stringVectorElement () {
-	InterpreterVariable vector = parse [programPointer]. content.variable;
+	InterpreterVariable vector = theProgram -> parse [programPointer]. content.variable;
 	integer element = 1;   // default
 	Stackel r = pop;
 	Melder_require (r->which == Stackel_NUMBER,
@@ -4800,8 +4980,8 @@ static void do_indexedNumericVariable () {
 	integer nindex = Melder_iround (narg->number);
 	Melder_require (nindex >= 1,
 		U"Indexed variables require at least one index.");
-	char32 *indexedVariableName = parse [programPointer]. content.string;
-	static MelderString totalVariableName;
+	char32 *indexedVariableName = theProgram -> parse [programPointer]. content.string;
+	static thread_local MelderString totalVariableName;
 	MelderString_copy (& totalVariableName, indexedVariableName, U"[");
 	w -= nindex;
 	for (int iindex = 1; iindex <= nindex; iindex ++) {
@@ -4814,7 +4994,7 @@ static void do_indexedNumericVariable () {
 			Melder_throw (U"In indexed variables, the index should be a number or a string, not ", index->whichText(), U".");
 		}
 	}
-	InterpreterVariable var = Interpreter_hasVariable (theInterpreter, totalVariableName.string);
+	InterpreterVariable var = Interpreter_hasVariable (theProgram -> interpreter, totalVariableName.string);
 	Melder_require (!! var,
 		U"Undefined indexed variable «", totalVariableName.string, U"».");
 	pushNumber (var -> numericValue);
@@ -4825,8 +5005,8 @@ static void do_indexedStringVariable () {
 	integer nindex = Melder_iround (narg->number);
 	Melder_require (nindex >= 1,
 		U"Indexed variables require at least one index.");
-	char32 *indexedVariableName = parse [programPointer]. content.string;
-	static MelderString totalVariableName;
+	char32 *indexedVariableName = theProgram -> parse [programPointer]. content.string;
+	static thread_local MelderString totalVariableName;
 	MelderString_copy (& totalVariableName, indexedVariableName, U"[");
 	w -= nindex;
 	for (int iindex = 1; iindex <= nindex; iindex ++) {
@@ -4839,7 +5019,7 @@ static void do_indexedStringVariable () {
 			Melder_throw (U"In indexed variables, the index should be a number or a string, not ", index->whichText(), U".");
 		}
 	}
-	InterpreterVariable var = Interpreter_hasVariable (theInterpreter, totalVariableName.string);
+	InterpreterVariable var = Interpreter_hasVariable (theProgram -> interpreter, totalVariableName.string);
 	Melder_require (!! var,
 		U"Undefined indexed variable «", totalVariableName.string, U"».");
 	autostring32 result = Melder_dup (var -> stringValue.get());
@@ -5039,7 +5219,7 @@ static void do_stringMatchesCriterion (kMelder_string criterion) {
 		int result = Melder_stringMatchesCriterion (s->getString(), criterion, t->getString(), true);
 		pushNumber (result);
 	} else {
-		Melder_throw (U"The function \"", Formula_instructionNames [parse [programPointer]. symbol],
+		Melder_throw (U"The function \"", Formula_instructionNames [theProgram -> parse [programPointer]. symbol],
 			U"\" requires two strings, not ", s->whichText(), U" and ", t->whichText(), U".");
 	}
 }
@@ -5060,7 +5240,7 @@ static void do_index_regex (int backward) {
 			}
 		}
 	} else {
-		Melder_throw (U"The function \"", Formula_instructionNames [parse [programPointer]. symbol],
+		Melder_throw (U"The function \"", Formula_instructionNames [theProgram -> parse [programPointer]. symbol],
 			U"\" requires two strings, not ", s->whichText(), U" and ", t->whichText(), U".");
 	}
 }
@@ -5127,7 +5307,7 @@ static void do_extractNumber () {
 			}
 		}
 	} else {
-		Melder_throw (U"The function \"", Formula_instructionNames [parse [programPointer]. symbol],
+		Melder_throw (U"The function \"", Formula_instructionNames [theProgram -> parse [programPointer]. symbol],
 			U"\" requires two strings, not ", s->whichText(), U" and ", t->whichText(), U".");
 	}
 }
@@ -5160,7 +5340,7 @@ static void do_extractText_STR (bool singleWord) {
 		}
 		pushString (result.move());
 	} else {
-		Melder_throw (U"The function \"", Formula_instructionNames [parse [programPointer]. symbol],
+		Melder_throw (U"The function \"", Formula_instructionNames [theProgram -> parse [programPointer]. symbol],
 			U"\" requires two strings, not ", s->whichText(), U" and ", t->whichText(), U".");
 	}
 }
@@ -5577,7 +5757,7 @@ static void do_createDirectory () {
 static void do_variableExists () {
 	Stackel f = pop;
 	if (f->which == Stackel_STRING) {
-		bool result = !! Interpreter_hasVariable (theInterpreter, f->getString());
+		bool result = !! Interpreter_hasVariable (theProgram -> interpreter, f->getString());
 		pushNumber (result);
 	} else {
 		Melder_throw (U"The function \"variableExists\" requires a string, not ", f->whichText(), U".");
@@ -6055,7 +6235,7 @@ static void do_beginPauseForm () {
 	if (n->number == 1) {
 		Stackel title = pop;
 		if (title->which == Stackel_STRING) {
-			UiPause_begin (theCurrentPraatApplication -> topShell, title->getString(), theInterpreter);
+			UiPause_begin (theCurrentPraatApplication -> topShell, title->getString(), theProgram -> interpreter);
 		} else {
 			Melder_throw (U"The function \"beginPauseForm\" requires a string (the title), not ", title->whichText(), U".");
 		}
@@ -6350,7 +6530,7 @@ static void do_endPauseForm () {
 		! co [5] ? nullptr : co[5]->getString(), ! co [6] ? nullptr : co[6]->getString(),
 		! co [7] ? nullptr : co[7]->getString(), ! co [8] ? nullptr : co[8]->getString(),
 		! co [9] ? nullptr : co[9]->getString(), ! co [10] ? nullptr : co[10]->getString(),
-		theInterpreter);
+		theProgram -> interpreter);
 	//Melder_casual (U"Button ", buttonClicked);
 	pushNumber (buttonClicked);
 }
@@ -6454,14 +6634,14 @@ static void do_demoWaitForInput () {
 	Stackel n = pop;
 	if (n->number != 0)
 		Melder_throw (U"The function \"demoWaitForInput\" requires 0 arguments, not ", n->number, U".");
-	Demo_waitForInput (theInterpreter);
+	Demo_waitForInput (theProgram -> interpreter);
 	pushNumber (1);
 }
 static void do_demoPeekInput () {
 	Stackel n = pop;
 	if (n->number != 0)
 		Melder_throw (U"The function \"demoPeekInput\" requires 0 arguments, not ", n->number, U".");
-	Demo_peekInput (theInterpreter);
+	Demo_peekInput (theProgram -> interpreter);
 	pushNumber (1);
 }
 static void do_demoInput () {
@@ -6580,7 +6760,7 @@ static integer Stackel_getColumnNumber (Stackel column, Daata thee) {
 	return result;
 }
 static void do_self0 (integer irow, integer icol) {
-	Daata me = theSource;
+	Daata me = theProgram -> source;
 	if (! me) Melder_throw (U"The name \"self\" is restricted to formulas for objects.");
 	if (my v_hasGetCell ()) {
 		pushNumber (my v_getCell ());
@@ -6612,7 +6792,7 @@ static void do_self0 (integer irow, integer icol) {
 	}
 }
 static void do_selfStr0 (integer irow, integer icol) {
-	Daata me = theSource;
+	Daata me = theProgram -> source;
 	if (! me) Melder_throw (U"The name \"self$\" is restricted to formulas for objects.");
 	if (my v_hasGetCellStr ()) {
 		pushString (Melder_dup (my v_getCellStr ()));
@@ -6697,7 +6877,7 @@ static void do_objectCell0 (integer irow, integer icol) {
 	}
 }
 static void do_matrix0 (integer irow, integer icol) {
-	Daata thee = parse [programPointer]. content.object;
+	Daata thee = theProgram -> parse [programPointer]. content.object;
 	if (thy v_hasGetCell ()) {
 		pushNumber (thy v_getCell ());
 	} else if (thy v_hasGetVector ()) {
@@ -6727,7 +6907,7 @@ static void do_matrix0 (integer irow, integer icol) {
 	}
 }
 static void do_selfMatrix1 (integer irow) {
-	Daata me = theSource;
+	Daata me = theProgram -> source;
 	Stackel column = pop;
 	if (! me) Melder_throw (U"The name \"self\" is restricted to formulas for objects.");
 	integer icol = Stackel_getColumnNumber (column, me);
@@ -6746,7 +6926,7 @@ static void do_selfMatrix1 (integer irow) {
 	}
 }
 static void do_selfMatrix1_STR (integer irow) {
-	Daata me = theSource;
+	Daata me = theProgram -> source;
 	Stackel column = pop;
 	if (! me) Melder_throw (U"The name \"self$\" is restricted to formulas for objects.");
 	integer icol = Stackel_getColumnNumber (column, me);
@@ -6783,7 +6963,7 @@ static void do_objectCell1 (integer irow) {
 	}
 }
 static void do_matrix1 (integer irow) {
-	Daata thee = parse [programPointer]. content.object;
+	Daata thee = theProgram -> parse [programPointer]. content.object;
 	Stackel column = pop;
 	integer icol = Stackel_getColumnNumber (column, thee);
 	if (thy v_hasGetVector ()) {
@@ -6819,7 +6999,7 @@ static void do_objectCell1_STR (integer irow) {
 	}
 }
 static void do_matrix1_STR (integer irow) {
-	Daata thee = parse [programPointer]. content.object;
+	Daata thee = theProgram -> parse [programPointer]. content.object;
 	Stackel column = pop;
 	integer icol = Stackel_getColumnNumber (column, thee);
 	if (thy v_hasGetVectorStr ()) {
@@ -6837,7 +7017,7 @@ static void do_matrix1_STR (integer irow) {
 	}
 }
 static void do_selfMatrix2 () {
-	Daata me = theSource;
+	Daata me = theProgram -> source;
 	Stackel column = pop, row = pop;
 	if (! me) Melder_throw (U"The name \"self\" is restricted to formulas for objects.");
 	integer irow = Stackel_getRowNumber (row, me);
@@ -6847,7 +7027,7 @@ static void do_selfMatrix2 () {
 	pushNumber (my v_getMatrix (irow, icol));
 }
 static void do_selfMatrix2_STR () {
-	Daata me = theSource;
+	Daata me = theProgram -> source;
 	Stackel column = pop, row = pop;
 	if (! me) Melder_throw (U"The name \"self$\" is restricted to formulas for objects.");
 	integer irow = Stackel_getRowNumber (row, me);
@@ -6866,7 +7046,7 @@ static void do_objectCell2 () {
 	pushNumber (thy v_getMatrix (irow, icol));
 }
 static void do_matrix2 () {
-	Daata thee = parse [programPointer]. content.object;
+	Daata thee = theProgram -> parse [programPointer]. content.object;
 	Stackel column = pop, row = pop;
 	integer irow = Stackel_getRowNumber (row, thee);
 	integer icol = Stackel_getColumnNumber (column, thee);
@@ -6884,7 +7064,7 @@ static void do_objectCell2_STR () {
 	pushString (Melder_dup (thy v_getMatrixStr (irow, icol)));
 }
 static void do_matrix2_STR () {
-	Daata thee = parse [programPointer]. content.object;
+	Daata thee = theProgram -> parse [programPointer]. content.object;
 	Stackel column = pop, row = pop;
 	integer irow = Stackel_getRowNumber (row, thee);
 	integer icol = Stackel_getColumnNumber (column, thee);
@@ -6898,7 +7078,7 @@ static void do_objectLocation0 (integer irow, integer icol) {
 	if (thy v_hasGetFunction0 ()) {
 		pushNumber (thy v_getFunction0 ());
 	} else if (thy v_hasGetFunction1 ()) {
-		Daata me = theSource;
+		Daata me = theProgram -> source;
 		if (! me)
 			Melder_throw (U"No current object (we are not in a Formula command),\n"
 				U"hence no implicit x value for this ", Thing_className (thee), U" object.\n"
@@ -6911,7 +7091,7 @@ static void do_objectLocation0 (integer irow, integer icol) {
 		double x = my v_getX (icol);
 		pushNumber (thy v_getFunction1 (irow, x));
 	} else if (thy v_hasGetFunction2 ()) {
-		Daata me = theSource;
+		Daata me = theProgram -> source;
 		if (! me)
 			Melder_throw (U"No current object (we are not in a Formula command),\n"
 				U"hence no implicit x or y values for this ", Thing_className (thee), U" object.\n"
@@ -6932,11 +7112,11 @@ static void do_objectLocation0 (integer irow, integer icol) {
 	}
 }
 static void do_function0 (integer irow, integer icol) {
-	Daata thee = parse [programPointer]. content.object;
+	Daata thee = theProgram -> parse [programPointer]. content.object;
 	if (thy v_hasGetFunction0 ()) {
 		pushNumber (thy v_getFunction0 ());
 	} else if (thy v_hasGetFunction1 ()) {
-		Daata me = theSource;
+		Daata me = theProgram -> source;
 		if (!me)
 			Melder_throw (U"No current object (we are not in a Formula command),\n"
 				U"hence no implicit x value for this ", Thing_className (thee), U" object.\n"
@@ -6949,7 +7129,7 @@ static void do_function0 (integer irow, integer icol) {
 		double x = my v_getX (icol);
 		pushNumber (thy v_getFunction1 (irow, x));
 	} else if (thy v_hasGetFunction2 ()) {
-		Daata me = theSource;
+		Daata me = theProgram -> source;
 		if (! me)
 			Melder_throw (U"No current object (we are not in a Formula command),\n"
 				U"hence no implicit x or y values for this ", Thing_className (thee), U" object.\n"
@@ -6970,7 +7150,7 @@ static void do_function0 (integer irow, integer icol) {
 	}
 }
 static void do_selfFunction1 (integer irow) {
-	Daata me = theSource;
+	Daata me = theProgram -> source;
 	Stackel x = pop;
 	if (x->which == Stackel_NUMBER) {
 		if (! me) Melder_throw (U"The name \"self\" is restricted to formulas for objects.");
@@ -6996,7 +7176,7 @@ static void do_objectLocation1 (integer irow) {
 		if (thy v_hasGetFunction1 ()) {
 			pushNumber (thy v_getFunction1 (irow, x->number));
 		} else if (thy v_hasGetFunction2 ()) {
-			Daata me = theSource;
+			Daata me = theProgram -> source;
 			if (! me)
 				Melder_throw (U"No current object (we are not in a Formula command),\n"
 					U"hence no implicit y value for this ", Thing_className (thee), U" object.\n"
@@ -7015,13 +7195,13 @@ static void do_objectLocation1 (integer irow) {
 	}
 }
 static void do_function1 (integer irow) {
-	Daata thee = parse [programPointer]. content.object;
+	Daata thee = theProgram -> parse [programPointer]. content.object;
 	Stackel x = pop;
 	if (x->which == Stackel_NUMBER) {
 		if (thy v_hasGetFunction1 ()) {
 			pushNumber (thy v_getFunction1 (irow, x->number));
 		} else if (thy v_hasGetFunction2 ()) {
-			Daata me = theSource;
+			Daata me = theProgram -> source;
 			if (! me)
 				Melder_throw (U"No current object (we are not in a Formula command),\n"
 					U"hence no implicit y value for this ", Thing_className (thee), U" object.\n"
@@ -7040,7 +7220,7 @@ static void do_function1 (integer irow) {
 	}
 }
 static void do_selfFunction2 () {
-	Daata me = theSource;
+	Daata me = theProgram -> source;
 	Stackel y = pop, x = pop;
 	if (x->which == Stackel_NUMBER && y->which == Stackel_NUMBER) {
 		if (! me) Melder_throw (U"The name \"self\" is restricted to formulas for objects.");
@@ -7063,7 +7243,7 @@ static void do_objectLocation2 () {
 	}
 }
 static void do_function2 () {
-	Daata thee = parse [programPointer]. content.object;
+	Daata thee = theProgram -> parse [programPointer]. content.object;
 	Stackel y = pop, x = pop;
 	if (x->which == Stackel_NUMBER && y->which == Stackel_NUMBER) {
 		if (! thy v_hasGetFunction2 ())
@@ -7074,7 +7254,7 @@ static void do_function2 () {
 	}
 }
 static void do_row_STR () {
-	Daata thee = parse [programPointer]. content.object;
+	Daata thee = theProgram -> parse [programPointer]. content.object;
 	Stackel row = pop;
 	integer irow = Stackel_getRowNumber (row, thee);
 	autostring32 result = Melder_dup (thy v_getRowStr (irow));
@@ -7083,7 +7263,7 @@ static void do_row_STR () {
 	pushString (result.move());
 }
 static void do_col_STR () {
-	Daata thee = parse [programPointer]. content.object;
+	Daata thee = theProgram -> parse [programPointer]. content.object;
 	Stackel col = pop;
 	integer icol = Stackel_getColumnNumber (col, thee);
 	autostring32 result = Melder_dup (thy v_getColStr (icol));
@@ -7106,18 +7286,70 @@ static double NUMerf (double x) {
 	return 1.0 - NUMerfcc (x);
 }
 
+/*
+	The stack memory of a thread, freed when the thread ends.
+*/
+class autoStackMemory {
+	Stackel elements = nullptr;
+public:
+	Stackel get () {
+		if (! elements)
+			elements = Melder_calloc_f (structStackel, 1+Formula_MAXIMUM_STACK_SIZE);
+		return elements;
+	}
+	~autoStackMemory () {
+		if (! elements)
+			return;
+		for (integer i = 0; i <= Formula_MAXIMUM_STACK_SIZE; i ++)
+			elements [i]. reset ();   // strings, vectors and matrices that the last formula left behind
+		Melder_free (elements);
+	}
+};
+
+class autoFormulaRun {
+	FormulaProgram outerProgram;
+	int outerProgramPointer;
+	Stackel outerStack;
+	integer outerW, outerWmax, outerStackSize;
+public:
+	autoFormulaRun (FormulaProgram program) :
+		outerProgram (theProgram), outerProgramPointer (programPointer),
+		outerStack (theStack), outerW (w), outerWmax (wmax), outerStackSize (theStackSize)
+	{
+		static thread_local autoStackMemory theStackMemory;
+		if (theRunDepth == 0) {
+			theStack = theStackMemory. get ();
+			theStackSize = Formula_MAXIMUM_STACK_SIZE;
+		} else {
+			theStack = outerStack + outerWmax;   // above everything the outer formula has used
+			theStackSize = outerStackSize - outerWmax;
+		}
+		theProgram = program;
+		theRunDepth += 1;
+	}
+	~autoFormulaRun () {
+		theRunDepth -= 1;
+		theProgram = outerProgram;
+		programPointer = outerProgramPointer;
+		theStack = outerStack;
+		w = outerW;
+		wmax = outerWmax;
+		theStackSize = outerStackSize;
+	}
+};
+
 void Formula_run (integer row, integer col, Formula_Result *result) {
-	FormulaInstruction f = parse;
+	FormulaProgram_run (Formula_defaultProgram (), row, col, result);
+}
+
+void FormulaProgram_run (FormulaProgram me, integer row, integer col, Formula_Result *result) {
+	autoFormulaRun run (me);
+	FormulaInstruction f = my parse;
 	programPointer = 1;   // first symbol of the program
-	if (! theStack) {
-		theStack = Melder_calloc_f (structStackel, 1+Formula_MAXIMUM_STACK_SIZE);
-		if (! theStack)
-			Melder_throw (U"Out of memory during formula computation.");
-	}
 	w = 0;   // start new stack
 	wmax = 0;   // start new stack
 	try {
-		while (programPointer <= numberOfInstructions) {
+		while (programPointer <= theProgram -> numberOfInstructions) {
 			int symbol;
 				switch (symbol = f [programPointer]. symbol) {
 
@@ -7126,12 +7358,12 @@ case NUMBER_: { pushNumber (f [programPointer]. content.number);
 } break; case ROW_: { pushNumber (row);
 } break; case COL_: { pushNumber (col);
 } break; case X_: {
-	Daata me = theSource;
+	Daata me = theProgram -> source;
 	Melder_require (my v_hasGetX (),
 		U"No values for \"x\" for this object.");
 	pushNumber (my v_getX (col));
 } break; case Y_: {
-	Daata me = theSource;
+	Daata me = theProgram -> source;
 	Melder_require (my v_hasGetY (),
 		U"No values for \"y\" for this object.");
 	pushNumber (my v_getY (row));
@@ -7422,7 +7654,7 @@ case NUMBER_: { pushNumber (f [programPointer]. content.number);
 		if (condition->number != 0.0) {
 /* Possible compiler BUG: some compilers cannot handle the following assignment. */
 /* Those compilers will have trouble with praat's AND and OR. */
-			programPointer = f [programPointer]. content.label - theOptimize;
+			programPointer = f [programPointer]. content.label - theProgram -> optimize;
 		}
 	} else {
 		Melder_throw (U"A condition between \"if\" and \"then\" should be a number, not ", condition->whichText(), U".");
@@ -7431,13 +7663,13 @@ case NUMBER_: { pushNumber (f [programPointer]. content.number);
 	Stackel condition = pop;
 	if (condition->which == Stackel_NUMBER) {
 		if (condition->number == 0.0) {
-			programPointer = f [programPointer]. content.label - theOptimize;
+			programPointer = f [programPointer]. content.label - theProgram -> optimize;
 		}
 	} else {
 		Melder_throw (U"A condition between \"if\" and \"then\" should be a number, not ", condition->whichText(), U".");
 	}
 } break; case GOTO_: {
-	programPointer = f [programPointer]. content.label - theOptimize;
+	programPointer = f [programPointer]. content.label - theProgram -> optimize;
 } break; case LABEL_: {
 	;
 } break; case DECREMENT_AND_ASSIGN_: {
@@ -7457,7 +7689,7 @@ case NUMBER_: { pushNumber (f [programPointer]. content.number);
 	//Melder_casual (U"loop variable ", var -> numericValue);
 	//Melder_casual (U"end value ", e->number);
 	if (var -> numericValue > e->number) {
-		programPointer = f [programPointer]. content.label - theOptimize;
+		programPointer = f [programPointer]. content.label - theProgram -> optimize;
 	}
 } break; case ADD_3DOWN_: {
 	Stackel x = pop, s = & theStack [w - 2];
@@ -7526,7 +7758,7 @@ case NUMBER_: { pushNumber (f [programPointer]. content.number);
 } break; case STRING_ARRAY_VARIABLE_: {
 	InterpreterVariable var = f [programPointer]. content.variable;
 	pushStringVectorReference (var -> stringArrayValue.get());
-} break; default: Melder_throw (U"Symbol \"", Formula_instructionNames [parse [programPointer]. symbol], U"\" without action.");
+} break; default: Melder_throw (U"Symbol \"", Formula_instructionNames [theProgram -> parse [programPointer]. symbol], U"\" without action.");
 			} // endswitch
 			programPointer ++;
 		} // endwhile
@@ -7536,7 +7768,7 @@ case NUMBER_: { pushNumber (f [programPointer]. content.number);
 			Move the result from the stack to `result`.
 		*/
 		result -> reset();
-		if (theExpressionType [theLevel] == kFormula_EXPRESSION_TYPE_NUMERIC) {
+		if (theProgram -> expressionType == kFormula_EXPRESSION_TYPE_NUMERIC) {
 			if (theStack [1]. which == Stackel_STRING)
 				Melder_throw (U"Found a string expression instead of a numeric expression.");
 			if (theStack [1]. which == Stackel_NUMERIC_VECTOR)
@@ -7548,7 +7780,7 @@ case NUMBER_: { pushNumber (f [programPointer]. content.number);
 			Melder_assert (theStack [1]. which == Stackel_NUMBER);
 			result -> expressionType = kFormula_EXPRESSION_TYPE_NUMERIC;
 			result -> numericResult = theStack [1]. number;
-		} else if (theExpressionType [theLevel] == kFormula_EXPRESSION_TYPE_STRING) {
+		} else if (theProgram -> expressionType == kFormula_EXPRESSION_TYPE_STRING) {
 			if (theStack [1]. which == Stackel_NUMBER)
 				Melder_throw (U"Found a numeric expression (value ", theStack [1]. number, U") instead of a string expression.");
 			if (theStack [1]. which == Stackel_NUMERIC_VECTOR)
@@ -7563,7 +7795,7 @@ case NUMBER_: { pushNumber (f [programPointer]. content.number);
 			result -> stringResult = theStack [1]. moveString();
 			Melder_assert (theStack [1]. which == Stackel_STRING);
 			Melder_assert (! theStack [1]. getString());
-		} else if (theExpressionType [theLevel] == kFormula_EXPRESSION_TYPE_NUMERIC_VECTOR) {
+		} else if (theProgram -> expressionType == kFormula_EXPRESSION_TYPE_NUMERIC_VECTOR) {
 			if (theStack [1]. which == Stackel_NUMBER)
 				Melder_throw (U"Found a numeric expression instead of a vector expression.");
 			if (theStack [1]. which == Stackel_STRING)
@@ -7577,7 +7809,7 @@ case NUMBER_: { pushNumber (f [programPointer]. content.number);
 			result -> numericVectorResult = theStack [1]. numericVector;
 			result -> owned = theStack [1]. owned;
 			theStack [1]. owned = false;
-		} else if (theExpressionType [theLevel] == kFormula_EXPRESSION_TYPE_NUMERIC_MATRIX) {
+		} else if (theProgram -> expressionType == kFormula_EXPRESSION_TYPE_NUMERIC_MATRIX) {
 			if (theStack [1]. which == Stackel_NUMBER)
 				Melder_throw (U"Found a numeric expression instead of a matrix expression.");
 			if (theStack [1]. which == Stackel_STRING)
@@ -7591,7 +7823,7 @@ case NUMBER_: { pushNumber (f [programPointer]. content.number);
 			result -> numericMatrixResult = theStack [1]. numericMatrix;
 			result -> owned = theStack [1]. owned;
 			theStack [1]. owned = false;
-		} else if (theExpressionType [theLevel] == kFormula_EXPRESSION_TYPE_STRING_ARRAY) {
+		} else if (theProgram -> expressionType == kFormula_EXPRESSION_TYPE_STRING_ARRAY) {
 			if (theStack [1]. which == Stackel_NUMBER)
 				Melder_throw (U"Found a numeric expression instead of a string vector expression.");
 			if (theStack [1]. which == Stackel_STRING)
@@ -7606,7 +7838,7 @@ case NUMBER_: { pushNumber (f [programPointer]. content.number);
 			result -> owned = theStack [1]. owned;
 			theStack [1]. owned = false;
 		} else {
-			Melder_assert (theExpressionType [theLevel] == kFormula_EXPRESSION_TYPE_UNKNOWN);
+			Melder_assert (theProgram -> expressionType == kFormula_EXPRESSION_TYPE_UNKNOWN);
 			if (theStack [1]. which == Stackel_NUMBER) {
 				result -> expressionType = kFormula_EXPRESSION_TYPE_NUMERIC;
 				result -> numericResult = theStack [1]. number;
@@ -7654,4 +7886,199 @@ case NUMBER_: { pushNumber (f [programPointer]. content.number);
 	}
 }
 
+bool FormulaProgram_canRunCells (FormulaProgram me) {
+	return my numberOfRowRegisters > 0 && Melder_debug != 61;
+}
+
+/*
+	The same computations as in FormulaProgram_run (), including the conversion of NaN and infinity to `undefined`
+	by pushNumber () (i.e. not after addition, subtraction and multiplication), but for a row of cells at once.
+*/
+inline static double definedOrUndefined (double x) {
+	return isdefined (x) ? x : undefined;
+}
+
+void FormulaProgram_runCells (FormulaProgram me, integer row, integer firstColumn, VEC const& result) {
+	Melder_assert (my numberOfRowRegisters > 0);
+	const integer n = result.size;
+	if (n == 0)
+		return;
+	static thread_local autoMAT theRegisters;   // one row per stack element
+	if (theRegisters.nrow < my numberOfRowRegisters || theRegisters.ncol < n)
+		theRegisters = raw_MAT (std::max (theRegisters.nrow, integer (my numberOfRowRegisters)), std::max (theRegisters.ncol, n));
+	integer top = 0;
+	auto pushRow = [&] () -> VEC {
+		return theRegisters.row (++ top). part (1, n);
+	};
+	auto popRow = [&] () -> VEC {
+		return theRegisters.row (top --). part (1, n);
+	};
+	auto topRow = [&] () -> VEC {
+		return theRegisters.row (top). part (1, n);
+	};
+	try {
+		for (integer i = 1; i <= my numberOfInstructions; i ++) {
+			const structFormulaInstruction& instruction = my parse [i];
+			const int symbol = instruction. symbol;
+			if (symbol == END_)
+				break;
+			switch (symbol) {
+				case NUMBER_: {
+					pushRow () <<= definedOrUndefined (instruction. content.number);
+				} break; case NUMERIC_VARIABLE_: {
+					pushRow () <<= definedOrUndefined (instruction. content.variable -> numericValue);
+				} break; case ROW_: {
+					pushRow () <<= double (row);
+				} break; case COL_: {
+					VEC x = pushRow ();
+					for (integer icell = 1; icell <= n; icell ++)
+						x [icell] = double (firstColumn + icell - 1);
+				} break; case X_: {
+					Daata source = my source;
+					Melder_require (source -> v_hasGetX (),
+						U"No values for \"x\" for this object.");
+					VEC x = pushRow ();
+					for (integer icell = 1; icell <= n; icell ++)
+						x [icell] = definedOrUndefined (source -> v_getX (firstColumn + icell - 1));
+				} break; case Y_: {
+					Daata source = my source;
+					Melder_require (source -> v_hasGetY (),
+						U"No values for \"y\" for this object.");
+					pushRow () <<= definedOrUndefined (source -> v_getY (row));
+				} break; case SELF0_: {
+					Daata source = my source;
+					if (! source)
+						Melder_throw (U"The name \"self\" is restricted to formulas for objects.");
+					VEC x = pushRow ();
+					if (source -> v_hasGetCell ()) {
+						x <<= definedOrUndefined (source -> v_getCell ());
+					} else if (source -> v_hasGetVector ()) {
+						for (integer icell = 1; icell <= n; icell ++)
+							x [icell] = definedOrUndefined (source -> v_getVector (row, firstColumn + icell - 1));
+					} else if (source -> v_hasGetMatrix ()) {
+						for (integer icell = 1; icell <= n; icell ++)
+							x [icell] = definedOrUndefined (source -> v_getMatrix (row, firstColumn + icell - 1));
+					} else {
+						Melder_throw (Thing_className (source), U" objects (like self) accept no [] indexing.");
+					}
+				} break; case ADD_: {
+					VEC y = popRow (), x = topRow ();
+					for (integer icell = 1; icell <= n; icell ++)
+						x [icell] += y [icell];
+				} break; case SUB_: {
+					VEC y = popRow (), x = topRow ();
+					for (integer icell = 1; icell <= n; icell ++)
+						x [icell] -= y [icell];
+				} break; case MUL_: {
+					VEC y = popRow (), x = topRow ();
+					for (integer icell = 1; icell <= n; icell ++)
+						x [icell] *= y [icell];
+				} break; case RDIV_: {
+					VEC y = popRow (), x = topRow ();
+					for (integer icell = 1; icell <= n; icell ++)
+						x [icell] = definedOrUndefined (x [icell] / y [icell]);
+				} break; case IDIV_: {
+					VEC y = popRow (), x = topRow ();
+					for (integer icell = 1; icell <= n; icell ++)
+						x [icell] = definedOrUndefined (floor (x [icell] / y [icell]));
+				} break; case MOD_: {
+					VEC y = popRow (), x = topRow ();
+					for (integer icell = 1; icell <= n; icell ++)
+						x [icell] = definedOrUndefined (x [icell] - floor (x [icell] / y [icell]) * y [icell]);
+				} break; case POWER_: {
+					VEC y = popRow (), x = topRow ();
+					for (integer icell = 1; icell <= n; icell ++)
+						x [icell] = ( isundef (x [icell]) || isundef (y [icell]) ? undefined : definedOrUndefined (pow (x [icell], y [icell])) );
+				} break; case MINUS_: {
+					VEC x = topRow ();
+					for (integer icell = 1; icell <= n; icell ++)
+						x [icell] = definedOrUndefined (- x [icell]);
+				} break; case SQR_: {
+					VEC x = topRow ();
+					for (integer icell = 1; icell <= n; icell ++)
+						x [icell] = ( isundef (x [icell]) ? undefined : definedOrUndefined (x [icell] * x [icell]) );
+				} break; case ABS_: {
+					VEC x = topRow ();
+					for (integer icell = 1; icell <= n; icell ++)
+						x [icell] = ( isundef (x [icell]) ? undefined : fabs (x [icell]) );
+				} break; case ROUND_: {
+					VEC x = topRow ();
+					for (integer icell = 1; icell <= n; icell ++)
+						x [icell] = ( isundef (x [icell]) ? undefined : definedOrUndefined (floor (x [icell] + 0.5)) );
+				} break; case FLOOR_: {
+					VEC x = topRow ();
+					for (integer icell = 1; icell <= n; icell ++)
+						x [icell] = ( isundef (x [icell]) ? undefined : Melder_roundDown (x [icell]) );
+				} break; case CEILING_: {
+					VEC x = topRow ();
+					for (integer icell = 1; icell <= n; icell ++)
+						x [icell] = ( isundef (x [icell]) ? undefined : Melder_roundUp (x [icell]) );
+				} break; case SQRT_: {
+					VEC x = topRow ();
+					for (integer icell = 1; icell <= n; icell ++)
+						x [icell] = ( isundef (x [icell]) || x [icell] < 0.0 ? undefined : sqrt (x [icell]) );
+				} break; case SIN_: {
+					VEC x = topRow ();
+					for (integer icell = 1; icell <= n; icell ++)
+						x [icell] = ( isundef (x [icell]) ? undefined : definedOrUndefined (sin (x [icell])) );
+				} break; case COS_: {
+					VEC x = topRow ();
+					for (integer icell = 1; icell <= n; icell ++)
+						x [icell] = ( isundef (x [icell]) ? undefined : definedOrUndefined (cos (x [icell])) );
+				} break; case TAN_: {
+					VEC x = topRow ();
+					for (integer icell = 1; icell <= n; icell ++)
+						x [icell] = ( isundef (x [icell]) ? undefined : definedOrUndefined (tan (x [icell])) );
+				} break; case ARCSIN_: {
+					VEC x = topRow ();
+					for (integer icell = 1; icell <= n; icell ++)
+						x [icell] = ( isundef (x [icell]) || fabs (x [icell]) > 1.0 ? undefined : asin (x [icell]) );
+				} break; case ARCCOS_: {
+					VEC x = topRow ();
+					for (integer icell = 1; icell <= n; icell ++)
+						x [icell] = ( isundef (x [icell]) || fabs (x [icell]) > 1.0 ? undefined : acos (x [icell]) );
+				} break; case ARCTAN_: {
+					VEC x = topRow ();
+					for (integer icell = 1; icell <= n; icell ++)
+						x [icell] = ( isundef (x [icell]) ? undefined : atan (x [icell]) );
+				} break; case EXP_: {
+					VEC x = topRow ();
+					for (integer icell = 1; icell <= n; icell ++)
+						x [icell] = ( isundef (x [icell]) ? undefined : definedOrUndefined (exp (x [icell])) );
+				} break; case SINH_: {
+					VEC x = topRow ();
+					for (integer icell = 1; icell <= n; icell ++)
+						x [icell] = ( isundef (x [icell]) ? undefined : definedOrUndefined (sinh (x [icell])) );
+				} break; case COSH_: {
+					VEC x = topRow ();
+					for (integer icell = 1; icell <= n; icell ++)
+						x [icell] = ( isundef (x [icell]) ? undefined : definedOrUndefined (cosh (x [icell])) );
+				} break; case TANH_: {
+					VEC x = topRow ();
+					for (integer icell = 1; icell <= n; icell ++)
+						x [icell] = ( isundef (x [icell]) ? undefined : tanh (x [icell]) );
+				} break; case LN_: {
+					VEC x = topRow ();
+					for (integer icell = 1; icell <= n; icell ++)
+						x [icell] = ( isundef (x [icell]) || x [icell] <= 0.0 ? undefined : log (x [icell]) );
+				} break; case LOG10_: {
+					VEC x = topRow ();
+					for (integer icell = 1; icell <= n; icell ++)
+						x [icell] = ( isundef (x [icell]) || x [icell] <= 0.0 ? undefined : log10 (x [icell]) );
+				} break; case LOG2_: {
+					VEC x = topRow ();
+					for (integer icell = 1; icell <= n; icell ++)
+						x [icell] = ( isundef (x [icell]) || x [icell] <= 0.0 ? undefined : definedOrUndefined (log (x [icell]) * NUMlog2e) );
+				} break; default: {
+					Melder_fatal (U"FormulaProgram_runCells: unexpected symbol \"", Formula_instructionNames [symbol], U"\".");
+				}
+			}
+		}
+		Melder_assert (top == 1);
+		result <<= theRegisters.row (1). part (1, n);
+	} catch (MelderError) {
+		Melder_throw (U"Formula not run.");
+	}
+}
+
 /* End of file Formula.cpp */
@@ -2,7 +2,7 @@
 #define _Formula_h_
 /* Formula.h
  *
- * Copyright (C) 1990-2005,2007,2008,2011-2020 Paul Boersma
+ * Copyright (C) 1990-2005,2007,2008,2011-2021 Paul Boersma
  *
  * This code is free software; you can redistribute it and/or modify
  * it under the terms of the GNU General Public License as published by
@@ -184,9 +184,76 @@ struct Formula_Result {
 
 Thing_declare (Interpreter);
 
+/*
+	A compiled formula. It owns its program (the instructions and their strings);
+	the object and the interpreter it refers to are not owned.
+	The program is not changed by running it, and the stack is kept per thread,
+	so one FormulaProgram can be run by several threads at the same time,
+	as long as the formula only reads the object and the variables
+	(i.e. no object selection, no menu commands, no scripts).
+*/
+struct structFormulaInstruction;
+Thing_define (FormulaProgram, Thing) {
+	Interpreter interpreter;
+	Daata source;
+	int expressionType;
+	bool optimize;
+	struct structFormulaInstruction *lexan, *parse;
+	int numberOfInstructions, numberOfStringConstants;
+	int numberOfRowRegisters;   // for FormulaProgram_runCells (); 0 if the formula cannot be computed for many cells at once
+
+	void v_destroy () noexcept
+		override;
+};
+
+autoFormulaProgram FormulaProgram_create (Interpreter interpreter, Daata data, conststring32 expression, int expressionType, bool optimize);
+
+void FormulaProgram_run (FormulaProgram me, integer row, integer col, Formula_Result *result);
+
+bool FormulaProgram_canRunInParallel (FormulaProgram me, bool sourceIsWritten);
+/*
+	Whether the cells of an object can be computed on several threads at the same time, in any order.
+	This is not so if the formula has side effects or uses global state (e.g. random numbers, selection, files,
+	the Info window, loops over variables), or if `sourceIsWritten` and the formula reads cells of the source
+	other than the current one (e.g. self [row - 1, col]).
+*/
+
+bool FormulaProgram_canBeReused (FormulaProgram me);
+/*
+	Whether the program can be run again later, e.g. at the next pass through a loop in a script.
+	This is not so if the program refers to objects (which could have been removed in the meantime)
+	or to names that were not variables at the time of compilation (but could have become variables).
+	Variables themselves are referred to by their address, which stays valid as long as the interpreter
+	does not remove any variables, i.e. until the next time it starts running a script.
+*/
+
+integer FormulaProgram_shrink (FormulaProgram me);
+/*
+	Give back the part of the instruction arrays that the compiled program does not use
+	(they are allocated for the largest possible formula, i.e. 32 MB),
+	so that the program can be kept for a long time, e.g. for reuse.
+	Returns the number of bytes that the program still occupies, not counting its strings.
+*/
+
+bool FormulaProgram_canRunCells (FormulaProgram me);
+void FormulaProgram_runCells (FormulaProgram me, integer row, integer firstColumn, VEC const& result);
+/*
+	Compute the cells (row, firstColumn) .. (row, firstColumn + result.size - 1) at once,
+	performing each instruction on all the cells before going on to the next instruction.
+	This is possible for numeric formulas without branches that consist only of numbers,
+	row, col, x, y, self (the current cell), arithmetic, and elementary functions such as sin and exp;
+	the results are the same as those of FormulaProgram_run () for each cell.
+*/
+
+/*
+	The traditional interface: compile a formula into the current thread's program for the current nesting level,
+	then run that program.
+*/
 void Formula_compile (Interpreter interpreter, Daata data, conststring32 expression, int expressionType, bool optimize);
 
 void Formula_run (integer row, integer col, Formula_Result *result);
 
+bool Formula_canBeReused ();   // FormulaProgram_canBeReused () for the formula that was compiled last
+
 /* End of file Formula.h */
 #endif
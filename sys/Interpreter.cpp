@@ -1,6 +1,6 @@
 /* Interpreter.cpp
  *
- * Copyright (C) 1993-2020 Paul Boersma
+ * Copyright (C) 1993-2021 Paul Boersma
  *
  * This code is free software; you can redistribute it and/or modify
  * it under the terms of the GNU General Public License as published by
@@ -21,6 +21,7 @@
 extern structMelderDir praatDir;
 #include "praat_script.h"
 #include "Formula.h"
+#include "ScriptProfiler.h"
 #include "praat_version.h"
 #include "../kar/UnicodeData.h"
 
@@ -657,8 +658,11 @@ InterpreterVariable Interpreter_hasVariable (Interpreter me, conststring32 key)
 
 InterpreterVariable Interpreter_lookUpVariable (Interpreter me, conststring32 key) {
 	Melder_assert (key);
-	conststring32 variableNameIncludingProcedureName =
-		key [0] == U'.' ? Melder_cat (my procedureNames [my callDepth], key) : key;
+	static thread_local std::u32string variableNameIncludingProcedureName;   // reused, so that looking up does not allocate
+	variableNameIncludingProcedureName. clear ();
+	if (key [0] == U'.')
+		variableNameIncludingProcedureName. append (my procedureNames [my callDepth]);
+	variableNameIncludingProcedureName. append (key);
 	auto it = my variablesMap. find (variableNameIncludingProcedureName);
 	if (it != my variablesMap. end()) {
 		return it -> second.get();
@@ -666,7 +670,7 @@ InterpreterVariable Interpreter_lookUpVariable (Interpreter me, conststring32 ke
 	/*
 	 * The variable doesn't yet exist: create a new one.
 	 */
-	autoInterpreterVariable variable = InterpreterVariable_create (variableNameIncludingProcedureName);
+	autoInterpreterVariable variable = InterpreterVariable_create (variableNameIncludingProcedureName. c_str ());
 	InterpreterVariable variable_ref = variable.get();
 	my variablesMap [variableNameIncludingProcedureName] = variable.move();
 	return variable_ref;
@@ -1533,6 +1537,8 @@ void Interpreter_run (Interpreter me, char32 *text) {
 		/*
 			Copy the parameter names and argument values into the array of variables.
 		*/
+		my compiledExpressions. clear ();   // these refer to the variables
+		my compiledExpressionsNumberOfBytes = 0;
 		my variablesMap. clear ();
 		for (ipar = 1; ipar <= my numberOfParameters; ipar ++) {
 			char32 parameter [200];
@@ -1586,6 +1592,20 @@ void Interpreter_run (Interpreter me, char32 *text) {
 		#define str(s) #s
 		Interpreter_addStringVariable (me, U"praatVersion$", U"" xstr(PRAAT_VERSION_STR));
 		Interpreter_addNumericVariable (me, U"praatVersion", PRAAT_VERSION_NUM);
+		/*
+			Profiling: the script is a frame, and each line is a frame on top of it.
+			A line that calls a procedure stays on the stack until the procedure returns.
+		*/
+		autoScriptProfilerScope profilerScope;
+		autoINTVEC profilerFrameOfLine;
+		integer profilerBaseDepth [1 + Interpreter_MAX_CALL_DEPTH];
+		int profiledCallDepth = 0;
+		if (profilerScope.depth () >= 0) {
+			const conststring32 scriptName = ( my scriptName ? my scriptName.get() : U"script" );
+			ScriptProfiler_push (ScriptProfiler_frame (scriptName));
+			profilerFrameOfLine = zero_INTVEC (numberOfLines);
+			profilerBaseDepth [0] = ScriptProfiler_depth ();
+		}
 		/*
 			Execute commands.
 		*/
@@ -1602,6 +1622,15 @@ void Interpreter_run (Interpreter me, char32 *text) {
 			try {
 				char32 c0;
 				bool fail = false;
+				if (profilerScope.depth () >= 0 && lines [lineNumber] [0] != U'\0') {
+					if (callDepth > profiledCallDepth)
+						profilerBaseDepth [callDepth] = ScriptProfiler_depth ();   // above the line that called the procedure
+					profiledCallDepth = callDepth;
+					if (profilerFrameOfLine [lineNumber] == 0)
+						profilerFrameOfLine [lineNumber] = ScriptProfiler_lineFrame (
+							my scriptName ? my scriptName.get() : U"script", lineNumber, lines [lineNumber]);
+					ScriptProfiler_popToAndPush (profilerBaseDepth [callDepth], profilerFrameOfLine [lineNumber]);
+				}
 				MelderString_copy (& command2, lines [lineNumber]);
 				c0 = command2. string [0];
 				if (c0 == U'\0')
@@ -1610,6 +1639,7 @@ void Interpreter_run (Interpreter me, char32 *text) {
 					Substitute variables.
 				*/
 				trace (U"substituting variables");
+				my lineHasSubstitutions = false;
 				for (char32 *p = & command2. string [0]; *p != U'\0'; p ++) if (*p == U'\'') {
 					/*
 						Found a left quote. Search for a matching right quote.
@@ -1652,6 +1682,7 @@ void Interpreter_run (Interpreter me, char32 *text) {
 						MelderString_append (& buffer, string, q + 1);
 						MelderString_copy (& command2, buffer.string);   // This invalidates p!! (really bad bug 20070203)
 						p = command2.string + headlen + arglen - 1;
+						my lineHasSubstitutions = true;
 					} else {
 						p = q - 1;   // go to before next quote
 					}
@@ -2806,10 +2837,54 @@ void Interpreter_stop (Interpreter me) {
 //Melder_casual (U"Interpreter_stop out: ", Melder_pointer (me));
 }
 
+/*
+	An expression in a loop is evaluated many times with the same text,
+	so we compile it only once, unless the compiled program refers to objects or to not-yet-existing variables.
+	Local variables (".x") are compiled into references to the variables of the current procedure,
+	so the key includes the name of the procedure.
+	Expressions on lines with substituted 'variables' are not kept, because their text tends to change
+	with every pass (e.g. assert a = b ; 'i'), so that keeping them would only fill the memory.
+*/
+#define Interpreter_MAXIMUM_NUMBER_OF_BYTES_OF_COMPILED_EXPRESSIONS  10'000'000
+
+static void Interpreter_runExpression (Interpreter me, conststring32 expression, int expressionType, Formula_Result *result) {
+	if (my lineHasSubstitutions || Melder_debug == 62) {
+		Formula_compile (me, nullptr, expression, expressionType, false);
+		Formula_run (0, 0, result);
+		return;
+	}
+	static thread_local std::u32string key;   // reused, so that looking up does not allocate
+	key. clear ();
+	key. push_back (char32 (U'0' + expressionType));
+	key. append (my procedureNames [my callDepth]);
+	key. push_back (U'\n');
+	key. append (expression);
+	auto it = my compiledExpressions. find (key);
+	if (it != my compiledExpressions. end ()) {
+		FormulaProgram_run (it -> second.get(), 0, 0, result);
+		return;
+	}
+	/*
+		Compile into the default program first, which is cheap because it reuses its memory;
+		only a program that will be kept gets memory of its own.
+	*/
+	Formula_compile (me, nullptr, expression, expressionType, false);
+	if (! Formula_canBeReused () ||
+		my compiledExpressionsNumberOfBytes >= Interpreter_MAXIMUM_NUMBER_OF_BYTES_OF_COMPILED_EXPRESSIONS
+	) {
+		Formula_run (0, 0, result);
+		return;
+	}
+	std::u32string newKey = key;   // because running the program can reuse `key`
+	autoFormulaProgram program = FormulaProgram_create (me, nullptr, expression, expressionType, false);
+	FormulaProgram_run (program.get(), 0, 0, result);
+	my compiledExpressionsNumberOfBytes += FormulaProgram_shrink (program.get()) + (integer) (newKey. size () * sizeof (char32));
+	my compiledExpressions [newKey] = program.move();
+}
+
 void Interpreter_voidExpression (Interpreter me, conststring32 expression) {
-	Formula_compile (me, nullptr, expression, kFormula_EXPRESSION_TYPE_NUMERIC, false);
 	Formula_Result result;
-	Formula_run (0, 0, & result);
+	Interpreter_runExpression (me, expression, kFormula_EXPRESSION_TYPE_NUMERIC, & result);
 }
 
 void Interpreter_numericExpression (Interpreter me, conststring32 expression, double *out_value) {
@@ -2817,50 +2892,44 @@ void Interpreter_numericExpression (Interpreter me, conststring32 expression, do
 	if (str32str (expression, U"(=")) {
 		*out_value = Melder_atof (expression);
 	} else {
-		Formula_compile (me, nullptr, expression, kFormula_EXPRESSION_TYPE_NUMERIC, false);
 		Formula_Result result;
-		Formula_run (0, 0, & result);
+		Interpreter_runExpression (me, expression, kFormula_EXPRESSION_TYPE_NUMERIC, & result);
 		*out_value = result. numericResult;
 	}
 }
 
 void Interpreter_numericVectorExpression (Interpreter me, conststring32 expression, VEC *out_value, bool *out_owned) {
-	Formula_compile (me, nullptr, expression, kFormula_EXPRESSION_TYPE_NUMERIC_VECTOR, false);
 	Formula_Result result;
-	Formula_run (0, 0, & result);
+	Interpreter_runExpression (me, expression, kFormula_EXPRESSION_TYPE_NUMERIC_VECTOR, & result);
 	*out_value = result. numericVectorResult;
 	*out_owned = result. owned;
 	result. owned = false;
 }
 
 void Interpreter_numericMatrixExpression (Interpreter me, conststring32 expression, MAT *out_value, bool *out_owned) {
-	Formula_compile (me, nullptr, expression, kFormula_EXPRESSION_TYPE_NUMERIC_MATRIX, false);
 	Formula_Result result;
-	Formula_run (0, 0, & result);
+	Interpreter_runExpression (me, expression, kFormula_EXPRESSION_TYPE_NUMERIC_MATRIX, & result);
 	*out_value = result. numericMatrixResult;
 	*out_owned = result. owned;
 	result. owned = false;
 }
 
 autostring32 Interpreter_stringExpression (Interpreter me, conststring32 expression) {
-	Formula_compile (me, nullptr, expression, kFormula_EXPRESSION_TYPE_STRING, false);
 	Formula_Result result;
-	Formula_run (0, 0, & result);
+	Interpreter_runExpression (me, expression, kFormula_EXPRESSION_TYPE_STRING, & result);
 	return result. stringResult.move();
 }
 
 void Interpreter_stringArrayExpression (Interpreter me, conststring32 expression, STRVEC *out_value, bool *out_owned) {
-	Formula_compile (me, nullptr, expression, kFormula_EXPRESSION_TYPE_STRING_ARRAY, false);
 	Formula_Result result;
-	Formula_run (0, 0, & result);
+	Interpreter_runExpression (me, expression, kFormula_EXPRESSION_TYPE_STRING_ARRAY, & result);
 	*out_value = result. stringArrayResult;
 	*out_owned = result. owned;
 	result. owned = false;
 }
 
 void Interpreter_anyExpression (Interpreter me, conststring32 expression, Formula_Result *out_result) {
-	Formula_compile (me, nullptr, expression, kFormula_EXPRESSION_TYPE_UNKNOWN, false);
-	Formula_run (0, 0, out_result);
+	Interpreter_runExpression (me, expression, kFormula_EXPRESSION_TYPE_UNKNOWN, out_result);
 }
 
 /* End of file Interpreter.cpp */
@@ -2,7 +2,7 @@
 #define _Interpreter_h_
 /* Interpreter.h
  *
- * Copyright (C) 1993-2018,2020 Paul Boersma
+ * Copyright (C) 1993-2018,2020,2021 Paul Boersma
  *
  * This code is free software; you can redistribute it and/or modify
  * it under the terms of the GNU General Public License as published by
@@ -56,6 +56,10 @@ Thing_define (Interpreter, Thing) {
 	char32 dialogTitle [1+Interpreter_MAX_DIALOG_TITLE_LENGTH], procedureNames [1+Interpreter_MAX_CALL_DEPTH] [100];
 	std::unordered_map <std::u32string, autoInterpreterVariable> variablesMap;
 	bool running, stopped;
+	std::unordered_map <std::u32string, autoFormulaProgram> compiledExpressions;   // by type, procedure and text; valid until variablesMap is cleared
+	integer compiledExpressionsNumberOfBytes;
+	bool lineHasSubstitutions;   // then its expressions are not worth keeping: the next pass will probably have a different text
+	autostring32 scriptName;   // for the profiler; null if the script does not come from a file
 };
 
 autoInterpreter Interpreter_create (conststring32 environmentName, ClassInfo editorClass);
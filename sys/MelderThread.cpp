@@ -0,0 +1,241 @@
+/* MelderThread.cpp
+ *
+ * Copyright (C) 2021 Paul Boersma
+ *
+ * This code is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or (at
+ * your option) any later version.
+ *
+ * This code is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ * See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this work. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "MelderThread.h"
+#include <mutex>
+#include <condition_variable>
+#include <exception>
+
+integer MelderThread_getNumberOfThreads () {
+	static integer numberOfThreads = 0;
+	static std::once_flag once;
+	std::call_once (once, [] () {
+		const conststring32 environmentSetting = Melder_getenv (U"PRAAT_NUMBER_OF_THREADS");
+		numberOfThreads = ( environmentSetting ? Melder_atoi (environmentSetting) : 0 );
+		if (numberOfThreads <= 0)
+			numberOfThreads = MelderThread_getNumberOfProcessors ();
+		Melder_clipLeft (1_integer, & numberOfThreads);
+	});
+	return numberOfThreads;
+}
+
+namespace {
+
+/*
+	The tasks that a thread still has to perform: firstTask .. lastTask.
+	The owner takes tasks from the front, thieves take the back half.
+*/
+struct TaskRange {
+	std::mutex mutex;
+	integer firstTask = 1, lastTask = 0;
+};
+
+struct Batch {
+	std::function <void (integer threadNumber, integer taskNumber)> const *task;
+	integer numberOfThreads;
+	std::unique_ptr <TaskRange []> ranges;
+	std::atomic <bool> cancelled { false };
+	std::mutex exceptionMutex;
+	std::exception_ptr exception;
+
+	void perform (integer threadNumber, integer taskNumber) {
+		if (cancelled)
+			return;
+		try {
+			(*task) (threadNumber, taskNumber);
+		} catch (...) {
+			std::lock_guard <std::mutex> lock (exceptionMutex);
+			if (! exception)
+				exception = std::current_exception ();
+			cancelled = true;
+		}
+	}
+	bool takeOwnTask (integer threadNumber, integer *taskNumber) {
+		TaskRange& range = ranges [integer_to_uinteger (threadNumber - 1)];
+		std::lock_guard <std::mutex> lock (range.mutex);
+		if (range.firstTask > range.lastTask)
+			return false;
+		*taskNumber = range.firstTask ++;
+		return true;
+	}
+	bool steal (integer threadNumber) {
+		for (integer offset = 1; offset < numberOfThreads; offset ++) {
+			const integer victimNumber = (threadNumber - 1 + offset) % numberOfThreads + 1;
+			TaskRange& victim = ranges [integer_to_uinteger (victimNumber - 1)];
+			integer firstStolenTask, lastStolenTask;
+			{
+				std::lock_guard <std::mutex> lock (victim.mutex);
+				const integer numberOfRemainingTasks = victim.lastTask - victim.firstTask + 1;
+				if (numberOfRemainingTasks <= 0)
+					continue;
+				lastStolenTask = victim.lastTask;
+				firstStolenTask = lastStolenTask - (numberOfRemainingTasks + 1) / 2 + 1;
+				victim.lastTask = firstStolenTask - 1;
+			}
+			TaskRange& own = ranges [integer_to_uinteger (threadNumber - 1)];
+			std::lock_guard <std::mutex> lock (own.mutex);
+			own.firstTask = firstStolenTask;
+			own.lastTask = lastStolenTask;
+			return true;
+		}
+		return false;
+	}
+	void work (integer threadNumber) {
+		do {
+			integer taskNumber;
+			while (takeOwnTask (threadNumber, & taskNumber))
+				perform (threadNumber, taskNumber);
+		} while (steal (threadNumber));
+	}
+};
+
+thread_local bool theCurrentThreadIsAPoolThread = false;
+
+class ThreadPool {
+	std::vector <std::thread> workers;
+	std::mutex mutex;
+	std::condition_variable workAvailable, workerLeft;
+	Batch *batch = nullptr;
+	integer numberOfThreadsInBatch = 0;   // including the calling thread
+	integer numberOfWorkersInBatch = 0;   // that have not left yet
+	uinteger generation = 0;
+	bool stopping = false;
+
+	void workerLoop () {
+		theCurrentThreadIsAPoolThread = true;
+		uinteger lastGeneration = 0;
+		for (;;) {
+			Batch *myBatch;
+			integer threadNumber;
+			{
+				std::unique_lock <std::mutex> lock (mutex);
+				workAvailable.wait (lock, [&] { return stopping || generation != lastGeneration; });
+				if (stopping)
+					return;
+				lastGeneration = generation;
+				if (! batch || numberOfThreadsInBatch >= batch -> numberOfThreads)
+					continue;   // this batch needs no more threads, or has already finished
+				myBatch = batch;
+				threadNumber = ++ numberOfThreadsInBatch;
+				numberOfWorkersInBatch += 1;
+			}
+			myBatch -> work (threadNumber);
+			{
+				std::lock_guard <std::mutex> lock (mutex);
+				numberOfWorkersInBatch -= 1;
+			}
+			workerLeft.notify_all ();
+		}
+	}
+public:
+	std::mutex busy;   // one batch at a time
+
+	~ThreadPool () {
+		{
+			std::lock_guard <std::mutex> lock (mutex);
+			stopping = true;
+		}
+		workAvailable.notify_all ();
+		for (std::thread& worker : workers)
+			worker. join ();
+	}
+	void run (Batch *newBatch) {
+		if (workers.empty ()) {
+			const integer numberOfWorkers = MelderThread_getNumberOfThreads () - 1;
+			for (integer iworker = 1; iworker <= numberOfWorkers; iworker ++)
+				workers. emplace_back (& ThreadPool::workerLoop, this);
+		}
+		{
+			std::lock_guard <std::mutex> lock (mutex);
+			batch = newBatch;
+			numberOfThreadsInBatch = 1;   // the calling thread
+			generation += 1;
+		}
+		workAvailable.notify_all ();
+		theCurrentThreadIsAPoolThread = true;
+		newBatch -> perform (1, 1);
+		newBatch -> work (1);
+		theCurrentThreadIsAPoolThread = false;
+		/*
+			No more threads can join after this, and the batch lives on until all threads have left it.
+		*/
+		std::unique_lock <std::mutex> lock (mutex);
+		batch = nullptr;
+		workerLeft.wait (lock, [&] { return numberOfWorkersInBatch == 0; });
+	}
+};
+
+ThreadPool thePool;
+
+}
+
+/*
+	The old model (Melder_debug 57): new threads at every call, each with a fixed range of tasks.
+*/
+static void runTasks_spawn (Batch *batch) {
+	const integer numberOfThreads = batch -> numberOfThreads;
+	std::vector <std::thread> thread (integer_to_uinteger (numberOfThreads - 1));
+	auto workOnFixedRange = [=] (integer threadNumber) {
+		theCurrentThreadIsAPoolThread = true;
+		TaskRange& range = batch -> ranges [integer_to_uinteger (threadNumber - 1)];
+		for (integer taskNumber = range.firstTask; taskNumber <= range.lastTask; taskNumber ++)
+			batch -> perform (threadNumber, taskNumber);
+	};
+	for (integer ithread = 2; ithread <= numberOfThreads; ithread ++)
+		thread [integer_to_uinteger (ithread - 2)] = std::thread (workOnFixedRange, ithread);
+	batch -> perform (1, 1);
+	workOnFixedRange (1);
+	theCurrentThreadIsAPoolThread = false;
+	for (std::thread& t : thread)
+		t. join ();
+}
+
+void MelderThread_runTasks (integer numberOfTasks, integer maximumNumberOfThreads,
+	std::function <void (integer threadNumber, integer taskNumber)> const& task)
+{
+	if (numberOfTasks < 1)
+		return;
+	const integer numberOfThreads = std::min ({ numberOfTasks, maximumNumberOfThreads, MelderThread_getNumberOfThreads () });
+	std::unique_lock <std::mutex> poolLock (thePool.busy, std::defer_lock);
+	if (numberOfThreads <= 1 || theCurrentThreadIsAPoolThread || ! poolLock.try_lock ()) {
+		for (integer taskNumber = 1; taskNumber <= numberOfTasks; taskNumber ++)
+			task (1, taskNumber);
+		return;
+	}
+	Batch batch;
+	batch.task = & task;
+	batch.numberOfThreads = numberOfThreads;
+	batch.ranges = std::unique_ptr <TaskRange []> (new TaskRange [integer_to_uinteger (numberOfThreads)]);
+	/*
+		Task 1 goes to the calling thread; tasks 2 .. numberOfTasks are divided evenly.
+	*/
+	const integer numberOfRemainingTasks = numberOfTasks - 1;
+	for (integer ithread = 1; ithread <= numberOfThreads; ithread ++) {
+		TaskRange& range = batch.ranges [integer_to_uinteger (ithread - 1)];
+		range.firstTask = 2 + (ithread - 1) * numberOfRemainingTasks / numberOfThreads;
+		range.lastTask = 1 + ithread * numberOfRemainingTasks / numberOfThreads;
+	}
+	if (Melder_debug == 57)
+		runTasks_spawn (& batch);
+	else
+		thePool.run (& batch);
+	if (batch.exception)
+		std::rethrow_exception (batch.exception);
+}
+
+/* End of file MelderThread.cpp */
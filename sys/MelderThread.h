@@ -2,7 +2,7 @@
 #define _MelderThread_h_
 /* MelderThread.h
  *
- * Copyright (C) 2014-2018,2020 Paul Boersma
+ * Copyright (C) 2014-2018,2020,2021 Paul Boersma
  *
  * This code is free software; you can redistribute it and/or modify
  * it under the terms of the GNU General Public License as published by
@@ -21,30 +21,122 @@
 #include <vector>
 #include "Thing.h"
 #include <thread>
+#include <atomic>
+#include <memory>
+#include <functional>
 
 inline integer MelderThread_getNumberOfProcessors () {
 	return uinteger_to_integer (std::thread::hardware_concurrency ());
 }
 
+/*
+	The process-wide thread pool.
+
+	The pool is started at the first parallel call, and its threads then wait for work
+	until Praat exits, so that a script that analyses thousands of short sounds
+	does not pay for creating and joining threads at every analysis.
+
+	The number of threads (including the calling thread) is the number of processors,
+	unless the environment variable PRAAT_NUMBER_OF_THREADS is set to a positive number.
+*/
+integer MelderThread_getNumberOfThreads ();
+
+/*
+	MelderThread_runTasks: perform `task (threadNumber, taskNumber)` for taskNumber = 1 .. numberOfTasks,
+	using at most `maximumNumberOfThreads` threads of the pool, numbered from 1 to maximumNumberOfThreads.
+
+	The calling thread is thread 1, and it always performs task 1 first, so that this task can report progress.
+	The remaining tasks are divided evenly over the threads, and a thread that runs out of tasks
+	steals half of the remaining tasks of another thread, so that threads that happen to get cheap tasks
+	take on more of the work.
+
+	If a task throws, the tasks that have not yet started are skipped,
+	and the exception is rethrown on the calling thread after all running tasks have finished.
+	However, the Melder error buffer is process-wide and not locked, so only thread 1 can safely call Melder_throw.
+	A task that runs on another thread therefore has to report expected failures (e.g. a frame that cannot be analysed,
+	or a formula error) by return value or in a flag, which the caller turns into a message after the tasks are done;
+	a MelderError thrown on another thread (e.g. when memory runs out) still stops the tasks, but its message may be garbled.
+
+	A call from within a task (i.e. a nested call), or from a second thread while the pool is busy,
+	performs all tasks on the calling thread.
+*/
+void MelderThread_runTasks (integer numberOfTasks, integer maximumNumberOfThreads,
+	std::function <void (integer threadNumber, integer taskNumber)> const& task);
+
 template <class T> void MelderThread_run (void (*func) (T *), autoSomeThing <T> *args, integer numberOfThreads) {
-	uinteger unsignedNumberOfThreads = integer_to_uinteger (numberOfThreads);
-	if (unsignedNumberOfThreads == 1) {
-		func (args [0].get());
-	} else {
-		std::vector <std::thread> thread (unsignedNumberOfThreads);
-		try {
-			for (uinteger ithread = 1; ithread < unsignedNumberOfThreads; ithread ++)
-				thread [ithread - 1] = std::thread (func, args [ithread - 1].get());
-			func (args [unsignedNumberOfThreads - 1].get());
-		} catch (MelderError) {
-			for (uinteger ithread = 1; ithread < unsignedNumberOfThreads; ithread ++)
-				if (thread [ithread - 1]. joinable ())
-					thread [ithread - 1]. join ();
-			throw;
+	/*
+		The last argument belongs to the main thread (it shows progress), so it goes into task 1.
+	*/
+	MelderThread_runTasks (numberOfThreads, numberOfThreads,
+		[func, args, numberOfThreads] (integer /* threadNumber */, integer taskNumber) {
+			func (args [taskNumber == 1 ? numberOfThreads - 1 : taskNumber - 2].get());
 		}
-		for (uinteger ithread = 1; ithread < unsignedNumberOfThreads; ithread ++)
-			thread [ithread - 1]. join ();
-	}
+	);
+}
+
+/*
+	MelderThread_runFrames: a frame-parallel driver for short-term analyses.
+
+	The frames 1 .. numberOfFrames are cut into chunks of `numberOfFramesPerChunk` consecutive frames,
+	which are the tasks for MelderThread_runTasks ().
+
+	Each thread owns a `Workspace`, i.e. its own scratch space (FFT tables, frame buffers, ...),
+	which is default-constructed and then set up by `initializeWorkspace (workspace)`
+	on the calling thread, before any analysis starts.
+	Then `analyseFrame (workspace, iframe)` is called exactly once for every frame.
+	As long as `analyseFrame` writes only to its own workspace and to its own frame of the result,
+	the result does not depend on the number of threads or on the order in which the chunks are handed out.
+
+	Only the calling thread reports progress, with `progressMessage`.
+	If the user cancels (i.e. Melder_progress throws), the other threads stop after their current chunk,
+	and the error is rethrown on the calling thread.
+	As with MelderThread_runTasks (), `analyseFrame` must not throw for frames that cannot be analysed,
+	because it may run on any thread; it should count such frames (e.g. in a std::atomic <integer>),
+	so that the caller can warn or throw after the analysis.
+
+	MelderThread_runFrameChunks is the same, except that it calls `analyseChunk (workspace, firstFrame, lastFrame)`
+	once for every chunk, so that an analysis can handle all frames of a chunk at once
+	(e.g. with NUMfft_forward_batch); the workspace can then hold `numberOfFramesPerChunk` frames.
+*/
+template <typename Workspace, typename InitializeWorkspace, typename AnalyseChunk>
+void MelderThread_runFrameChunks (integer numberOfFrames, integer numberOfFramesPerChunk,
+	InitializeWorkspace initializeWorkspace, AnalyseChunk analyseChunk, conststring32 progressMessage)
+{
+	if (numberOfFrames < 1)
+		return;
+	Melder_assert (numberOfFramesPerChunk >= 1);
+	const integer numberOfChunks = (numberOfFrames - 1) / numberOfFramesPerChunk + 1;
+	const integer numberOfThreads = std::min (numberOfChunks, MelderThread_getNumberOfThreads ());
+
+	std::unique_ptr <Workspace []> workspaces (new Workspace [integer_to_uinteger (numberOfThreads)]);
+	for (integer ithread = 1; ithread <= numberOfThreads; ithread ++)
+		initializeWorkspace (workspaces [integer_to_uinteger (ithread - 1)]);
+
+	std::atomic <integer> numberOfFramesDone (0);
+	MelderThread_runTasks (numberOfChunks, numberOfThreads, [&] (integer threadNumber, integer chunkNumber) {
+		Workspace& workspace = workspaces [integer_to_uinteger (threadNumber - 1)];
+		const integer firstFrame = 1 + (chunkNumber - 1) * numberOfFramesPerChunk;
+		const integer lastFrame = std::min (firstFrame + numberOfFramesPerChunk - 1, numberOfFrames);
+		analyseChunk (workspace, firstFrame, lastFrame);
+		const integer done = ( numberOfFramesDone += lastFrame - firstFrame + 1 );
+		if (threadNumber == 1)
+			Melder_progress (double (done) / (numberOfFrames + 1.0),
+					progressMessage, U": frame ", done, U" out of ", numberOfFrames, U".");
+	});
+}
+
+template <typename Workspace, typename InitializeWorkspace, typename AnalyseFrame>
+void MelderThread_runFrames (integer numberOfFrames, integer numberOfFramesPerChunk,
+	InitializeWorkspace initializeWorkspace, AnalyseFrame analyseFrame, conststring32 progressMessage)
+{
+	Melder_clipLeft (1_integer, & numberOfFramesPerChunk);
+	MelderThread_runFrameChunks <Workspace> (numberOfFrames, numberOfFramesPerChunk, initializeWorkspace,
+		[&] (Workspace& workspace, integer firstFrame, integer lastFrame) {
+			for (integer iframe = firstFrame; iframe <= lastFrame; iframe ++)
+				analyseFrame (workspace, iframe);
+		},
+		progressMessage
+	);
 }
 
 /* End of file MelderThread.h */
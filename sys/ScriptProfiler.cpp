@@ -0,0 +1,224 @@
+/* ScriptProfiler.cpp
+ *
+ * Copyright (C) 2021 Paul Boersma
+ *
+ * This code is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or (at
+ * your option) any later version.
+ *
+ * This code is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ * See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this work. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "ScriptProfiler.h"
+#include <string>
+#include <vector>
+#include <unordered_map>
+#include <algorithm>
+
+namespace {
+
+struct Frame {
+	std::u32string name;   // without semicolons and line breaks, which have a meaning in folded stacks
+	integer hits = 0;
+	double selfTime = 0.0, totalTime = 0.0;
+	int64 selfAllocations = 0, totalAllocations = 0;
+};
+
+/*
+	A call path is a frame on top of a shorter call path.
+*/
+struct Path {
+	integer parent;   // 0 for a frame at the bottom of the stack
+	integer frame;
+	double selfTime = 0.0;
+};
+
+struct Activation {
+	integer frame, path;
+	double startTime;
+	int64 startAllocations;
+};
+
+std::vector <Frame> theFrames;   // frame number `iframe` is at index `iframe - 1`
+std::unordered_map <std::u32string, integer> theFrameNumbers;
+std::vector <Path> thePaths;   // path number `ipath` is at index `ipath - 1`
+std::unordered_map <uint64, integer> thePathNumbers;   // by parent and frame
+std::vector <Activation> theStack;
+double theLastTime = 0.0;
+int64 theLastAllocations = 0;
+bool theProfilerIsOn = false;
+structMelderFile theFile { };
+
+/*
+	Attribute the time and the allocations since the previous event to the frame on top of the stack.
+*/
+void chargeTopFrame () {
+	const double now = Melder_clock ();
+	const int64 allocations = Melder_allocationCount ();
+	if (theStack.size () > 0) {
+		Frame& top = theFrames [uinteger (theStack.back (). frame - 1)];
+		top.selfTime += now - theLastTime;
+		top.selfAllocations += allocations - theLastAllocations;
+		thePaths [uinteger (theStack.back (). path - 1)]. selfTime += now - theLastTime;
+	}
+	theLastTime = now;
+	theLastAllocations = allocations;
+}
+
+void writeProfile () {
+	autoMelderString text;
+	const conststring32 fileName = MelderFile_name (& theFile);
+	const integer fileNameLength = str32len (fileName);
+	const bool folded = ( fileNameLength >= 7 && str32equ (fileName + fileNameLength - 7, U".folded") );
+	if (folded) {
+		std::vector <integer> framesOfPath;
+		for (const Path& path : thePaths) {
+			const int64 microseconds = Melder_iround (path.selfTime * 1e6);
+			if (microseconds <= 0)
+				continue;
+			framesOfPath. clear ();
+			for (const Path *p = & path; ; p = & thePaths [uinteger (p -> parent - 1)]) {
+				framesOfPath. push_back (p -> frame);
+				if (p -> parent == 0)
+					break;
+			}
+			for (auto it = framesOfPath.rbegin (); it != framesOfPath.rend (); ++ it) {
+				if (it != framesOfPath.rbegin ())
+					MelderString_appendCharacter (& text, U';');
+				MelderString_append (& text, theFrames [uinteger (*it - 1)]. name.c_str ());
+			}
+			MelderString_append (& text, U" ", microseconds, U"\n");
+		}
+	} else {
+		std::vector <integer> order (theFrames.size ());
+		for (uinteger i = 0; i < order.size (); i ++)
+			order [i] = integer (i);
+		std::stable_sort (order.begin (), order.end (), [] (integer a, integer b) {
+			return theFrames [uinteger (a)]. selfTime > theFrames [uinteger (b)]. selfTime;
+		});
+		MelderString_append (& text, U"self time (µs)\ttotal time (µs)\thits\tself allocations\ttotal allocations\tline or command\n");
+		for (const integer i : order) {
+			const Frame& frame = theFrames [uinteger (i)];
+			MelderString_append (& text,
+				Melder_iround (frame.selfTime * 1e6), U"\t", Melder_iround (frame.totalTime * 1e6), U"\t", frame.hits, U"\t",
+				frame.selfAllocations, U"\t", frame.totalAllocations, U"\t", frame.name.c_str (), U"\n"
+			);
+		}
+	}
+	MelderFile_writeText (& theFile, text.string, kMelder_textOutputEncoding::UTF8);
+}
+
+}
+
+bool ScriptProfiler_isOn () {
+	static bool initialized = false;
+	if (! initialized) {
+		initialized = true;
+		const conststring32 fileName = Melder_getenv (U"PRAAT_SCRIPT_PROFILE");
+		if (fileName && fileName [0] != U'\0') {
+			try {
+				Melder_relativePathToFile (fileName, & theFile);
+				theProfilerIsOn = true;
+			} catch (MelderError) {
+				Melder_flushError (U"Script profiling is off.");
+			}
+		}
+	}
+	return theProfilerIsOn;
+}
+
+integer ScriptProfiler_frame (conststring32 name) {
+	auto it = theFrameNumbers. find (name);
+	if (it != theFrameNumbers. end ())
+		return it -> second;
+	Frame frame;
+	for (const char32 *p = & name [0]; *p != U'\0'; p ++)
+		frame.name. push_back (*p == U';' ? U',' : Melder_isVerticalSpace (*p) || *p == U'\t' ? U' ' : *p);
+	theFrames. push_back (frame);
+	const integer frameNumber = integer (theFrames.size ());
+	theFrameNumbers [name] = frameNumber;
+	return frameNumber;
+}
+
+integer ScriptProfiler_lineFrame (conststring32 scriptName, integer lineNumber, conststring32 lineText) {
+	constexpr integer maximumTextLength = 60;
+	autoMelderString name;
+	MelderString_append (& name, scriptName, U":", lineNumber, U"  ");
+	if (str32len (lineText) > maximumTextLength) {
+		for (integer i = 0; i < maximumTextLength; i ++)
+			MelderString_appendCharacter (& name, lineText [i]);
+		MelderString_append (& name, U"...");
+	} else {
+		MelderString_append (& name, lineText);
+	}
+	return ScriptProfiler_frame (name.string);
+}
+
+integer ScriptProfiler_depth () {
+	return integer (theStack.size ());
+}
+
+static void push (integer frame) {
+	Melder_assert (frame >= 1 && frame <= integer (theFrames.size ()));
+	theFrames [uinteger (frame - 1)]. hits += 1;
+	const integer parent = ( theStack.size () > 0 ? theStack.back (). path : 0 );
+	const uint64 key = (uint64 (parent) << 32) | uint64 (frame);
+	integer& path = thePathNumbers [key];
+	if (path == 0) {
+		thePaths. push_back ({ parent, frame });
+		path = integer (thePaths.size ());
+	}
+	theStack. push_back ({ frame, path, theLastTime, theLastAllocations });
+}
+
+static void popTo (integer depth) {
+	while (integer (theStack.size ()) > depth) {
+		const Activation activation = theStack.back ();
+		theStack. pop_back ();
+		/*
+			In a recursive procedure, count the time only once, namely for the outermost call.
+		*/
+		const bool isRecursive = std::any_of (theStack.begin (), theStack.end (),
+				[&] (const Activation& outer) { return outer.frame == activation.frame; });
+		if (! isRecursive) {
+			Frame& frame = theFrames [uinteger (activation.frame - 1)];
+			frame.totalTime += theLastTime - activation.startTime;
+			frame.totalAllocations += theLastAllocations - activation.startAllocations;
+		}
+	}
+	if (theStack.size () == 0) {
+		try {
+			writeProfile ();
+		} catch (MelderError) {
+			Melder_flushError (U"Script profile not written.");
+		}
+	}
+}
+
+void ScriptProfiler_push (integer frame) {
+	chargeTopFrame ();
+	push (frame);
+}
+
+void ScriptProfiler_popTo (integer depth) {
+	if (integer (theStack.size ()) <= depth)
+		return;
+	chargeTopFrame ();
+	popTo (depth);
+}
+
+void ScriptProfiler_popToAndPush (integer depth, integer frame) {
+	Melder_assert (depth >= 1);   // otherwise the profile would be written in between
+	chargeTopFrame ();
+	popTo (depth);
+	push (frame);
+}
+
+/* End of file ScriptProfiler.cpp */
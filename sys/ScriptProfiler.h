@@ -0,0 +1,82 @@
+#ifndef _ScriptProfiler_h_
+#define _ScriptProfiler_h_
+/* ScriptProfiler.h
+ *
+ * Copyright (C) 2021 Paul Boersma
+ *
+ * This code is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or (at
+ * your option) any later version.
+ *
+ * This code is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ * See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this work. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "melder.h"
+
+/*
+	Where does a script spend its time?
+
+	If the environment variable PRAAT_SCRIPT_PROFILE is set to a file name when Praat starts a script,
+	the interpreter records, for every script line and every menu command that it executes,
+	how often it was executed, how much wall-clock time it took, and how many memory blocks it allocated.
+	Time spent in a line that calls a procedure includes the time spent in that procedure;
+	time spent in a command that runs a script includes the time spent in that script.
+
+	Every time the outermost script finishes, the profile of all scripts run so far is written to the file:
+	if the name of the file ends in ".folded", as "folded stacks" (one line per call path,
+	with the time in microseconds that was spent in the last frame of that path),
+	which is the input format for flame-graph programs;
+	otherwise, as a table sorted by the time spent in each line or command itself.
+	A relative file name is taken relative to the folder of the first script.
+
+	The profiler is meant for scripts, which are run on the main thread;
+	it is not thread-safe.
+*/
+
+bool ScriptProfiler_isOn ();
+
+/*
+	The frames are script lines and commands, identified by an integer.
+	ScriptProfiler_frame () returns the number of the frame with the given name, creating a new frame if needed.
+*/
+integer ScriptProfiler_frame (conststring32 name);
+integer ScriptProfiler_lineFrame (conststring32 scriptName, integer lineNumber, conststring32 lineText);
+
+/*
+	ScriptProfiler_push () makes a frame the current frame, on top of the frames that are being executed;
+	ScriptProfiler_popTo () finishes all frames above the given stack depth;
+	when the stack becomes empty, the profile is written to the file.
+	ScriptProfiler_popToAndPush () does both with a single reading of the clock,
+	which is what the interpreter does at every line.
+*/
+integer ScriptProfiler_depth ();
+void ScriptProfiler_push (integer frame);
+void ScriptProfiler_popTo (integer depth);
+void ScriptProfiler_popToAndPush (integer depth, integer frame);
+
+/*
+	Finishes, at the end of its scope, all frames that were pushed within that scope,
+	also if an exception occurs.
+*/
+class autoScriptProfilerScope {
+	integer _depth;
+public:
+	autoScriptProfilerScope () : _depth (ScriptProfiler_isOn () ? ScriptProfiler_depth () : -1) { }
+	~autoScriptProfilerScope () {
+		if (_depth >= 0)
+			ScriptProfiler_popTo (_depth);
+	}
+	integer depth () const { return _depth; }
+	autoScriptProfilerScope (const autoScriptProfilerScope&) = delete;
+	autoScriptProfilerScope& operator= (const autoScriptProfilerScope&) = delete;
+};
+
+/* End of file ScriptProfiler.h */
+#endif
@@ -1,6 +1,6 @@
 /* praat_script.cpp
  *
- * Copyright (C) 1993-2020 Paul Boersma
+ * Copyright (C) 1993-2021 Paul Boersma
  *
  * This code is free software; you can redistribute it and/or modify
  * it under the terms of the GNU General Public License as published by
@@ -22,6 +22,7 @@
 #include "sendsocket.h"
 #include "UiPause.h"
 #include "DemoEditor.h"
+#include "ScriptProfiler.h"
 
 static int praat_findObjectFromString (Interpreter interpreter, conststring32 string) {
 	try {
@@ -452,6 +453,9 @@ int praat_executeCommand (Interpreter interpreter, char32 *command) {
 			colon [0] = colon [1] = colon [2] = U'.';
 			colon [3] = U'\0';
 		}
+		autoScriptProfilerScope profilerScope;
+		if (profilerScope.depth () >= 0)
+			ScriptProfiler_push (ScriptProfiler_frame (hasColon ? command2 : command));
 		if (theCurrentPraatObjects == & theForegroundPraatObjects && praatP. editor) {
 			if (hasColon) {
 				Editor_doMenuCommand (praatP. editor, command2, narg, args, nullptr, interpreter);
@@ -559,6 +563,7 @@ void praat_executeScriptFromFile (MelderFile file, conststring32 arguments) {
 		autoMelderFileSetDefaultDir dir (file);   // so that relative file names can be used inside the script
 		Melder_includeIncludeFiles (& text);
 		autoInterpreter interpreter = Interpreter_createFromEnvironment (praatP.editor);
+		interpreter -> scriptName = Melder_dup (MelderFile_name (file));
 		if (arguments) {
 			Interpreter_readParameters (interpreter.get(), text.get());
 			Interpreter_getArgumentsFromString (interpreter.get(), arguments);
@@ -580,6 +585,7 @@ void praat_executeScriptFromFileName (conststring32 fileName, integer narg, Stac
 		autoMelderFileSetDefaultDir dir (& file);   // so that relative file names can be used inside the script
 		Melder_includeIncludeFiles (& text);
 		autoInterpreter interpreter = Interpreter_createFromEnvironment (praatP.editor);
+		interpreter -> scriptName = Melder_dup (MelderFile_name (& file));
 		Interpreter_readParameters (interpreter.get(), text.get());
 		Interpreter_getArgumentsFromArgs (interpreter.get(), narg, args);
 		Interpreter_run (interpreter.get(), text.get());
@@ -650,6 +656,7 @@ void praat_executeScriptFromDialog (UiForm dia) {
 	autoMelderFileSetDefaultDir dir (& file);
 	Melder_includeIncludeFiles (& text);
 	autoInterpreter interpreter = Interpreter_createFromEnvironment (praatP.editor);
+	interpreter -> scriptName = Melder_dup (MelderFile_name (& file));
 	Interpreter_readParameters (interpreter.get(), text.get());
 	Interpreter_getArgumentsFromDialog (interpreter.get(), dia);
 	autoPraatBackground background;